@@ -37,7 +37,7 @@ int main(int argc, char **argv) {
 	int cflags = REG_NOSUB | REG_EXTENDED;
 	int found = 0, count = 0;
 
-	plan_tests(33);
+	plan_tests(40);
 
 	ok(np_find_name(exclude_filesystem, "/var/log") == false, "/var/log not in list");
 	np_add_name(&exclude_filesystem, "/var/log");
@@ -94,6 +94,7 @@ int main(int argc, char **argv) {
 	np_add_parameter(&paths, "/tmp");
 	np_add_parameter(&paths, "/home/tonvoon");
 	np_add_parameter(&paths, "/dev/c2t0d0s0");
+	np_add_parameter(&paths, "/homework");
 
 	np_set_best_match(paths, dummy_mount_list, false);
 	for (p = paths; p; p = p->name_next) {
@@ -109,6 +110,8 @@ int main(int argc, char **argv) {
 			ok(temp_me && !strcmp(temp_me->me_mountdir, "/home"), "/home/tonvoon got right best match: /home");
 		} else if (!strcmp(p->name, "/dev/c2t0d0s0")) {
 			ok(temp_me && !strcmp(temp_me->me_devname, "/dev/c2t0d0s0"), "/dev/c2t0d0s0 got right best match: /dev/c2t0d0s0");
+		} else if (!strcmp(p->name, "/homework")) {
+			ok(temp_me && !strcmp(temp_me->me_mountdir, "/"), "/homework got right best match: /");
 		}
 	}
 
@@ -173,6 +176,43 @@ int main(int argc, char **argv) {
 	ok(found == 0, "last (/home) element successfully deleted");
 	ok(count == 2, "two elements remaining");
 
+	{
+		struct name_hash hash = {0};
+		struct parameter_index index = {0};
+		char names[1000][8];
+		int missing = 0;
+
+		ok(np_name_hash_get(&hash, "/var") == NULL, "empty hash");
+		np_name_hash_put(&hash, "/var", "a");
+		np_name_hash_put(&hash, "/var", "b");
+		ok(hash.count == 1 && !strcmp(np_name_hash_get(&hash, "/var"), "b"), "put replaces the value");
+
+		for (int i = 0; i < 1000; i++) {
+			snprintf(names[i], sizeof(names[i]), "/m%d", i);
+			np_name_hash_put(&hash, names[i], names[i]);
+		}
+		for (int i = 0; i < 1000; i += 2)
+			np_name_hash_del(&hash, names[i]);
+		for (int i = 0; i < 1000; i++) {
+			if ((np_name_hash_get(&hash, names[i]) != NULL) != (i % 2 == 1))
+				missing++;
+		}
+		ok(missing == 0 && hash.count == 501, "entries survive deleting their neighbours");
+		np_name_hash_free(&hash);
+
+		paths = NULL;
+		np_add_parameter_indexed(&paths, &index, "/var");
+		p = np_add_parameter_indexed(&paths, &index, "/home");
+		np_add_parameter_indexed(&paths, &index, "/tmp");
+		ok(np_find_parameter_indexed(&index, "/home") == p, "indexed parameter found");
+		np_del_parameter_indexed(&index, p, paths);
+		ok(np_find_parameter_indexed(&index, "/home") == NULL, "deleted parameter not found");
+		np_del_parameter_indexed(&index, paths->name_next, paths);
+		np_add_parameter_indexed(&paths, &index, "/usr");
+		ok(paths->name_next && !strcmp(paths->name_next->name, "/usr") && paths->name_next->name_next == NULL,
+		   "appended after deleting the last element");
+	}
+
 	return exit_status();
 }
 
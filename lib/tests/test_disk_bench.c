@@ -0,0 +1,198 @@
+/*****************************************************************************
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *****************************************************************************/
+
+/* Path and mount matching with a synthetic mount table as found on container
+ * hosts, compared against the linked list scans used before */
+
+#include "common.h"
+#include "utils_disk.h"
+#include "tap.h"
+#include "fsusage.h"
+
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#define NOF_MOUNTS 10000
+#define NESTED_EVERY 10
+
+static double seconds_since(struct timeval *start) {
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_usec - start->tv_usec) / 1.0e6;
+}
+
+/* np_set_best_match() as it was, O(paths x mounts) */
+static struct mount_entry *linear_best_match(struct mount_entry *mount_list, const char *name) {
+	struct mount_entry *me;
+	struct mount_entry *best_match = NULL;
+	size_t name_len = strlen(name);
+	size_t best_match_len = 0;
+	struct fs_usage fsp;
+
+	for (me = mount_list; me; me = me->me_next) {
+		if (strcmp(me->me_devname, name) == 0 && get_fs_usage(me->me_mountdir, me->me_devname, &fsp) >= 0)
+			best_match = me;
+	}
+	if (best_match)
+		return best_match;
+
+	for (me = mount_list; me; me = me->me_next) {
+		size_t len = strlen(me->me_mountdir);
+		if (best_match_len <= len && len <= name_len && (len == 1 || strncmp(me->me_mountdir, name, len) == 0)) {
+			if (get_fs_usage(me->me_mountdir, me->me_devname, &fsp) >= 0) {
+				best_match = me;
+				best_match_len = len;
+			}
+		}
+	}
+	return best_match;
+}
+
+static struct mount_entry *add_mount(struct mount_entry ***tail, const char *devname, const char *mountdir) {
+	struct mount_entry *me = calloc(1, sizeof(*me));
+	me->me_devname = strdup(devname);
+	me->me_mountdir = strdup(mountdir);
+	**tail = me;
+	*tail = &me->me_next;
+	return me;
+}
+
+int main(int argc, char **argv) {
+	char base[] = "/tmp/test_disk_bench.XXXXXX";
+	char buf[PATH_MAX];
+	struct mount_entry *mount_list = NULL;
+	struct mount_entry **mtail = &mount_list;
+	struct mount_entry *me;
+	struct parameter_list *paths = NULL;
+	struct parameter_list *linear_paths = NULL;
+	struct parameter_list *p;
+	struct parameter_index index = {0};
+	struct name_list *seen_list = NULL;
+	struct name_hash seen = {0};
+	struct timeval start;
+	double linear_time;
+	double indexed_time;
+	int nof_paths = 0;
+	int mismatches = 0;
+	int found = 0;
+
+	plan_tests(6);
+
+	if (mkdtemp(base) == NULL) {
+		skip(6, "cannot create %s", base);
+		return exit_status();
+	}
+
+	/* mount points need to exist, they are statvfs()ed while matching */
+	add_mount(&mtail, "/dev/root", "/");
+	for (int i = 0; i < NOF_MOUNTS; i++) {
+		char devname[32];
+
+		snprintf(devname, sizeof(devname), "overlay%05d", i);
+		snprintf(buf, sizeof(buf), "%s/m%05d", base, i);
+		mkdir(buf, 0700);
+		add_mount(&mtail, devname, buf);
+		if (i % NESTED_EVERY == 0) {
+			snprintf(buf, sizeof(buf), "%s/m%05d/data", base, i);
+			mkdir(buf, 0700);
+			add_mount(&mtail, "tmpfs", buf);
+		}
+	}
+
+	for (int i = 0; i < NOF_MOUNTS; i++) {
+		snprintf(buf, sizeof(buf), i % NESTED_EVERY == 0 ? "%s/m%05d/data/file" : "%s/m%05d/file", base, i);
+		np_add_parameter_indexed(&paths, &index, buf);
+		if (i % NESTED_EVERY == 1)
+			np_add_parameter(&linear_paths, buf);
+		nof_paths++;
+	}
+
+	gettimeofday(&start, NULL);
+	np_set_best_match(paths, mount_list, false);
+	indexed_time = seconds_since(&start);
+
+	/* the linear scan only on every tenth path, it would take too long otherwise */
+	gettimeofday(&start, NULL);
+	for (p = linear_paths; p; p = p->name_next)
+		p->best_match = linear_best_match(mount_list, p->name);
+	linear_time = seconds_since(&start) * NESTED_EVERY;
+	diag("best match of %d paths in %d mounts: %.3fs indexed, ~%.3fs linear", nof_paths, NOF_MOUNTS + NOF_MOUNTS / NESTED_EVERY + 1,
+		 indexed_time, linear_time);
+
+	for (p = linear_paths; p; p = p->name_next) {
+		struct parameter_list *indexed = np_find_parameter_indexed(&index, p->name);
+		if (!indexed || indexed->best_match != p->best_match)
+			mismatches++;
+	}
+	ok(mismatches == 0, "indexed best match agrees with the linear scan");
+
+	for (p = paths; p; p = p->name_next) {
+		size_t len = strlen(p->best_match ? p->best_match->me_mountdir : "");
+		if (len > 0 && strncmp(p->best_match->me_mountdir, p->name, len) == 0 && p->name[len] == '/')
+			found++;
+	}
+	ok(found == nof_paths, "every path matched its own mount point (%d/%d)", found, nof_paths);
+
+	snprintf(buf, sizeof(buf), "%s/m%05d0", base, 1);
+	p = np_add_parameter_indexed(&paths, &index, buf);
+	np_set_best_match(p, mount_list, false);
+	ok(p->best_match && !strcmp(p->best_match->me_mountdir, "/"), "%s is not in %s/m00001", buf, base);
+
+	gettimeofday(&start, NULL);
+	for (p = paths; p; p = p->name_next)
+		found = np_find_parameter(paths, p->name) != NULL;
+	linear_time = seconds_since(&start);
+	gettimeofday(&start, NULL);
+	for (p = paths; p; p = p->name_next)
+		found = np_find_parameter_indexed(&index, p->name) != NULL;
+	indexed_time = seconds_since(&start);
+	diag("lookup of %d parameters: %.3fs indexed, %.3fs linear", nof_paths, indexed_time, linear_time);
+	ok(found, "parameters found by name");
+
+	gettimeofday(&start, NULL);
+	for (me = mount_list; me; me = me->me_next) {
+		if (!np_seen_name(seen_list, me->me_mountdir))
+			np_add_name(&seen_list, me->me_mountdir);
+	}
+	linear_time = seconds_since(&start);
+	gettimeofday(&start, NULL);
+	for (me = mount_list; me; me = me->me_next) {
+		if (!np_name_hash_get(&seen, me->me_mountdir))
+			np_name_hash_put(&seen, me->me_mountdir, me);
+	}
+	indexed_time = seconds_since(&start);
+	diag("seen set of %d mount points: %.3fs hashed, %.3fs linear", (int)seen.count, indexed_time, linear_time);
+	ok(seen.count == NOF_MOUNTS + NOF_MOUNTS / NESTED_EVERY + 1, "all mount points seen once");
+
+	for (me = mount_list; me; me = me->me_next)
+		np_name_hash_del(&seen, me->me_mountdir);
+	ok(seen.count == 0 && np_name_hash_get(&seen, "/") == NULL, "all mount points removed again");
+
+	for (me = mount_list; me; me = me->me_next) {
+		if (strcmp(me->me_mountdir, "/") != 0)
+			rmdir(me->me_mountdir);
+	}
+	/* the nested ones come after their parents */
+	for (me = mount_list; me; me = me->me_next) {
+		if (strcmp(me->me_mountdir, "/") != 0)
+			rmdir(me->me_mountdir);
+	}
+	rmdir(base);
+
+	return exit_status();
+}
@@ -0,0 +1,6 @@
+#!/usr/bin/perl
+use Test::More;
+if (! -e "./test_disk_bench") {
+	plan skip_all => "./test_disk_bench not compiled - please enable libtap library to test";
+}
+exec "./test_disk_bench";
@@ -0,0 +1,112 @@
+/*****************************************************************************
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *****************************************************************************/
+
+#include "common.h"
+#include "utils_mount.h"
+#include "tap.h"
+
+#include <fcntl.h>
+#ifdef __linux__
+#	include <sys/sysmacros.h>
+#endif
+
+#define NOF_READS 200
+
+int main(int argc, char **argv) {
+	struct mount_table table = {0};
+	struct mount_snapshot snapshot = {0};
+	struct mount_entry *me;
+	struct mount_entry *gl_list;
+	struct mount_entry *gl_me;
+	unsigned long generation;
+	int mismatches = 0;
+	char *buffer = strdup("22 1 8:1 / / rw,relatime shared:1 - ext4 /dev/sda1 rw,errors=remount-ro\n"
+						  "23 22 0:21 / /proc rw,nosuid,nodev,noexec,relatime shared:12 - proc proc rw\n"
+						  "24 22 0:45 /export /mnt/with\\040blank rw,relatime shared:40 master:2 - nfs4 server:/export rw,vers=4.2\n"
+						  "25 22 0:46 / /srv/share rw - cifs //fileserver/share rw\n"
+						  "garbage line\n"
+						  "26 22 259:3 /sub /home rw,relatime - xfs /dev/nvme0n1p3 rw");
+
+	plan_tests(19);
+
+	ok(np_parse_mountinfo(buffer, &table) == 5, "five entries parsed, the broken line is skipped");
+	me = table.entries;
+	ok(me && !strcmp(me->me_devname, "/dev/sda1") && !strcmp(me->me_mountdir, "/") && !strcmp(me->me_type, "ext4"), "root file system");
+	ok(me && me->me_dev == makedev(8, 1) && !me->me_dummy && !me->me_remote, "device number, local and not dummy");
+	me = me ? me->me_next : NULL;
+	ok(me && !strcmp(me->me_mountdir, "/proc") && me->me_dummy, "proc is a dummy file system");
+	me = me ? me->me_next : NULL;
+	ok(me && !strcmp(me->me_mountdir, "/mnt/with blank"), "escaped blank in mount point");
+	ok(me && !strcmp(me->me_mntroot, "/export") && !strcmp(me->me_devname, "server:/export"), "optional fields skipped");
+	ok(me && me->me_remote && !me->me_dummy, "nfs is remote");
+	me = me ? me->me_next : NULL;
+	ok(me && me->me_remote, "cifs share is remote");
+	me = me ? me->me_next : NULL;
+	ok(me && !strcmp(me->me_devname, "/dev/nvme0n1p3") && !strcmp(me->me_mntroot, "/sub"), "last line without newline");
+	ok(me && me->me_next == NULL, "end of the list");
+	free(table.entries);
+	free(table.buffer);
+
+	buffer = strdup("");
+	ok(np_parse_mountinfo(buffer, &table) == 0 && table.entries == NULL, "empty table");
+	free(table.entries);
+	free(table.buffer);
+
+	if (access("/proc/self/mountinfo", R_OK) != 0) {
+		skip(8, "no /proc/self/mountinfo");
+		return exit_status();
+	}
+
+	me = np_mount_snapshot_get(&snapshot);
+	gl_list = read_file_system_list(false);
+	for (gl_me = gl_list; gl_me && me; gl_me = gl_me->me_next, me = me->me_next) {
+		if (strcmp(gl_me->me_devname, me->me_devname) || strcmp(gl_me->me_mountdir, me->me_mountdir) ||
+			strcmp(gl_me->me_type, me->me_type) || gl_me->me_dev != me->me_dev || gl_me->me_dummy != me->me_dummy ||
+			gl_me->me_remote != me->me_remote)
+			mismatches++;
+	}
+	ok(me == NULL && gl_me == NULL, "as many entries as read_file_system_list()");
+	ok(mismatches == 0, "same entries as read_file_system_list()");
+	ok(snapshot.generation == 1, "table read once");
+
+	me = snapshot.table->entries;
+	ok(np_mount_snapshot_get(&snapshot) == me, "unchanged table is reused");
+	ok(snapshot.generation == 1, "and not read again");
+
+	while (gl_list) {
+		gl_me = gl_list->me_next;
+		free_mount_entry(gl_list);
+		gl_list = gl_me;
+	}
+
+	for (int i = 0; i < NOF_READS; i++) {
+		np_mount_snapshot_get(&snapshot);
+	}
+	ok(np_mount_snapshot_get(&snapshot) == me && snapshot.generation == 1, "many gets, still read once");
+
+	/* the change events are per open file, a new one starts without */
+	generation = snapshot.generation;
+	close(snapshot.fd);
+	snapshot.fd = open("/proc/self/mountinfo", O_RDONLY);
+	ok(np_mount_snapshot_get(&snapshot) == me && snapshot.generation == generation, "new descriptor, nothing changed");
+
+	np_mount_snapshot_free(&snapshot);
+	ok(snapshot.table == NULL && !snapshot.opened, "snapshot freed");
+
+	return exit_status();
+}
@@ -38,7 +38,7 @@ int main(int argc, char **argv) {
 	state_data *temp_state_data;
 	time_t current_time;
 
-	plan_tests(185);
+	plan_tests(186);
 
 	ok(this_monitoring_plugin == NULL, "monitoring_plugin not initialised");
 
@@ -430,6 +430,15 @@ int main(int argc, char **argv) {
 	ok(system("cmp var/generated var/statefile > /dev/null") != 0, "Generated file should be different this time");
 	ok(this_monitoring_plugin->state->state_data->time - current_time <= 1, "Has time generated from current time");
 
+	/* check_disk keeps the usage history of all file systems in one line */
+	temp_string = malloc(4001);
+	memset(temp_string, 'x', 4000);
+	temp_string[4000] = '\0';
+	np_state_write_string(0, temp_string);
+	temp_state_data = np_state_read();
+	ok(temp_state_data != NULL && !strcmp((char *)temp_state_data->data, temp_string), "Data longer than 1024 bytes read back whole");
+	free(temp_string);
+
 	/* Don't know how to automatically test this. Need to be able to redefine die and catch the error */
 	/*
 	temp_state_key->_filename="/dev/do/not/expect/to/be/able/to/write";
@@ -565,7 +565,8 @@ state_data *np_state_read() {
 bool _np_state_read_file(FILE *f) {
 	bool status = false;
 	size_t pos;
-	char *line;
+	char *line = NULL;
+	size_t line_size = 0;
 	int i;
 	int failure = 0;
 	time_t current_time, data_time;
@@ -579,14 +580,9 @@ bool _np_state_read_file(FILE *f) {
 
 	time(&current_time);
 
-	/* Note: This introduces a limit of 1024 bytes in the string data */
-	line = (char *)calloc(1, 1024);
-	if (line == NULL)
-		die(STATE_UNKNOWN, _("Cannot allocate memory: %s"), strerror(errno));
-
-	while (!failure && (fgets(line, 1024, f)) != NULL) {
+	while (!failure && getline(&line, &line_size, f) != -1) {
 		pos = strlen(line);
-		if (line[pos - 1] == '\n') {
+		if (pos > 0 && line[pos - 1] == '\n') {
 			line[pos - 1] = '\0';
 		}
 
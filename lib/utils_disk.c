@@ -31,6 +31,99 @@
 #include "gl/fsusage.h"
 #include <string.h>
 
+/* FNV-1a */
+static size_t np_name_hash_slot(const struct name_hash *hash, const char *name) {
+	uint64_t h = 14695981039346656037ULL;
+	for (const unsigned char *c = (const unsigned char *)name; *c; c++) {
+		h ^= *c;
+		h *= 1099511628211ULL;
+	}
+	return (size_t)h & (hash->size - 1);
+}
+
+static struct name_hash_slot *np_name_hash_find(const struct name_hash *hash, const char *name) {
+	if (hash->size == 0)
+		return NULL;
+
+	for (size_t i = np_name_hash_slot(hash, name);; i = (i + 1) & (hash->size - 1)) {
+		if (hash->slots[i].name == NULL)
+			return NULL;
+		if (!strcmp(hash->slots[i].name, name))
+			return &hash->slots[i];
+	}
+}
+
+static void np_name_hash_grow(struct name_hash *hash) {
+	struct name_hash old = *hash;
+
+	hash->size = old.size ? old.size * 2 : 64;
+	hash->count = 0;
+	hash->slots = calloc(hash->size, sizeof(struct name_hash_slot));
+	if (hash->slots == NULL) {
+		die(STATE_UNKNOWN, _("Cannot allocate memory: %s"), strerror(errno));
+	}
+
+	for (size_t i = 0; i < old.size; i++) {
+		if (old.slots[i].name != NULL)
+			np_name_hash_put(hash, old.slots[i].name, old.slots[i].value);
+	}
+	free(old.slots);
+}
+
+/* Adds name or replaces its value */
+void np_name_hash_put(struct name_hash *hash, const char *name, void *value) {
+	struct name_hash_slot *slot = np_name_hash_find(hash, name);
+	size_t i;
+
+	if (slot != NULL) {
+		slot->value = value;
+		return;
+	}
+
+	/* keep the load factor below 3/4 */
+	if ((hash->count + 1) * 4 > hash->size * 3)
+		np_name_hash_grow(hash);
+
+	for (i = np_name_hash_slot(hash, name); hash->slots[i].name != NULL; i = (i + 1) & (hash->size - 1))
+		;
+	hash->slots[i].name = name;
+	hash->slots[i].value = value;
+	hash->count++;
+}
+
+void *np_name_hash_get(const struct name_hash *hash, const char *name) {
+	struct name_hash_slot *slot = np_name_hash_find(hash, name);
+	return slot ? slot->value : NULL;
+}
+
+void np_name_hash_del(struct name_hash *hash, const char *name) {
+	struct name_hash_slot *slot = np_name_hash_find(hash, name);
+	size_t hole;
+
+	if (slot == NULL)
+		return;
+
+	/* move following entries of the probe sequence up, no tombstones needed */
+	hole = slot - hash->slots;
+	for (size_t i = (hole + 1) & (hash->size - 1); hash->slots[i].name != NULL; i = (i + 1) & (hash->size - 1)) {
+		size_t home = np_name_hash_slot(hash, hash->slots[i].name);
+		/* can the entry at i be moved to the hole, i.e. is home not in (hole, i] */
+		if ((i > hole && (home <= hole || home > i)) || (i < hole && home <= hole && home > i)) {
+			hash->slots[hole] = hash->slots[i];
+			hole = i;
+		}
+	}
+	hash->slots[hole].name = NULL;
+	hash->slots[hole].value = NULL;
+	hash->count--;
+}
+
+void np_name_hash_free(struct name_hash *hash) {
+	free(hash->slots);
+	hash->slots = NULL;
+	hash->size = hash->count = 0;
+}
+
 void np_add_name(struct name_list **list, const char *name) {
 	struct name_list *new_entry;
 	new_entry = (struct name_list *)malloc(sizeof *new_entry);
@@ -104,6 +197,7 @@ struct parameter_list *np_add_parameter(struct parameter_list **list, const char
 	new_path->inodes_used = 0;
 	new_path->dused_inodes_percent = 0;
 	new_path->dfree_inodes_percent = 0;
+	new_path->stat_request = NULL;
 
 	strcpy(new_path->name, name);
 
@@ -157,47 +251,140 @@ struct parameter_list *np_find_parameter(struct parameter_list *list, const char
 	return NULL;
 }
 
+/* Appends a new parameter to list and indexes it by name */
+struct parameter_list *np_add_parameter_indexed(struct parameter_list **list, struct parameter_index *index, const char *name) {
+	struct parameter_list *new_path;
+
+	if (*list == NULL)
+		index->tail = NULL;
+
+	/* np_add_parameter() would walk the whole list to find its end */
+	if (index->tail == NULL) {
+		new_path = np_add_parameter(list, name);
+	} else {
+		struct parameter_list *next = NULL;
+		new_path = np_add_parameter(&next, name);
+		index->tail->name_next = new_path;
+		new_path->name_prev = index->tail;
+	}
+
+	index->tail = new_path;
+	np_name_hash_put(&index->names, new_path->name, new_path);
+	return new_path;
+}
+
+struct parameter_list *np_find_parameter_indexed(const struct parameter_index *index, const char *name) {
+	return np_name_hash_get(&index->names, name);
+}
+
+struct parameter_list *np_del_parameter_indexed(struct parameter_index *index, struct parameter_list *item, struct parameter_list *prev) {
+	if (item == NULL) {
+		return NULL;
+	}
+	if (np_name_hash_get(&index->names, item->name) == item)
+		np_name_hash_del(&index->names, item->name);
+	if (index->tail == item)
+		index->tail = prev;
+	return np_del_parameter(item, prev);
+}
+
+void np_mount_index_init(struct mount_index *index, struct mount_entry *mount_list) {
+	struct mount_entry *me;
+	size_t nof_entries = 0;
+	size_t i = 0;
+
+	memset(index, 0, sizeof(*index));
+	for (me = mount_list; me; me = me->me_next)
+		nof_entries++;
+
+	/* two per mount entry: by device name and by mount point */
+	index->entries = calloc(nof_entries * 2 + 1, sizeof(struct mount_index_entry));
+	if (index->entries == NULL) {
+		die(STATE_UNKNOWN, _("Cannot allocate memory: %s"), strerror(errno));
+	}
+
+	for (me = mount_list; me; me = me->me_next) {
+		struct mount_index_entry *by_devname = &index->entries[i++];
+		struct mount_index_entry *by_mountdir = &index->entries[i++];
+
+		by_devname->me = me;
+		by_devname->prev_same = np_name_hash_get(&index->by_devname, me->me_devname);
+		np_name_hash_put(&index->by_devname, me->me_devname, by_devname);
+
+		by_mountdir->me = me;
+		by_mountdir->prev_same = np_name_hash_get(&index->by_mountdir, me->me_mountdir);
+		np_name_hash_put(&index->by_mountdir, me->me_mountdir, by_mountdir);
+	}
+}
+
+void np_mount_index_free(struct mount_index *index) {
+	np_name_hash_free(&index->by_devname);
+	np_name_hash_free(&index->by_mountdir);
+	free(index->entries);
+	index->entries = NULL;
+}
+
+/* The last entry named name, which is usable if check_usage is set */
+static struct mount_entry *np_mount_index_lookup(const struct name_hash *hash, const char *name, bool check_usage) {
+	struct mount_index_entry *entry;
+	struct fs_usage fsp;
+
+	for (entry = np_name_hash_get(hash, name); entry; entry = entry->prev_same) {
+		if (!check_usage || get_fs_usage(entry->me->me_mountdir, entry->me->me_devname, &fsp) >= 0)
+			return entry->me;
+	}
+	return NULL;
+}
+
+struct mount_entry *np_mount_index_best_match(const struct mount_index *index, const char *name, bool exact, bool check_usage) {
+	struct mount_entry *best_match;
+	char *prefix;
+	char *slash;
+
+	/* set best match if path name exactly matches a mounted device name */
+	best_match = np_mount_index_lookup(&index->by_devname, name, check_usage);
+	if (best_match || exact) {
+		return best_match ? best_match : np_mount_index_lookup(&index->by_mountdir, name, check_usage);
+	}
+
+	/* otherwise the longest mount point the path is in, its parent directories
+	 * are looked up from the deepest to the root */
+	prefix = strdup(name);
+	if (prefix == NULL) {
+		die(STATE_UNKNOWN, _("Cannot allocate memory: %s"), strerror(errno));
+	}
+	while (true) {
+		if (*prefix != '\0' && (best_match = np_mount_index_lookup(&index->by_mountdir, prefix, check_usage)))
+			break;
+		if ((slash = strrchr(prefix, '/')) == NULL) {
+			break;
+		}
+		*slash = '\0';
+	}
+	free(prefix);
+
+	if (!best_match)
+		best_match = np_mount_index_lookup(&index->by_mountdir, "/", check_usage);
+	return best_match;
+}
+
 void np_set_best_match(struct parameter_list *desired, struct mount_entry *mount_list, bool exact) {
 	struct parameter_list *d;
+	struct mount_index index;
+	bool indexed = false;
+
 	for (d = desired; d; d = d->name_next) {
 		if (!d->best_match) {
-			struct mount_entry *me;
-			size_t name_len = strlen(d->name);
-			size_t best_match_len = 0;
-			struct mount_entry *best_match = NULL;
-			struct fs_usage fsp;
-
-			/* set best match if path name exactly matches a mounted device name */
-			for (me = mount_list; me; me = me->me_next) {
-				if (strcmp(me->me_devname, d->name) == 0) {
-					if (get_fs_usage(me->me_mountdir, me->me_devname, &fsp) >= 0) {
-						best_match = me;
-					}
-				}
-			}
-
-			/* set best match by directory name if no match was found by devname */
-			if (!best_match) {
-				for (me = mount_list; me; me = me->me_next) {
-					size_t len = strlen(me->me_mountdir);
-					if ((!exact &&
-						 (best_match_len <= len && len <= name_len && (len == 1 || strncmp(me->me_mountdir, d->name, len) == 0))) ||
-						(exact && strcmp(me->me_mountdir, d->name) == 0)) {
-						if (get_fs_usage(me->me_mountdir, me->me_devname, &fsp) >= 0) {
-							best_match = me;
-							best_match_len = len;
-						}
-					}
-				}
-			}
-
-			if (best_match) {
-				d->best_match = best_match;
-			} else {
-				d->best_match = NULL; /* Not sure why this is needed as it should be null on initialisation */
+			if (!indexed) {
+				np_mount_index_init(&index, mount_list);
+				indexed = true;
 			}
+			d->best_match = np_mount_index_best_match(&index, d->name, exact, true);
 		}
 	}
+
+	if (indexed)
+		np_mount_index_free(&index);
 }
 
 /* Returns true if name is in list */
@@ -1,3 +1,5 @@
+#ifndef _UTILS_DISK_
+#define _UTILS_DISK_
 /* Header file for utils_disk */
 
 #include "mountlist.h"
@@ -9,6 +11,19 @@ struct name_list {
 	struct name_list *next;
 };
 
+struct name_hash_slot {
+	const char *name;
+	void *value;
+};
+
+/* Open addressing hash table from names to values, zero initialised it is
+ * empty. The names are not copied. */
+struct name_hash {
+	struct name_hash_slot *slots;
+	size_t size; /* power of two */
+	size_t count;
+};
+
 struct regex_list {
 	regex_t regex;
 	struct regex_list *next;
@@ -32,8 +47,35 @@ struct parameter_list {
 	double dfree_pct, dused_pct;
 	uint64_t dused_units, dfree_units, dtotal_units;
 	double dused_inodes_percent, dfree_inodes_percent;
+	struct disk_stat_request *stat_request; /* stat() and statvfs() done in advance */
+	bool stat_probe;                        /* selected with -p, to be checked that it is there */
+};
+
+/* A parameter_list with lookups by name and appends in constant time,
+ * zero initialised it is empty */
+struct parameter_index {
+	struct name_hash names;
+	struct parameter_list *tail;
 };
 
+struct mount_index_entry {
+	struct mount_entry *me;
+	struct mount_index_entry *prev_same; /* previous entry with the same name */
+};
+
+/* Mount entries by device name and by mount point, to find the best match
+ * of a path by looking up the path and its parent directories */
+struct mount_index {
+	struct name_hash by_devname;
+	struct name_hash by_mountdir;
+	struct mount_index_entry *entries;
+};
+
+void np_name_hash_put(struct name_hash *hash, const char *name, void *value);
+void *np_name_hash_get(const struct name_hash *hash, const char *name);
+void np_name_hash_del(struct name_hash *hash, const char *name);
+void np_name_hash_free(struct name_hash *hash);
+
 void np_add_name(struct name_list **list, const char *name);
 bool np_find_name(struct name_list *list, const char *name);
 bool np_seen_name(struct name_list *list, const char *name);
@@ -42,7 +84,16 @@ bool np_find_regmatch(struct regex_list *list, const char *name);
 struct parameter_list *np_add_parameter(struct parameter_list **list, const char *name);
 struct parameter_list *np_find_parameter(struct parameter_list *list, const char *name);
 struct parameter_list *np_del_parameter(struct parameter_list *item, struct parameter_list *prev);
+struct parameter_list *np_add_parameter_indexed(struct parameter_list **list, struct parameter_index *index, const char *name);
+struct parameter_list *np_find_parameter_indexed(const struct parameter_index *index, const char *name);
+struct parameter_list *np_del_parameter_indexed(struct parameter_index *index, struct parameter_list *item, struct parameter_list *prev);
 
 int search_parameter_list(struct parameter_list *list, const char *name);
 void np_set_best_match(struct parameter_list *desired, struct mount_entry *mount_list, bool exact);
+void np_mount_index_init(struct mount_index *index, struct mount_entry *mount_list);
+void np_mount_index_free(struct mount_index *index);
+/* With check_usage only file systems get_fs_usage() succeeds on are considered */
+struct mount_entry *np_mount_index_best_match(const struct mount_index *index, const char *name, bool exact, bool check_usage);
 bool np_regex_match_mount_entry(struct mount_entry *me, regex_t *re);
+
+#endif /* _UTILS_DISK_ */
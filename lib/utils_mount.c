@@ -0,0 +1,254 @@
+/*****************************************************************************
+ *
+ * Library for reading the mount table
+ *
+ * License: GPL
+ * Copyright (c) 2024 Monitoring Plugins Development Team
+ *
+ * Description:
+ *
+ * This file contains a reader for /proc/self/mountinfo which keeps the
+ * parsed table around until the kernel reports a change. On systems without
+ * mountinfo read_file_system_list() is used. These are tested by libtap
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *****************************************************************************/
+
+#include "common.h"
+#include "utils_mount.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#ifdef __linux__
+#	include <sys/sysmacros.h>
+#endif
+
+#define MOUNTINFO "/proc/self/mountinfo"
+
+/* Same lists as in gl/mountlist.c */
+static bool np_mount_dummy(const char *type) {
+	static const char *const dummy_types[] = {"autofs", "proc",       "subfs",  "debugfs", "devpts", "fusectl", "fuse.portal",
+											  "mqueue", "rpc_pipefs", "sysfs",  "devfs",   "kernfs", "ignore",  "none"};
+
+	for (size_t i = 0; i < sizeof(dummy_types) / sizeof(dummy_types[0]); i++) {
+		if (strcmp(type, dummy_types[i]) == 0)
+			return true;
+	}
+	return false;
+}
+
+static bool np_mount_remote(const char *devname, const char *type) {
+	static const char *const remote_types[] = {"acfs", "afs", "coda", "auristorfs", "fhgfs", "gpfs", "ibrix", "ocfs2", "vxfs"};
+
+	if (strchr(devname, ':') != NULL || strcmp(devname, "-hosts") == 0)
+		return true;
+	if (devname[0] == '/' && devname[1] == '/' && (!strcmp(type, "smbfs") || !strcmp(type, "smb3") || !strcmp(type, "cifs")))
+		return true;
+	for (size_t i = 0; i < sizeof(remote_types) / sizeof(remote_types[0]); i++) {
+		if (strcmp(type, remote_types[i]) == 0)
+			return true;
+	}
+	return false;
+}
+
+/* Undoes the octal escapes of blanks and backslashes, in place */
+static void np_mount_unescape(char *str) {
+	char *out = str;
+
+	for (; *str; str++) {
+		if (str[0] == '\\' && str[1] >= '0' && str[1] <= '3' && str[2] >= '0' && str[2] <= '7' && str[3] >= '0' && str[3] <= '7') {
+			*out++ = (char)((str[1] - '0') * 64 + (str[2] - '0') * 8 + (str[3] - '0'));
+			str += 3;
+		} else {
+			*out++ = *str;
+		}
+	}
+	*out = '\0';
+}
+
+/* Terminates the field starting at *pos and advances *pos to the next one */
+static char *np_mount_field(char **pos) {
+	char *field = *pos;
+	char *end = field + strcspn(field, " ");
+
+	if (*end == '\0')
+		return NULL;
+	*end = '\0';
+	*pos = end + 1;
+	return field;
+}
+
+int np_parse_mountinfo(char *buffer, struct mount_table *table) {
+	size_t nof_lines = 1;
+	char *line;
+	char *next;
+	struct mount_entry *block;
+	struct mount_entry **tail;
+
+	for (const char *c = buffer; *c; c++) {
+		if (*c == '\n')
+			nof_lines++;
+	}
+
+	table->buffer = buffer;
+	table->nof_entries = 0;
+	table->entries = NULL;
+	block = calloc(nof_lines, sizeof(struct mount_entry));
+	if (block == NULL)
+		return -1;
+	tail = &table->entries;
+
+	/* id parent major:minor root mountdir options [optional...] - type source superoptions */
+	for (line = buffer; line && *line; line = next) {
+		struct mount_entry *me = &block[table->nof_entries];
+		unsigned int devmaj;
+		unsigned int devmin;
+		char *pos = line;
+		char *dev;
+		char *dash;
+
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+
+		if (!np_mount_field(&pos) || !np_mount_field(&pos) || !(dev = np_mount_field(&pos)) ||
+			sscanf(dev, "%u:%u", &devmaj, &devmin) != 2 || !(me->me_mntroot = np_mount_field(&pos)) ||
+			!(me->me_mountdir = np_mount_field(&pos)))
+			continue;
+		dash = strstr(pos, " - ");
+		if (!dash)
+			continue;
+		pos = dash + 3;
+		if (!(me->me_type = np_mount_field(&pos)))
+			continue;
+		me->me_devname = pos;
+		pos[strcspn(pos, " ")] = '\0';
+
+		np_mount_unescape(me->me_devname);
+		np_mount_unescape(me->me_mountdir);
+		np_mount_unescape(me->me_mntroot);
+		np_mount_unescape(me->me_type);
+		me->me_dev = makedev(devmaj, devmin);
+		me->me_dummy = np_mount_dummy(me->me_type);
+		me->me_remote = np_mount_remote(me->me_devname, me->me_type);
+		me->me_type_malloced = 0;
+
+		*tail = me;
+		tail = &me->me_next;
+		table->nof_entries++;
+	}
+	*tail = NULL;
+	if (table->nof_entries == 0)
+		free(block);
+	return (int)table->nof_entries;
+}
+
+/* Reads the whole file from the start, returns a NUL terminated buffer */
+static char *np_mount_read(int fd) {
+	size_t size = 16384;
+	size_t length = 0;
+	char *buffer = NULL;
+
+	if (lseek(fd, 0, SEEK_SET) != 0)
+		return NULL;
+
+	for (;;) {
+		ssize_t n;
+		char *larger = realloc(buffer, size);
+
+		if (larger == NULL) {
+			free(buffer);
+			return NULL;
+		}
+		buffer = larger;
+		n = read(fd, buffer + length, size - length - 1);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			free(buffer);
+			return NULL;
+		}
+		if (n == 0)
+			break;
+		length += (size_t)n;
+		if (size - length - 1 == 0)
+			size *= 2;
+	}
+	buffer[length] = '\0';
+	return buffer;
+}
+
+/* The kernel flags the open mountinfo with POLLPRI (and POLLERR) when the
+ * mount namespace changed since the last poll */
+static bool np_mount_changed(struct mount_snapshot *snapshot) {
+	struct pollfd pfd = {.fd = snapshot->fd, .events = POLLPRI};
+
+	if (poll(&pfd, 1, 0) < 0)
+		return true;
+	return (pfd.revents & (POLLPRI | POLLERR)) != 0;
+}
+
+struct mount_entry *np_mount_snapshot_get(struct mount_snapshot *snapshot) {
+	struct mount_table *table;
+	char *buffer;
+
+	if (!snapshot->opened && !snapshot->fallback) {
+		snapshot->fd = open(MOUNTINFO, O_RDONLY | O_CLOEXEC);
+		if (snapshot->fd < 0)
+			snapshot->fallback = true;
+		else
+			snapshot->opened = true;
+	}
+
+	if (snapshot->fallback) {
+		/* no way to tell whether something changed */
+		snapshot->fallback_list = read_file_system_list(false);
+		snapshot->generation++;
+		return snapshot->fallback_list;
+	}
+
+	if (snapshot->table != NULL && !np_mount_changed(snapshot))
+		return snapshot->table->entries;
+
+	table = calloc(1, sizeof(*table));
+	buffer = table ? np_mount_read(snapshot->fd) : NULL;
+	if (buffer == NULL || np_parse_mountinfo(buffer, table) < 0) {
+		free(buffer);
+		free(table);
+		/* keep the last table, it is the best guess there is */
+		return snapshot->table ? snapshot->table->entries : read_file_system_list(false);
+	}
+	table->older = snapshot->table;
+	snapshot->table = table;
+	snapshot->generation++;
+	return table->entries;
+}
+
+void np_mount_snapshot_free(struct mount_snapshot *snapshot) {
+	struct mount_table *table = snapshot->table;
+
+	while (table != NULL) {
+		struct mount_table *older = table->older;
+		free(table->entries);
+		free(table->buffer);
+		free(table);
+		table = older;
+	}
+	if (snapshot->opened)
+		close(snapshot->fd);
+	memset(snapshot, 0, sizeof(*snapshot));
+}
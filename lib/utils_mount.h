@@ -0,0 +1,38 @@
+#ifndef _UTILS_MOUNT_
+#define _UTILS_MOUNT_
+/* Header file for utils_mount */
+
+#include "mountlist.h"
+
+/* A mount table read in one go: the entries are allocated in one block and
+ * their strings point into the buffer the table was read into */
+struct mount_table {
+	struct mount_entry *entries; /* linked through me_next, in mount order */
+	size_t nof_entries;
+	char *buffer;
+	struct mount_table *older; /* replaced tables, entries may still be referenced */
+};
+
+/* The mount table of the process, read again only when it has changed.
+ * Zero initialised it is empty. */
+struct mount_snapshot {
+	int fd;          /* /proc/self/mountinfo, polled for changes */
+	bool opened;     /* fd is valid */
+	bool fallback;   /* no mountinfo, read_file_system_list() is used */
+	unsigned long generation; /* incremented each time the table is read */
+	struct mount_table *table;
+	struct mount_entry *fallback_list;
+};
+
+/* Parses the contents of /proc/self/mountinfo in place, buffer must be
+ * NUL terminated and is owned by table afterwards. Returns the number of
+ * entries or -1 if out of memory. */
+int np_parse_mountinfo(char *buffer, struct mount_table *table);
+
+/* Returns the current mount table, the one of the last call if it has not
+ * changed since. Entries of earlier calls stay valid until the snapshot is
+ * freed. */
+struct mount_entry *np_mount_snapshot_get(struct mount_snapshot *snapshot);
+void np_mount_snapshot_free(struct mount_snapshot *snapshot);
+
+#endif /* _UTILS_MOUNT_ */
@@ -50,10 +50,10 @@ const char *email = "devel@monitoring-plugins.org";
 #include "curl/curl.h"
 #include "curl/easy.h"
 
-#include "picohttpparser.h"
-
 #include "uriparser/Uri.h"
 
+#include "./check_curl.d/json.h"
+
 #include <arpa/inet.h>
 #include <netinet/in.h>
 
@@ -95,6 +95,29 @@ typedef struct {
 	size_t bufsize;
 } curlhelp_write_curlbuf;
 
+/* the response body as seen by the content checks, with automatic
+ * decompression or --json-path only a sliding window over the decoded
+ * body is kept in memory and -s/-r are evaluated on every window. What a
+ * match may still need is carried over: the last -s string length minus
+ * one byte and, as -r matches do not span lines, the unfinished line */
+enum {
+	BODY_WINDOW_SIZE = 65536
+};
+
+typedef struct {
+	curlhelp_write_curlbuf *buf;
+	bool sliding;
+	size_t window_limit; /* check and slide the window when it is this full */
+	bool mid_line;       /* the window does not start at the beginning of a line */
+	json_parser *json; /* --json-path values are extracted while receiving */
+	bool stop_when_resolved;
+	bool stopped; /* transfer aborted, everything needed is there */
+	size_t decoded_len; /* all body bytes handed over by libcurl */
+	bool string_found;
+	bool regex_found;
+	int regex_errcode;
+} curlhelp_body_stream;
+
 /* for buffering the data sent in PUT */
 typedef struct {
 	char *buf;
@@ -114,6 +137,30 @@ typedef struct {
 	char *first_line; /* a copy of the first line */
 } curlhelp_statusline;
 
+/* index over the headers of the last response, built line by line in the
+ * header callback, so lookups need neither a second parse nor a linear scan */
+enum {
+	HEADER_INDEX_INITIAL_SIZE = 64 /* must be a power of two, doubled when three quarters are used */
+};
+
+typedef struct {
+	unsigned int hash;
+	size_t name_off; /* offsets into the header buffer, which may move on realloc */
+	size_t name_len; /* 0 marks an unused slot */
+	size_t value_off;
+	size_t value_len;
+} curlhelp_header_slot;
+
+typedef struct {
+	curlhelp_write_curlbuf *buf; /* raw headers of all responses as received */
+	bool have_status_line;
+	size_t status_line_off; /* status line of the last response */
+	size_t status_line_len;
+	size_t nof_headers;
+	size_t size; /* number of slots, 0 before the first header */
+	curlhelp_header_slot *slots;
+} curlhelp_header_index;
+
 /* to know the underlying SSL library used by libcurl */
 typedef enum curlhelp_ssl_library {
 	CURLHELP_SSL_LIBRARY_UNKNOWN,
@@ -123,6 +170,17 @@ typedef enum curlhelp_ssl_library {
 	CURLHELP_SSL_LIBRARY_NSS
 } curlhelp_ssl_library;
 
+/* resolved addresses of lookup_host(), a redirect chain usually stays
+ * on a handful of hosts */
+enum {
+	DNS_CACHE_SIZE = 8
+};
+
+typedef struct {
+	char *host;
+	char addrs[DEFAULT_BUFFER_SIZE / 2];
+} dns_cache_entry;
+
 enum {
 	REGS = 2,
 	MAX_RE_SIZE = 1024
@@ -157,6 +215,7 @@ static bool show_body = false;
 static int min_page_len = 0;
 static int max_page_len = 0;
 static int redir_depth = 0;
+static double *redir_times = NULL; /* response time of every hop followed so far */
 static int max_depth = DEFAULT_MAX_REDIRS;
 static char *http_method = NULL;
 static char *http_post_data = NULL;
@@ -167,8 +226,10 @@ static bool curl_easy_initialized = false;
 static struct curl_slist *header_list = NULL;
 static bool body_buf_initialized = false;
 static curlhelp_write_curlbuf body_buf;
+static curlhelp_body_stream body_stream;
 static bool header_buf_initialized = false;
 static curlhelp_write_curlbuf header_buf;
+static curlhelp_header_index header_index;
 static bool status_line_initialized = false;
 static curlhelp_statusline status_line;
 static bool put_buf_initialized = false;
@@ -224,24 +285,40 @@ static int curl_http_version = CURL_HTTP_VERSION_NONE;
 static bool automatic_decompression = false;
 static char *cookie_jar_file = NULL;
 static bool haproxy_protocol = false;
+static json_path json_paths[JSON_MAX_PATHS];
+static thresholds *json_thlds[JSON_MAX_PATHS];
+static int nof_json_paths = 0;
+static json_parser json;
+static dns_cache_entry dns_cache[DNS_CACHE_SIZE];
+static int dns_cache_next = 0;
 
 static bool process_arguments(int /*argc*/, char ** /*argv*/);
 static void handle_curl_option_return_code(CURLcode res, const char *option);
 static int check_http(void);
-static void redir(curlhelp_write_curlbuf * /*header_buf*/);
+static void redir(const curlhelp_header_index * /*header_index*/);
 static char *perfd_time(double elapsed_time);
 static char *perfd_time_connect(double elapsed_time_connect);
 static char *perfd_time_ssl(double elapsed_time_ssl);
 static char *perfd_time_firstbyte(double elapsed_time_firstbyte);
 static char *perfd_time_headers(double elapsed_time_headers);
 static char *perfd_time_transfer(double elapsed_time_transfer);
+static char *perfd_time_redirect(int hop, double elapsed_time_redirect);
 static char *perfd_size(int page_len);
+static char *perfd_size_wire(int page_len_wire);
+static char *perfd_json(int json_path_index);
+static char *perfd_compression_ratio(double ratio);
 static void print_help(void);
 void print_usage(void);
 static void print_curl_version(void);
 static int curlhelp_initwritebuffer(curlhelp_write_curlbuf * /*buf*/);
 static size_t curlhelp_buffer_write_callback(void * /*buffer*/, size_t /*size*/, size_t /*nmemb*/, void * /*stream*/);
 static void curlhelp_freewritebuffer(curlhelp_write_curlbuf * /*buf*/);
+static void curlhelp_initheaderindex(curlhelp_header_index * /*index*/, curlhelp_write_curlbuf * /*buf*/);
+static void curlhelp_freeheaderindex(curlhelp_header_index * /*index*/);
+static size_t curlhelp_header_callback(void * /*buffer*/, size_t /*size*/, size_t /*nmemb*/, void * /*stream*/);
+static void curlhelp_initbodystream(curlhelp_body_stream * /*body*/, curlhelp_write_curlbuf * /*buf*/, bool /*sliding*/);
+static size_t curlhelp_body_callback(void * /*buffer*/, size_t /*size*/, size_t /*nmemb*/, void * /*stream*/);
+static void curlhelp_check_body(curlhelp_body_stream * /*body*/, bool /*complete*/);
 static int curlhelp_initreadbuffer(curlhelp_read_curlbuf * /*buf*/, const char * /*data*/, size_t /*datalen*/);
 static size_t curlhelp_buffer_read_callback(void * /*buffer*/, size_t /*size*/, size_t /*nmemb*/, void * /*stream*/);
 static void curlhelp_freereadbuffer(curlhelp_read_curlbuf * /*buf*/);
@@ -249,11 +326,11 @@ static curlhelp_ssl_library curlhelp_get_ssl_library(void);
 static const char *curlhelp_get_ssl_library_string(curlhelp_ssl_library /*ssl_library*/);
 int net_noopenssl_check_certificate(cert_ptr_union *, int, int);
 
-static int curlhelp_parse_statusline(const char * /*buf*/, curlhelp_statusline * /*status_line*/);
+static int curlhelp_parse_statusline(const curlhelp_header_index * /*header_index*/, curlhelp_statusline * /*status_line*/);
 static void curlhelp_free_statusline(curlhelp_statusline * /*status_line*/);
-static char *get_header_value(const struct phr_header *headers, size_t nof_headers, const char *header);
-static int check_document_dates(const curlhelp_write_curlbuf * /*header_buf*/, char (*msg)[DEFAULT_BUFFER_SIZE]);
-static int get_content_length(const curlhelp_write_curlbuf *header_buf, const curlhelp_write_curlbuf *body_buf);
+static char *get_header_value(const curlhelp_header_index * /*header_index*/, const char *header);
+static int check_document_dates(const curlhelp_header_index * /*header_index*/, char (*msg)[DEFAULT_BUFFER_SIZE]);
+static int get_content_length(const curlhelp_header_index * /*header_index*/, const curlhelp_body_stream * /*body_stream*/);
 
 #if defined(HAVE_SSL) && defined(USE_OPENSSL)
 int np_net_ssl_check_certificate(X509 *certificate, int days_till_exp_warn, int days_till_exp_crit);
@@ -390,6 +467,16 @@ int lookup_host(const char *host, char *buf, size_t buflen) {
 	void *ptr = {0};
 	size_t buflen_remaining = buflen - 1;
 
+	for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+		if (dns_cache[i].host != NULL && !strcmp(dns_cache[i].host, host)) {
+			if (verbose >= 1)
+				printf("* DNS cache hit for %s: %s\n", host, dns_cache[i].addrs);
+			strncpy(buf, dns_cache[i].addrs, buflen - 1);
+			buf[buflen - 1] = '\0';
+			return 0;
+		}
+	}
+
 	memset(&hints, 0, sizeof(hints));
 	hints.ai_family = address_family;
 	hints.ai_socktype = SOCK_STREAM;
@@ -433,30 +520,43 @@ int lookup_host(const char *host, char *buf, size_t buflen) {
 
 	freeaddrinfo(result);
 
+	free(dns_cache[dns_cache_next].host);
+	dns_cache[dns_cache_next].host = strdup(host);
+	strncpy(dns_cache[dns_cache_next].addrs, buf, sizeof(dns_cache[dns_cache_next].addrs) - 1);
+	dns_cache_next = (dns_cache_next + 1) % DNS_CACHE_SIZE;
+
 	return 0;
 }
 
-static void cleanup(void) {
+/* release everything belonging to a single request, but keep the curl
+ * handle (and with it the connection and DNS cache) for following redirects */
+static void cleanup_request(void) {
 	if (status_line_initialized)
 		curlhelp_free_statusline(&status_line);
 	status_line_initialized = false;
-	if (curl_easy_initialized)
-		curl_easy_cleanup(curl);
-	curl_easy_initialized = false;
-	if (curl_global_initialized)
-		curl_global_cleanup();
-	curl_global_initialized = false;
 	if (body_buf_initialized)
 		curlhelp_freewritebuffer(&body_buf);
 	body_buf_initialized = false;
-	if (header_buf_initialized)
+	if (header_buf_initialized) {
 		curlhelp_freewritebuffer(&header_buf);
+		curlhelp_freeheaderindex(&header_index);
+	}
 	header_buf_initialized = false;
 	if (put_buf_initialized)
 		curlhelp_freereadbuffer(&put_buf);
 	put_buf_initialized = false;
 }
 
+static void cleanup(void) {
+	cleanup_request();
+	if (curl_easy_initialized)
+		curl_easy_cleanup(curl);
+	curl_easy_initialized = false;
+	if (curl_global_initialized)
+		curl_global_cleanup();
+	curl_global_initialized = false;
+}
+
 int check_http(void) {
 	int result = STATE_OK;
 	int result_ssl = STATE_OK;
@@ -467,18 +567,23 @@ int check_http(void) {
 	char addrstr[DEFAULT_BUFFER_SIZE / 2];
 	char dnscache[DEFAULT_BUFFER_SIZE];
 
-	/* initialize curl */
-	if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK)
-		die(STATE_UNKNOWN, "HTTP UNKNOWN - curl_global_init failed\n");
-	curl_global_initialized = true;
+	/* initialize curl, when following redirects the handle of the first
+	 * request is reused together with its connection and DNS cache */
+	if (!curl_global_initialized) {
+		if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK)
+			die(STATE_UNKNOWN, "HTTP UNKNOWN - curl_global_init failed\n");
+		curl_global_initialized = true;
 
-	if ((curl = curl_easy_init()) == NULL) {
-		die(STATE_UNKNOWN, "HTTP UNKNOWN - curl_easy_init failed\n");
+		/* register cleanup function to shut down libcurl properly */
+		atexit(cleanup);
 	}
-	curl_easy_initialized = true;
 
-	/* register cleanup function to shut down libcurl properly */
-	atexit(cleanup);
+	if (!curl_easy_initialized) {
+		if ((curl = curl_easy_init()) == NULL) {
+			die(STATE_UNKNOWN, "HTTP UNKNOWN - curl_easy_init failed\n");
+		}
+		curl_easy_initialized = true;
+	}
 
 	if (verbose >= 1)
 		handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_VERBOSE, 1), "CURLOPT_VERBOSE");
@@ -497,17 +602,28 @@ int check_http(void) {
 	if (curlhelp_initwritebuffer(&body_buf) < 0)
 		die(STATE_UNKNOWN, "HTTP CRITICAL - out of memory allocating buffer for body\n");
 	body_buf_initialized = true;
-	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, (curl_write_callback)curlhelp_buffer_write_callback),
+	/* the whole body is needed for printing it, a -l regex may match across all of it */
+	curlhelp_initbodystream(&body_stream, &body_buf,
+							(automatic_decompression || nof_json_paths > 0) && !show_body && (!strlen(regexp) || (cflags & REG_NEWLINE)));
+	if (nof_json_paths > 0) {
+		json_parser_init(&json, json_paths, nof_json_paths);
+		body_stream.json = &json;
+		/* nothing else needs the rest of the body */
+		body_stream.stop_when_resolved = !show_body && verbose < 2 && !strlen(string_expect) && !strlen(regexp) && min_page_len == 0 &&
+										 max_page_len == 0;
+	}
+	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, (curl_write_callback)curlhelp_body_callback),
 								   "CURLOPT_WRITEFUNCTION");
-	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&body_buf), "CURLOPT_WRITEDATA");
+	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&body_stream), "CURLOPT_WRITEDATA");
 
 	/* initialize buffer for header of the answer */
 	if (curlhelp_initwritebuffer(&header_buf) < 0)
 		die(STATE_UNKNOWN, "HTTP CRITICAL - out of memory allocating buffer for header\n");
 	header_buf_initialized = true;
-	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, (curl_write_callback)curlhelp_buffer_write_callback),
+	curlhelp_initheaderindex(&header_index, &header_buf);
+	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, (curl_write_callback)curlhelp_header_callback),
 								   "CURLOPT_HEADERFUNCTION");
-	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_WRITEHEADER, (void *)&header_buf), "CURLOPT_WRITEHEADER");
+	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_WRITEHEADER, (void *)&header_index), "CURLOPT_WRITEHEADER");
 
 	/* set the error buffer */
 	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errbuf), "CURLOPT_ERRORBUFFER");
@@ -603,9 +719,12 @@ int check_http(void) {
 		header_list = curl_slist_append(header_list, http_header);
 	}
 
-	/* always close connection, be nice to servers */
-	snprintf(http_header, DEFAULT_BUFFER_SIZE, "Connection: close");
-	header_list = curl_slist_append(header_list, http_header);
+	/* always close connection, be nice to servers, unless we follow
+	 * redirects ourselves and want to reuse it for the next hop */
+	if (onredirect != STATE_DEPENDENT || followmethod != FOLLOW_HTTP_CURL) {
+		snprintf(http_header, DEFAULT_BUFFER_SIZE, "Connection: close");
+		header_list = curl_slist_append(header_list, http_header);
+	}
 
 	/* attach additional headers supplied by the user */
 	/* optionally send any other header tag */
@@ -831,18 +950,33 @@ int check_http(void) {
 	if (verbose >= 2 && http_post_data)
 		printf("**** REQUEST CONTENT ****\n%s\n", http_post_data);
 
-	/* free header and server IP resolve lists, we don't need it anymore */
+	/* check what is left of the body */
+	curlhelp_check_body(&body_stream, true);
+	if (body_stream.json != NULL)
+		json_parser_finish(body_stream.json);
+
+	/* free header and server IP resolve lists, we don't need it anymore,
+	 * the handle may be reused for a redirect, so it must forget them too */
+	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, NULL);
 	curl_slist_free_all(header_list);
 	header_list = NULL;
 	curl_slist_free_all(server_ips);
 	server_ips = NULL;
 	if (host) {
+		curl_easy_setopt(curl, CURLOPT_RESOLVE, NULL);
 		curl_slist_free_all(host);
 		host = NULL;
 	}
+	/* same for the method, the payload and the proxy, the next hop sets
+	 * again what it needs. HTTPGET also clears POST, UPLOAD and NOBODY */
+	curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+	curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, NULL);
+	curl_easy_setopt(curl, CURLOPT_POSTFIELDS, NULL);
+	curl_easy_setopt(curl, CURLOPT_PROXY, NULL);
+	curl_easy_setopt(curl, CURLOPT_PROXYPORT, 0L);
 
 	/* Curl errors, result in critical Nagios state */
-	if (res != CURLE_OK) {
+	if (res != CURLE_OK && !(res == CURLE_WRITE_ERROR && body_stream.stopped)) {
 		snprintf(msg, DEFAULT_BUFFER_SIZE, _("Invalid HTTP response received from host on port %d: cURL returned %d - %s"), server_port,
 				 res, errbuf[0] ? errbuf : curl_easy_strerror(res));
 		die(STATE_CRITICAL, "HTTP CRITICAL - %s\n", msg);
@@ -928,7 +1062,7 @@ int check_http(void) {
 	 * performance data to the answer always
 	 */
 	handle_curl_option_return_code(curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &total_time), "CURLINFO_TOTAL_TIME");
-	page_len = get_content_length(&header_buf, &body_buf);
+	page_len = get_content_length(&header_index, &body_stream);
 	if (show_extended_perfdata) {
 		handle_curl_option_return_code(curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME, &time_connect), "CURLINFO_CONNECT_TIME");
 		handle_curl_option_return_code(curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME, &time_appconnect), "CURLINFO_APPCONNECT_TIME");
@@ -942,13 +1076,30 @@ int check_http(void) {
 	} else {
 		snprintf(perfstring, DEFAULT_BUFFER_SIZE, "%s %s", perfd_time(total_time), perfd_size(page_len));
 	}
+	if (automatic_decompression) {
+		size_t perfstring_len = strlen(perfstring);
+#if LIBCURL_VERSION_NUM >= MAKE_LIBCURL_VERSION(7, 55, 0)
+		curl_off_t size_wire = 0;
+		handle_curl_option_return_code(curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &size_wire), "CURLINFO_SIZE_DOWNLOAD_T");
+#else
+		double size_wire = 0;
+		handle_curl_option_return_code(curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD, &size_wire), "CURLINFO_SIZE_DOWNLOAD");
+#endif /* LIBCURL_VERSION_NUM >= MAKE_LIBCURL_VERSION(7, 55, 0) */
+		snprintf(perfstring + perfstring_len, DEFAULT_BUFFER_SIZE - perfstring_len, " %s %s",
+				 perfd_size_wire((int)(header_buf.buflen + size_wire)),
+				 perfd_compression_ratio(size_wire > 0 ? (double)body_stream.decoded_len / (double)size_wire : 1.0));
+	}
+	for (i = 0; i < redir_depth && redir_times != NULL; i++) {
+		size_t perfstring_len = strlen(perfstring);
+		snprintf(perfstring + perfstring_len, DEFAULT_BUFFER_SIZE - perfstring_len, " %s", perfd_time_redirect(i + 1, redir_times[i]));
+	}
 
 	/* return a CRITICAL status if we couldn't read any data */
-	if (strlen(header_buf.buf) == 0 && strlen(body_buf.buf) == 0)
+	if (header_buf.buflen == 0 && body_stream.decoded_len == 0)
 		die(STATE_CRITICAL, _("HTTP CRITICAL - No header received from host\n"));
 
 	/* get status line of answer, check sanity of HTTP code */
-	if (curlhelp_parse_statusline(header_buf.buf, &status_line) < 0) {
+	if (curlhelp_parse_statusline(&header_index, &status_line) < 0) {
 		snprintf(msg, DEFAULT_BUFFER_SIZE, "Unparsable status line in %.3g seconds response time|%s\n", total_time, perfstring);
 		/* we cannot know the major/minor version here for sure as we cannot parse the first line */
 		die(STATE_CRITICAL, "HTTP CRITICAL HTTP/x.x %ld unknown - %s", code, msg);
@@ -962,7 +1113,13 @@ int check_http(void) {
 
 	/* print status line, header, body if verbose */
 	if (verbose >= 2) {
-		printf("**** HEADER ****\n%s\n**** CONTENT ****\n%s\n", header_buf.buf, (no_body ? "  [[ skipped ]]" : body_buf.buf));
+		printf("**** HEADER ****\n%s\n**** CONTENT ****\n", header_buf.buf);
+		/* only the last window of a sliding body is left */
+		if (!no_body && body_buf.buflen == 0 && body_stream.decoded_len > 0)
+			printf(_("  [[ %zu bytes, none of them kept ]]\n"), body_stream.decoded_len);
+		else if (!no_body && body_buf.buflen < body_stream.decoded_len)
+			printf(_("  [[ showing the last %zu of %zu bytes ]]\n"), body_buf.buflen, body_stream.decoded_len);
+		printf("%s\n", no_body ? "  [[ skipped ]]" : body_buf.buf);
 	}
 
 	/* make sure the status line matches the response we are looking for */
@@ -1000,7 +1157,7 @@ int check_http(void) {
 					 * back here, we are in the same status as with
 					 * the libcurl method
 					 */
-					redir(&header_buf);
+					redir(&header_index);
 				}
 			} else {
 				/* this is a specific code in the command line to
@@ -1032,7 +1189,7 @@ int check_http(void) {
 	}
 
 	if (maximum_age >= 0) {
-		result = max_state_alt(check_document_dates(&header_buf, &msg), result);
+		result = max_state_alt(check_document_dates(&header_index, &msg), result);
 	}
 
 	/* Page and Header content checks go here */
@@ -1058,7 +1215,7 @@ int check_http(void) {
 	}
 
 	if (strlen(string_expect)) {
-		if (!strstr(body_buf.buf, string_expect)) {
+		if (!body_stream.string_found) {
 
 			strncpy(&output_string_search[0], string_expect, sizeof(output_string_search));
 
@@ -1078,7 +1235,7 @@ int check_http(void) {
 	}
 
 	if (strlen(regexp)) {
-		errcode = regexec(&preg, body_buf.buf, REGS, pmatch, 0);
+		errcode = body_stream.regex_found ? 0 : (body_stream.regex_errcode ? body_stream.regex_errcode : REG_NOMATCH);
 		if ((errcode == 0 && !invert_regex) || (errcode == REG_NOMATCH && invert_regex)) {
 			/* OK - No-op to avoid changing the logic around it */
 			result = max_state_alt(STATE_OK, result);
@@ -1107,6 +1264,38 @@ int check_http(void) {
 		}
 	}
 
+	/* JSON path assertions */
+	bool json_error_reported = false;
+	for (i = 0; i < nof_json_paths; i++) {
+		char tmp[DEFAULT_BUFFER_SIZE];
+
+		if (!json_paths[i].found) {
+			if (json.status != JSON_ERROR)
+				snprintf(tmp, DEFAULT_BUFFER_SIZE, _("%sJSON path '%s' not found, "), msg, json_paths[i].expression);
+			else if (!json_error_reported)
+				snprintf(tmp, DEFAULT_BUFFER_SIZE, _("%sinvalid JSON at byte %zu, "), msg, json.offset);
+			else
+				continue;
+			json_error_reported = json.status == JSON_ERROR;
+			strcpy(msg, tmp);
+			result = max_state_alt(STATE_CRITICAL, result);
+		} else if (!json_paths[i].is_number) {
+			snprintf(tmp, DEFAULT_BUFFER_SIZE, _("%sJSON path '%s' is not a number, "), msg, json_paths[i].expression);
+			strcpy(msg, tmp);
+			result = max_state_alt(STATE_UNKNOWN, result);
+		} else {
+			int json_result = get_status(json_paths[i].value, json_thlds[i]);
+			size_t perfstring_len = strlen(perfstring);
+
+			if (json_result != STATE_OK) {
+				snprintf(tmp, DEFAULT_BUFFER_SIZE, _("%sJSON path '%s' is %g, "), msg, json_paths[i].expression, json_paths[i].value);
+				strcpy(msg, tmp);
+			}
+			result = max_state_alt(json_result, result);
+			snprintf(perfstring + perfstring_len, DEFAULT_BUFFER_SIZE - perfstring_len, " %s", perfd_json(i));
+		}
+	}
+
 	/* make sure the page is of an appropriate size */
 	if ((max_page_len > 0) && (page_len > max_page_len)) {
 		char tmp[DEFAULT_BUFFER_SIZE];
@@ -1162,26 +1351,17 @@ char *uri_string(const UriTextRangeA range, char *buf, size_t buflen) {
 	return buf;
 }
 
-void redir(curlhelp_write_curlbuf *header_buf) {
+void redir(const curlhelp_header_index *header_index) {
 	char *location = NULL;
-	curlhelp_statusline status_line;
-	struct phr_header headers[255];
-	size_t nof_headers = 255;
-	size_t msglen;
 	char buf[DEFAULT_BUFFER_SIZE];
 	char ipstr[INET_ADDR_MAX_SIZE];
 	int new_port;
 	char *new_host;
 	char *new_url;
 
-	int res = phr_parse_response(header_buf->buf, header_buf->buflen, &status_line.http_major, &status_line.http_minor,
-								 &status_line.http_code, &status_line.msg, &msglen, headers, &nof_headers, 0);
-
-	if (res == -1) {
-		die(STATE_UNKNOWN, _("HTTP UNKNOWN - Failed to parse Response\n"));
-	}
-
-	location = get_header_value(headers, nof_headers, "location");
+	location = get_header_value(header_index, "location");
+	if (location == NULL)
+		die(STATE_UNKNOWN, _("HTTP UNKNOWN - Redirect without Location header%s\n"), (display_html ? "</A>" : ""));
 
 	if (verbose >= 2)
 		printf(_("* Seen redirect location %s\n"), location);
@@ -1190,6 +1370,15 @@ void redir(curlhelp_write_curlbuf *header_buf) {
 		die(STATE_WARNING, _("HTTP WARNING - maximum redirection depth %d exceeded - %s%s\n"), max_depth, location,
 			(display_html ? "</A>" : ""));
 
+	if (redir_times == NULL && (redir_times = calloc(max_depth, sizeof(double))) == NULL)
+		die(STATE_UNKNOWN, _("HTTP UNKNOWN - Unable to allocate memory\n"));
+	redir_times[redir_depth - 1] = total_time;
+	if (verbose) {
+		long num_connects = 0;
+		curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &num_connects);
+		printf(_("* Redirect hop %d took %.3f seconds (%ld new connections)\n"), redir_depth, total_time, num_connects);
+	}
+
 	UriParserStateA state;
 	UriUriA uri;
 	state.uri = &uri;
@@ -1307,7 +1496,7 @@ void redir(curlhelp_write_curlbuf *header_buf) {
 	 * attached to the URL in Location
 	 */
 
-	cleanup();
+	cleanup_request();
 	check_http();
 }
 
@@ -1333,7 +1522,8 @@ bool process_arguments(int argc, char **argv) {
 		AUTOMATIC_DECOMPRESSION,
 		COOKIE_JAR,
 		HAPROXY_PROTOCOL,
-		STATE_REGEX
+		STATE_REGEX,
+		JSON_PATH
 	};
 
 	int option = 0;
@@ -1381,6 +1571,7 @@ bool process_arguments(int argc, char **argv) {
 									   {"enable-automatic-decompression", no_argument, 0, AUTOMATIC_DECOMPRESSION},
 									   {"cookie-jar", required_argument, 0, COOKIE_JAR},
 									   {"haproxy-protocol", no_argument, 0, HAPROXY_PROTOCOL},
+									   {"json-path", required_argument, 0, JSON_PATH},
 									   {0, 0, 0, 0}};
 
 	if (argc < 2)
@@ -1798,6 +1989,28 @@ bool process_arguments(int argc, char **argv) {
 		case HAPROXY_PROTOCOL:
 			haproxy_protocol = true;
 			break;
+		case JSON_PATH: /* PATH[,WARNING[,CRITICAL]] */
+		{
+			char *json_warn = NULL;
+			char *json_crit = NULL;
+
+			if (nof_json_paths >= JSON_MAX_PATHS) {
+				char max_paths[16];
+
+				snprintf(max_paths, sizeof(max_paths), "%d", JSON_MAX_PATHS);
+				usage2(_("Too many JSON paths, the maximum is"), max_paths);
+			}
+			if ((json_warn = strchr(optarg, ',')) != NULL) {
+				*json_warn++ = '\0';
+				if ((json_crit = strchr(json_warn, ',')) != NULL)
+					*json_crit++ = '\0';
+			}
+			if (json_path_compile(optarg, &json_paths[nof_json_paths]) != 0)
+				usage2(_("Invalid JSON path"), optarg);
+			set_thresholds(&json_thlds[nof_json_paths], json_warn && *json_warn ? json_warn : NULL,
+						   json_crit && *json_crit ? json_crit : NULL);
+			nof_json_paths++;
+		} break;
 		case '?':
 			/* print short usage statement if args not parsable */
 			usage5();
@@ -1869,11 +2082,34 @@ char *perfd_time_transfer(double elapsed_time_transfer) {
 	return fperfdata("time_transfer", elapsed_time_transfer, "s", false, 0, false, 0, false, 0, true, socket_timeout);
 }
 
+char *perfd_time_redirect(int hop, double elapsed_time_redirect) {
+	char label[32];
+
+	snprintf(label, sizeof(label), "time_redirect_%d", hop);
+	return fperfdata(label, elapsed_time_redirect, "s", false, 0, false, 0, false, 0, true, socket_timeout);
+}
+
 char *perfd_size(int page_len) {
 	return perfdata("size", page_len, "B", (min_page_len > 0 ? true : false), min_page_len, (min_page_len > 0 ? true : false), 0, true, 0,
 					false, 0);
 }
 
+char *perfd_json(int json_path_index) {
+	const thresholds *thlds = json_thlds[json_path_index];
+
+	return fperfdata(json_paths[json_path_index].expression, json_paths[json_path_index].value, "", thlds->warning ? true : false,
+					 thlds->warning ? thlds->warning->end : 0, thlds->critical ? true : false, thlds->critical ? thlds->critical->end : 0,
+					 false, 0, false, 0);
+}
+
+char *perfd_size_wire(int page_len_wire) {
+	return perfdata("size_wire", page_len_wire, "B", false, 0, false, 0, true, 0, false, 0);
+}
+
+char *perfd_compression_ratio(double ratio) {
+	return fperfdata("compression_ratio", ratio, "", false, 0, false, 0, true, 0, false, 0);
+}
+
 void print_help(void) {
 	print_revision(progname, NP_VERSION);
 
@@ -1998,6 +2234,8 @@ void print_help(void) {
 	printf("    %s\n", _("How to handle redirected pages. sticky is like follow but stick to the"));
 	printf("    %s\n", _("specified IP address. stickyport also ensures port stays the same."));
 	printf("    %s\n", _("follow uses the old redirection algorithm of check_http."));
+	printf("    %s\n", _("It reuses the connection and resolved addresses for the next hop and reports"));
+	printf("    %s\n", _("the response time of every hop as time_redirect_N performance data."));
 	printf("    %s\n", _("curl uses CURL_FOLLOWLOCATION built into libcurl."));
 	printf(" %s\n", "--max-redirs=INTEGER");
 	printf("    %s", _("Maximal number of redirects (default: "));
@@ -2010,8 +2248,20 @@ void print_help(void) {
 	printf("    %s\n", _("1.0 = HTTP/1.0, 1.1 = HTTP/1.1, 2.0 = HTTP/2 (HTTP/2 will fail without -S)"));
 	printf(" %s\n", "--enable-automatic-decompression");
 	printf("    %s\n", _("Enable automatic decompression of body (CURLOPT_ACCEPT_ENCODING)."));
+	printf("    %s\n", _("Unless -B or -l is given, -s and -r are evaluated on a sliding window over the"));
+	printf("    %s\n", _("decoded body instead of keeping all of it in memory, only a line matched by -r"));
+	printf("    %s\n", _("is kept as a whole. Adds the transferred size and the compression ratio to the"));
+	printf("    %s\n", _("performance data."));
 	printf(" %s\n", "--haproxy-protocol");
 	printf("    %s\n", _("Send HAProxy proxy protocol v1 header (CURLOPT_HAPROXYPROTOCOL)."));
+	printf(" %s\n", "--json-path=PATH[,WARNING[,CRITICAL]]");
+	printf("    %s\n", _("Extract the value at PATH (e.g. $.db.replicas[0].lag) from a JSON body and"));
+	printf("    %s\n", _("check it against the WARNING and CRITICAL ranges. Numbers, numeric strings"));
+	printf("    %s\n", _("and booleans (1/0) are accepted. The value is added to the performance data."));
+	printf("    %s\n", _("The body is parsed while it is received and, unless other content checks need"));
+	printf("    %s\n", _("it, the transfer stops as soon as all paths are found. Unless -B is given, the"));
+	printf("    %s", _("body is not kept in memory as a whole. Can be given up to "));
+	printf("%d %s\n", JSON_MAX_PATHS, _("times."));
 	printf(" %s\n", "--cookie-jar=FILE");
 	printf("    %s\n", _("Store cookies in the cookie jar and send them out when requested."));
 	printf("    %s\n", _("Specify an empty string as FILE to enable curl's cookie engine without saving"));
@@ -2097,7 +2347,7 @@ void print_usage(void) {
 	printf("       [-A string] [-k string] [-S <version>] [--sni] [--haproxy-protocol]\n");
 	printf("       [-T <content-type>] [-j method]\n");
 	printf("       [--http-version=<version>] [--enable-automatic-decompression]\n");
-	printf("       [--cookie-jar=<cookie jar file>\n");
+	printf("       [--cookie-jar=<cookie jar file>] [--json-path=<path>[,<warn>[,<crit>]]]\n");
 	printf(" %s -H <vhost> | -I <IP-address> -C <warn_age>[,<crit_age>]\n", progname);
 	printf("       [-p <port>] [-t <timeout>] [-4|-6] [--sni]\n");
 	printf("\n");
@@ -2148,6 +2398,85 @@ size_t curlhelp_buffer_read_callback(void *buffer, size_t size, size_t nmemb, vo
 	return (int)n;
 }
 
+void curlhelp_initbodystream(curlhelp_body_stream *body, curlhelp_write_curlbuf *buf, bool sliding) {
+	memset(body, 0, sizeof(*body));
+	body->buf = buf;
+	body->sliding = sliding;
+	body->window_limit = BODY_WINDOW_SIZE;
+}
+
+/* run the content checks on what is currently buffered, a match is
+ * remembered, so later windows do not need to be searched again. Unless
+ * the body is complete, the end of the window is not the end of a line */
+void curlhelp_check_body(curlhelp_body_stream *body, bool complete) {
+	if (body->buf->buflen == 0)
+		return;
+
+	if (strlen(string_expect) && !body->string_found)
+		body->string_found = strstr(body->buf->buf, string_expect) != NULL;
+
+	if (strlen(regexp) && !body->regex_found && body->regex_errcode == 0) {
+		int eflags = (body->mid_line ? REG_NOTBOL : 0) | (complete ? 0 : REG_NOTEOL);
+		int regex_errcode = regexec(&preg, body->buf->buf, REGS, pmatch, eflags);
+		if (regex_errcode == 0)
+			body->regex_found = true;
+		else if (regex_errcode != REG_NOMATCH)
+			body->regex_errcode = regex_errcode;
+	}
+}
+
+/* where the next window starts, 0 if nothing can be dropped yet */
+static size_t curlhelp_body_keep_from(const curlhelp_body_stream *body) {
+	size_t keep_from = body->buf->buflen;
+
+	if (strlen(string_expect) && !body->string_found && keep_from > strlen(string_expect) - 1)
+		keep_from -= strlen(string_expect) - 1;
+
+	if (strlen(regexp) && !body->regex_found && body->regex_errcode == 0) {
+		size_t line_start = body->buf->buflen;
+
+		while (line_start > 0 && body->buf->buf[line_start - 1] != '\n')
+			line_start--;
+		if (line_start < keep_from)
+			keep_from = line_start;
+	}
+
+	return keep_from;
+}
+
+size_t curlhelp_body_callback(void *buffer, size_t size, size_t nmemb, void *stream) {
+	curlhelp_body_stream *body = (curlhelp_body_stream *)stream;
+	size_t written;
+
+	written = curlhelp_buffer_write_callback(buffer, size, nmemb, body->buf);
+	if (written != size * nmemb)
+		return written;
+	body->decoded_len += written;
+
+	if (body->json != NULL && json_parser_feed(body->json, buffer, written) == JSON_DONE && body->stop_when_resolved) {
+		if (verbose >= 1)
+			printf("* all JSON paths resolved after %zu bytes, stop reading the body\n", body->decoded_len);
+		body->stopped = true;
+		return 0;
+	}
+
+	/* window is full: check it and keep only what a match may still need */
+	if (body->sliding && body->buf->buflen >= body->window_limit) {
+		size_t keep_from = curlhelp_body_keep_from(body);
+
+		if (keep_from > 0) {
+			curlhelp_check_body(body, false);
+			body->mid_line = body->buf->buf[keep_from - 1] != '\n';
+			memmove(body->buf->buf, body->buf->buf + keep_from, body->buf->buflen - keep_from + 1);
+			body->buf->buflen -= keep_from;
+		}
+		/* a line longer than a window has to be seen as a whole */
+		body->window_limit = body->buf->buflen + BODY_WINDOW_SIZE;
+	}
+
+	return written;
+}
+
 void curlhelp_freewritebuffer(curlhelp_write_curlbuf *buf) {
 	free(buf->buf);
 	buf->buf = NULL;
@@ -2168,64 +2497,157 @@ void curlhelp_freereadbuffer(curlhelp_read_curlbuf *buf) {
 	buf->buf = NULL;
 }
 
-/* TODO: where to put this, it's actually part of sstrings2 (logically)?
- */
-const char *strrstr2(const char *haystack, const char *needle) {
-	int counter;
-	size_t len;
-	const char *prev_pos;
-	const char *pos;
+/* FNV-1a over the lower-cased header name, header names are case-insensitive */
+static unsigned int curlhelp_header_hash(const char *name, size_t len) {
+	unsigned int hash = 2166136261U;
 
-	if (haystack == NULL || needle == NULL)
-		return NULL;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (unsigned char)tolower((unsigned char)name[i]);
+		hash *= 16777619U;
+	}
 
-	if (haystack[0] == '\0' || needle[0] == '\0')
+	return hash;
+}
+
+void curlhelp_initheaderindex(curlhelp_header_index *index, curlhelp_write_curlbuf *buf) {
+	memset(index, 0, sizeof(*index));
+	index->buf = buf;
+}
+
+void curlhelp_freeheaderindex(curlhelp_header_index *index) {
+	free(index->slots);
+	index->slots = NULL;
+	index->size = 0;
+	index->nof_headers = 0;
+}
+
+/* doubles the number of slots, the headers are already known to be unique */
+static void curlhelp_grow_header_index(curlhelp_header_index *index) {
+	size_t new_size = index->size ? index->size * 2 : HEADER_INDEX_INITIAL_SIZE;
+	curlhelp_header_slot *new_slots = calloc(new_size, sizeof(*new_slots));
+
+	if (new_slots == NULL)
+		die(STATE_UNKNOWN, "HTTP CRITICAL - out of memory allocating header index\n");
+
+	for (size_t i = 0; i < index->size; i++) {
+		size_t slot;
+
+		if (index->slots[i].name_len == 0)
+			continue;
+		slot = index->slots[i].hash & (new_size - 1);
+		while (new_slots[slot].name_len != 0)
+			slot = (slot + 1) & (new_size - 1);
+		new_slots[slot] = index->slots[i];
+	}
+
+	free(index->slots);
+	index->slots = new_slots;
+	index->size = new_size;
+}
+
+static void curlhelp_index_header(curlhelp_header_index *index, size_t name_off, size_t name_len, size_t value_off, size_t value_len) {
+	unsigned int hash = curlhelp_header_hash(index->buf->buf + name_off, name_len);
+	size_t slot;
+
+	if ((index->nof_headers + 1) * 4 > index->size * 3)
+		curlhelp_grow_header_index(index);
+
+	slot = hash & (index->size - 1);
+	while (index->slots[slot].name_len != 0) {
+		/* keep the first occurrence of a repeated header */
+		if (index->slots[slot].hash == hash && index->slots[slot].name_len == name_len &&
+			strncasecmp(index->buf->buf + index->slots[slot].name_off, index->buf->buf + name_off, name_len) == 0)
+			return;
+		slot = (slot + 1) & (index->size - 1);
+	}
+
+	index->slots[slot].hash = hash;
+	index->slots[slot].name_off = name_off;
+	index->slots[slot].name_len = name_len;
+	index->slots[slot].value_off = value_off;
+	index->slots[slot].value_len = value_len;
+	index->nof_headers++;
+}
+
+/* libcurl passes exactly one complete header line per call, so every line is
+ * stored and indexed as it arrives */
+size_t curlhelp_header_callback(void *buffer, size_t size, size_t nmemb, void *stream) {
+	curlhelp_header_index *index = (curlhelp_header_index *)stream;
+	size_t line_off = index->buf->buflen;
+	size_t line_len = size * nmemb;
+	size_t written;
+	const char *line;
+	const char *colon;
+	size_t value_off;
+	size_t value_end;
+
+	written = curlhelp_buffer_write_callback(buffer, size, nmemb, index->buf);
+	if (written != line_len)
+		return written;
+
+	line = index->buf->buf + line_off;
+	while (line_len > 0 && (line[line_len - 1] == '\r' || line[line_len - 1] == '\n'))
+		line_len--;
+
+	/* a new response starts (interim 1xx, proxy CONNECT, redirect hop),
+	 * only the headers of the last one are of interest */
+	if (line_len >= strlen(HTTP_EXPECT) && strncmp(line, HTTP_EXPECT, strlen(HTTP_EXPECT)) == 0) {
+		if (index->slots != NULL)
+			memset(index->slots, 0, index->size * sizeof(*index->slots));
+		index->nof_headers = 0;
+		index->have_status_line = true;
+		index->status_line_off = line_off;
+		index->status_line_len = line_len;
+		return written;
+	}
+
+	/* empty line at the end of the headers or no header at all */
+	colon = memchr(line, ':', line_len);
+	if (colon == NULL || colon == line)
+		return written;
+
+	value_off = (size_t)(colon - line) + 1;
+	while (value_off < line_len && (line[value_off] == ' ' || line[value_off] == '\t'))
+		value_off++;
+	value_end = line_len;
+	while (value_end > value_off && (line[value_end - 1] == ' ' || line[value_end - 1] == '\t'))
+		value_end--;
+
+	curlhelp_index_header(index, line_off, (size_t)(colon - line), line_off + value_off, value_end - value_off);
+
+	return written;
+}
+
+static const curlhelp_header_slot *curlhelp_find_header(const curlhelp_header_index *index, const char *name) {
+	size_t name_len = strlen(name);
+	unsigned int hash = curlhelp_header_hash(name, name_len);
+	size_t slot;
+
+	if (index->size == 0)
 		return NULL;
 
-	counter = 0;
-	prev_pos = NULL;
-	pos = haystack;
-	len = strlen(needle);
-	for (;;) {
-		pos = strstr(pos, needle);
-		if (pos == NULL) {
-			if (counter == 0)
-				return NULL;
-			return prev_pos;
-		}
-		counter++;
-		prev_pos = pos;
-		pos += len;
-		if (*pos == '\0')
-			return prev_pos;
+	slot = hash & (index->size - 1);
+	while (index->slots[slot].name_len != 0) {
+		if (index->slots[slot].hash == hash && index->slots[slot].name_len == name_len &&
+			strncasecmp(index->buf->buf + index->slots[slot].name_off, name, name_len) == 0)
+			return &index->slots[slot];
+		slot = (slot + 1) & (index->size - 1);
 	}
+
+	return NULL;
 }
 
-int curlhelp_parse_statusline(const char *buf, curlhelp_statusline *status_line) {
-	char *first_line_end;
+int curlhelp_parse_statusline(const curlhelp_header_index *header_index, curlhelp_statusline *status_line) {
 	char *p;
-	size_t first_line_len;
 	char *pp;
-	const char *start;
 	char *first_line_buf;
 
-	/* find last start of a new header */
-	start = strrstr2(buf, "\r\nHTTP/");
-	if (start != NULL) {
-		start += 2;
-		buf = start;
-	}
-
-	first_line_end = strstr(buf, "\r\n");
-	if (first_line_end == NULL)
+	if (!header_index->have_status_line)
 		return -1;
 
-	first_line_len = (size_t)(first_line_end - buf);
-	status_line->first_line = (char *)malloc(first_line_len + 1);
+	status_line->first_line = strndup(header_index->buf->buf + header_index->status_line_off, header_index->status_line_len);
 	if (status_line->first_line == NULL)
 		return -1;
-	memcpy(status_line->first_line, buf, first_line_len);
-	status_line->first_line[first_line_len] = '\0';
 	first_line_buf = strdup(status_line->first_line);
 
 	/* protocol and version: "HTTP/x.x" SP or "HTTP/2" SP */
@@ -2315,33 +2737,21 @@ int curlhelp_parse_statusline(const char *buf, curlhelp_statusline *status_line)
 
 void curlhelp_free_statusline(curlhelp_statusline *status_line) { free(status_line->first_line); }
 
-char *get_header_value(const struct phr_header *headers, const size_t nof_headers, const char *header) {
-	for (size_t i = 0; i < nof_headers; i++) {
-		if (headers[i].name != NULL && strncasecmp(header, headers[i].name, max(headers[i].name_len, 4)) == 0) {
-			return strndup(headers[i].value, headers[i].value_len);
-		}
-	}
-	return NULL;
+char *get_header_value(const curlhelp_header_index *header_index, const char *header) {
+	const curlhelp_header_slot *slot = curlhelp_find_header(header_index, header);
+
+	if (slot == NULL)
+		return NULL;
+	return strndup(header_index->buf->buf + slot->value_off, slot->value_len);
 }
 
-int check_document_dates(const curlhelp_write_curlbuf *header_buf, char (*msg)[DEFAULT_BUFFER_SIZE]) {
+int check_document_dates(const curlhelp_header_index *header_index, char (*msg)[DEFAULT_BUFFER_SIZE]) {
 	char *server_date = NULL;
 	char *document_date = NULL;
 	int date_result = STATE_OK;
-	curlhelp_statusline status_line;
-	struct phr_header headers[255];
-	size_t nof_headers = 255;
-	size_t msglen;
 
-	int res = phr_parse_response(header_buf->buf, header_buf->buflen, &status_line.http_major, &status_line.http_minor,
-								 &status_line.http_code, &status_line.msg, &msglen, headers, &nof_headers, 0);
-
-	if (res == -1) {
-		die(STATE_UNKNOWN, _("HTTP UNKNOWN - Failed to parse Response\n"));
-	}
-
-	server_date = get_header_value(headers, nof_headers, "date");
-	document_date = get_header_value(headers, nof_headers, "last-modified");
+	server_date = get_header_value(header_index, "date");
+	document_date = get_header_value(header_index, "last-modified");
 
 	if (!server_date || !*server_date) {
 		char tmp[DEFAULT_BUFFER_SIZE];
@@ -2413,35 +2823,23 @@ int check_document_dates(const curlhelp_write_curlbuf *header_buf, char (*msg)[D
 	return date_result;
 }
 
-int get_content_length(const curlhelp_write_curlbuf *header_buf, const curlhelp_write_curlbuf *body_buf) {
+int get_content_length(const curlhelp_header_index *header_index, const curlhelp_body_stream *body_stream) {
 	size_t content_length = 0;
-	struct phr_header headers[255];
-	size_t nof_headers = 255;
-	size_t msglen;
 	char *content_length_s = NULL;
-	curlhelp_statusline status_line;
-
-	int res = phr_parse_response(header_buf->buf, header_buf->buflen, &status_line.http_major, &status_line.http_minor,
-								 &status_line.http_code, &status_line.msg, &msglen, headers, &nof_headers, 0);
-
-	if (res == -1) {
-		die(STATE_UNKNOWN, _("HTTP UNKNOWN - Failed to parse Response\n"));
-	}
 
-	content_length_s = get_header_value(headers, nof_headers, "content-length");
+	content_length_s = get_header_value(header_index, "content-length");
 	if (!content_length_s) {
-		return header_buf->buflen + body_buf->buflen;
+		return header_index->buf->buflen + body_stream->decoded_len;
 	}
-	content_length_s += strspn(content_length_s, " \t");
 	content_length = atoi(content_length_s);
-	if (content_length != body_buf->buflen) {
+	if (content_length != body_stream->decoded_len) {
 		/* TODO: should we warn if the actual and the reported body length don't match? */
 	}
 
 	if (content_length_s)
 		free(content_length_s);
 
-	return header_buf->buflen + body_buf->buflen;
+	return header_index->buf->buflen + body_stream->decoded_len;
 }
 
 /* TODO: is there a better way in libcurl to check for the SSL library? */
@@ -0,0 +1,343 @@
+#include "./json.h"
+
+#include <ctype.h>
+
+int json_path_compile(const char *expression, json_path *path) {
+	const char *p = expression;
+
+	memset(path, 0, sizeof(*path));
+
+	/* "$" denotes the root, "$.a", ".a" and "a" all address member a */
+	if (*p == '$')
+		p++;
+
+	while (*p != '\0') {
+		json_path_segment segment = {NULL, 0};
+
+		if (*p == '[') {
+			char *end;
+			segment.index = strtol(p + 1, &end, 10);
+			if (end == p + 1 || *end != ']' || segment.index < 0)
+				goto syntax_error;
+			p = end + 1;
+		} else {
+			size_t len;
+			if (*p == '.')
+				p++;
+			len = strcspn(p, ".[");
+			if (len == 0)
+				goto syntax_error;
+			segment.key = strndup(p, len);
+			if (segment.key == NULL)
+				goto syntax_error;
+			p += len;
+		}
+
+		json_path_segment *segments = realloc(path->segments, sizeof(json_path_segment) * (path->nof_segments + 1));
+		if (segments == NULL || path->nof_segments >= JSON_MAX_DEPTH) {
+			free(segment.key);
+			if (segments != NULL)
+				path->segments = segments;
+			goto syntax_error;
+		}
+		path->segments = segments;
+		path->segments[path->nof_segments++] = segment;
+	}
+
+	path->expression = strdup(expression);
+	return 0;
+
+syntax_error:
+	json_path_free(path);
+	return -1;
+}
+
+void json_path_free(json_path *path) {
+	for (int i = 0; i < path->nof_segments; i++)
+		free(path->segments[i].key);
+	free(path->segments);
+	free(path->expression);
+	memset(path, 0, sizeof(*path));
+}
+
+void json_parser_init(json_parser *parser, json_path *paths, int nof_paths) {
+	memset(parser, 0, sizeof(*parser));
+	parser->paths = paths;
+	parser->nof_paths = nof_paths;
+	parser->state = JSON_LEX_VALUE;
+	parser->status = nof_paths > 0 ? JSON_CONTINUE : JSON_DONE;
+
+	for (int i = 0; i < nof_paths; i++) {
+		paths[i].found = false;
+		paths[i].is_number = false;
+		paths[i].value = 0;
+	}
+}
+
+/* does the path of the value just completed match the requested one */
+static bool json_path_matches(const json_parser *parser, const json_path *path) {
+	if (path->nof_segments != parser->depth)
+		return false;
+
+	for (int i = 0; i < parser->depth; i++) {
+		const json_frame *frame = &parser->stack[i];
+		const json_path_segment *segment = &path->segments[i];
+
+		if (segment->key != NULL) {
+			if (!frame->is_object || strcmp(frame->key, segment->key) != 0)
+				return false;
+		} else {
+			if (frame->is_object || frame->index != segment->index)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+typedef enum {
+	JSON_VALUE_NUMBER,
+	JSON_VALUE_STRING,
+	JSON_VALUE_LITERAL,
+	JSON_VALUE_CONTAINER
+} json_value_type;
+
+static void json_emit_value(json_parser *parser, json_value_type type) {
+	parser->token[parser->token_len] = '\0';
+
+	for (int i = 0; i < parser->nof_paths; i++) {
+		json_path *path = &parser->paths[i];
+		char *end;
+
+		if (path->found || !json_path_matches(parser, path))
+			continue;
+
+		path->found = true;
+		parser->nof_resolved++;
+
+		switch (type) {
+		case JSON_VALUE_NUMBER:
+		case JSON_VALUE_STRING:
+			path->value = strtod(parser->token, &end);
+			path->is_number = end != parser->token && *end == '\0';
+			break;
+		case JSON_VALUE_LITERAL:
+			path->is_number = strcmp(parser->token, "null") != 0;
+			path->value = strcmp(parser->token, "true") == 0 ? 1 : 0;
+			break;
+		case JSON_VALUE_CONTAINER:
+			path->is_number = false;
+			break;
+		}
+	}
+
+	if (parser->nof_resolved == parser->nof_paths)
+		parser->status = JSON_DONE;
+}
+
+static void json_append_token(json_parser *parser, char c) {
+	if (parser->token_len < JSON_MAX_TOKEN - 1)
+		parser->token[parser->token_len++] = c;
+}
+
+static void json_append_codepoint(json_parser *parser, unsigned int cp) {
+	if (cp < 0x80) {
+		json_append_token(parser, (char)cp);
+	} else if (cp < 0x800) {
+		json_append_token(parser, (char)(0xc0 | (cp >> 6)));
+		json_append_token(parser, (char)(0x80 | (cp & 0x3f)));
+	} else {
+		json_append_token(parser, (char)(0xe0 | (cp >> 12)));
+		json_append_token(parser, (char)(0x80 | ((cp >> 6) & 0x3f)));
+		json_append_token(parser, (char)(0x80 | (cp & 0x3f)));
+	}
+}
+
+static void json_end_string(json_parser *parser) {
+	parser->token[parser->token_len] = '\0';
+
+	if (parser->string_is_key) {
+		json_frame *frame = &parser->stack[parser->depth - 1];
+		memcpy(frame->key, parser->token, parser->token_len + 1);
+		frame->expect_key = false;
+	} else {
+		json_emit_value(parser, JSON_VALUE_STRING);
+	}
+}
+
+static void json_end_literal(json_parser *parser) {
+	parser->token[parser->token_len] = '\0';
+
+	if (strcmp(parser->token, "true") != 0 && strcmp(parser->token, "false") != 0 && strcmp(parser->token, "null") != 0)
+		parser->status = JSON_ERROR;
+	else
+		json_emit_value(parser, JSON_VALUE_LITERAL);
+}
+
+/* a character outside of strings, numbers and literals */
+static void json_structural(json_parser *parser, char c) {
+	json_frame *top = parser->depth > 0 ? &parser->stack[parser->depth - 1] : NULL;
+
+	switch (c) {
+	case ' ':
+	case '\t':
+	case '\r':
+	case '\n':
+		break;
+	case '{':
+	case '[':
+		parser->token_len = 0;
+		json_emit_value(parser, JSON_VALUE_CONTAINER);
+		if (parser->depth >= JSON_MAX_DEPTH) {
+			parser->status = JSON_ERROR;
+			break;
+		}
+		top = &parser->stack[parser->depth++];
+		top->is_object = (c == '{');
+		top->expect_key = top->is_object;
+		top->index = 0;
+		top->key[0] = '\0';
+		break;
+	case '}':
+	case ']':
+		if (top == NULL || top->is_object != (c == '}'))
+			parser->status = JSON_ERROR;
+		else
+			parser->depth--;
+		break;
+	case ',':
+		if (top == NULL)
+			parser->status = JSON_ERROR;
+		else if (top->is_object)
+			top->expect_key = true;
+		else
+			top->index++;
+		break;
+	case ':':
+		if (top == NULL || !top->is_object)
+			parser->status = JSON_ERROR;
+		break;
+	case '"':
+		parser->state = JSON_LEX_STRING;
+		parser->string_is_key = top != NULL && top->is_object && top->expect_key;
+		parser->token_len = 0;
+		break;
+	case 't':
+	case 'f':
+	case 'n':
+		parser->state = JSON_LEX_LITERAL;
+		parser->token_len = 0;
+		json_append_token(parser, c);
+		break;
+	default:
+		if (c == '-' || isdigit((unsigned char)c)) {
+			parser->state = JSON_LEX_NUMBER;
+			parser->token_len = 0;
+			json_append_token(parser, c);
+		} else {
+			parser->status = JSON_ERROR;
+		}
+		break;
+	}
+}
+
+json_status json_parser_feed(json_parser *parser, const char *buf, size_t len) {
+	for (size_t i = 0; i < len && parser->status == JSON_CONTINUE; i++) {
+		char c = buf[i];
+
+		switch (parser->state) {
+		case JSON_LEX_VALUE:
+			json_structural(parser, c);
+			break;
+		case JSON_LEX_STRING:
+			if (c == '"') {
+				parser->state = JSON_LEX_VALUE;
+				json_end_string(parser);
+			} else if (c == '\\') {
+				parser->state = JSON_LEX_STRING_ESCAPE;
+			} else {
+				json_append_token(parser, c);
+			}
+			break;
+		case JSON_LEX_STRING_ESCAPE:
+			parser->state = JSON_LEX_STRING;
+			switch (c) {
+			case 'b':
+				json_append_token(parser, '\b');
+				break;
+			case 'f':
+				json_append_token(parser, '\f');
+				break;
+			case 'n':
+				json_append_token(parser, '\n');
+				break;
+			case 'r':
+				json_append_token(parser, '\r');
+				break;
+			case 't':
+				json_append_token(parser, '\t');
+				break;
+			case 'u':
+				parser->state = JSON_LEX_STRING_UNICODE;
+				parser->codepoint = 0;
+				parser->codepoint_digits = 0;
+				break;
+			default: /* \" \\ \/ */
+				json_append_token(parser, c);
+				break;
+			}
+			break;
+		case JSON_LEX_STRING_UNICODE:
+			if (!isxdigit((unsigned char)c)) {
+				parser->status = JSON_ERROR;
+				break;
+			}
+			parser->codepoint = parser->codepoint * 16 + (isdigit((unsigned char)c) ? c - '0' : tolower((unsigned char)c) - 'a' + 10);
+			if (++parser->codepoint_digits == 4) {
+				json_append_codepoint(parser, parser->codepoint);
+				parser->state = JSON_LEX_STRING;
+			}
+			break;
+		case JSON_LEX_NUMBER:
+			if (isdigit((unsigned char)c) || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+				json_append_token(parser, c);
+			} else {
+				parser->state = JSON_LEX_VALUE;
+				json_emit_value(parser, JSON_VALUE_NUMBER);
+				if (parser->status == JSON_CONTINUE)
+					json_structural(parser, c);
+			}
+			break;
+		case JSON_LEX_LITERAL:
+			if (isalpha((unsigned char)c)) {
+				json_append_token(parser, c);
+			} else {
+				parser->state = JSON_LEX_VALUE;
+				json_end_literal(parser);
+				if (parser->status == JSON_CONTINUE)
+					json_structural(parser, c);
+			}
+			break;
+		}
+
+		if (parser->status != JSON_ERROR)
+			parser->offset++;
+	}
+
+	return parser->status;
+}
+
+json_status json_parser_finish(json_parser *parser) {
+	if (parser->status != JSON_CONTINUE)
+		return parser->status;
+
+	if (parser->state == JSON_LEX_NUMBER) {
+		parser->state = JSON_LEX_VALUE;
+		json_emit_value(parser, JSON_VALUE_NUMBER);
+	} else if (parser->state == JSON_LEX_LITERAL) {
+		parser->state = JSON_LEX_VALUE;
+		json_end_literal(parser);
+	}
+
+	return parser->status;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../common.h"
+
+/*
+ * Streaming extraction of values from a JSON document
+ *
+ * The document is fed in arbitrary pieces (as they arrive from the network)
+ * to a small SAX style tokenizer, which only keeps the path to the current
+ * value. Whenever a value is complete, it is compared against the requested
+ * paths, nothing else of the document is stored.
+ */
+
+enum {
+	JSON_MAX_PATHS = 16,
+	JSON_MAX_DEPTH = 64,
+	JSON_MAX_TOKEN = 256 /* longer keys and strings are truncated */
+};
+
+typedef enum {
+	JSON_CONTINUE, /* more input needed */
+	JSON_DONE,     /* all requested paths are resolved */
+	JSON_ERROR     /* syntax error, see json_parser.offset */
+} json_status;
+
+typedef struct {
+	char *key;  /* member name, NULL for an array index */
+	long index; /* array index */
+} json_path_segment;
+
+typedef struct {
+	char *expression; /* as given by the user, e.g. "$.db.replicas[0].lag" */
+	json_path_segment *segments;
+	int nof_segments;
+	bool found;
+	bool is_number; /* numbers, true/false (1/0) and numeric strings */
+	double value;
+} json_path;
+
+typedef struct {
+	bool is_object;
+	bool expect_key;
+	long index;
+	char key[JSON_MAX_TOKEN];
+} json_frame;
+
+typedef enum {
+	JSON_LEX_VALUE,
+	JSON_LEX_STRING,
+	JSON_LEX_STRING_ESCAPE,
+	JSON_LEX_STRING_UNICODE,
+	JSON_LEX_NUMBER,
+	JSON_LEX_LITERAL
+} json_lex_state;
+
+typedef struct {
+	json_path *paths;
+	int nof_paths;
+	int nof_resolved;
+	json_frame stack[JSON_MAX_DEPTH];
+	int depth;
+	json_lex_state state;
+	bool string_is_key;
+	char token[JSON_MAX_TOKEN];
+	size_t token_len;
+	unsigned int codepoint;
+	int codepoint_digits;
+	json_status status;
+	size_t offset; /* bytes consumed so far */
+} json_parser;
+
+/* returns 0 on success, -1 if the expression can not be parsed */
+int json_path_compile(const char *expression, json_path *path);
+void json_path_free(json_path *path);
+
+void json_parser_init(json_parser *parser, json_path *paths, int nof_paths);
+json_status json_parser_feed(json_parser *parser, const char *buf, size_t len);
+/* end of input, completes a number or literal at the very end of the document */
+json_status json_parser_finish(json_parser *parser);
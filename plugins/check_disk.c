@@ -42,14 +42,22 @@ const char *email = "devel@monitoring-plugins.org";
 #include "popen.h"
 #include "utils.h"
 #include "utils_disk.h"
+#include "utils_mount.h"
+#include "utils_cmd.h"
 #include <stdarg.h>
 #include "fsusage.h"
 #include "mountlist.h"
 #include <float.h>
+#ifdef __linux__
+#	include <sys/sysmacros.h>
+#endif
 #if HAVE_LIMITS_H
 #	include <limits.h>
 #endif
 #include "regex.h"
+#include "./check_disk.d/disk_stat.h"
+#include "./check_disk.d/fill_rate.h"
+#include "./check_disk.d/io_stats.h"
 
 #ifdef __CYGWIN__
 #	include <windows.h>
@@ -98,19 +106,50 @@ static struct regex_list *fs_exclude_list = NULL;
    If the list is empty, include all types.  */
 static struct regex_list *fs_include_list;
 
-static struct name_list *dp_exclude_list;
+static struct name_hash dp_exclude_list;
 
 static struct parameter_list *path_select_list = NULL;
+static struct parameter_index path_select_index;
 
 /* Linked list of mounted filesystems. */
 static struct mount_entry *mount_list;
+static struct mount_snapshot mounts;
+
+/* A file system of a group, as it was before the totals were folded in */
+struct disk_group_member {
+	struct parameter_list *path;
+	char *label;
+	uint64_t dused_units, dtotal_units;
+	uintmax_t inodes_used, inodes_total;
+};
+
+/* Sums of all file systems of a group, every mount is counted once */
+struct disk_group {
+	uintmax_t total, available, available_to_root, used, inodes_free, inodes_free_to_root, inodes_used, inodes_total;
+	uint64_t dused_units, dfree_units, dtotal_units;
+	struct name_hash mounts;
+	struct disk_group_member *members;
+	size_t nof_members;
+};
+
+/* struct disk_group by group name */
+static struct name_hash groups;
 
 /* For long options that have no equivalent short option, use a
    non-character as a pseudo short option, starting with CHAR_MAX + 1.  */
 enum {
 	SYNC_OPTION = CHAR_MAX + 1,
 	NO_SYNC_OPTION,
-	BLOCK_SIZE_OPTION
+	BLOCK_SIZE_OPTION,
+	STAT_TIMEOUT_OPTION,
+	GROUP_MEMBER_PERFDATA_OPTION,
+	FILL_WARNING_OPTION,
+	FILL_CRITICAL_OPTION,
+	FILL_WINDOW_OPTION,
+	IO_STATS_OPTION,
+	IO_INTERVAL_OPTION,
+	IO_WARNING_OPTION,
+	IO_CRITICAL_OPTION
 };
 
 #ifdef _AIX
@@ -122,7 +161,14 @@ static void set_all_thresholds(struct parameter_list *path);
 static void print_help(void);
 void print_usage(void);
 static double calculate_percent(uintmax_t, uintmax_t);
-static bool stat_path(struct parameter_list *p);
+static disk_stat_status stat_path(struct parameter_list *p);
+static struct mount_entry *best_match_by_name(const char *name);
+static bool filesystem_excluded(struct mount_entry *me);
+static void stat_all_paths(void);
+static void probe_selected_paths(void);
+static void start_timeout(void);
+static disk_stat_status get_path_usage(struct parameter_list *p, struct fs_usage *fsp);
+static void aggregate_groups(void);
 static void get_stats(struct parameter_list *p, struct fs_usage *fsp);
 static void get_path_stats(struct parameter_list *p, struct fs_usage *fsp);
 
@@ -135,6 +181,7 @@ static bool exact_match = false;
 static bool ignore_missing = false;
 static bool freespace_ignore_reserved = false;
 static bool display_inodes_perfdata = false;
+static bool display_group_member_perfdata = false;
 static char *warn_freespace_units = NULL;
 static char *crit_freespace_units = NULL;
 static char *warn_freespace_percent = NULL;
@@ -150,8 +197,18 @@ static char *crit_freeinodes_percent = NULL;
 static bool path_selected = false;
 static bool path_ignored = false;
 static char *group = NULL;
-static struct stat *stat_buf;
-static struct name_list *seen = NULL;
+static struct name_hash seen;
+static double stat_timeout = 0; /* per file system, defaults to half of timeout_interval */
+static char *warn_time_to_full = NULL;
+static char *crit_time_to_full = NULL;
+static thresholds *time_to_full_thresholds = NULL;
+static time_t fill_window = 0; /* seconds of usage history, 0 if not kept */
+static struct name_hash fill_histories;
+static bool io_stats_enabled = false;
+static double io_interval = 1; /* seconds between the two samples of /proc/diskstats */
+static char *io_warning[IO_METRIC_COUNT];
+static char *io_critical[IO_METRIC_COUNT];
+static thresholds *io_thresholds[IO_METRIC_COUNT];
 
 int main(int argc, char **argv) {
 	int result = STATE_UNKNOWN;
@@ -165,6 +222,21 @@ int main(int argc, char **argv) {
 	char *ignored_preamble = " - ignored paths:";
 	char *flag_header = NULL;
 	int temp_result = STATE_UNKNOWN;
+	disk_stat_status stat_status;
+	const char *label;
+	char *fill_text = NULL;
+	double fill_rate = 0;
+	double time_to_full = 0;
+	bool fill_known;
+	time_t current_time;
+	state_data *previous_state;
+	io_sample io_before = {0};
+	io_sample io_after = {0};
+	io_pressure pressure;
+	double io_seconds = 0;
+	double io_metrics[IO_METRIC_COUNT];
+	bool io_known;
+	char *io_text = NULL;
 
 	struct mount_entry *me = NULL;
 	struct fs_usage fsp = {0};
@@ -180,13 +252,14 @@ int main(int argc, char **argv) {
 	details = strdup("");
 	perf = strdup("");
 	perf_ilabel = strdup("");
-	stat_buf = malloc(sizeof *stat_buf);
 
 	setlocale(LC_ALL, "");
 	bindtextdomain(PACKAGE, LOCALEDIR);
 	textdomain(PACKAGE);
 
-	mount_list = read_file_system_list(0);
+	mount_list = np_mount_snapshot_get(&mounts);
+
+	np_init((char *)progname, argc, argv);
 
 	/* Parse extra opts if any */
 	argv = np_extra_opts(&argc, argv, progname);
@@ -194,13 +267,32 @@ int main(int argc, char **argv) {
 	if (process_arguments(argc, argv) == ERROR)
 		usage4(_("Could not parse arguments"));
 
+	start_timeout();
+	probe_selected_paths();
+
+	time(&current_time);
+	if (fill_window > 0) {
+		set_thresholds(&time_to_full_thresholds, warn_time_to_full, crit_time_to_full);
+		np_enable_state(NULL, 1);
+		previous_state = np_state_read();
+		if (previous_state != NULL)
+			disk_fill_parse(previous_state->data, &fill_histories);
+	}
+
+	/* first sample, the second one is taken after the file systems were queried */
+	if (io_stats_enabled) {
+		for (int i = 0; i < IO_METRIC_COUNT; i++)
+			set_thresholds(&io_thresholds[i], io_warning[i], io_critical[i]);
+		io_sample_read(IO_DISKSTATS, &io_before);
+	}
+
 	/* If a list of paths has not been selected, find entire
 	   mount list and create list of paths
 	 */
 	if (path_selected == false && path_ignored == false) {
 		for (me = mount_list; me; me = me->me_next) {
-			if (!(path = np_find_parameter(path_select_list, me->me_mountdir))) {
-				path = np_add_parameter(&path_select_list, me->me_mountdir);
+			if (!(path = np_find_parameter_indexed(&path_select_index, me->me_mountdir))) {
+				path = np_add_parameter_indexed(&path_select_list, &path_select_index, me->me_mountdir);
 			}
 			path->best_match = me;
 			path->group = group;
@@ -224,7 +316,7 @@ int main(int argc, char **argv) {
 			/* Add path argument to list of ignored paths to inform about missing paths being ignored and not alerted */
 			xasprintf(&ignored, "%s %s;", ignored, path_select_list->name);
 			/* Delete the path from the list so that it is not stat-checked later in the code. */
-			path_select_list = np_del_parameter(path_select_list, path_select_list->name_prev);
+			path_select_list = np_del_parameter_indexed(&path_select_index, path_select_list, path_select_list->name_prev);
 		} else if (!path_select_list->best_match) {
 			/* Without --ignore-missing option, exit with Critical state. */
 			die(STATE_CRITICAL, _("DISK %s: %s not found\n"), _("CRITICAL"), path_select_list->name);
@@ -243,6 +335,27 @@ int main(int argc, char **argv) {
 		}
 	}
 
+	/* Query all file systems at once, so a hanging one does not delay the others */
+	stat_all_paths();
+	aggregate_groups();
+
+	if (io_stats_enabled) {
+		struct timespec now;
+		double elapsed;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		elapsed = (double)(now.tv_sec - io_before.time.tv_sec) + (double)(now.tv_nsec - io_before.time.tv_nsec) / 1.0e9;
+		if (elapsed < io_interval) {
+			struct timespec pause = {.tv_sec = (time_t)(io_interval - elapsed),
+									 .tv_nsec = (long)((io_interval - elapsed - (time_t)(io_interval - elapsed)) * 1.0e9)};
+			nanosleep(&pause, NULL);
+		}
+		io_sample_read(IO_DISKSTATS, &io_after);
+		io_seconds = (double)(io_after.time.tv_sec - io_before.time.tv_sec) + (double)(io_after.time.tv_nsec - io_before.time.tv_nsec) / 1.0e9;
+		if (verbose >= 3)
+			printf("Sampled %lu block devices over %.3fs\n", (unsigned long)io_after.nof_devices, io_seconds);
+	}
+
 	/* Process for every path in list */
 	for (path = path_select_list; path; path = path->name_next) {
 		if (verbose >= 3 && path->freespace_percent->warning != NULL && path->freespace_percent->critical != NULL)
@@ -271,48 +384,47 @@ int main(int argc, char **argv) {
 		/* Filters */
 
 		/* Remove filesystems already seen */
-		if (np_seen_name(seen, me->me_mountdir)) {
+		if (np_name_hash_get(&seen, me->me_mountdir)) {
 			continue;
 		}
-		np_add_name(&seen, me->me_mountdir);
+		np_name_hash_put(&seen, me->me_mountdir, me);
 
 		if (path->group == NULL) {
 			/* Skip remote filesystems if we're not interested in them */
 			if (me->me_remote && show_local_fs) {
 				if (stat_remote_fs) {
-					if (!stat_path(path) && ignore_missing == true) {
+					stat_status = get_path_usage(path, NULL);
+					if (stat_status == DISK_STAT_FAILED && ignore_missing == true) {
 						result = STATE_OK;
 						xasprintf(&ignored, "%s %s;", ignored, path->name);
+					} else if (stat_status == DISK_STAT_HUNG) {
+						result = max_state(result, STATE_CRITICAL);
+						xasprintf(&output, _("%s %s hung (no answer within %gs);"), output, path->name, stat_timeout);
 					}
 				}
 				continue;
-				/* Skip pseudo fs's if we haven't asked for all fs's */
-			}
-			if (me->me_dummy && !show_all_fs) {
-				continue;
-				/* Skip excluded fstypes */
-			}
-			if (fs_exclude_list && np_find_regmatch(fs_exclude_list, me->me_type)) {
-				continue;
-				/* Skip excluded fs's */
 			}
-			if (dp_exclude_list && (np_find_name(dp_exclude_list, me->me_devname) || np_find_name(dp_exclude_list, me->me_mountdir))) {
-				continue;
-				/* Skip not included fstypes */
-			}
-			if (fs_include_list && !np_find_regmatch(fs_include_list, me->me_type)) {
+			if (filesystem_excluded(me)) {
 				continue;
 			}
 		}
 
-		if (!stat_path(path)) {
+		stat_status = get_path_usage(path, &fsp);
+		if (stat_status == DISK_STAT_FAILED) {
 			if (ignore_missing == true) {
 				result = STATE_OK;
 				xasprintf(&ignored, "%s %s;", ignored, path->name);
 			}
 			continue;
 		}
-		get_fs_usage(me->me_mountdir, me->me_devname, &fsp);
+		if (stat_status == DISK_STAT_HUNG) {
+			/* reported with its own (unknown) perfdata value, the other file systems are still checked */
+			result = max_state(result, STATE_CRITICAL);
+			label = (!strcmp(me->me_mountdir, "none") || display_mntp) ? me->me_devname : me->me_mountdir;
+			xasprintf(&output, _("%s %s hung (no answer within %gs);"), output, label, stat_timeout);
+			xasprintf(&perf, strpbrk(label, "'= ") ? "%s '%s'=U" : "%s %s=U", perf, label);
+			continue;
+		}
 
 		if (fsp.fsu_blocks && strcmp("none", me->me_mountdir)) {
 			get_stats(path, &fsp);
@@ -356,6 +468,49 @@ int main(int argc, char **argv) {
 				printf("Freeinodes_percent result=%d\n", temp_result);
 			disk_result = max_state(disk_result, temp_result);
 
+			label = (!strcmp(me->me_mountdir, "none") || display_mntp) ? me->me_devname : me->me_mountdir;
+			fill_known = false;
+			if (fill_window > 0) {
+				disk_fill_history *history = disk_fill_history_get(&fill_histories, label);
+
+				disk_fill_add(history, current_time, path->dused_units * mult, fill_window);
+				fill_known = disk_fill_rate(history, &fill_rate);
+				/* a file system which does not fill up is never full */
+				if (fill_known && fill_rate > 0) {
+					time_to_full = (double)(path->dfree_units * mult) / fill_rate;
+					temp_result = get_status(time_to_full, time_to_full_thresholds);
+					if (verbose >= 3)
+						printf("Fill rate of %s: %gB/s, time to full %gs, result=%d\n", label, fill_rate, time_to_full, temp_result);
+					disk_result = max_state(disk_result, temp_result);
+				}
+			}
+
+			/* load of the device the file system is on, groups span several devices */
+			io_known = false;
+			free(io_text);
+			io_text = NULL;
+			if (io_stats_enabled && path->group == NULL) {
+				const io_device_counters *before = io_sample_find(&io_before, major(me->me_dev), minor(me->me_dev));
+				const io_device_counters *after = io_sample_find(&io_after, major(me->me_dev), minor(me->me_dev));
+
+				if (before != NULL && after != NULL) {
+					io_metrics_compute(before, after, io_seconds, io_metrics);
+					io_known = true;
+					for (int i = 0; i < IO_METRIC_PRESSURE; i++) {
+						temp_result = get_status(io_metrics[i], io_thresholds[i]);
+						if (verbose >= 3)
+							printf("I/O %s of %s: %g, result=%d\n", io_metric_names[i], label, io_metrics[i], temp_result);
+						if (temp_result != STATE_OK) {
+							char *previous = io_text;
+
+							xasprintf(&io_text, "%s, %s=%g", previous ? previous : "", io_metric_names[i], io_metrics[i]);
+							free(previous);
+						}
+						disk_result = max_state(disk_result, temp_result);
+					}
+				}
+			}
+
 			result = max_state(result, disk_result);
 
 			/* What a mess of units. The output shows free space, the perf data shows used space. Yikes!
@@ -414,6 +569,46 @@ int main(int argc, char **argv) {
 										  true, path->inodes_total));
 			}
 
+			if (io_known) {
+				static const char *const io_units[] = {"", "", "s", "%"};
+
+				for (int i = 0; i < IO_METRIC_PRESSURE; i++) {
+					xasprintf(&perf_ilabel, "%s (%s)", label, io_metric_names[i]);
+					xasprintf(&perf, "%s %s", perf,
+							  sperfdata(perf_ilabel, io_metrics[i], io_units[i], io_warning[i], io_critical[i], true, 0, i == IO_METRIC_UTIL,
+										100));
+				}
+			}
+
+			if (fill_known) {
+				xasprintf(&perf_ilabel, "%s (fill rate)", label);
+				xasprintf(&perf, "%s %s", perf, fperfdata(perf_ilabel, fill_rate, "", false, 0, false, 0, false, 0, false, 0));
+				if (fill_rate > 0) {
+					xasprintf(&perf_ilabel, "%s (time to full)", label);
+					xasprintf(&perf, "%s %s", perf,
+							  fperfdata(perf_ilabel, time_to_full, "s", time_to_full_thresholds->warning != NULL,
+										time_to_full_thresholds->warning ? time_to_full_thresholds->warning->end : 0,
+										time_to_full_thresholds->critical != NULL,
+										time_to_full_thresholds->critical ? time_to_full_thresholds->critical->end : 0, true, 0, false, 0));
+				}
+			}
+
+			if (display_group_member_perfdata && path->group != NULL) {
+				struct disk_group *g = np_name_hash_get(&groups, path->group);
+
+				for (size_t i = 0; g != NULL && i < g->nof_members; i++) {
+					xasprintf(&perf, "%s %s", perf,
+							  perfdata_uint64(g->members[i].label, g->members[i].dused_units * mult, "B", false, 0, false, 0, true, 0, true,
+											  g->members[i].dtotal_units * mult));
+					if (display_inodes_perfdata) {
+						xasprintf(&perf_ilabel, "%s (inodes)", g->members[i].label);
+						xasprintf(&perf, "%s %s", perf,
+								  perfdata_uint64(perf_ilabel, g->members[i].inodes_used, "", false, 0, false, 0, true, 0, true,
+												  g->members[i].inodes_total));
+					}
+				}
+			}
+
 			if (disk_result == STATE_OK && erronly && !verbose)
 				continue;
 
@@ -425,15 +620,40 @@ int main(int argc, char **argv) {
 			xasprintf(&output, "%s%s %s %llu%s (%.1f%%", output, flag_header,
 					  (!strcmp(me->me_mountdir, "none") || display_mntp) ? me->me_devname : me->me_mountdir, path->dfree_units, units,
 					  path->dfree_pct);
+			if (fill_known && fill_rate > 0) {
+				xasprintf(&fill_text, _(", full in %.1fh"), time_to_full / 3600);
+			} else {
+				xasprintf(&fill_text, "");
+			}
 			if (path->dused_inodes_percent < 0) {
-				xasprintf(&output, "%s inode=-)%s;", output, (disk_result ? "]" : ""));
+				xasprintf(&output, "%s inode=-%s%s)%s;", output, fill_text, io_text ? io_text : "", (disk_result ? "]" : ""));
 			} else {
-				xasprintf(&output, "%s inode=%.0f%%)%s;", output, path->dfree_inodes_percent, ((disk_result && verbose >= 1) ? "]" : ""));
+				xasprintf(&output, "%s inode=%.0f%%%s%s)%s;", output, path->dfree_inodes_percent, fill_text,
+						  io_text ? io_text : "", ((disk_result && verbose >= 1) ? "]" : ""));
 			}
+			free(fill_text);
 			free(flag_header);
 		}
 	}
 
+	free(io_text);
+
+	if (fill_window > 0)
+		np_state_write_string(current_time, disk_fill_format(&fill_histories, current_time, fill_window));
+
+	/* stalls of the whole system, not of a single file system */
+	if (io_stats_enabled && io_pressure_read(IO_PRESSURE, &pressure)) {
+		temp_result = get_status(pressure.some_avg10, io_thresholds[IO_METRIC_PRESSURE]);
+		result = max_state(result, temp_result);
+		if (temp_result != STATE_OK)
+			xasprintf(&output, _("%s I/O pressure %.1f%%;"), output, pressure.some_avg10);
+		xasprintf(&perf, "%s %s", perf,
+				  sperfdata("io pressure (some)", pressure.some_avg10, "%", io_warning[IO_METRIC_PRESSURE],
+							io_critical[IO_METRIC_PRESSURE], true, 0, true, 100));
+		if (pressure.has_full)
+			xasprintf(&perf, "%s %s", perf, sperfdata("io pressure (full)", pressure.full_avg10, "%", NULL, NULL, true, 0, true, 100));
+	}
+
 	if (verbose >= 2)
 		xasprintf(&output, "%s%s", output, details);
 
@@ -498,6 +718,15 @@ int process_arguments(int argc, char **argv) {
 									   {"local", no_argument, 0, 'l'},
 									   {"stat-remote-fs", no_argument, 0, 'L'},
 									   {"iperfdata", no_argument, 0, 'P'},
+									   {"stat-timeout", required_argument, 0, STAT_TIMEOUT_OPTION},
+									   {"group-member-perfdata", no_argument, 0, GROUP_MEMBER_PERFDATA_OPTION},
+									   {"fill-warning", required_argument, 0, FILL_WARNING_OPTION},
+									   {"fill-critical", required_argument, 0, FILL_CRITICAL_OPTION},
+									   {"fill-window", required_argument, 0, FILL_WINDOW_OPTION},
+									   {"io-stats", no_argument, 0, IO_STATS_OPTION},
+									   {"io-interval", required_argument, 0, IO_INTERVAL_OPTION},
+									   {"io-warning", required_argument, 0, IO_WARNING_OPTION},
+									   {"io-critical", required_argument, 0, IO_CRITICAL_OPTION},
 									   {"mountpoint", no_argument, 0, 'M'},
 									   {"errors-only", no_argument, 0, 'e'},
 									   {"exact-match", no_argument, 0, 'E'},
@@ -533,6 +762,59 @@ int process_arguments(int argc, char **argv) {
 				usage2(_("Timeout interval must be a positive integer"), optarg);
 			}
 
+		case STAT_TIMEOUT_OPTION:
+			if (!is_positive(optarg))
+				usage2(_("Stat timeout must be a positive number"), optarg);
+			stat_timeout = strtod(optarg, NULL);
+			break;
+
+		case GROUP_MEMBER_PERFDATA_OPTION:
+			display_group_member_perfdata = true;
+			break;
+
+		/* alert if the file system will be full in less than the given seconds */
+		case FILL_WARNING_OPTION:
+		case FILL_CRITICAL_OPTION:
+			if (!is_positive(optarg))
+				usage2(_("Time until full must be a positive number of seconds"), optarg);
+			xasprintf(c == FILL_WARNING_OPTION ? &warn_time_to_full : &crit_time_to_full, "@%s", optarg);
+			if (fill_window == 0)
+				fill_window = DISK_FILL_DEFAULT_WINDOW;
+			break;
+
+		case FILL_WINDOW_OPTION:
+			if (!is_intpos(optarg))
+				usage2(_("Fill window must be a positive number of seconds"), optarg);
+			fill_window = atol(optarg);
+			break;
+
+		case IO_STATS_OPTION:
+			io_stats_enabled = true;
+			break;
+
+		case IO_INTERVAL_OPTION:
+			if (!is_positive(optarg))
+				usage2(_("I/O sampling interval must be a positive number of seconds"), optarg);
+			io_interval = strtod(optarg, NULL);
+			io_stats_enabled = true;
+			break;
+
+		/* METRIC=RANGE */
+		case IO_WARNING_OPTION:
+		case IO_CRITICAL_OPTION: {
+			char *range = strchr(optarg, '=');
+			int metric = range ? io_metric_by_name(optarg, (size_t)(range - optarg)) : -1;
+
+			if (metric < 0)
+				usage2(_("Expected iops, throughput, await, util or pressure followed by =RANGE"), optarg);
+			if (c == IO_WARNING_OPTION)
+				io_warning[metric] = range + 1;
+			else
+				io_critical[metric] = range + 1;
+			io_stats_enabled = true;
+			break;
+		}
+
 		/* See comments for 'c' */
 		case 'w': /* warning threshold */
 			if (!is_percentage_expression(optarg) && !is_numeric(optarg)) {
@@ -664,31 +946,18 @@ int process_arguments(int argc, char **argv) {
 			}
 
 			/* add parameter if not found. overwrite thresholds if path has already been added  */
-			if (!(se = np_find_parameter(path_select_list, optarg))) {
-				se = np_add_parameter(&path_select_list, optarg);
-
-				if (stat(optarg, &stat_buf[0]) && ignore_missing == true) {
-					path_ignored = true;
-					break;
-				}
+			if (!(se = np_find_parameter_indexed(&path_select_index, optarg))) {
+				se = np_add_parameter_indexed(&path_select_list, &path_select_index, optarg);
 			}
 			se->group = group;
 			set_all_thresholds(se);
 
-			/* With autofs, it is required to stat() the path before re-populating the mount_list */
-			if (!stat_path(se)) {
-				break;
-			}
-			/* NB: We can't free the old mount_list "just like that": both list pointers and struct
-			 * pointers are copied around. One of the reason it wasn't done yet is that other parts
-			 * of check_disk need the same kind of cleanup so it'd better be done as a whole */
-			mount_list = read_file_system_list(0);
-			np_set_best_match(se, mount_list, exact_match);
-
+			/* stat() later on, all paths at once and within the timeout */
+			se->stat_probe = true;
 			path_selected = true;
 			break;
 		case 'x': /* exclude path or partition */
-			np_add_name(&dp_exclude_list, optarg);
+			np_name_hash_put(&dp_exclude_list, optarg, optarg);
 			break;
 		case 'X': /* exclude file system type */
 			err = np_add_regex(&fs_exclude_list, optarg, REG_EXTENDED);
@@ -740,6 +1009,8 @@ int process_arguments(int argc, char **argv) {
 				die(STATE_UNKNOWN, "DISK %s: %s - %s\n", _("UNKNOWN"), _("Could not compile regular expression"), errbuf);
 			}
 
+			/* the mount entries of the paths are matched */
+			probe_selected_paths();
 			temp_list = path_select_list;
 
 			previous = NULL;
@@ -750,7 +1021,7 @@ int process_arguments(int argc, char **argv) {
 						if (verbose >= 3)
 							printf("ignoring %s matching regex\n", temp_list->name);
 
-						temp_list = np_del_parameter(temp_list, previous);
+						temp_list = np_del_parameter_indexed(&path_select_index, temp_list, previous);
 						/* pointer to first element needs to be updated if first item gets deleted */
 						if (previous == NULL)
 							path_select_list = temp_list;
@@ -797,9 +1068,11 @@ int process_arguments(int argc, char **argv) {
 						printf("%s %s matching expression %s\n", me->me_devname, me->me_mountdir, optarg);
 
 					/* add parameter if not found. overwrite thresholds if path has already been added  */
-					if (!(se = np_find_parameter(path_select_list, me->me_mountdir))) {
-						se = np_add_parameter(&path_select_list, me->me_mountdir);
+					if (!(se = np_find_parameter_indexed(&path_select_index, me->me_mountdir))) {
+						se = np_add_parameter_indexed(&path_select_list, &path_select_index, me->me_mountdir);
 					}
+					/* set directly, np_set_best_match() would have to statvfs() every mount */
+					se->best_match = me;
 					se->group = group;
 					set_all_thresholds(se);
 				}
@@ -827,8 +1100,8 @@ int process_arguments(int argc, char **argv) {
 			if (path_selected == false) {
 				struct parameter_list *path;
 				for (me = mount_list; me; me = me->me_next) {
-					if (!(path = np_find_parameter(path_select_list, me->me_mountdir)))
-						path = np_add_parameter(&path_select_list, me->me_mountdir);
+					if (!(path = np_find_parameter_indexed(&path_select_index, me->me_mountdir)))
+						path = np_add_parameter_indexed(&path_select_list, &path_select_index, me->me_mountdir);
 					path->best_match = me;
 					path->group = group;
 					set_all_thresholds(path);
@@ -870,7 +1143,7 @@ int process_arguments(int argc, char **argv) {
 		crit_usedspace_percent = argv[c++];
 
 	if (argc > c) {
-		se = np_add_parameter(&path_select_list, strdup(argv[c++]));
+		se = np_add_parameter_indexed(&path_select_list, &path_select_index, strdup(argv[c++]));
 		path_selected = true;
 		set_all_thresholds(se);
 	}
@@ -880,6 +1153,11 @@ int process_arguments(int argc, char **argv) {
 		mult = (uintmax_t)1024 * 1024;
 	}
 
+	if (io_stats_enabled && io_interval >= timeout_interval)
+		usage4(_("I/O sampling interval must be shorter than the timeout"));
+	if (stat_timeout == 0)
+		stat_timeout = timeout_interval / 2.0;
+
 	return true;
 }
 
@@ -948,6 +1226,8 @@ void print_help(void) {
 	printf("    %s\n", _("Display inode usage in perfdata"));
 	printf(" %s\n", "-g, --group=NAME");
 	printf("    %s\n", _("Group paths. Thresholds apply to (free-)space of all partitions together"));
+	printf(" %s\n", "--group-member-perfdata");
+	printf("    %s\n", _("Display the usage of every partition of a group in perfdata, labelled GROUP:MOUNTPOINT"));
 	printf(" %s\n", "-k, --kilobytes");
 	printf("    %s\n", _("Same as '--units kB'"));
 	printf(" %s\n", "-l, --local");
@@ -973,6 +1253,26 @@ void print_help(void) {
 	printf("    %s\n", _("Return OK if no filesystem matches, filesystem does not exist or is inaccessible."));
 	printf("    %s\n", _("(Provide this option before -p / -r / --ereg-path if used)"));
 	printf(UT_PLUG_TIMEOUT, DEFAULT_SOCKET_TIMEOUT);
+	printf(" %s\n", "--stat-timeout=SECONDS");
+	printf("    %s\n", _("Report a filesystem as hung (CRITICAL) if it does not answer within SECONDS,"));
+	printf("    %s\n", _("all filesystems are queried in parallel (default: half of the plugin timeout)"));
+	printf(" %s\n", "--fill-warning=SECONDS");
+	printf("    %s\n", _("Exit with WARNING status if a disk is going to be full in less than SECONDS,"));
+	printf("    %s\n", _("judging by the usage recorded in the state file during --fill-window"));
+	printf(" %s\n", "--fill-critical=SECONDS");
+	printf("    %s\n", _("Exit with CRITICAL status if a disk is going to be full in less than SECONDS"));
+	printf(" %s\n", "--fill-window=SECONDS");
+	printf("    %s\n", _("Estimate the fill rate from the usage of the last SECONDS (default: 21600),"));
+	printf("    %s\n", _("adds fill rate and time to full to perfdata"));
+	printf(" %s\n", "--io-stats");
+	printf("    %s\n", _("Add IOPS, throughput, await (s) and utilisation (%) of the block device of every disk"));
+	printf("    %s\n", _("and the I/O pressure of the system (% of the last 10s) to perfdata"));
+	printf(" %s\n", "--io-interval=SECONDS");
+	printf("    %s\n", _("Time between the two samples of /proc/diskstats (default: 1)"));
+	printf(" %s\n", "--io-warning=METRIC=RANGE");
+	printf("    %s\n", _("Exit with WARNING status if iops, throughput, await, util or pressure is outside RANGE"));
+	printf(" %s\n", "--io-critical=METRIC=RANGE");
+	printf("    %s\n", _("Exit with CRITICAL status if iops, throughput, await, util or pressure is outside RANGE"));
 	printf(" %s\n", "-u, --units=STRING");
 	printf("    %s\n", _("Choose bytes, kB, MB, GB, TB (default: MB)"));
 	printf(UT_VERBOSE);
@@ -1006,71 +1306,322 @@ void print_usage(void) {
 		   "inode_percentage_limit } {-p path | -x device}\n",
 		   progname);
 	printf("[-C] [-E] [-e] [-f] [-g group ] [-k] [-l] [-M] [-m] [-R path ] [-r path ]\n");
-	printf("[-t timeout] [-u unit] [-v] [-X type_regex] [-N type]\n");
+	printf("[-t timeout] [--stat-timeout seconds] [-u unit] [-v] [-X type_regex] [-N type]\n");
 }
 
-bool stat_path(struct parameter_list *p) {
+disk_stat_status stat_path(struct parameter_list *p) {
+	disk_stat_request request = {0};
+
+	/* do not wait for a hung path twice */
+	if (p->stat_request != NULL && p->stat_request->status == DISK_STAT_HUNG)
+		return DISK_STAT_HUNG;
+
 	/* Stat entry to check that dir exists and is accessible */
 	if (verbose >= 3)
 		printf("calling stat on %s\n", p->name);
-	if (stat(p->name, &stat_buf[0])) {
+	request.path = p->name;
+	disk_stat_run(&request, 1, stat_timeout > 0 ? stat_timeout : timeout_interval / 2.0);
+
+	if (request.status == DISK_STAT_HUNG) {
+		if (verbose >= 3)
+			printf("stat hung on %s\n", p->name);
+		p->stat_request = malloc(sizeof(request));
+		if (p->stat_request == NULL)
+			die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+		*p->stat_request = request;
+		return DISK_STAT_HUNG;
+	}
+
+	if (request.status == DISK_STAT_FAILED) {
 		if (verbose >= 3)
 			printf("stat failed on %s\n", p->name);
 		if (ignore_missing == true) {
-			return false;
+			return DISK_STAT_FAILED;
 		}
 		printf("DISK %s - ", _("CRITICAL"));
-		die(STATE_CRITICAL, _("%s %s: %s\n"), p->name, _("is not accessible"), strerror(errno));
+		die(STATE_CRITICAL, _("%s %s: %s\n"), p->name, _("is not accessible"), strerror(request.error));
+	}
+	return DISK_STAT_OK;
+}
+
+/* Arms the alarm, which bounds everything from the first stat() on */
+void start_timeout(void) {
+	static bool started = false;
+
+	if (started)
+		return;
+	started = true;
+	if (signal(SIGALRM, timeout_alarm_handler) == SIG_ERR) {
+		usage4(_("Cannot catch SIGALRM"));
+	}
+	alarm(timeout_interval);
+}
+
+/* Checks that the paths selected with -p are there, with a concurrent stat()
+ * of all of them. With autofs the stat() mounts them, so the mount list is
+ * read again before the paths are matched with its entries. */
+void probe_selected_paths(void) {
+	struct parameter_list *path;
+	struct parameter_list **paths;
+	disk_stat_request *requests;
+	struct mount_index index;
+	size_t nof_requests = 0;
+	bool mounted = false;
+
+	for (path = path_select_list; path; path = path->name_next) {
+		if (path->stat_probe)
+			nof_requests++;
+	}
+	if (nof_requests == 0)
+		return;
+
+	start_timeout();
+	/* hung requests stay referenced until the end */
+	requests = calloc(nof_requests, sizeof(*requests));
+	paths = calloc(nof_requests, sizeof(*paths));
+	if (requests == NULL || paths == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+
+	nof_requests = 0;
+	for (path = path_select_list; path; path = path->name_next) {
+		if (!path->stat_probe)
+			continue;
+		path->stat_probe = false;
+		if (verbose >= 3)
+			printf("calling stat on %s\n", path->name);
+		paths[nof_requests] = path;
+		requests[nof_requests++].path = path->name;
+	}
+	disk_stat_run(requests, nof_requests, stat_timeout > 0 ? stat_timeout : timeout_interval / 2.0);
+
+	for (size_t i = 0; i < nof_requests; i++) {
+		path = paths[i];
+		if (requests[i].status == DISK_STAT_HUNG) {
+			if (verbose >= 3)
+				printf("stat hung on %s\n", path->name);
+			/* reported later on, without waiting for it again */
+			path->stat_request = &requests[i];
+			if (!path->best_match)
+				path->best_match = best_match_by_name(path->name);
+		} else if (requests[i].status == DISK_STAT_FAILED) {
+			if (verbose >= 3)
+				printf("stat failed on %s\n", path->name);
+			if (ignore_missing == false) {
+				printf("DISK %s - ", _("CRITICAL"));
+				die(STATE_CRITICAL, _("%s %s: %s\n"), path->name, _("is not accessible"), strerror(requests[i].error));
+			}
+			/* left without a match, it is listed as ignored */
+			path_ignored = true;
+		} else {
+			mounted = true;
+		}
+	}
+
+	if (mounted) {
+		/* Entries of the old list stay valid, both list pointers and struct
+		 * pointers are copied around. */
+		mount_list = np_mount_snapshot_get(&mounts);
+		np_mount_index_init(&index, mount_list);
+		for (size_t i = 0; i < nof_requests; i++) {
+			if (requests[i].status == DISK_STAT_OK && !paths[i]->best_match)
+				paths[i]->best_match = np_mount_index_best_match(&index, paths[i]->name, exact_match, true);
+		}
+		np_mount_index_free(&index);
+	}
+	free(paths);
+}
+
+/* Like np_set_best_match(), but without checking that the file system answers */
+struct mount_entry *best_match_by_name(const char *name) {
+	struct mount_index index;
+	struct mount_entry *best_match;
+
+	np_mount_index_init(&index, mount_list);
+	best_match = np_mount_index_best_match(&index, name, exact_match, false);
+	np_mount_index_free(&index);
+	return best_match;
+}
+
+/* Skip pseudo fs's if we haven't asked for all fs's and excluded or not included fs types and devices */
+bool filesystem_excluded(struct mount_entry *me) {
+	if (me->me_dummy && !show_all_fs) {
+		return true;
+	}
+	if (fs_exclude_list && np_find_regmatch(fs_exclude_list, me->me_type)) {
+		return true;
+	}
+	if (np_name_hash_get(&dp_exclude_list, me->me_devname) || np_name_hash_get(&dp_exclude_list, me->me_mountdir)) {
+		return true;
+	}
+	if (fs_include_list && !np_find_regmatch(fs_include_list, me->me_type)) {
+		return true;
+	}
+	return false;
+}
+
+/* Issues stat() and statvfs() for every path which is going to be checked concurrently */
+void stat_all_paths(void) {
+	struct parameter_list *path;
+	disk_stat_request *requests;
+	size_t nof_requests = 0;
+
+	for (path = path_select_list; path; path = path->name_next)
+		nof_requests++;
+	requests = calloc(nof_requests, sizeof(*requests));
+	if (nof_requests > 0 && requests == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+
+	nof_requests = 0;
+	for (path = path_select_list; path; path = path->name_next) {
+		struct mount_entry *me = path->best_match;
+		disk_stat_request *request = &requests[nof_requests];
+
+		if (!me || path->stat_request != NULL)
+			continue;
+
+		request->path = path->name;
+		request->mountdir = me->me_mountdir;
+		request->devname = me->me_devname;
+		if (path->group == NULL) {
+			if (me->me_remote && show_local_fs) {
+				if (!stat_remote_fs)
+					continue;
+				request->mountdir = NULL;
+			} else if (filesystem_excluded(me)) {
+				continue;
+			}
+		}
+		path->stat_request = request;
+		nof_requests++;
+	}
+
+	if (verbose >= 3)
+		printf("Querying %lu filesystems with a timeout of %gs each\n", (unsigned long)nof_requests, stat_timeout);
+	disk_stat_run(requests, nof_requests, stat_timeout);
+}
+
+/* Returns the results of stat_all_paths() for p, a failing stat() is fatal
+ * unless missing paths are ignored */
+disk_stat_status get_path_usage(struct parameter_list *p, struct fs_usage *fsp) {
+	disk_stat_request *request = p->stat_request;
+
+	if (request == NULL) {
+		/* not queried in advance */
+		disk_stat_status status = stat_path(p);
+		if (status == DISK_STAT_OK && fsp != NULL)
+			get_fs_usage(p->best_match->me_mountdir, p->best_match->me_devname, fsp);
+		return status;
+	}
+
+	if (verbose >= 3)
+		printf("stat on %s: %s\n", p->name,
+			   request->status == DISK_STAT_OK ? "ok" : request->status == DISK_STAT_HUNG ? "hung" : "failed");
+
+	if (request->status == DISK_STAT_FAILED && ignore_missing == false) {
+		printf("DISK %s - ", _("CRITICAL"));
+		die(STATE_CRITICAL, _("%s %s: %s\n"), p->name, _("is not accessible"), strerror(request->error));
+	}
+
+	if (request->status == DISK_STAT_OK && fsp != NULL) {
+		if (request->mountdir != NULL)
+			*fsp = request->fsu;
+		else
+			get_fs_usage(p->best_match->me_mountdir, p->best_match->me_devname, fsp);
+	}
+	return request->status;
+}
+
+/* Folds the usage of every group member into the totals of its group, in a
+ * single pass and with the results of stat_all_paths() */
+void aggregate_groups(void) {
+	struct parameter_list *p;
+	struct disk_group *g;
+	struct fs_usage fsp;
+
+	for (p = path_select_list; p; p = p->name_next) {
+		struct mount_entry *me = p->best_match;
+		struct disk_group_member *member;
+
+		if (p->group == NULL || me == NULL)
+			continue;
+#ifdef __CYGWIN__
+		if (strncmp(p->name, "/cygdrive/", 10) != 0)
+			continue;
+#endif
+
+		g = np_name_hash_get(&groups, p->group);
+		if (g == NULL) {
+			g = calloc(1, sizeof(*g));
+			if (g == NULL)
+				die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+			np_name_hash_put(&groups, p->group, g);
+		}
+
+		/* several paths on the same file system */
+		if (np_name_hash_get(&g->mounts, me->me_mountdir))
+			continue;
+		/* hung members are reported on their own */
+		if (get_path_usage(p, &fsp) != DISK_STAT_OK)
+			continue;
+		np_name_hash_put(&g->mounts, me->me_mountdir, me);
+
+		get_path_stats(p, &fsp);
+		if (verbose >= 3)
+			printf("Group %s: adding %lu blocks sized %lu, (%s) used_units=%lu free_units=%lu total_units=%lu mult=%lu\n", p->group,
+				   fsp.fsu_blocks, fsp.fsu_blocksize, me->me_mountdir, p->dused_units, p->dfree_units, p->dtotal_units, mult);
+
+		g->total += p->total;
+		g->available += p->available;
+		g->available_to_root += p->available_to_root;
+		g->used += p->used;
+		g->dused_units += p->dused_units;
+		g->dfree_units += p->dfree_units;
+		g->dtotal_units += p->dtotal_units;
+		g->inodes_total += p->inodes_total;
+		g->inodes_free += p->inodes_free;
+		g->inodes_free_to_root += p->inodes_free_to_root;
+		g->inodes_used += p->inodes_used;
+
+		g->members = realloc(g->members, (g->nof_members + 1) * sizeof(*g->members));
+		if (g->members == NULL)
+			die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+		member = &g->members[g->nof_members++];
+		member->path = p;
+		xasprintf(&member->label, "%s:%s", p->group, (!strcmp(me->me_mountdir, "none") || display_mntp) ? me->me_devname : me->me_mountdir);
+		member->dused_units = p->dused_units;
+		member->dtotal_units = p->dtotal_units;
+		member->inodes_used = p->inodes_used;
+		member->inodes_total = p->inodes_total;
 	}
-	return true;
 }
 
 void get_stats(struct parameter_list *p, struct fs_usage *fsp) {
-	struct parameter_list *p_list;
-	struct fs_usage tmpfsp;
-	int first = 1;
+	struct disk_group *g;
 
 	if (p->group == NULL) {
 		get_path_stats(p, fsp);
 	} else {
-		/* find all group members */
-		for (p_list = path_select_list; p_list; p_list = p_list->name_next) {
-#ifdef __CYGWIN__
-			if (strncmp(p_list->name, "/cygdrive/", 10) != 0)
-				continue;
-#endif
-			if (p_list->group && !(strcmp(p_list->group, p->group))) {
-				if (!stat_path(p_list))
-					continue;
-				get_fs_usage(p_list->best_match->me_mountdir, p_list->best_match->me_devname, &tmpfsp);
-				get_path_stats(p_list, &tmpfsp);
-				if (verbose >= 3)
-					printf("Group %s: adding %lu blocks sized %lu, (%s) used_units=%lu free_units=%lu total_units=%lu mult=%lu\n",
-						   p_list->group, tmpfsp.fsu_blocks, tmpfsp.fsu_blocksize, p_list->best_match->me_mountdir, p_list->dused_units,
-						   p_list->dfree_units, p_list->dtotal_units, mult);
-
-				/* prevent counting the first FS of a group twice since its parameter_list entry
-				 * is used to carry the information of all file systems of the entire group */
-				if (!first) {
-					p->total += p_list->total;
-					p->available += p_list->available;
-					p->available_to_root += p_list->available_to_root;
-					p->used += p_list->used;
-
-					p->dused_units += p_list->dused_units;
-					p->dfree_units += p_list->dfree_units;
-					p->dtotal_units += p_list->dtotal_units;
-					p->inodes_total += p_list->inodes_total;
-					p->inodes_free += p_list->inodes_free;
-					p->inodes_free_to_root += p_list->inodes_free_to_root;
-					p->inodes_used += p_list->inodes_used;
-				}
-				first = 0;
-			}
-			if (verbose >= 3)
-				printf("Group %s now has: used_units=%lu free_units=%lu total_units=%lu fsu_blocksize=%lu mult=%lu\n", p->group,
-					   p->dused_units, p->dfree_units, p->dtotal_units, tmpfsp.fsu_blocksize, mult);
+		/* the first member of a group which is reached carries the totals */
+		g = np_name_hash_get(&groups, p->group);
+		if (g != NULL) {
+			p->total = g->total;
+			p->available = g->available;
+			p->available_to_root = g->available_to_root;
+			p->used = g->used;
+			p->dused_units = g->dused_units;
+			p->dfree_units = g->dfree_units;
+			p->dtotal_units = g->dtotal_units;
+			p->inodes_total = g->inodes_total;
+			p->inodes_free = g->inodes_free;
+			p->inodes_free_to_root = g->inodes_free_to_root;
+			p->inodes_used = g->inodes_used;
+			/* the other members are done with it */
+			for (size_t i = 0; i < g->nof_members; i++)
+				np_name_hash_put(&seen, g->members[i].path->best_match->me_mountdir, g->members[i].path->best_match);
 		}
+		if (verbose >= 3)
+			printf("Group %s now has: used_units=%lu free_units=%lu total_units=%lu fsu_blocksize=%lu mult=%lu\n", p->group,
+				   p->dused_units, p->dfree_units, p->dtotal_units, fsp->fsu_blocksize, mult);
 		/* modify devname and mountdir for output */
 		p->best_match->me_mountdir = p->best_match->me_devname = p->group;
 	}
@@ -1109,5 +1660,4 @@ void get_path_stats(struct parameter_list *p, struct fs_usage *fsp) {
 		/* default behaviour : take all the inodes into account */
 		p->inodes_total = fsp->fsu_files;
 	}
-	np_add_name(&seen, p->best_match->me_mountdir);
 }
@@ -0,0 +1,415 @@
+#include "./disk_stat.h"
+#include "utils_disk.h"
+
+#include <sys/stat.h>
+#include <time.h>
+#ifdef HAVE_LIBPTHREAD
+#	include <pthread.h>
+#endif
+#if defined(HAVE_LINUX_IO_URING_H) && defined(STATX_BASIC_STATS)
+#	define DISK_STAT_BATCH
+#	include <fcntl.h>
+#	include <linux/io_uring.h>
+#	include <poll.h>
+#	include <sys/mman.h>
+#	include <sys/syscall.h>
+#endif
+
+static bool disk_stat_batch_enabled = true;
+
+void disk_stat_set_batch(bool enabled) { disk_stat_batch_enabled = enabled; }
+
+static void disk_stat_execute(disk_stat_request *request) {
+	struct stat stat_buf;
+
+	memset(&request->fsu, 0, sizeof(request->fsu));
+	request->error = 0;
+
+	if (!request->stat_done && stat(request->path, &stat_buf) != 0) {
+		request->error = errno;
+		request->status = DISK_STAT_FAILED;
+		return;
+	}
+
+	if (request->mountdir != NULL)
+		get_fs_usage(request->mountdir, request->devname, &request->fsu);
+	request->status = DISK_STAT_OK;
+}
+
+static void disk_stat_now(struct timespec *ts) { clock_gettime(CLOCK_MONOTONIC, ts); }
+
+static double disk_stat_elapsed(const struct timespec *since, const struct timespec *now) {
+	return (double)(now->tv_sec - since->tv_sec) + (double)(now->tv_nsec - since->tv_nsec) / 1.0e9;
+}
+
+#ifdef DISK_STAT_BATCH
+
+#	define DISK_STAT_RING_ENTRIES 256
+
+typedef struct {
+	int fd;
+	unsigned sq_entries;
+	unsigned cq_entries;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_ring;
+	void *cq_ring;
+	size_t sq_ring_size;
+	size_t cq_ring_size;
+} disk_stat_ring;
+
+static void disk_stat_ring_free(disk_stat_ring *ring) {
+	if (ring->sqes != NULL && ring->sqes != MAP_FAILED)
+		munmap(ring->sqes, ring->sq_entries * sizeof(struct io_uring_sqe));
+	if (ring->cq_ring != NULL && ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring)
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	if (ring->sq_ring != NULL && ring->sq_ring != MAP_FAILED)
+		munmap(ring->sq_ring, ring->sq_ring_size);
+	close(ring->fd);
+}
+
+/* Sets up an io_uring without liburing, false if the kernel refuses */
+static bool disk_stat_ring_init(disk_stat_ring *ring, unsigned entries) {
+	struct io_uring_params params;
+
+	memset(ring, 0, sizeof(*ring));
+	memset(&params, 0, sizeof(params));
+	ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+	if (ring->fd < 0)
+		return false;
+
+	ring->sq_entries = params.sq_entries;
+	ring->cq_entries = params.cq_entries;
+	ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (ring->cq_ring_size > ring->sq_ring_size)
+			ring->sq_ring_size = ring->cq_ring_size;
+		ring->cq_ring_size = ring->sq_ring_size;
+	}
+
+	ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sq_ring == MAP_FAILED) {
+		disk_stat_ring_free(ring);
+		return false;
+	}
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		ring->cq_ring = ring->sq_ring;
+	else
+		ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+	ring->sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+					  IORING_OFF_SQES);
+	if (ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+		disk_stat_ring_free(ring);
+		return false;
+	}
+
+	ring->sq_head = (unsigned *)((char *)ring->sq_ring + params.sq_off.head);
+	ring->sq_tail = (unsigned *)((char *)ring->sq_ring + params.sq_off.tail);
+	ring->sq_mask = (unsigned *)((char *)ring->sq_ring + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned *)((char *)ring->sq_ring + params.sq_off.array);
+	ring->cq_head = (unsigned *)((char *)ring->cq_ring + params.cq_off.head);
+	ring->cq_tail = (unsigned *)((char *)ring->cq_ring + params.cq_off.tail);
+	ring->cq_mask = (unsigned *)((char *)ring->cq_ring + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)((char *)ring->cq_ring + params.cq_off.cqes);
+	return true;
+}
+
+/* stat()s the paths of all requests through io_uring. Answered requests
+ * get stat_done (or fail), requests still unanswered at the deadline are
+ * hung. The others are left pending, e.g. if the kernel has no statx for
+ * io_uring. */
+static void disk_stat_batch(disk_stat_request *requests, size_t nof_requests, const struct timespec *deadline) {
+	disk_stat_ring ring;
+	struct statx *buffers;
+	size_t submitted = 0;
+	size_t in_flight = 0;
+	bool timed_out = false;
+
+	if (!disk_stat_ring_init(&ring, DISK_STAT_RING_ENTRIES))
+		return;
+	buffers = calloc(nof_requests, sizeof(*buffers));
+	if (buffers == NULL) {
+		disk_stat_ring_free(&ring);
+		return;
+	}
+
+	while (submitted < nof_requests || in_flight > 0) {
+		unsigned tail = *ring.sq_tail;
+		unsigned head;
+		struct pollfd pfd = {.fd = ring.fd, .events = POLLIN};
+		struct timespec now;
+		double remaining;
+
+		/* never more in flight than the completion queue holds */
+		while (submitted < nof_requests && in_flight < ring.cq_entries &&
+			   tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE) < ring.sq_entries) {
+			unsigned index = tail & *ring.sq_mask;
+			struct io_uring_sqe *sqe = &ring.sqes[index];
+
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = IORING_OP_STATX;
+			sqe->fd = AT_FDCWD;
+			sqe->addr = (uintptr_t)requests[submitted].path;
+			sqe->len = STATX_BASIC_STATS;
+			sqe->off = (uintptr_t)&buffers[submitted];
+			sqe->statx_flags = AT_STATX_SYNC_AS_STAT;
+			sqe->user_data = submitted;
+			ring.sq_array[index] = index;
+			requests[submitted].status = DISK_STAT_RUNNING;
+			tail++;
+			submitted++;
+			in_flight++;
+		}
+		__atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+
+		if (tail != __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE) &&
+			syscall(__NR_io_uring_enter, ring.fd, tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE), 0, 0, NULL, 0) < 0 &&
+			errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			break;
+
+		head = *ring.cq_head;
+		while (head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE)) {
+			struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+			disk_stat_request *request = &requests[cqe->user_data];
+
+			if (cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP) {
+				/* statx is not supported here, left to the workers */
+				request->status = DISK_STAT_PENDING;
+			} else if (cqe->res < 0) {
+				request->error = -cqe->res;
+				request->status = DISK_STAT_FAILED;
+			} else {
+				request->stat_done = true;
+				request->status = request->mountdir ? DISK_STAT_PENDING : DISK_STAT_OK;
+			}
+			head++;
+			in_flight--;
+		}
+		__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+		if (in_flight == 0 || (submitted < nof_requests && in_flight < ring.cq_entries))
+			continue;
+
+		disk_stat_now(&now);
+		remaining = disk_stat_elapsed(&now, deadline);
+		if (remaining <= 0) {
+			timed_out = true;
+			break;
+		}
+		poll(&pfd, 1, (int)(remaining * 1000) + 1);
+	}
+
+	if (in_flight > 0 || submitted < nof_requests) {
+		/* not answered before the deadline, or io_uring failed and the
+		 * workers have to try */
+		for (size_t i = 0; i < nof_requests; i++) {
+			if (requests[i].status == DISK_STAT_RUNNING)
+				requests[i].status = timed_out ? DISK_STAT_HUNG : DISK_STAT_PENDING;
+		}
+		/* the kernel may still write to them */
+		return;
+	}
+	free(buffers);
+	disk_stat_ring_free(&ring);
+}
+
+#endif /* DISK_STAT_BATCH */
+
+/* Requests whose path was stat()ed already and which are on the same file
+ * system as another pending one take its usage instead of asking again */
+static void disk_stat_share(disk_stat_request *requests, size_t nof_requests) {
+	struct name_hash file_systems = {0};
+
+	for (size_t i = 0; i < nof_requests; i++) {
+		disk_stat_request *first;
+
+		if (requests[i].status != DISK_STAT_PENDING || !requests[i].stat_done || requests[i].mountdir == NULL)
+			continue;
+		first = np_name_hash_get(&file_systems, requests[i].mountdir);
+		if (first == NULL)
+			np_name_hash_put(&file_systems, requests[i].mountdir, &requests[i]);
+		else
+			requests[i].same_fs = first;
+	}
+	np_name_hash_free(&file_systems);
+}
+
+static void disk_stat_take_shared(disk_stat_request *requests, size_t nof_requests) {
+	for (size_t i = 0; i < nof_requests; i++) {
+		if (requests[i].same_fs == NULL)
+			continue;
+		requests[i].status = requests[i].same_fs->status;
+		requests[i].fsu = requests[i].same_fs->fsu;
+	}
+}
+
+#ifdef HAVE_LIBPTHREAD
+
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	disk_stat_request **requests;
+	size_t nof_requests;
+	size_t next;         /* first request not taken by a worker yet */
+	size_t nof_answered; /* including hung ones */
+	size_t nof_workers;
+	bool finished;       /* disk_stat_run() returned, requests must not be touched any more */
+} disk_stat_pool;
+
+static void *disk_stat_worker(void *arg) {
+	disk_stat_pool *pool = arg;
+
+	pthread_mutex_lock(&pool->lock);
+	while (!pool->finished && pool->next < pool->nof_requests) {
+		disk_stat_request *request = pool->requests[pool->next++];
+		disk_stat_request result;
+
+		request->status = DISK_STAT_RUNNING;
+		disk_stat_now(&request->started);
+		/* work on a copy, the requests are gone once a hung call returns late */
+		result = *request;
+		pthread_mutex_unlock(&pool->lock);
+
+		disk_stat_execute(&result);
+
+		pthread_mutex_lock(&pool->lock);
+		if (pool->finished)
+			break;
+		request->status = result.status;
+		request->error = result.error;
+		request->fsu = result.fsu;
+		if (++pool->nof_answered == pool->nof_requests)
+			pthread_cond_signal(&pool->changed);
+	}
+	pool->nof_workers--;
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+/* Starts workers until there are enough for the requests not taken yet,
+ * called with the lock held */
+static void disk_stat_spawn(disk_stat_pool *pool) {
+	pthread_t thread;
+	pthread_attr_t attr;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	while (pool->nof_workers < DISK_STAT_THREADS && pool->nof_workers < pool->nof_requests - pool->next) {
+		if (pthread_create(&thread, &attr, disk_stat_worker, pool) != 0)
+			break;
+		pool->nof_workers++;
+	}
+	pthread_attr_destroy(&attr);
+}
+
+static void disk_stat_run_workers(disk_stat_request **requests, size_t nof_requests, const struct timespec *deadline) {
+	disk_stat_pool *pool;
+	pthread_condattr_t condattr;
+
+	if (nof_requests == 0)
+		return;
+
+	/* Not freed, hung workers may still refer to it after we returned */
+	pool = calloc(1, sizeof(*pool));
+	if (pool == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_condattr_init(&condattr);
+	pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+	pthread_cond_init(&pool->changed, &condattr);
+	pthread_condattr_destroy(&condattr);
+	pool->requests = requests;
+	pool->nof_requests = nof_requests;
+
+	pthread_mutex_lock(&pool->lock);
+
+	disk_stat_spawn(pool);
+	if (pool->nof_workers == 0) {
+		/* no threads available at all, do it the old way */
+		pthread_mutex_unlock(&pool->lock);
+		for (size_t i = 0; i < nof_requests; i++)
+			disk_stat_execute(requests[i]);
+		return;
+	}
+
+	while (pool->nof_answered < pool->nof_requests) {
+		struct timespec now;
+
+		disk_stat_now(&now);
+		if (disk_stat_elapsed(&now, deadline) <= 0) {
+			/* give up on the ones still running or still waiting for a
+			 * worker, the blocked workers are left behind */
+			for (size_t i = 0; i < pool->nof_requests; i++) {
+				if (requests[i]->status == DISK_STAT_RUNNING || requests[i]->status == DISK_STAT_PENDING) {
+					requests[i]->status = DISK_STAT_HUNG;
+					pool->nof_answered++;
+				}
+			}
+			pool->next = pool->nof_requests;
+			break;
+		}
+		pthread_cond_timedwait(&pool->changed, &pool->lock, deadline);
+	}
+
+	pool->finished = true;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+#else /* HAVE_LIBPTHREAD */
+
+static void disk_stat_run_workers(disk_stat_request **requests, size_t nof_requests, const struct timespec *deadline) {
+	(void)deadline;
+	for (size_t i = 0; i < nof_requests; i++)
+		disk_stat_execute(requests[i]);
+}
+
+#endif /* HAVE_LIBPTHREAD */
+
+void disk_stat_run(disk_stat_request *requests, size_t nof_requests, double timeout) {
+	disk_stat_request **queue;
+	size_t nof_queued = 0;
+	struct timespec deadline;
+
+	for (size_t i = 0; i < nof_requests; i++) {
+		requests[i].status = DISK_STAT_PENDING;
+		requests[i].stat_done = false;
+		requests[i].same_fs = NULL;
+	}
+	if (nof_requests == 0)
+		return;
+
+	/* one deadline for the batch and the workers together */
+	disk_stat_now(&deadline);
+	deadline.tv_sec += (time_t)timeout;
+	deadline.tv_nsec += (long)((timeout - (double)(time_t)timeout) * 1.0e9);
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+#ifdef DISK_STAT_BATCH
+	if (disk_stat_batch_enabled)
+		disk_stat_batch(requests, nof_requests, &deadline);
+#endif
+	disk_stat_share(requests, nof_requests);
+
+	/* Not freed, like the pool of the workers */
+	queue = calloc(nof_requests, sizeof(*queue));
+	if (queue == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	for (size_t i = 0; i < nof_requests; i++) {
+		if (requests[i].status == DISK_STAT_PENDING && requests[i].same_fs == NULL)
+			queue[nof_queued++] = &requests[i];
+	}
+	disk_stat_run_workers(queue, nof_queued, &deadline);
+
+	disk_stat_take_shared(requests, nof_requests);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../common.h"
+#include "fsusage.h"
+
+/*
+ * Concurrent stat()/statvfs() of file systems
+ *
+ * A (dead) network file system can block stat() and statvfs() for a very
+ * long time. The calls are therefore issued from a small pool of worker
+ * threads, so one blocked file system does not hold up the others. All
+ * requests of a run share one deadline, a request which is not answered
+ * by then is marked as hung and its worker is left behind.
+ *
+ * Where io_uring is available the stat() calls of all requests are
+ * submitted to the kernel at once and only statvfs(), which has no io_uring
+ * counterpart, is left to the workers. It is issued once per file system,
+ * paths on the same file system share the result.
+ */
+
+#ifndef DISK_STAT_THREADS
+#	define DISK_STAT_THREADS 16
+#endif
+
+typedef enum {
+	DISK_STAT_PENDING,
+	DISK_STAT_RUNNING,
+	DISK_STAT_OK,
+	DISK_STAT_FAILED, /* stat() failed, see error */
+	DISK_STAT_HUNG    /* no answer before the deadline */
+} disk_stat_status;
+
+typedef struct disk_stat_request {
+	/* input, must stay valid until the program exits */
+	const char *path;     /* stat()ed to check that the path is accessible */
+	const char *mountdir; /* passed to get_fs_usage(), NULL for stat() only */
+	const char *devname;
+
+	/* output */
+	disk_stat_status status;
+	int error; /* errno of stat() */
+	struct fs_usage fsu;
+	struct timespec started;
+
+	/* internal */
+	bool stat_done;                    /* stat() answered by the batch */
+	struct disk_stat_request *same_fs; /* takes the usage of this one */
+} disk_stat_request;
+
+/* Processes all requests, returns when every one of them is answered or
+ * after timeout seconds at the latest */
+void disk_stat_run(disk_stat_request *requests, size_t nof_requests, double timeout);
+
+/* Enables or disables batching through io_uring, enabled by default */
+void disk_stat_set_batch(bool enabled);
@@ -0,0 +1,188 @@
+#include "./fill_rate.h"
+
+#include <stdarg.h>
+
+/* State format: label=time:used,time:used;label=...
+ * with the separators and blanks in labels escaped as %XX */
+
+static bool disk_fill_needs_escape(unsigned char c) { return c <= ' ' || c == '%' || c == ';' || c == '=' || c == ',' || c == ':'; }
+
+static int disk_fill_hex(char c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+static char *disk_fill_unescape(const char *start, size_t length) {
+	char *label = malloc(length + 1);
+	size_t j = 0;
+
+	if (label == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	for (size_t i = 0; i < length; i++) {
+		if (start[i] == '%' && i + 2 < length && disk_fill_hex(start[i + 1]) >= 0 && disk_fill_hex(start[i + 2]) >= 0) {
+			label[j++] = (char)(disk_fill_hex(start[i + 1]) * 16 + disk_fill_hex(start[i + 2]));
+			i += 2;
+		} else {
+			label[j++] = start[i];
+		}
+	}
+	label[j] = '\0';
+	return label;
+}
+
+disk_fill_history *disk_fill_history_get(struct name_hash *histories, const char *label) {
+	disk_fill_history *history = np_name_hash_get(histories, label);
+
+	if (history != NULL)
+		return history;
+	history = calloc(1, sizeof(*history));
+	if (history == NULL || (history->label = strdup(label)) == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	np_name_hash_put(histories, history->label, history);
+	return history;
+}
+
+void disk_fill_parse(const char *state, struct name_hash *histories) {
+	const char *record = state;
+
+	while (record && *record) {
+		const char *end = record + strcspn(record, ";");
+		const char *equals = memchr(record, '=', (size_t)(end - record));
+
+		if (equals != NULL) {
+			char *label = disk_fill_unescape(record, (size_t)(equals - record));
+			disk_fill_history *history = disk_fill_history_get(histories, label);
+			const char *pos = equals + 1;
+
+			free(label);
+			while (pos < end && history->nof_samples < DISK_FILL_MAX_SAMPLES) {
+				char *next;
+				disk_fill_sample sample;
+
+				sample.time = (time_t)strtoll(pos, &next, 10);
+				if (next == pos || *next != ':')
+					break;
+				pos = next + 1;
+				sample.used = strtoull(pos, &next, 10);
+				if (next == pos)
+					break;
+				/* must be in order */
+				if (history->nof_samples == 0 || history->samples[history->nof_samples - 1].time < sample.time)
+					history->samples[history->nof_samples++] = sample;
+				if (*next != ',')
+					break;
+				pos = next + 1;
+			}
+		}
+		record = (*end == ';') ? end + 1 : NULL;
+	}
+}
+
+typedef struct {
+	char *data;
+	size_t length;
+	size_t size;
+} disk_fill_buffer;
+
+static void disk_fill_append(disk_fill_buffer *buffer, const char *fmt, ...) {
+	va_list ap;
+	int n;
+
+	for (;;) {
+		va_start(ap, fmt);
+		n = vsnprintf(buffer->data + buffer->length, buffer->size - buffer->length, fmt, ap);
+		va_end(ap);
+		if (n < 0)
+			die(STATE_UNKNOWN, _("Could not format state data\n"));
+		if ((size_t)n < buffer->size - buffer->length)
+			break;
+		buffer->size = (buffer->length + (size_t)n + 1) * 2;
+		buffer->data = realloc(buffer->data, buffer->size);
+		if (buffer->data == NULL)
+			die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	}
+	buffer->length += (size_t)n;
+}
+
+char *disk_fill_format(const struct name_hash *histories, time_t now, time_t window) {
+	disk_fill_buffer state = {0};
+
+	disk_fill_append(&state, "%s", "");
+	for (size_t i = 0; i < histories->size; i++) {
+		const disk_fill_history *history = histories->slots[i].value;
+
+		if (histories->slots[i].name == NULL || history->nof_samples == 0 ||
+			history->samples[history->nof_samples - 1].time <= now - window)
+			continue;
+		if (state.length > 0)
+			disk_fill_append(&state, ";");
+		for (const unsigned char *c = (const unsigned char *)history->label; *c; c++) {
+			if (disk_fill_needs_escape(*c))
+				disk_fill_append(&state, "%%%02X", *c);
+			else
+				disk_fill_append(&state, "%c", *c);
+		}
+		for (size_t j = 0; j < history->nof_samples; j++)
+			disk_fill_append(&state, "%c%lld:%llu", j ? ',' : '=', (long long)history->samples[j].time,
+							 (unsigned long long)history->samples[j].used);
+	}
+	return state.data;
+}
+
+void disk_fill_add(disk_fill_history *history, time_t now, uint64_t used, time_t window) {
+	size_t keep = 0;
+
+	/* samples from the future, the clock was set back */
+	while (history->nof_samples > 0 && history->samples[history->nof_samples - 1].time >= now)
+		history->nof_samples--;
+
+	while (keep < history->nof_samples && history->samples[keep].time <= now - window)
+		keep++;
+	if (history->nof_samples - keep == DISK_FILL_MAX_SAMPLES)
+		keep++;
+	if (keep > 0) {
+		memmove(history->samples, history->samples + keep, (history->nof_samples - keep) * sizeof(history->samples[0]));
+		history->nof_samples -= keep;
+	}
+
+	history->samples[history->nof_samples].time = now;
+	history->samples[history->nof_samples].used = used;
+	history->nof_samples++;
+}
+
+bool disk_fill_rate(const disk_fill_history *history, double *rate) {
+	double mean_time = 0;
+	double mean_used = 0;
+	double covariance = 0;
+	double variance = 0;
+	size_t n = history->nof_samples;
+
+	if (n < 2)
+		return false;
+
+	/* relative to the first sample, doubles cannot hold bytes and epoch
+	 * seconds squared exactly */
+	for (size_t i = 0; i < n; i++) {
+		mean_time += (double)(history->samples[i].time - history->samples[0].time);
+		mean_used += (double)history->samples[i].used - (double)history->samples[0].used;
+	}
+	mean_time /= (double)n;
+	mean_used /= (double)n;
+
+	for (size_t i = 0; i < n; i++) {
+		double dt = (double)(history->samples[i].time - history->samples[0].time) - mean_time;
+		double du = ((double)history->samples[i].used - (double)history->samples[0].used) - mean_used;
+		covariance += dt * du;
+		variance += dt * dt;
+	}
+	if (variance <= 0)
+		return false;
+
+	*rate = covariance / variance;
+	return true;
+}
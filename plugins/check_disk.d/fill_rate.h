@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../common.h"
+#include "utils_disk.h"
+
+/*
+ * Fill rate of file systems
+ *
+ * The usage of every file system is sampled on each run and kept in the
+ * state file. A least squares fit over the samples of the last window gives
+ * the rate at which the file system fills up, and from that the time until
+ * it is full.
+ */
+
+#define DISK_FILL_MAX_SAMPLES 256
+#define DISK_FILL_DEFAULT_WINDOW (6 * 60 * 60)
+
+typedef struct {
+	time_t time;
+	uint64_t used; /* bytes */
+} disk_fill_sample;
+
+typedef struct {
+	char *label;
+	size_t nof_samples;
+	disk_fill_sample samples[DISK_FILL_MAX_SAMPLES]; /* oldest first */
+} disk_fill_history;
+
+/* Adds the histories in state (as written by disk_fill_format()) to
+ * histories, by label */
+void disk_fill_parse(const char *state, struct name_hash *histories);
+
+/* Returns the history of label, a new one if there is none yet */
+disk_fill_history *disk_fill_history_get(struct name_hash *histories, const char *label);
+
+/* Encodes the histories for the state file. Those of file systems missing
+ * in this run (e.g. unmounted for a while) are kept as long as they have
+ * samples in the window, so they are not lost after a short absence */
+char *disk_fill_format(const struct name_hash *histories, time_t now, time_t window);
+
+/* Appends a sample and drops the ones which are older than window seconds */
+void disk_fill_add(disk_fill_history *history, time_t now, uint64_t used, time_t window);
+
+/* Bytes per second by a linear fit over the samples, false if there are
+ * not enough of them yet */
+bool disk_fill_rate(const disk_fill_history *history, double *rate);
@@ -0,0 +1,171 @@
+#include "./io_stats.h"
+#include "../utils.h"
+
+#include <time.h>
+
+const char *const io_metric_names[IO_METRIC_COUNT] = {"iops", "throughput", "await", "util", "pressure"};
+
+int io_metric_by_name(const char *name, size_t length) {
+	for (int i = 0; i < IO_METRIC_COUNT; i++) {
+		if (strlen(io_metric_names[i]) == length && strncmp(io_metric_names[i], name, length) == 0)
+			return i;
+	}
+	return -1;
+}
+
+/* Reads a small file from /proc, which does not tell its size up front */
+static char *io_read_file(const char *path) {
+	FILE *fp = fopen(path, "r");
+	size_t size = 8192;
+	size_t length = 0;
+	char *text = NULL;
+
+	if (fp == NULL)
+		return NULL;
+	for (;;) {
+		char *larger = realloc(text, size);
+
+		if (larger == NULL) {
+			free(text);
+			fclose(fp);
+			return NULL;
+		}
+		text = larger;
+		length += fread(text + length, 1, size - length - 1, fp);
+		if (length < size - 1)
+			break;
+		size *= 2;
+	}
+	text[length] = '\0';
+	fclose(fp);
+	return text;
+}
+
+static int io_device_compare(const void *a, const void *b) {
+	const io_device_counters *x = a;
+	const io_device_counters *y = b;
+
+	if (x->major != y->major)
+		return x->major < y->major ? -1 : 1;
+	if (x->minor != y->minor)
+		return x->minor < y->minor ? -1 : 1;
+	return 0;
+}
+
+bool io_sample_parse(const char *text, io_sample *sample) {
+	size_t nof_lines = 1;
+	const char *line;
+
+	for (const char *c = text; *c; c++) {
+		if (*c == '\n')
+			nof_lines++;
+	}
+	sample->nof_devices = 0;
+	sample->devices = calloc(nof_lines, sizeof(io_device_counters));
+	if (sample->devices == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+
+	/* major minor name reads merged sectors ms writes merged sectors ms in_flight ms_io weighted_ms ... */
+	for (line = text; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : NULL) {
+		io_device_counters *device = &sample->devices[sample->nof_devices];
+		unsigned long long reads;
+		unsigned long long sectors_read;
+		unsigned long long ms_reading;
+		unsigned long long writes;
+		unsigned long long sectors_written;
+		unsigned long long ms_writing;
+		unsigned long long ms_doing_io;
+
+		if (sscanf(line, "%u %u %*s %llu %*u %llu %llu %llu %*u %llu %llu %*u %llu", &device->major, &device->minor, &reads,
+				   &sectors_read, &ms_reading, &writes, &sectors_written, &ms_writing, &ms_doing_io) != 9)
+			continue;
+		device->reads = reads;
+		device->sectors_read = sectors_read;
+		device->ms_reading = ms_reading;
+		device->writes = writes;
+		device->sectors_written = sectors_written;
+		device->ms_writing = ms_writing;
+		device->ms_doing_io = ms_doing_io;
+		sample->nof_devices++;
+	}
+	qsort(sample->devices, sample->nof_devices, sizeof(io_device_counters), io_device_compare);
+	return sample->nof_devices > 0;
+}
+
+bool io_sample_read(const char *path, io_sample *sample) {
+	char *text = io_read_file(path);
+	bool result;
+
+	clock_gettime(CLOCK_MONOTONIC, &sample->time);
+	if (text == NULL) {
+		memset(sample, 0, sizeof(*sample));
+		return false;
+	}
+	result = io_sample_parse(text, sample);
+	free(text);
+	return result;
+}
+
+void io_sample_free(io_sample *sample) {
+	free(sample->devices);
+	sample->devices = NULL;
+	sample->nof_devices = 0;
+}
+
+const io_device_counters *io_sample_find(const io_sample *sample, unsigned int major, unsigned int minor) {
+	io_device_counters key = {.major = major, .minor = minor};
+
+	if (sample->nof_devices == 0)
+		return NULL;
+	return bsearch(&key, sample->devices, sample->nof_devices, sizeof(io_device_counters), io_device_compare);
+}
+
+/* Counters wrap around at 32 bits on 32 bit kernels */
+static double io_delta(uint64_t before, uint64_t after) {
+	if (after >= before)
+		return (double)(after - before);
+	if (before <= UINT32_MAX)
+		return (double)(after + ((uint64_t)UINT32_MAX + 1 - before));
+	return 0;
+}
+
+void io_metrics_compute(const io_device_counters *before, const io_device_counters *after, double seconds, double *metrics) {
+	double ios = io_delta(before->reads, after->reads) + io_delta(before->writes, after->writes);
+	double sectors = io_delta(before->sectors_read, after->sectors_read) + io_delta(before->sectors_written, after->sectors_written);
+	double ms_waiting = io_delta(before->ms_reading, after->ms_reading) + io_delta(before->ms_writing, after->ms_writing);
+
+	if (seconds <= 0)
+		seconds = 1;
+	/* diskstats counts in sectors of 512 bytes, whatever the device uses */
+	metrics[IO_METRIC_IOPS] = ios / seconds;
+	metrics[IO_METRIC_THROUGHPUT] = sectors * 512 / seconds;
+	metrics[IO_METRIC_AWAIT] = ios > 0 ? ms_waiting / ios / 1000 : 0;
+	metrics[IO_METRIC_UTIL] = io_delta(before->ms_doing_io, after->ms_doing_io) / (seconds * 10);
+	if (metrics[IO_METRIC_UTIL] > 100)
+		metrics[IO_METRIC_UTIL] = 100;
+}
+
+bool io_pressure_parse(const char *text, io_pressure *pressure) {
+	bool has_some = false;
+	const char *line;
+
+	memset(pressure, 0, sizeof(*pressure));
+	for (line = text; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : NULL) {
+		if (sscanf(line, "some avg10=%lf", &pressure->some_avg10) == 1)
+			has_some = true;
+		else if (sscanf(line, "full avg10=%lf", &pressure->full_avg10) == 1)
+			pressure->has_full = true;
+	}
+	return has_some;
+}
+
+bool io_pressure_read(const char *path, io_pressure *pressure) {
+	char *text = io_read_file(path);
+	bool result;
+
+	if (text == NULL)
+		return false;
+	result = io_pressure_parse(text, pressure);
+	free(text);
+	return result;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "../common.h"
+
+/*
+ * I/O load of the block devices behind file systems
+ *
+ * /proc/diskstats is read twice and the counters of the device a file
+ * system is mounted from give its IOPS, throughput, average wait time and
+ * utilisation in between. /proc/pressure/io tells how much the whole
+ * system is stalled on I/O.
+ */
+
+#define IO_DISKSTATS "/proc/diskstats"
+#define IO_PRESSURE "/proc/pressure/io"
+
+typedef enum {
+	IO_METRIC_IOPS,       /* completed reads and writes per second */
+	IO_METRIC_THROUGHPUT, /* bytes read and written per second */
+	IO_METRIC_AWAIT,      /* average time a request took, seconds */
+	IO_METRIC_UTIL,       /* percentage of time the device was busy */
+	IO_METRIC_PRESSURE,   /* percentage of time some tasks stalled on I/O, last 10s */
+	IO_METRIC_COUNT
+} io_metric;
+
+extern const char *const io_metric_names[IO_METRIC_COUNT];
+
+typedef struct {
+	unsigned int major;
+	unsigned int minor;
+	uint64_t reads;
+	uint64_t sectors_read;
+	uint64_t ms_reading;
+	uint64_t writes;
+	uint64_t sectors_written;
+	uint64_t ms_writing;
+	uint64_t ms_doing_io;
+} io_device_counters;
+
+typedef struct {
+	io_device_counters *devices; /* sorted by major and minor */
+	size_t nof_devices;
+	struct timespec time;
+} io_sample;
+
+typedef struct {
+	double some_avg10;
+	double full_avg10;
+	bool has_full; /* not reported by older kernels */
+} io_pressure;
+
+/* Returns the metric named by the first length characters of name, -1 if
+ * there is none */
+int io_metric_by_name(const char *name, size_t length);
+
+/* Parses the contents of /proc/diskstats, false if it has no devices */
+bool io_sample_parse(const char *text, io_sample *sample);
+bool io_sample_read(const char *path, io_sample *sample);
+void io_sample_free(io_sample *sample);
+
+const io_device_counters *io_sample_find(const io_sample *sample, unsigned int major, unsigned int minor);
+
+/* Fills metrics[] up to IO_METRIC_UTIL from the counters of a device in
+ * two samples taken seconds apart */
+void io_metrics_compute(const io_device_counters *before, const io_device_counters *after, double seconds, double *metrics);
+
+/* Parses the contents of /proc/pressure/io */
+bool io_pressure_parse(const char *text, io_pressure *pressure);
+bool io_pressure_read(const char *path, io_pressure *pressure);
@@ -10,7 +10,8 @@
  * This file contains the check_hpjd plugin
  *
  * This plugin tests the STATUS of an HP printer with a JetDirect card.
- * Net-SNMP must be installed on the computer running the plugin.
+ * Net-SNMP must be installed on the computer running the plugin, unless
+ * the printers are queried in-process with --native.
  *
  *
  * This program is free software: you can redistribute it and/or modify
@@ -37,35 +38,39 @@ const char *email = "devel@monitoring-plugins.org";
 #include "popen.h"
 #include "utils.h"
 #include "netutils.h"
+#include "check_hpjd.d/status.h"
+#include "check_snmp.d/poller.h"
 
 #define DEFAULT_COMMUNITY "public"
 #define DEFAULT_PORT      "161"
 
-#define HPJD_LINE_STATUS           ".1.3.6.1.4.1.11.2.3.9.1.1.2.1"
-#define HPJD_PAPER_STATUS          ".1.3.6.1.4.1.11.2.3.9.1.1.2.2"
-#define HPJD_INTERVENTION_REQUIRED ".1.3.6.1.4.1.11.2.3.9.1.1.2.3"
-#define HPJD_GD_PERIPHERAL_ERROR   ".1.3.6.1.4.1.11.2.3.9.1.1.2.6"
-#define HPJD_GD_PAPER_OUT          ".1.3.6.1.4.1.11.2.3.9.1.1.2.8"
-#define HPJD_GD_PAPER_JAM          ".1.3.6.1.4.1.11.2.3.9.1.1.2.9"
-#define HPJD_GD_TONER_LOW          ".1.3.6.1.4.1.11.2.3.9.1.1.2.10"
-#define HPJD_GD_PAGE_PUNT          ".1.3.6.1.4.1.11.2.3.9.1.1.2.11"
-#define HPJD_GD_MEMORY_OUT         ".1.3.6.1.4.1.11.2.3.9.1.1.2.12"
-#define HPJD_GD_DOOR_OPEN          ".1.3.6.1.4.1.11.2.3.9.1.1.2.17"
-#define HPJD_GD_PAPER_OUTPUT       ".1.3.6.1.4.1.11.2.3.9.1.1.2.19"
-#define HPJD_GD_STATUS_DISPLAY     ".1.3.6.1.4.1.11.2.3.9.1.1.3"
-
-#define ONLINE  0
-#define OFFLINE 1
+#define L_NATIVE     CHAR_MAX + 1
+#define L_HOSTS      CHAR_MAX + 2
+#define L_HOSTS_FILE CHAR_MAX + 3
+
+/* as snmpget does */
+#define NATIVE_TIMEOUT 1
+#define NATIVE_RETRIES 5
+
+/* of the line of a printer, its panel message and what is wrong */
+#define PRINTER_TEXT_SIZE (MAX_INPUT_BUFFER * 2)
 
 static int process_arguments(int /*argc*/, char ** /*argv*/);
 static int validate_arguments(void);
 static void print_help(void);
 void print_usage(void);
+static void add_host(char *host);
+static void read_hosts_file(const char *filename);
+static int poll_printers(void);
 
 static char *community = NULL;
 static char *address = NULL;
 static unsigned int port = 0;
 static int check_paper_out = 1;
+static bool native = false; /* query in-process instead of running snmpget */
+static char **hosts = NULL; /* of --hosts and --hosts-file, polled at once */
+static size_t nof_hosts = 0;
+static size_t hosts_size = 0;
 
 int main(int argc, char **argv) {
 	char command_line[1024];
@@ -75,18 +80,8 @@ int main(int argc, char **argv) {
 	char query_string[512];
 	char *errmsg;
 	char *temp_buffer;
-	int line_status = ONLINE;
-	int paper_status = 0;
-	int intervention_required = 0;
-	int peripheral_error = 0;
-	int paper_jam = 0;
-	int paper_out = 0;
-	int toner_low = 0;
-	int page_punt = 0;
-	int memory_out = 0;
-	int door_open = 0;
-	int paper_output = 0;
-	char display_message[MAX_INPUT_BUFFER];
+	const char *message;
+	hpjd_status status = {.line_status = ONLINE};
 
 	errmsg = malloc(MAX_INPUT_BUFFER);
 
@@ -100,14 +95,21 @@ int main(int argc, char **argv) {
 	if (process_arguments(argc, argv) == ERROR)
 		usage4(_("Could not parse arguments"));
 
+	if (native)
+		return poll_printers();
+
 	/* removed ' 2>1' at end of command 10/27/1999 - EG */
 	/* create the query string */
-	sprintf(query_string, "%s.0 %s.0 %s.0 %s.0 %s.0 %s.0 %s.0 %s.0 %s.0 %s.0 %s.0 %s.0", HPJD_LINE_STATUS, HPJD_PAPER_STATUS,
-			HPJD_INTERVENTION_REQUIRED, HPJD_GD_PERIPHERAL_ERROR, HPJD_GD_PAPER_JAM, HPJD_GD_PAPER_OUT, HPJD_GD_TONER_LOW,
-			HPJD_GD_PAGE_PUNT, HPJD_GD_MEMORY_OUT, HPJD_GD_DOOR_OPEN, HPJD_GD_PAPER_OUTPUT, HPJD_GD_STATUS_DISPLAY);
+	query_string[0] = '\0';
+	for (size_t i = 0; i < HPJD_NOF_OIDS; i++)
+		sprintf(query_string + strlen(query_string), "%s%s", i ? " " : "", hpjd_oids[i]);
 
 	/* get the command to run */
+#ifdef PATH_TO_SNMPGET
 	sprintf(command_line, "%s -OQa -m : -v 1 -c %s %s:%u %s", PATH_TO_SNMPGET, community, address, port, query_string);
+#else
+	die(STATE_UNKNOWN, _("snmpget was not found at compile time, query the printer with --native\n"));
+#endif
 
 	/* run the command */
 	child_process = spopen(command_line);
@@ -142,47 +144,10 @@ int main(int argc, char **argv) {
 
 		} else {
 
-			switch (line) {
-
-			case 1: /* 1st line should contain the line status */
-				line_status = atoi(temp_buffer);
-				break;
-			case 2: /* 2nd line should contain the paper status */
-				paper_status = atoi(temp_buffer);
-				break;
-			case 3: /* 3rd line should be intervention required */
-				intervention_required = atoi(temp_buffer);
-				break;
-			case 4: /* 4th line should be peripheral error */
-				peripheral_error = atoi(temp_buffer);
-				break;
-			case 5: /* 5th line should contain the paper jam status */
-				paper_jam = atoi(temp_buffer);
-				break;
-			case 6: /* 6th line should contain the paper out status */
-				paper_out = atoi(temp_buffer);
-				break;
-			case 7: /* 7th line should contain the toner low status */
-				toner_low = atoi(temp_buffer);
-				break;
-			case 8: /* did data come too slow for engine */
-				page_punt = atoi(temp_buffer);
-				break;
-			case 9: /* did we run out of memory */
-				memory_out = atoi(temp_buffer);
-				break;
-			case 10: /* is there a door open */
-				door_open = atoi(temp_buffer);
-				break;
-			case 11: /* is output tray full */
-				paper_output = atoi(temp_buffer);
-				break;
-			case 12: /* display panel message */
-				strcpy(display_message, temp_buffer + 1);
-				break;
-			default: /* fold multiline message */
-				strncat(display_message, input_buffer, sizeof(display_message) - strlen(display_message) - 1);
-			}
+			if (line <= HPJD_NOF_OIDS) /* a line per OID in the order of the query */
+				hpjd_status_set(&status, line - 1, temp_buffer);
+			else /* fold multiline message */
+				strncat(status.display_message, input_buffer, sizeof(status.display_message) - strlen(status.display_message) - 1);
 		}
 
 		/* break out of the read loop if we encounter an error */
@@ -216,48 +181,13 @@ int main(int argc, char **argv) {
 
 	/* if we had no read errors, check the printer status results... */
 	if (result == STATE_OK) {
-
-		if (paper_jam) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Paper Jam"));
-		} else if (paper_out) {
-			if (check_paper_out)
-				result = STATE_WARNING;
-			strcpy(errmsg, _("Out of Paper"));
-		} else if (line_status == OFFLINE) {
-			if (strcmp(errmsg, "POWERSAVE ON") != 0) {
-				result = STATE_WARNING;
-				strcpy(errmsg, _("Printer Offline"));
-			}
-		} else if (peripheral_error) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Peripheral Error"));
-		} else if (intervention_required) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Intervention Required"));
-		} else if (toner_low) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Toner Low"));
-		} else if (memory_out) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Insufficient Memory"));
-		} else if (door_open) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("A Door is Open"));
-		} else if (paper_output) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Output Tray is Full"));
-		} else if (page_punt) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Data too Slow for Engine"));
-		} else if (paper_status) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Unknown Paper Error"));
-		}
+		result = hpjd_status_check(&status, check_paper_out, &message);
+		if (message != NULL)
+			strcpy(errmsg, message);
 	}
 
 	if (result == STATE_OK)
-		printf(_("Printer ok - (%s)\n"), display_message);
+		printf(_("Printer ok - (%s)\n"), status.display_message);
 
 	else if (result == STATE_UNKNOWN) {
 
@@ -269,7 +199,7 @@ int main(int argc, char **argv) {
 	}
 
 	else if (result == STATE_WARNING)
-		printf("%s (%s)\n", errmsg, display_message);
+		printf("%s (%s)\n", errmsg, status.display_message);
 
 	return result;
 }
@@ -286,6 +216,9 @@ int process_arguments(int argc, char **argv) {
 									   {"port", required_argument, 0, 'p'},
 									   {"version", no_argument, 0, 'V'},
 									   {"help", no_argument, 0, 'h'},
+									   {"native", no_argument, 0, L_NATIVE},
+									   {"hosts", required_argument, 0, L_HOSTS},
+									   {"hosts-file", required_argument, 0, L_HOSTS_FILE},
 									   {0, 0, 0, 0}};
 
 	if (argc < 2)
@@ -325,11 +258,25 @@ int process_arguments(int argc, char **argv) {
 			exit(STATE_UNKNOWN);
 		case '?': /* help */
 			usage5();
+		case L_NATIVE:
+			native = true;
+			break;
+		case L_HOSTS:
+			for (char *host = strtok(optarg, ", "); host != NULL; host = strtok(NULL, ", "))
+				add_host(host);
+			native = true;
+			break;
+		case L_HOSTS_FILE:
+			read_hosts_file(optarg);
+			native = true;
+			break;
 		}
 	}
 
 	c = optind;
-	if (address == NULL) {
+	if (address == NULL && nof_hosts > 0 && (argv[c] == NULL || !is_host(argv[c]))) {
+		/* the printers of --hosts only */
+	} else if (address == NULL) {
 		if (is_host(argv[c])) {
 			address = argv[c++];
 		} else {
@@ -348,6 +295,10 @@ int process_arguments(int argc, char **argv) {
 		port = atoi(DEFAULT_PORT);
 	}
 
+	/* -H is one more of them */
+	if (native && address != NULL)
+		add_host(address);
+
 	return validate_arguments();
 }
 
@@ -360,7 +311,8 @@ void print_help(void) {
 	printf(COPYRIGHT, copyright, email);
 
 	printf("%s\n", _("This plugin tests the STATUS of an HP printer with a JetDirect card."));
-	printf("%s\n", _("Net-snmp must be installed on the computer running the plugin."));
+	printf("%s\n", _("Net-snmp must be installed on the computer running the plugin, unless"));
+	printf("%s\n", _("the printers are queried with --native."));
 
 	printf("\n\n");
 
@@ -378,12 +330,129 @@ void print_help(void) {
 	printf(_("(default=%s)"), DEFAULT_PORT);
 	printf("\n");
 	printf(" %s\n", "-D");
-	printf("    %s", _("Disable paper check "));
+	printf("    %s\n", _("Disable paper check "));
+	printf(" %s\n", "--native");
+	printf("    %s\n", _("Query the printer directly with one request instead of running snmpget"));
+	printf(" %s\n", "--hosts=HOST[:PORT][,HOST...]");
+	printf("    %s\n", _("Query all these printers at once, as with --native, and report each of"));
+	printf("    %s\n", _("them after a summary"));
+	printf(" %s\n", "--hosts-file=FILE");
+	printf("    %s\n", _("Read more printers from FILE, one per line"));
 
 	printf(UT_SUPPORT);
 }
 
 void print_usage(void) {
 	printf("%s\n", _("Usage:"));
-	printf("%s -H host [-C community] [-p port] [-D]\n", progname);
+	printf("%s -H host [-C community] [-p port] [-D] [--native]\n", progname);
+	printf("[--hosts=host,... | --hosts-file=file]\n");
+}
+
+static void add_host(char *host) {
+	if (nof_hosts == hosts_size) {
+		hosts_size += 64;
+		hosts = realloc(hosts, hosts_size * sizeof(*hosts));
+		if (hosts == NULL)
+			die(STATE_UNKNOWN, _("Cannot malloc"));
+	}
+	hosts[nof_hosts++] = host;
+}
+
+/* One host per line, blank lines and comments starting with # are skipped */
+static void read_hosts_file(const char *filename) {
+	FILE *fp = fopen(filename, "r");
+	char line[MAX_INPUT_BUFFER];
+
+	if (fp == NULL)
+		die(STATE_UNKNOWN, _("Cannot open hosts file %s: %s\n"), filename, strerror(errno));
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		char *host = line + strspn(line, " \t");
+
+		host[strcspn(host, " \t\r\n#")] = '\0';
+		if (host[0] != '\0')
+			add_host(strdup(host));
+	}
+	fclose(fp);
+}
+
+/* The state of a printer from its response, with the line reporting it */
+static int printer_state(const snmp_target *target, char *text, size_t size) {
+	hpjd_status status;
+	const char *message;
+	char error[MAX_INPUT_BUFFER];
+	int result;
+
+	if (target->state != SNMP_TARGET_ANSWERED) {
+		snprintf(text, size, "%s %s %s", target->error, _("from host"), target->host);
+		/* if printer could not be reached, escalate to critical */
+		return strstr(target->error, "Timeout") ? STATE_CRITICAL : STATE_UNKNOWN;
+	}
+	if (target->response.error_status != 0) {
+		snprintf(text, size, "%s: %s", _("Error in packet"), snmp_error_text(target->response.error_status));
+		return STATE_UNKNOWN;
+	}
+	if (!hpjd_status_decode(&status, &target->response, error, sizeof(error))) {
+		snprintf(text, size, "%s", error);
+		return STATE_UNKNOWN;
+	}
+
+	result = hpjd_status_check(&status, check_paper_out, &message);
+	if (result == STATE_OK)
+		snprintf(text, size, _("Printer ok - (%s)"), status.display_message);
+	else
+		snprintf(text, size, "%s (%s)", message, status.display_message);
+	return result;
+}
+
+/* Sends the GET of all status OIDs to every printer at once, the answer of
+ * a single printer is reported as the snmpget one is */
+static int poll_printers(void) {
+	char port_text[8];
+	snmp_poller poller = {.version = SNMP_VERSION_1,
+						  .community = community,
+						  .timeout = NATIVE_TIMEOUT,
+						  .retries = NATIVE_RETRIES,
+						  .port = port_text,
+						  .family = AF_UNSPEC};
+	snmp_varbind requested[HPJD_NOF_OIDS];
+	snmp_pdu request = {.type = SNMP_PDU_GET, .varbinds = requested, .nof_varbinds = HPJD_NOF_OIDS};
+	static const int order[] = {STATE_CRITICAL, STATE_WARNING, STATE_UNKNOWN, STATE_OK};
+	int counts[STATE_UNKNOWN + 1] = {0};
+	int result = STATE_OK;
+	int *states = calloc(nof_hosts, sizeof(int));
+	char (*texts)[PRINTER_TEXT_SIZE] = calloc(nof_hosts, PRINTER_TEXT_SIZE);
+
+	if (states == NULL || texts == NULL)
+		die(STATE_UNKNOWN, _("Cannot malloc"));
+	for (size_t i = 0; i < HPJD_NOF_OIDS; i++) {
+		snmp_oid_parse(hpjd_oids[i], &requested[i].oid);
+		requested[i].value.type = SNMP_NULL;
+	}
+	snprintf(port_text, sizeof(port_text), "%u", port);
+	for (size_t h = 0; h < nof_hosts; h++)
+		snmp_poller_add(&poller, hosts[h]);
+	if (!snmp_poller_run(&poller, &request, HPJD_NOF_OIDS))
+		die(STATE_UNKNOWN, _("Cannot open socket: %s\n"), strerror(errno));
+
+	for (size_t h = 0; h < nof_hosts; h++) {
+		states[h] = printer_state(&poller.targets[h], texts[h], PRINTER_TEXT_SIZE);
+		counts[states[h]]++;
+		result = max_state_alt(result, states[h]);
+	}
+
+	if (nof_hosts == 1) {
+		printf("%s\n", texts[0]);
+	} else {
+		printf("HPJD %s - %zu %s, %d %s, %d %s, %d %s\n", state_text(result), nof_hosts, _("printers"), counts[STATE_CRITICAL],
+			   _("critical"), counts[STATE_WARNING], _("warning"), counts[STATE_UNKNOWN], _("unknown"));
+		/* the printers with problems first */
+		for (size_t s = 0; s < sizeof(order) / sizeof(order[0]); s++) {
+			for (size_t h = 0; h < nof_hosts; h++) {
+				if (states[h] == order[s])
+					printf("%s %s - %s\n", hosts[h], state_text(order[s]), texts[h]);
+			}
+		}
+	}
+	snmp_poller_free(&poller);
+	return result;
 }
@@ -0,0 +1,120 @@
+#include "./status.h"
+
+#include <ctype.h>
+
+const char *const hpjd_oids[HPJD_NOF_OIDS] = {HPJD_LINE_STATUS ".0",
+												HPJD_PAPER_STATUS ".0",
+												HPJD_INTERVENTION_REQUIRED ".0",
+												HPJD_GD_PERIPHERAL_ERROR ".0",
+												HPJD_GD_PAPER_JAM ".0",
+												HPJD_GD_PAPER_OUT ".0",
+												HPJD_GD_TONER_LOW ".0",
+												HPJD_GD_PAGE_PUNT ".0",
+												HPJD_GD_MEMORY_OUT ".0",
+												HPJD_GD_DOOR_OPEN ".0",
+												HPJD_GD_PAPER_OUTPUT ".0",
+												HPJD_GD_STATUS_DISPLAY ".0"};
+
+static void hpjd_status_set_number(hpjd_status *status, size_t position, int value) {
+	switch (position) {
+	case 0:
+		status->line_status = value;
+		break;
+	case 1:
+		status->paper_status = value;
+		break;
+	case 2:
+		status->intervention_required = value;
+		break;
+	case 3:
+		status->peripheral_error = value;
+		break;
+	case 4:
+		status->paper_jam = value;
+		break;
+	case 5:
+		status->paper_out = value;
+		break;
+	case 6:
+		status->toner_low = value;
+		break;
+	case 7: /* did data come too slow for engine */
+		status->page_punt = value;
+		break;
+	case 8: /* did we run out of memory */
+		status->memory_out = value;
+		break;
+	case 9: /* is there a door open */
+		status->door_open = value;
+		break;
+	case 10: /* is output tray full */
+		status->paper_output = value;
+		break;
+	}
+}
+
+void hpjd_status_set(hpjd_status *status, size_t position, const char *text) {
+	if (position + 1 < HPJD_NOF_OIDS) {
+		hpjd_status_set_number(status, position, atoi(text));
+	} else if (position + 1 == HPJD_NOF_OIDS) {
+		/* after the blank snmpget puts behind '=' */
+		snprintf(status->display_message, sizeof(status->display_message), "%s", text[0] == ' ' ? text + 1 : text);
+	}
+}
+
+bool hpjd_status_decode(hpjd_status *status, const snmp_pdu *response, char *error, size_t size) {
+	memset(status, 0, sizeof(*status));
+	for (size_t i = 0; i < HPJD_NOF_OIDS; i++) {
+		const snmp_value *value = i < response->nof_varbinds ? &response->varbinds[i].value : NULL;
+		char text[MAX_INPUT_BUFFER];
+
+		if (value != NULL && i + 1 < HPJD_NOF_OIDS && value->type == SNMP_INTEGER) {
+			hpjd_status_set_number(status, i, (int)value->integer);
+		} else if (value != NULL && i + 1 == HPJD_NOF_OIDS && value->type == SNMP_OCTET_STRING) {
+			size_t length = value->length < sizeof(status->display_message) ? value->length : sizeof(status->display_message) - 1;
+
+			/* lines of the panel folded into one */
+			for (size_t c = 0; c < length; c++)
+				status->display_message[c] = iscntrl(value->bytes[c]) ? ' ' : (char)value->bytes[c];
+			status->display_message[length] = '\0';
+		} else {
+			text[0] = '\0';
+			if (value != NULL)
+				snmp_value_format(value, text, sizeof(text));
+			snprintf(error, size, "%s = %s", hpjd_oids[i], value != NULL ? text : _("No response"));
+			return false;
+		}
+	}
+	return true;
+}
+
+int hpjd_status_check(const hpjd_status *status, bool check_paper_out, const char **message) {
+	*message = NULL;
+	if (status->paper_jam) {
+		*message = _("Paper Jam");
+	} else if (status->paper_out) {
+		*message = _("Out of Paper");
+		return check_paper_out ? STATE_WARNING : STATE_OK;
+	} else if (status->line_status == OFFLINE) {
+		if (strcmp(status->display_message, "POWERSAVE ON") == 0)
+			return STATE_OK;
+		*message = _("Printer Offline");
+	} else if (status->peripheral_error) {
+		*message = _("Peripheral Error");
+	} else if (status->intervention_required) {
+		*message = _("Intervention Required");
+	} else if (status->toner_low) {
+		*message = _("Toner Low");
+	} else if (status->memory_out) {
+		*message = _("Insufficient Memory");
+	} else if (status->door_open) {
+		*message = _("A Door is Open");
+	} else if (status->paper_output) {
+		*message = _("Output Tray is Full");
+	} else if (status->page_punt) {
+		*message = _("Data too Slow for Engine");
+	} else if (status->paper_status) {
+		*message = _("Unknown Paper Error");
+	}
+	return *message != NULL ? STATE_WARNING : STATE_OK;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "../common.h"
+#include "../check_snmp.d/ber.h"
+
+/*
+ * The status of a JetDirect printer
+ *
+ * It is read from the varbinds of one GET of all the status OIDs, typed as
+ * the printer sent them, or from the lines snmpget prints for them, and
+ * judged the same either way.
+ */
+
+#define HPJD_LINE_STATUS           ".1.3.6.1.4.1.11.2.3.9.1.1.2.1"
+#define HPJD_PAPER_STATUS          ".1.3.6.1.4.1.11.2.3.9.1.1.2.2"
+#define HPJD_INTERVENTION_REQUIRED ".1.3.6.1.4.1.11.2.3.9.1.1.2.3"
+#define HPJD_GD_PERIPHERAL_ERROR   ".1.3.6.1.4.1.11.2.3.9.1.1.2.6"
+#define HPJD_GD_PAPER_OUT          ".1.3.6.1.4.1.11.2.3.9.1.1.2.8"
+#define HPJD_GD_PAPER_JAM          ".1.3.6.1.4.1.11.2.3.9.1.1.2.9"
+#define HPJD_GD_TONER_LOW          ".1.3.6.1.4.1.11.2.3.9.1.1.2.10"
+#define HPJD_GD_PAGE_PUNT          ".1.3.6.1.4.1.11.2.3.9.1.1.2.11"
+#define HPJD_GD_MEMORY_OUT         ".1.3.6.1.4.1.11.2.3.9.1.1.2.12"
+#define HPJD_GD_DOOR_OPEN          ".1.3.6.1.4.1.11.2.3.9.1.1.2.17"
+#define HPJD_GD_PAPER_OUTPUT       ".1.3.6.1.4.1.11.2.3.9.1.1.2.19"
+#define HPJD_GD_STATUS_DISPLAY     ".1.3.6.1.4.1.11.2.3.9.1.1.3"
+
+#define ONLINE  0
+#define OFFLINE 1
+
+enum {
+	HPJD_NOF_OIDS = 12
+};
+
+/* The instances of the OIDs above in the order they are asked for */
+extern const char *const hpjd_oids[HPJD_NOF_OIDS];
+
+typedef struct {
+	int line_status;
+	int paper_status;
+	int intervention_required;
+	int peripheral_error;
+	int paper_jam;
+	int paper_out;
+	int toner_low;
+	int page_punt;
+	int memory_out;
+	int door_open;
+	int paper_output;
+	char display_message[MAX_INPUT_BUFFER];
+} hpjd_status;
+
+/* Sets the value of the OID at position of hpjd_oids from its text */
+void hpjd_status_set(hpjd_status *status, size_t position, const char *text);
+
+/* Reads the varbinds of a response to the request of hpjd_oids, false
+ * with the OID that was missing or not of its type in error otherwise */
+bool hpjd_status_decode(hpjd_status *status, const snmp_pdu *response, char *error, size_t size);
+
+/* STATE_OK or STATE_WARNING, with what is wrong in message */
+int hpjd_status_check(const hpjd_status *status, bool check_paper_out, const char **message);
@@ -136,6 +136,25 @@ char buffer[MAX_INPUT_BUFFER];
 char *client_cert = NULL;
 char *client_privkey = NULL;
 
+/* The response is received into a list of buffers, which are joined only
+ * once after the transfer, instead of growing a single buffer on every read */
+typedef struct page_chunk {
+  struct page_chunk *next;
+  size_t len;
+  char data[MAX_INPUT_BUFFER];
+} page_chunk;
+
+typedef struct {
+  page_chunk *head;
+  page_chunk *tail;
+  size_t size;
+  /* end of headers, searched for while receiving */
+  bool headers_done;
+  size_t headers_end; /* offset of the first newline of the empty line */
+  size_t last_newline;
+  int empty_line_state; /* 0: in a line, 1: after \n, 2: after \n\r */
+} page_buffer;
+
 // Forward function declarations
 bool process_arguments (int, char **);
 int check_http (void);
@@ -151,7 +170,7 @@ char *perfd_time_transfer (double microsec);
 char *perfd_size (int page_len);
 void print_help (void);
 void print_usage (void);
-char *unchunk_content(const char *content);
+char *unchunk_content(char *content);
 
 int
 main (int argc, char **argv)
@@ -623,22 +642,83 @@ bool process_arguments (int argc, char **argv)
 
 
 
-/* Returns 1 if we're done processing the document body; 0 to keep going */
-static int
-document_headers_done (char *full_page)
+/* Returns a buffer with room for at least one more byte */
+static page_chunk *
+page_buffer_tail (page_buffer *pb)
 {
-  const char *body;
+  page_chunk *chunk;
 
-  for (body = full_page; *body; body++) {
-    if (!strncmp (body, "\n\n", 2) || !strncmp (body, "\n\r\n", 3))
-      break;
+  if (pb->tail != NULL && pb->tail->len < sizeof (pb->tail->data))
+    return pb->tail;
+
+  if ((chunk = malloc (sizeof (page_chunk))) == NULL)
+    die (STATE_UNKNOWN, _("HTTP UNKNOWN - Could not allocate memory for full_page\n"));
+  chunk->next = NULL;
+  chunk->len = 0;
+
+  if (pb->tail == NULL)
+    pb->head = chunk;
+  else
+    pb->tail->next = chunk;
+  pb->tail = chunk;
+  return chunk;
+}
+
+/* Accounts for len bytes just received at the end of the tail buffer and
+ * continues the search for the end of the headers where it stopped */
+static void
+page_buffer_received (page_buffer *pb, size_t len)
+{
+  char *data = pb->tail->data + pb->tail->len;
+  char *pos;
+  size_t i;
+
+  while ((pos = memchr (data, '\0', len))) {
+    /* replace nul character with a blank */
+    *pos = ' ';
   }
 
-  if (!*body)
-    return 0;  /* haven't read end of headers yet */
+  for (i = 0; i < len && !pb->headers_done; i++) {
+    if (data[i] == '\n') {
+      if (pb->empty_line_state > 0) {
+        pb->headers_done = true;
+        pb->headers_end = pb->last_newline;
+      }
+      pb->last_newline = pb->size + i;
+      pb->empty_line_state = 1;
+    } else if (data[i] == '\r' && pb->empty_line_state == 1) {
+      pb->empty_line_state = 2;
+    } else {
+      pb->empty_line_state = 0;
+    }
+  }
+
+  pb->tail->len += len;
+  pb->size += len;
+}
+
+/* Copies the received data into one nul terminated string and releases the
+ * buffers */
+static char *
+page_buffer_join (page_buffer *pb)
+{
+  page_chunk *chunk, *next;
+  char *page;
+  size_t offset = 0;
+
+  if ((page = malloc (pb->size + 1)) == NULL)
+    die (STATE_UNKNOWN, _("HTTP UNKNOWN - Could not allocate memory for full_page\n"));
+
+  for (chunk = pb->head; chunk != NULL; chunk = next) {
+    next = chunk->next;
+    memcpy (page + offset, chunk->data, chunk->len);
+    offset += chunk->len;
+    free (chunk);
+  }
+  page[offset] = '\0';
 
-  full_page[body - full_page] = 0;
-  return 1;
+  pb->head = pb->tail = NULL;
+  return page;
 }
 
 static time_t
@@ -927,8 +1007,9 @@ check_http (void)
   int http_status;
   int i = 0;
   size_t pagesize = 0;
+  page_buffer received = { 0 };
+  page_chunk *chunk;
   char *full_page;
-  char *full_page_new;
   char *buf;
   char *pos;
   long microsec = 0L;
@@ -1096,32 +1177,22 @@ check_http (void)
   elapsed_time_headers = (double)microsec_headers / 1.0e6;
 
   /* fetch the page */
-  full_page = strdup("");
   gettimeofday (&tv_temp, NULL);
-  while ((i = my_recv (buffer, MAX_INPUT_BUFFER-1)) > 0) {
+  while (true) {
+    chunk = page_buffer_tail (&received);
+    if ((i = my_recv (chunk->data + chunk->len, sizeof (chunk->data) - chunk->len)) <= 0)
+      break;
     if ((i >= 1) && (elapsed_time_firstbyte <= 0.000001)) {
       microsec_firstbyte = deltime (tv_temp);
       elapsed_time_firstbyte = (double)microsec_firstbyte / 1.0e6;
     }
-    while ((pos = memchr(buffer, '\0', i))) {
-      /* replace nul character with a blank */
-      *pos = ' ';
-    }
-    buffer[i] = '\0';
-
-    if ((full_page_new = realloc(full_page, pagesize + i + 1)) == NULL)
-        die (STATE_UNKNOWN, _("HTTP UNKNOWN - Could not allocate memory for full_page\n"));
-
-    memmove(&full_page_new[pagesize], buffer, i + 1);
-
-    full_page = full_page_new;
 
-    pagesize += i;
+    page_buffer_received (&received, i);
 
-                if (no_body && document_headers_done (full_page)) {
-                  i = 0;
-                  break;
-                }
+    if (no_body && received.headers_done) {
+      i = 0;
+      break;
+    }
   }
   microsec_transfer = deltime (tv_temp);
   elapsed_time_transfer = (double)microsec_transfer / 1.0e6;
@@ -1130,6 +1201,11 @@ check_http (void)
     die(STATE_CRITICAL, _("HTTP CRITICAL - Error on receive\n"));
   }
 
+  pagesize = received.size;
+  full_page = page_buffer_join (&received);
+  if (no_body && received.headers_done)
+    full_page[received.headers_end] = '\0';
+
   /* return a CRITICAL status if we couldn't read any data */
   if (pagesize == (size_t) 0)
     die (STATE_CRITICAL, _("HTTP CRITICAL - No data received from host\n"));
@@ -1293,11 +1369,9 @@ check_http (void)
       printf("Found chunked content\n");
     }
     // We actually found the chunked header
-    char *tmp = unchunk_content(page);
-    if (tmp == NULL) {
+    if (unchunk_content(page) == NULL) {
       die(STATE_UNKNOWN, "HTTP %s: %s\n", state_text(STATE_UNKNOWN), "Failed to unchunk message body");
     }
-    page = tmp;
   }
 
   if (strlen(string_expect) > 0) {
@@ -1392,26 +1466,23 @@ check_http (void)
   return STATE_UNKNOWN;
 }
 
-/* Receivces a pointer to the beginning of the body of a HTTP message
- * which is chunked and returns a pointer to a freshly allocated memory
- * region containing the unchunked body or NULL if something failed.
- * The result must be freed by the caller.
+/* Receives a pointer to the beginning of the body of a HTTP message
+ * which is chunked and decodes it in place, the decoded body is never
+ * longer than the encoded one. Returns content or NULL if the body is
+ * malformed.
  */
-char *unchunk_content(const char *content) {
+char *unchunk_content(char *content) {
   // https://en.wikipedia.org/wiki/Chunked_transfer_encoding
   // https://www.rfc-editor.org/rfc/rfc7230#section-4.1
-  char *result = NULL;
-  char *start_of_chunk;
-  char* end_of_chunk;
-  long size_of_chunk;
+  const char *end = content + strlen(content);
   const char *pointer = content;
+  char *result = content;
   char *endptr;
-  long length_of_chunk = 0;
-  size_t overall_size = 0;
+  long size_of_chunk;
 
   while (true) {
     size_of_chunk = strtol(pointer, &endptr, 16);
-    if (size_of_chunk == LONG_MIN || size_of_chunk == LONG_MAX) {
+    if (size_of_chunk == LONG_MIN || size_of_chunk == LONG_MAX || size_of_chunk < 0) {
       // Apparently underflow or overflow, should not happen
       if (verbose) {
         printf("Got an underflow or overflow from strtol at: %u\n", __LINE__);
@@ -1426,59 +1497,42 @@ char *unchunk_content(const char *content) {
       return NULL;
     }
 
-    // So, we got the length of the chunk
-    if (*endptr == ';') {
-      // Chunk extension starts here
-      while (*endptr != '\r') {
-        endptr++;
+    // So, we got the length of the chunk, skip a chunk extension
+    pointer = endptr + strcspn(endptr, "\n");
+    if (*pointer != '\n') {
+      if (verbose) {
+        printf("Chunk size line is not terminated (Line: %u)\n", __LINE__);
       }
+      return NULL;
     }
+    pointer++;
 
-    start_of_chunk = endptr + 2;
-    end_of_chunk = start_of_chunk + size_of_chunk;
-    length_of_chunk = (long)(end_of_chunk - start_of_chunk);
-    pointer = end_of_chunk + 2; //Next number should be here
-
-    if (length_of_chunk == 0) {
+    if (size_of_chunk == 0) {
       // Chunk length is 0, so this is the last one
       break;
     }
 
-    overall_size += length_of_chunk;
-
-    if (result == NULL) {
-      // Size of the chunk plus the ending NULL byte
-      result = (char *)malloc(length_of_chunk +1);
-      if (result == NULL) {
-        if (verbose) {
-          printf("Failed to allocate memory for unchunked body\n");
-        }
-        return NULL;
-      }
-    } else {
-      // Enlarge memory to the new size plus the ending NULL byte
-      void *tmp = realloc(result, overall_size +1);
-      if (tmp == NULL) {
-        if (verbose) {
-          printf("Failed to allocate memory for unchunked body\n");
-        }
-        return NULL;
-      } else {
-        result = tmp;
+    if (size_of_chunk > end - pointer) {
+      if (verbose) {
+        printf("Chunk of %ld bytes exceeds the received data (Line: %u)\n", size_of_chunk, __LINE__);
       }
+      return NULL;
     }
 
-    memcpy(result + (overall_size - size_of_chunk), start_of_chunk, size_of_chunk);
-  }
+    // The write position never overtakes the read position
+    memmove(result, pointer, size_of_chunk);
+    result += size_of_chunk;
+    pointer += size_of_chunk;
 
-  if (overall_size == 0 && result == NULL) {
-    // We might just have received the end chunk without previous content, so result is never allocated
-    result = calloc(1, sizeof(char));
-    // No error handling here, we can only return NULL anyway
-  } else {
-    result[overall_size] = '\0';
+    // Next number should be after the CRLF
+    if (*pointer == '\r')
+      pointer++;
+    if (*pointer == '\n')
+      pointer++;
   }
-  return result;
+
+  *result = '\0';
+  return content;
 }
 
 /* per RFC 2396 */
@@ -36,6 +36,8 @@ const char *email = "devel@monitoring-plugins.org";
 #include "./runcmd.h"
 #include "./utils.h"
 #include "./popen.h"
+#include "./check_load.d/cpu.h"
+#include "./check_load.d/top.h"
 
 #include <string.h>
 
@@ -56,9 +58,23 @@ static int validate_arguments (void);
 void print_help (void);
 void print_usage (void);
 static int print_top_consuming_processes();
+static int check_cpu_usage (void);
 
 static int n_procs_to_show = 0;
 
+/* the CPU usage sampled over a short window, thresholds unset when negative */
+#define L_UTILIZATION CHAR_MAX + 1
+#define L_IOWAIT      CHAR_MAX + 2
+#define L_STEAL       CHAR_MAX + 3
+#define L_PRESSURE    CHAR_MAX + 4
+
+enum { CPU_UTILIZATION, CPU_IOWAIT, CPU_STEAL, CPU_PRESSURE, CPU_METRICS };
+static const char *const cpu_metrics[CPU_METRICS] = { "cpu", "iowait", "steal", "cpu_pressure" };
+static double sample_seconds = 0.0;
+static double wcpu[CPU_METRICS] = { -1.0, -1.0, -1.0, -1.0 };
+static double ccpu[CPU_METRICS] = { -1.0, -1.0, -1.0, -1.0 };
+static char *cpu_perfdata = "";
+
 /* strictly for pretty-print usage in loops */
 static const int nums[3] = { 1, 5, 15 };
 
@@ -100,6 +116,23 @@ get_threshold(char *arg, double *th)
 }
 
 
+/* "WARN,CRIT" in percent */
+static void
+get_cpu_threshold(char *arg, int metric)
+{
+	char *p;
+
+	wcpu[metric] = strtod(arg, &p);
+	if (p == arg || *p != ',')
+		usage2 (_("CPU thresholds must be WARN,CRIT in percent"), arg);
+	ccpu[metric] = strtod(p + 1, &p);
+	if (*p != '\0' || wcpu[metric] < 0 || wcpu[metric] > ccpu[metric])
+		usage2 (_("CPU thresholds must be WARN,CRIT in percent"), arg);
+	if (sample_seconds == 0.0)
+		sample_seconds = 1.0;
+}
+
+
 int
 main (int argc, char **argv)
 {
@@ -203,6 +236,9 @@ main (int argc, char **argv)
 		}
 	}
 
+	if (sample_seconds > 0.0)
+		result = max_state (result, check_cpu_usage ());
+
 	printf("LOAD %s - %s|", state_text(result), status_line);
 	for(i = 0; i < 3; i++) {
 		if (is_using_scaled_load_values) {
@@ -212,6 +248,7 @@ main (int argc, char **argv)
 			printf("load%d=%.3f;%.3f;%.3f;0; ", nums[i], la[i], wload[i], cload[i]);
 		}
 	}
+	printf("%s", cpu_perfdata);
 
 	putchar('\n');
 	if (n_procs_to_show > 0) {
@@ -235,6 +272,11 @@ process_arguments (int argc, char **argv)
 		{"version", no_argument, 0, 'V'},
 		{"help", no_argument, 0, 'h'},
 		{"procs-to-show", required_argument, 0, 'n'},
+		{"sample", required_argument, 0, 's'},
+		{"utilization", required_argument, 0, L_UTILIZATION},
+		{"iowait", required_argument, 0, L_IOWAIT},
+		{"steal", required_argument, 0, L_STEAL},
+		{"pressure", required_argument, 0, L_PRESSURE},
 		{0, 0, 0, 0}
 	};
 
@@ -242,7 +284,7 @@ process_arguments (int argc, char **argv)
 		return ERROR;
 
 	while (1) {
-		c = getopt_long (argc, argv, "Vhrc:w:n:", longopts, &option);
+		c = getopt_long (argc, argv, "Vhrc:w:n:s:", longopts, &option);
 
 		if (c == -1 || c == EOF)
 			break;
@@ -266,6 +308,23 @@ process_arguments (int argc, char **argv)
 		case 'n':
 			n_procs_to_show = atoi(optarg);
 			break;
+		case 's': /* window the CPU usage is sampled over */
+			sample_seconds = strtod(optarg, NULL);
+			if (sample_seconds <= 0.0 || sample_seconds > 60.0)
+				usage2 (_("Sample window must be between 0 and 60 seconds"), optarg);
+			break;
+		case L_UTILIZATION:
+			get_cpu_threshold(optarg, CPU_UTILIZATION);
+			break;
+		case L_IOWAIT:
+			get_cpu_threshold(optarg, CPU_IOWAIT);
+			break;
+		case L_STEAL:
+			get_cpu_threshold(optarg, CPU_STEAL);
+			break;
+		case L_PRESSURE:
+			get_cpu_threshold(optarg, CPU_PRESSURE);
+			break;
 		case '?':									/* help */
 			usage5 ();
 		}
@@ -336,6 +395,19 @@ print_help (void)
 	printf (" %s\n", "-n, --procs-to-show=NUMBER_OF_PROCS");
 	printf ("    %s\n", _("Number of processes to show when printing the top consuming processes."));
 	printf ("    %s\n", _("NUMBER_OF_PROCS=0 disables this feature. Default value is 0"));
+	printf (" %s\n", "-s, --sample=SECONDS");
+	printf ("    %s\n", _("Read the CPU time from /proc/stat and the CPU pressure (PSI) from"));
+	printf ("    %s\n", _("/proc/pressure/cpu at the start and the end of this window, to report"));
+	printf ("    %s\n", _("the CPU usage of now besides the load averages. Default is 1 second"));
+	printf ("    %s\n", _("when any of the thresholds below is given"));
+	printf (" %s\n", "--utilization=WARN,CRIT");
+	printf ("    %s\n", _("Percent of the CPU time spent busy"));
+	printf (" %s\n", "--iowait=WARN,CRIT");
+	printf ("    %s\n", _("Percent of the CPU time spent idle waiting for I/O"));
+	printf (" %s\n", "--steal=WARN,CRIT");
+	printf ("    %s\n", _("Percent of the CPU time taken by the hypervisor for other guests"));
+	printf (" %s\n", "--pressure=WARN,CRIT");
+	printf ("    %s\n", _("Percent of the window some task waited for a CPU"));
 
 	printf (UT_SUPPORT);
 }
@@ -345,6 +417,7 @@ print_usage (void)
 {
 	printf ("%s\n", _("Usage:"));
 	printf ("%s [-r] -w WLOAD1,WLOAD5,WLOAD15 -c CLOAD1,CLOAD5,CLOAD15 [-n NUMBER_OF_PROCS]\n", progname);
+	printf ("[-s SECONDS] [--utilization=W,C] [--iowait=W,C] [--steal=W,C] [--pressure=W,C]\n");
 }
 
 #ifdef PS_USES_PROCPCPU
@@ -371,6 +444,20 @@ int cmpstringp(const void *p1, const void *p2) {
 static int print_top_consuming_processes() {
 	int i = 0;
 	struct output chld_out, chld_err;
+	load_top top;
+
+	/* the top ones of /proc without running ps and sorting its lines */
+	load_top_init(&top, (size_t)n_procs_to_show);
+	if (load_top_scan(&top, PROC_SCAN_ROOT)) {
+		printf("%7s %7s %9s %9s %5s %s\n", "PID", "PPID", "VSZ", "RSS", "%CPU", "COMMAND");
+		for (size_t p = 0; p < top.nof_processes; p++)
+			printf("%7d %7d %9d %9d %5.1f %s\n", (int)top.processes[p].pid, (int)top.processes[p].ppid, top.processes[p].vsz,
+				   top.processes[p].rss, top.processes[p].pcpu, top.processes[p].prog);
+		load_top_free(&top);
+		return OK;
+	}
+	load_top_free(&top);
+
 	if(np_runcmd(PS_COMMAND, &chld_out, &chld_err, 0) != 0){
 		fprintf(stderr, _("'%s' exited with non-zero status.\n"), PS_COMMAND);
 		return STATE_UNKNOWN;
@@ -389,3 +476,55 @@ static int print_top_consuming_processes() {
 	}
 	return OK;
 }
+
+/* Samples the CPU time and pressure over the window and checks them,
+ * their text is added to the status line */
+static int
+check_cpu_usage (void)
+{
+	load_sample first, second;
+	load_usage usage;
+	struct timespec window;
+	double values[CPU_METRICS];
+	int result = STATE_OK;
+	int i;
+
+	if (!load_sample_read (&first, LOAD_PROC_STAT, LOAD_PRESSURE_CPU))
+		die (STATE_UNKNOWN, _("Could not read %s: %s\n"), LOAD_PROC_STAT, strerror (errno));
+	window.tv_sec = (time_t) sample_seconds;
+	window.tv_nsec = (long) ((sample_seconds - (double) window.tv_sec) * 1000000000.0);
+	while (nanosleep (&window, &window) != 0 && errno == EINTR)
+		;
+	if (!load_sample_read (&second, LOAD_PROC_STAT, LOAD_PRESSURE_CPU))
+		die (STATE_UNKNOWN, _("Could not read %s: %s\n"), LOAD_PROC_STAT, strerror (errno));
+	load_usage_between (&first, &second, &usage);
+
+	if (!usage.has_pressure && ccpu[CPU_PRESSURE] >= 0)
+		die (STATE_UNKNOWN, _("CPU pressure is not available from %s\n"), LOAD_PRESSURE_CPU);
+	values[CPU_UTILIZATION] = usage.utilization;
+	values[CPU_IOWAIT] = usage.iowait;
+	values[CPU_STEAL] = usage.steal;
+	values[CPU_PRESSURE] = usage.pressure;
+
+	for (i = 0; i < CPU_METRICS; i++) {
+		if (i == CPU_PRESSURE && !usage.has_pressure)
+			break;
+		if (ccpu[i] >= 0 && values[i] > ccpu[i])
+			result = max_state (result, STATE_CRITICAL);
+		else if (wcpu[i] >= 0 && values[i] > wcpu[i])
+			result = max_state (result, STATE_WARNING);
+		if (ccpu[i] >= 0)
+			xasprintf (&cpu_perfdata, "%s%s=%.1f%%;%.1f;%.1f;0;100 ", cpu_perfdata, cpu_metrics[i], values[i], wcpu[i], ccpu[i]);
+		else
+			xasprintf (&cpu_perfdata, "%s%s=%.1f%%;;;0;100 ", cpu_perfdata, cpu_metrics[i], values[i]);
+	}
+
+	xasprintf (&status_line, _("%s, cpu %.1f%% (iowait %.1f%%, steal %.1f%%) over %gs"), status_line, usage.utilization, usage.iowait,
+			   usage.steal, sample_seconds);
+	if (usage.has_pressure) {
+		xasprintf (&status_line, _("%s, cpu pressure %.1f%% (avg10 %.2f%%)"), status_line, usage.pressure, usage.avg10);
+		xasprintf (&cpu_perfdata, "%scpu_pressure_avg10=%.2f%%;;;0;100 cpu_pressure_avg60=%.2f%%;;;0;100 cpu_pressure_avg300=%.2f%%;;;0;100 ",
+				   cpu_perfdata, usage.avg10, usage.avg60, usage.avg300);
+	}
+	return result;
+}
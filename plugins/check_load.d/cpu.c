@@ -0,0 +1,86 @@
+#include "./cpu.h"
+
+#include <fcntl.h>
+
+/* Reads the start of filename into buffer, the first lines are all that
+ * is needed of either file */
+static bool load_read_start(const char *filename, char *buffer, size_t size) {
+	int fd = open(filename, O_RDONLY);
+	ssize_t length;
+
+	if (fd < 0)
+		return false;
+	length = read(fd, buffer, size - 1);
+	close(fd);
+	if (length <= 0)
+		return false;
+	buffer[length] = '\0';
+	return true;
+}
+
+bool load_parse_stat(const char *text, load_cpu_times *cpu) {
+	/* the line of all CPUs comes before the "cpu0" ones */
+	if (strncmp(text, "cpu ", 4) != 0)
+		return false;
+	memset(cpu, 0, sizeof(*cpu));
+	/* kernels before 2.6.11 have no steal, before 2.5.41 no iowait */
+	return sscanf(text + 4, "%llu %llu %llu %llu %llu %llu %llu %llu", &cpu->user, &cpu->nice, &cpu->system, &cpu->idle, &cpu->iowait,
+				  &cpu->irq, &cpu->softirq, &cpu->steal) >= 4;
+}
+
+bool load_parse_pressure(const char *text, load_pressure *pressure) {
+	const char *some = strncmp(text, "some ", 5) == 0 ? text : strstr(text, "\nsome ");
+
+	if (some == NULL)
+		return false;
+	if (*some == '\n')
+		some++;
+	return sscanf(some, "some avg10=%lf avg60=%lf avg300=%lf total=%llu", &pressure->avg10, &pressure->avg60, &pressure->avg300,
+				  &pressure->total) == 4;
+}
+
+bool load_sample_read(load_sample *sample, const char *stat_file, const char *pressure_file) {
+	char buffer[4096];
+
+	clock_gettime(CLOCK_MONOTONIC, &sample->time);
+	if (!load_read_start(stat_file, buffer, sizeof(buffer)) || !load_parse_stat(buffer, &sample->cpu))
+		return false;
+	sample->has_pressure = pressure_file != NULL && load_read_start(pressure_file, buffer, sizeof(buffer)) &&
+						   load_parse_pressure(buffer, &sample->pressure);
+	return true;
+}
+
+/* The ticks of b after those of a, 0 if the counter went back */
+static double load_ticks(unsigned long long a, unsigned long long b) { return b > a ? (double)(b - a) : 0.0; }
+
+void load_usage_between(const load_sample *first, const load_sample *second, load_usage *usage) {
+	const load_cpu_times *a = &first->cpu;
+	const load_cpu_times *b = &second->cpu;
+	double idle = load_ticks(a->idle, b->idle);
+	double iowait = load_ticks(a->iowait, b->iowait);
+	double steal = load_ticks(a->steal, b->steal);
+	double busy = load_ticks(a->user, b->user) + load_ticks(a->nice, b->nice) + load_ticks(a->system, b->system) +
+				  load_ticks(a->irq, b->irq) + load_ticks(a->softirq, b->softirq);
+	double total = busy + idle + iowait + steal;
+	double seconds =
+		(double)(second->time.tv_sec - first->time.tv_sec) + (double)(second->time.tv_nsec - first->time.tv_nsec) / 1000000000.0;
+
+	memset(usage, 0, sizeof(*usage));
+	if (total > 0) {
+		usage->utilization = busy / total * 100.0;
+		usage->iowait = iowait / total * 100.0;
+		usage->steal = steal / total * 100.0;
+	}
+
+	usage->has_pressure = first->has_pressure && second->has_pressure;
+	if (usage->has_pressure) {
+		if (seconds > 0)
+			usage->pressure = load_ticks(first->pressure.total, second->pressure.total) / (seconds * 10000.0);
+		/* waits overlap the window at its edges */
+		if (usage->pressure > 100.0)
+			usage->pressure = 100.0;
+		usage->avg10 = second->pressure.avg10;
+		usage->avg60 = second->pressure.avg60;
+		usage->avg300 = second->pressure.avg300;
+	}
+}
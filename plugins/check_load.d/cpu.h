@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../common.h"
+
+#include <time.h>
+
+/*
+ * CPU time and pressure sampled over a short window
+ *
+ * The load averages trail what happens by minutes. The time the CPUs spent
+ * busy, waiting for I/O and stolen by the hypervisor is read from the first
+ * line of /proc/stat at the start and the end of the window, the time tasks
+ * waited for a CPU from the "some" line of /proc/pressure/cpu (PSI).
+ */
+
+#define LOAD_PROC_STAT    "/proc/stat"
+#define LOAD_PRESSURE_CPU "/proc/pressure/cpu"
+
+typedef struct {
+	/* clock ticks of all CPUs since boot */
+	unsigned long long user;
+	unsigned long long nice;
+	unsigned long long system;
+	unsigned long long idle;
+	unsigned long long iowait;
+	unsigned long long irq;
+	unsigned long long softirq;
+	unsigned long long steal;
+} load_cpu_times;
+
+typedef struct {
+	double avg10; /* percent of the time */
+	double avg60;
+	double avg300;
+	unsigned long long total; /* microseconds some task waited */
+} load_pressure;
+
+typedef struct {
+	struct timespec time;
+	load_cpu_times cpu;
+	bool has_pressure; /* kernels without PSI or booted with psi=0 */
+	load_pressure pressure;
+} load_sample;
+
+typedef struct {
+	double utilization; /* percent of the CPU time of the window */
+	double iowait;
+	double steal;
+	bool has_pressure;
+	double pressure; /* percent of the window some task waited for a CPU */
+	double avg10;    /* of the end of the window */
+	double avg60;
+	double avg300;
+} load_usage;
+
+/* Decodes the "cpu" line of /proc/stat */
+bool load_parse_stat(const char *text, load_cpu_times *cpu);
+
+/* Decodes the "some" line of /proc/pressure/cpu */
+bool load_parse_pressure(const char *text, load_pressure *pressure);
+
+/* Reads both files, false if stat_file cannot be read. The pressure is
+ * optional, pressure_file may be NULL. */
+bool load_sample_read(load_sample *sample, const char *stat_file, const char *pressure_file);
+
+/* The usage of the CPUs from first to second */
+void load_usage_between(const load_sample *first, const load_sample *second, load_usage *usage);
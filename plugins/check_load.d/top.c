@@ -0,0 +1,56 @@
+#include "./top.h"
+#include "../utils.h"
+
+void load_top_init(load_top *top, size_t size) {
+	top->processes = calloc(size ? size : 1, sizeof(load_top_process));
+	if (top->processes == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	top->nof_processes = 0;
+	top->size = size;
+}
+
+void load_top_add(load_top *top, const proc_scan_entry *entry) {
+	size_t position = top->nof_processes;
+	load_top_process *process;
+
+	if (top->size == 0)
+		return;
+	/* most of them use less than the last one kept */
+	if (position == top->size) {
+		if (entry->pcpu <= top->processes[position - 1].pcpu)
+			return;
+		position--;
+	}
+	while (position > 0 && top->processes[position - 1].pcpu < entry->pcpu) {
+		top->processes[position] = top->processes[position - 1];
+		position--;
+	}
+	if (top->nof_processes < top->size)
+		top->nof_processes++;
+
+	process = &top->processes[position];
+	process->pid = entry->pid;
+	process->ppid = entry->ppid;
+	process->vsz = entry->vsz;
+	process->rss = entry->rss;
+	process->pcpu = entry->pcpu;
+	strcpy(process->prog, entry->prog);
+}
+
+bool load_top_scan(load_top *top, const char *root) {
+	proc_scan scan;
+	proc_scan_entry entry;
+
+	if (!proc_scan_open(&scan, root, 0))
+		return false;
+	while (proc_scan_next(&scan, &entry))
+		load_top_add(top, &entry);
+	proc_scan_close(&scan);
+	return true;
+}
+
+void load_top_free(load_top *top) {
+	free(top->processes);
+	top->processes = NULL;
+	top->nof_processes = top->size = 0;
+}
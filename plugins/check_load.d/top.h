@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../common.h"
+#include "../check_procs.d/proc_scan.h"
+
+/*
+ * The processes using the most CPU, read from /proc
+ *
+ * Only the top ones are kept while the process table is scanned, in an
+ * array sorted by %CPU that a process enters only if it uses more than the
+ * last of them. Neither the table nor lines of ps output are sorted.
+ */
+
+typedef struct {
+	pid_t pid;
+	pid_t ppid;
+	int vsz; /* KiB */
+	int rss; /* KiB */
+	float pcpu;
+	char prog[PROC_SCAN_PROG_SIZE];
+} load_top_process;
+
+typedef struct {
+	load_top_process *processes; /* most %CPU first */
+	size_t nof_processes;
+	size_t size; /* the number to keep */
+} load_top;
+
+void load_top_init(load_top *top, size_t size);
+
+/* Keeps the process if it is among the top ones so far */
+void load_top_add(load_top *top, const proc_scan_entry *entry);
+
+/* Scans root (PROC_SCAN_ROOT except in tests), false if it cannot be read */
+bool load_top_scan(load_top *top, const char *root);
+
+void load_top_free(load_top *top);
@@ -43,6 +43,10 @@ const char *email = "devel@monitoring-plugins.org";
 #include "utils.h"
 #include "utils_cmd.h"
 #include "regex.h"
+#include "check_procs.d/proc_scan.h"
+#include "check_procs.d/rules.h"
+#include "check_procs.d/rates.h"
+#include "check_procs.d/groups.h"
 
 #include <pwd.h>
 #include <errno.h>
@@ -52,71 +56,44 @@ const char *email = "devel@monitoring-plugins.org";
 #endif
 
 static int process_arguments (int /*argc*/, char ** /*argv*/);
+static bool filter_option (procs_rule * /*rule*/, int /*c*/, char * /*optarg*/);
 static int validate_arguments (void);
+static void rule_state (procs_rule * /*rule*/, int /*state*/, const char * /*prog*/);
+static void print_rate_perfdata (const procs_rule * /*rule*/, const char * /*label*/);
+static void print_count (const procs_rule * /*rule*/, const procs_groups * /*groups*/);
+static void print_group_perfdata (const procs_rule * /*rule*/, const procs_groups * /*groups*/);
+static const char *group_label (const procs_group * /*group*/);
 static int convert_to_seconds (char * /*etime*/);
 static void print_help (void);
 void print_usage (void);
 
-static char *warning_range = NULL;
-static char *critical_range = NULL;
-static thresholds *procs_thresholds = NULL;
-
-static int options = 0; /* bitmask of filter criteria to test against */
-#define ALL 1
-#define STAT 2
-#define PPID 4
-#define USER 8
-#define PROG 16
-#define ARGS 32
-#define VSZ  64
-#define RSS  128
-#define PCPU 256
-#define ELAPSED 512
-#define EREG_ARGS 1024
-#define EXCLUDE_PROGS 2048
-
 #define KTHREAD_PARENT "kthreadd" /* the parent process of kernel threads:
 							ppid of procs are compared to pid of this proc*/
 
-/* Different metrics */
-char *metric_name;
-enum metric {
-	METRIC_PROCS,
-	METRIC_VSZ,
-	METRIC_RSS,
-	METRIC_CPU,
-	METRIC_ELAPSED
-};
-enum metric metric = METRIC_PROCS;
+static procs_rule *rules = NULL; /* the first one is the rule of the command line */
+static size_t nof_rules = 0;
+static char **rule_texts = NULL; /* --rule and the lines of --rule-file */
+static size_t nof_rule_texts = 0;
 
 static int verbose = 0;
-static int uid;
-static pid_t ppid;
-static int vsz;
-static int rss;
-static float pcpu;
-static char *statopts;
-static char *prog;
-static char *exclude_progs;
-static char **exclude_progs_arr = NULL;
-static char exclude_progs_counter = 0;
-static char *args;
 static char *input_filename = NULL;
-static regex_t re_args;
-static char *fmt;
-static char *fails;
 static char tmp[MAX_INPUT_BUFFER];
 static int kthread_filter = 0;
 static int usepid = 0; /* whether to test for pid or /proc/pid/exe */
+static bool use_ps = false; /* run ps even where /proc can be read */
+static bool elapsed_metric = false; /* any rule checks the elapsed time */
+static bool rate_metric = false; /* any rule checks a rate */
+static int rate_interval = PROCS_DEFAULT_RATE_INTERVAL;
+static procs_group_by group_by = GROUP_NONE;
+static procs_groups *rule_groups = NULL; /* of every rule, when grouping */
+static bool cgroup_stats = false; /* memory and CPU time from the cgroups */
 
 static int
 stat_exe (const pid_t pid, struct stat *buf) {
-	char *path;
-	int ret;
-	xasprintf(&path, "/proc/%d/exe", pid);
-	ret = stat(path, buf);
-	free(path);
-	return ret;
+	char path[64];
+
+	snprintf(path, sizeof(path), "/proc/%d/exe", (int) pid);
+	return stat(path, buf);
 }
 
 
@@ -146,18 +123,21 @@ main (int argc, char **argv)
 
 	const char *zombie = "Z";
 
-	int resultsum = 0; /* bitmask of the filter criteria met by a process */
 	int found = 0; /* counter for number of lines returned in `ps` output */
-	int procs = 0; /* counter for number of processes meeting filter criteria */
 	int pos; /* number of spaces before 'args' in `ps` output */
 	int cols; /* number of columns in ps output */
 	int expected_cols = PS_COLS - 1;
-	int warn = 0; /* number of processes in warn state */
-	int crit = 0; /* number of processes in crit state */
 	int i = 0;
 	int result = STATE_UNKNOWN;
 	int ret = 0;
 	output chld_out, chld_err;
+	proc_scan scan;
+	proc_scan_entry entry;
+	bool scanning = false; /* reading /proc instead of the output of ps */
+	procs_rule *rule;
+	procs_rates rates = { 0 };
+	procs_group *group;
+	char key[32];
 
 	setlocale (LC_ALL, "");
 	bindtextdomain (PACKAGE, LOCALEDIR);
@@ -167,9 +147,6 @@ main (int argc, char **argv)
 	input_buffer = malloc (MAX_INPUT_BUFFER);
 	procprog = malloc (MAX_INPUT_BUFFER);
 
-	xasprintf (&metric_name, "PROCS");
-	metric = METRIC_PROCS;
-
 	/* Parse extra opts if any */
 	argv=np_extra_opts (&argc, argv, progname);
 
@@ -194,10 +171,30 @@ main (int argc, char **argv)
 	}
 	(void) alarm ((unsigned) timeout_interval);
 
+	if (input_filename == NULL && !use_ps) {
+		unsigned int fields = 0;
+
+		/* only read what the filters and the output need */
+		for (size_t r = 0; r < nof_rules; r++)
+			fields |= procs_rule_fields (&rules[r]);
+		if (verbose >= 2)
+			fields |= PROC_SCAN_UID | PROC_SCAN_ARGS;
+		if (group_by == GROUP_CGROUP)
+			fields |= PROC_SCAN_CGROUP;
+		else if (group_by == GROUP_USER)
+			fields |= PROC_SCAN_UID;
+		scanning = proc_scan_open (&scan, PROC_SCAN_ROOT, fields);
+	}
+
+	if ((rate_metric || group_by == GROUP_CGROUP) && !scanning)
+		die (STATE_UNKNOWN, "PROCS %s: %s %s\n", _("UNKNOWN"), _("Could not read the process table of"), PROC_SCAN_ROOT);
+
 	if (verbose >= 2)
-		printf (_("CMD: %s\n"), PS_COMMAND);
+		printf (_("CMD: %s\n"), scanning ? PROC_SCAN_ROOT : PS_COMMAND);
 
-	if (input_filename == NULL) {
+	if (scanning) {
+		chld_out.lines = 0;
+	} else if (input_filename == NULL) {
 		result = cmd_run( PS_COMMAND, &chld_out, &chld_err, 0);
 		if (chld_err.lines > 0) {
 			printf ("%s: %s", _("System call sent warnings to stderr"), chld_err.line[0]);
@@ -208,35 +205,65 @@ main (int argc, char **argv)
 	}
 
 	/* flush first line: j starts at 1 */
-	for (size_t j = 1; j < chld_out.lines; j++) {
-		input_line = chld_out.line[j];
+	for (size_t j = 1; scanning ? proc_scan_next (&scan, &entry) : j < chld_out.lines; j++) {
+		if (scanning) {
+			strcpy (procstat, entry.stat);
+			procuid = entry.uid;
+			procpid = entry.pid;
+			procppid = entry.ppid;
+			procvsz = entry.vsz;
+			procrss = entry.rss;
+			procpcpu = entry.pcpu;
+			procseconds = entry.seconds;
+			snprintf (procetime, sizeof (procetime), "%d", entry.seconds);
+			strcpy (procprog, entry.prog);
+			procargs = entry.args;
+			cols = expected_cols;
+		} else {
+			input_line = chld_out.line[j];
 
-		if (verbose >= 3)
-			printf ("%s", input_line);
+			if (verbose >= 3)
+				printf ("%s", input_line);
 
-		strcpy (procprog, "");
-		xasprintf (&procargs, "%s", "");
+			strcpy (procprog, "");
+			xasprintf (&procargs, "%s", "");
 
-		cols = sscanf (input_line, PS_FORMAT, PS_VARLIST);
+			cols = sscanf (input_line, PS_FORMAT, PS_VARLIST);
 
-		/* Zombie processes do not give a procprog command */
-		if ( cols < expected_cols && strstr(procstat, zombie) ) {
-			cols = expected_cols;
+			/* Zombie processes do not give a procprog command */
+			if ( cols < expected_cols && strstr(procstat, zombie) ) {
+				cols = expected_cols;
+			}
 		}
 		if ( cols >= expected_cols ) {
-			resultsum = 0;
-			xasprintf (&procargs, "%s", input_line + pos);
-			strip (procargs);
-
-			/* Some ps return full pathname for command. This removes path */
-			strcpy(procprog, base_name(procprog));
-
-			/* we need to convert the elapsed time to seconds */
-			procseconds = convert_to_seconds(procetime);
+			if (!scanning) {
+				xasprintf (&procargs, "%s", input_line + pos);
+				strip (procargs);
+
+				/* Some ps return full pathname for command. This removes path */
+				strcpy(procprog, base_name(procprog));
+
+				/* we need to convert the elapsed time to seconds */
+				procseconds = convert_to_seconds(procetime);
+
+				/* what the rules are matched against */
+				strcpy (entry.stat, procstat);
+				entry.uid = procuid;
+				entry.pid = procpid;
+				entry.ppid = procppid;
+				entry.vsz = procvsz;
+				entry.rss = procrss;
+				entry.pcpu = procpcpu;
+				entry.seconds = procseconds;
+				snprintf (entry.prog, sizeof (entry.prog), "%s", procprog);
+				entry.args = procargs;
+				entry.args_length = strlen (procargs);
+				entry.cgroup = "";
+			}
 
 			if (verbose >= 3)
 				printf ("proc#=%d uid=%d vsz=%d rss=%d pid=%d ppid=%d pcpu=%.2f stat=%s etime=%s prog=%s args=%s\n",
-					procs, procuid, procvsz, procrss,
+					found, procuid, procvsz, procrss,
 					procpid, procppid, procpcpu, procstat,
 					procetime, procprog, procargs);
 
@@ -263,25 +290,6 @@ main (int argc, char **argv)
 				continue;
 			}
 
-			/* Ignore excluded processes by name */
-			if(options & EXCLUDE_PROGS) {
-			  int found = 0;
-			  int i = 0;
-
-			  for(i=0; i < (exclude_progs_counter); i++) {
-			    if(!strcmp(procprog, exclude_progs_arr[i])) {
-			      found = 1;
-			    }
-			  }
-			  if(found == 0) {
-			    resultsum |= EXCLUDE_PROGS;
-			  } else
-			  {
-			    if(verbose >= 3)
-			      printf("excluding - by ignorelist\n");
-			  }
-			}
-
 			/* filter kernel threads (children of KTHREAD_PARENT)*/
 			/* TODO adapt for other OSes than GNU/Linux
 					sorry for not doing that, but I've no other OSes to test :-( */
@@ -297,60 +305,33 @@ main (int argc, char **argv)
 				}
 			}
 
-			if ((options & STAT) && (strstr (procstat, statopts)))
-				resultsum |= STAT;
-			if ((options & ARGS) && procargs && (strstr (procargs, args) != NULL))
-				resultsum |= ARGS;
-			if ((options & EREG_ARGS) && procargs && (regexec(&re_args, procargs, (size_t) 0, NULL, 0) == 0))
-				resultsum |= EREG_ARGS;
-			if ((options & PROG) && procprog && (strcmp (prog, procprog) == 0))
-				resultsum |= PROG;
-			if ((options & PPID) && (procppid == ppid))
-				resultsum |= PPID;
-			if ((options & USER) && (procuid == uid))
-				resultsum |= USER;
-			if ((options & VSZ)  && (procvsz >= vsz))
-				resultsum |= VSZ;
-			if ((options & RSS)  && (procrss >= rss))
-				resultsum |= RSS;
-			if ((options & PCPU)  && (procpcpu >= pcpu))
-				resultsum |= PCPU;
-
 			found++;
 
-			/* Next line if filters not matched */
-			if (!(options == resultsum || options == ALL))
-				continue;
+			for (size_t r = 0; r < nof_rules; r++) {
+				rule = &rules[r];
 
-			procs++;
-			if (verbose >= 2) {
-				printf ("Matched: uid=%d vsz=%d rss=%d pid=%d ppid=%d pcpu=%.2f stat=%s etime=%s prog=%s args=%s\n",
-					procuid, procvsz, procrss,
-					procpid, procppid, procpcpu, procstat,
-					procetime, procprog, procargs);
-			}
+				/* Next rule if filters not matched */
+				if (!procs_rule_matches (rule, &entry))
+					continue;
 
-			if (metric == METRIC_VSZ)
-				i = get_status ((double)procvsz, procs_thresholds);
-			else if (metric == METRIC_RSS)
-				i = get_status ((double)procrss, procs_thresholds);
-			/* TODO? float thresholds for --metric=CPU */
-			else if (metric == METRIC_CPU)
-				i = get_status (procpcpu, procs_thresholds);
-			else if (metric == METRIC_ELAPSED)
-				i = get_status ((double)procseconds, procs_thresholds);
-
-			if (metric != METRIC_PROCS) {
-				if (i == STATE_WARNING) {
-					warn++;
-					xasprintf (&fails, "%s%s%s", fails, (strcmp(fails,"") ? ", " : ""), procprog);
-					result = max_state (result, i);
-				}
-				if (i == STATE_CRITICAL) {
-					crit++;
-					xasprintf (&fails, "%s%s%s", fails, (strcmp(fails,"") ? ", " : ""), procprog);
-					result = max_state (result, i);
+				rule->procs++;
+				if (verbose >= 2) {
+					if (rule->name)
+						printf ("%s: ", rule->name);
+					printf ("Matched: uid=%d vsz=%d rss=%d pid=%d ppid=%d pcpu=%.2f stat=%s etime=%s prog=%s args=%s\n",
+						procuid, procvsz, procrss,
+						procpid, procppid, procpcpu, procstat,
+						procetime, procprog, procargs);
 				}
+
+				/* the thresholds apply to the groups then */
+				if (group_by != GROUP_NONE)
+					procs_groups_add (&rule_groups[r], procs_group_key (group_by, &entry, key, sizeof (key)), &entry);
+				/* rates are known once the scan is done */
+				else if (procs_metric_is_rate (rule->metric))
+					procs_rates_track (&rates, r, &entry);
+				else if (rule->metric != METRIC_PROCS)
+					rule_state (rule, get_status (procs_rule_value (rule, &entry), rule->thresholds), procprog);
 			}
 		}
 		/* This should not happen */
@@ -359,48 +340,132 @@ main (int argc, char **argv)
 		}
 	}
 
+	if (rates.nof_tracked > 0) {
+		procs_rates_sample (&rates, &scan, true);
+		sleep ((unsigned) rate_interval);
+		procs_rates_sample (&rates, &scan, false);
+
+		for (size_t t = 0; t < rates.nof_tracked; t++) {
+			double value;
+
+			rule = &rules[rates.tracked[t].rule];
+			if (!procs_rates_value (&rates.tracked[t], rule->metric, scan.ticks, &value))
+				continue;
+			if (verbose >= 2)
+				printf ("%s: pid=%d prog=%s %.2f\n", rule->metric_name, rates.tracked[t].pid, rates.tracked[t].prog, value);
+			if (!rule->has_max || value > rule->max)
+				rule->max = value;
+			rule->has_max = true;
+			rule_state (rule, get_status (value, rule->thresholds), rates.tracked[t].prog);
+		}
+		procs_rates_free (&rates);
+	}
+
+	if (scanning)
+		proc_scan_close (&scan);
+
+	for (size_t r = 0; group_by != GROUP_NONE && r < nof_rules; r++) {
+		rule = &rules[r];
+		procs_groups_sort (&rule_groups[r]);
+		for (size_t g = 0; g < rule_groups[r].nof_groups; g++) {
+			group = rule_groups[r].groups[g];
+			if (cgroup_stats && !procs_group_read_cgroup (group, PROCS_CGROUP_ROOT) && verbose >= 2)
+				printf (_("No statistics of cgroup %s\n"), group->key);
+			group->result = get_status (procs_group_value (group, rule->metric), rule->thresholds);
+			rule_state (rule, group->result, group_label (group));
+		}
+	}
+
 	if (found == 0) {							/* no process lines parsed so return STATE_UNKNOWN */
 		printf (_("Unable to read output\n"));
 		return STATE_UNKNOWN;
 	}
 
-	if ( result == STATE_UNKNOWN )
-		result = STATE_OK;
+	result = STATE_OK;
+	for (size_t r = 0; r < nof_rules; r++) {
+		rule = &rules[r];
+		if ( rule->result == STATE_UNKNOWN )
+			rule->result = STATE_OK;
 
-	/* Needed if procs found, but none match filter */
-	if ( metric == METRIC_PROCS ) {
-		result = max_state (result, get_status ((double)procs, procs_thresholds) );
+		/* Needed if procs found, but none match filter */
+		if ( rule->metric == METRIC_PROCS && group_by == GROUP_NONE ) {
+			rule->result = max_state (rule->result, get_status ((double)rule->procs, rule->thresholds) );
+		}
+		result = max_state (result, rule->result);
 	}
 
-	if ( result == STATE_OK ) {
-		printf ("%s %s: ", metric_name, _("OK"));
-	} else if (result == STATE_WARNING) {
-		printf ("%s %s: ", metric_name, _("WARNING"));
-		if ( metric != METRIC_PROCS ) {
-			printf (_("%d warn out of "), warn);
+	if (rules[0].name == NULL) {
+		rule = &rules[0];
+		if ( result == STATE_OK ) {
+			printf ("%s %s: ", rule->metric_name, _("OK"));
+		} else if (result == STATE_WARNING) {
+			printf ("%s %s: ", rule->metric_name, _("WARNING"));
+			if ( rule->metric != METRIC_PROCS || group_by != GROUP_NONE ) {
+				printf (_("%d warn out of "), rule->warn);
+			}
+		} else if (result == STATE_CRITICAL) {
+			printf ("%s %s: ", rule->metric_name, _("CRITICAL"));
+			if (rule->metric != METRIC_PROCS || group_by != GROUP_NONE) {
+				printf (_("%d crit, %d warn out of "), rule->crit, rule->warn);
+			}
 		}
-	} else if (result == STATE_CRITICAL) {
-		printf ("%s %s: ", metric_name, _("CRITICAL"));
-		if (metric != METRIC_PROCS) {
-			printf (_("%d crit, %d warn out of "), crit, warn);
+		print_count (rule, rule_groups);
+
+		if (strcmp(rule->fmt,"") != 0) {
+			printf (_(" with %s"), rule->fmt);
 		}
-	}
-	printf (ngettext ("%d process", "%d processes", (unsigned long) procs), procs);
 
-	if (strcmp(fmt,"") != 0) {
-		printf (_(" with %s"), fmt);
+		if ( verbose >= 1 && strcmp(rule->fails,"") )
+			printf (" [%s]", rule->fails);
+
+		if (group_by != GROUP_NONE)
+			printf (" | procs=%d;;;0; groups=%zu;;;0;", rule->procs, rule_groups[0].nof_groups);
+		else if (rule->metric == METRIC_PROCS)
+			printf (" | procs=%d;%s;%s;0;", rule->procs,
+					rule->warning_range ? rule->warning_range : "",
+					rule->critical_range ? rule->critical_range : "");
+		else
+			printf (" | procs=%d;;;0; procs_warn=%d;;;0; procs_crit=%d;;;0;", rule->procs, rule->warn, rule->crit);
+		print_rate_perfdata (rule, "procs");
+		print_group_perfdata (rule, rule_groups);
+
+		printf ("\n");
+		return result;
 	}
 
-	if ( verbose >= 1 && strcmp(fails,"") )
-		printf (" [%s]", fails);
-
-	if (metric == METRIC_PROCS)
-		printf (" | procs=%d;%s;%s;0;", procs,
-				warning_range ? warning_range : "",
-				critical_range ? critical_range : "");
-	else
-		printf (" | procs=%d;;;0; procs_warn=%d;;;0; procs_crit=%d;;;0;", procs, warn, crit);
-
+	/* one line for all rules, the ones which are not OK first */
+	printf ("PROCS %s: ", state_text (result));
+	i = 0;
+	for (int state = STATE_CRITICAL; state >= STATE_OK; state--) {
+		for (size_t r = 0; r < nof_rules; r++) {
+			rule = &rules[r];
+			if (rule->result != state)
+				continue;
+			printf ("%s%s %s ", i++ ? ", " : "", rule->name, state_text (rule->result));
+			if (rule->metric != METRIC_PROCS || group_by != GROUP_NONE)
+				printf (_("%s %d crit, %d warn out of "), rule->metric_name, rule->crit, rule->warn);
+			print_count (rule, rule_groups ? &rule_groups[r] : NULL);
+			if (verbose >= 1 && strcmp(rule->fmt,"") != 0)
+				printf (_(" with %s"), rule->fmt);
+			if (verbose >= 1 && strcmp(rule->fails,"") )
+				printf (" [%s]", rule->fails);
+		}
+	}
+	printf (" |");
+	for (size_t r = 0; r < nof_rules; r++) {
+		rule = &rules[r];
+		if (group_by != GROUP_NONE)
+			printf (" '%s'=%d;;;0; '%s_groups'=%zu;;;0;", rule->name, rule->procs, rule->name, rule_groups[r].nof_groups);
+		else if (rule->metric == METRIC_PROCS)
+			printf (" '%s'=%d;%s;%s;0;", rule->name, rule->procs,
+					rule->warning_range ? rule->warning_range : "",
+					rule->critical_range ? rule->critical_range : "");
+		else
+			printf (" '%s'=%d;;;0; '%s_warn'=%d;;;0; '%s_crit'=%d;;;0;", rule->name, rule->procs,
+					rule->name, rule->warn, rule->name, rule->crit);
+		print_rate_perfdata (rule, rule->name);
+		print_group_perfdata (rule, rule_groups ? &rule_groups[r] : NULL);
+	}
 	printf ("\n");
 	return result;
 }
@@ -412,14 +477,10 @@ int
 process_arguments (int argc, char **argv)
 {
 	int c = 1;
-	char *user;
-	struct passwd *pw;
 	int option = 0;
-	int err;
-	int cflags = REG_NOSUB | REG_EXTENDED;
-	char errbuf[MAX_INPUT_BUFFER];
-	char *temp_string;
-	int i=0;
+	int rule_argc;
+	char **rule_argv;
+	procs_rule *rule;
 	static struct option longopts[] = {
 		{"warning", required_argument, 0, 'w'},
 		{"critical", required_argument, 0, 'c'},
@@ -442,9 +503,21 @@ process_arguments (int argc, char **argv)
 		{"no-kthreads", required_argument, 0, 'k'},
 		{"traditional-filter", no_argument, 0, 'T'},
 		{"exclude-process", required_argument, 0, 'X'},
+		{"use-ps", no_argument, 0, CHAR_MAX+3},
+		{"rule", required_argument, 0, CHAR_MAX+4},
+		{"rule-file", required_argument, 0, CHAR_MAX+5},
+		{"rate-interval", required_argument, 0, CHAR_MAX+6},
+		{"group-by", required_argument, 0, CHAR_MAX+7},
+		{"cgroup-stats", no_argument, 0, CHAR_MAX+8},
 		{0, 0, 0, 0}
 	};
 
+	rules = calloc (1, sizeof (procs_rule));
+	if (rules == NULL)
+		die (STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	nof_rules = 1;
+	procs_rule_init (&rules[0], NULL);
+
 	for (c = 1; c < argc; c++)
 		if (strcmp ("-to", argv[c]) == 0)
 			strcpy (argv[c], "-t");
@@ -471,146 +544,6 @@ process_arguments (int argc, char **argv)
 			else
 				timeout_interval = atoi (optarg);
 			break;
-		case 'c':									/* critical threshold */
-			critical_range = optarg;
-			break;
-		case 'w':									/* warning threshold */
-			warning_range = optarg;
-			break;
-		case 'p':									/* process id */
-			if (sscanf (optarg, "%d%[^0-9]", &ppid, tmp) == 1) {
-				xasprintf (&fmt, "%s%sPPID = %d", (fmt ? fmt : "") , (options ? ", " : ""), ppid);
-				options |= PPID;
-				break;
-			}
-			usage4 (_("Parent Process ID must be an integer!"));
-		case 's':									/* status */
-			if (statopts)
-				break;
-			else
-				statopts = optarg;
-			xasprintf (&fmt, _("%s%sSTATE = %s"), (fmt ? fmt : ""), (options ? ", " : ""), statopts);
-			options |= STAT;
-			break;
-		case 'u':									/* user or user id */
-			if (is_integer (optarg)) {
-				uid = atoi (optarg);
-				pw = getpwuid ((uid_t) uid);
-				/*  check to be sure user exists */
-				if (pw == NULL)
-					usage2 (_("UID was not found"), optarg);
-			}
-			else {
-				pw = getpwnam (optarg);
-				/*  check to be sure user exists */
-				if (pw == NULL)
-					usage2 (_("User name was not found"), optarg);
-				/*  then get uid */
-				uid = pw->pw_uid;
-			}
-			user = pw->pw_name;
-			xasprintf (&fmt, "%s%sUID = %d (%s)", (fmt ? fmt : ""), (options ? ", " : ""),
-			          uid, user);
-			options |= USER;
-			break;
-		case 'C':									/* command */
-			/* TODO: allow this to be passed in with --metric */
-			if (prog)
-				break;
-			else
-				prog = optarg;
-			xasprintf (&fmt, _("%s%scommand name '%s'"), (fmt ? fmt : ""), (options ? ", " : ""),
-			          prog);
-			options |= PROG;
-			break;
-		case 'X':
-			if(exclude_progs)
-			  break;
-			else
-			  exclude_progs = optarg;
-			xasprintf (&fmt, _("%s%sexclude progs '%s'"), (fmt ? fmt : ""), (options ? ", " : ""),
-				   exclude_progs);
-			char *p = strtok(exclude_progs, ",");
-
-			while(p){
-			  exclude_progs_arr = realloc(exclude_progs_arr, sizeof(char*) * ++exclude_progs_counter);
-			  exclude_progs_arr[exclude_progs_counter-1] = p;
-			  p = strtok(NULL, ",");
-			}
-
-			options |= EXCLUDE_PROGS;
-			break;
-		case 'a':									/* args (full path name with args) */
-			/* TODO: allow this to be passed in with --metric */
-			if (args)
-				break;
-			else
-				args = optarg;
-			xasprintf (&fmt, "%s%sargs '%s'", (fmt ? fmt : ""), (options ? ", " : ""), args);
-			options |= ARGS;
-			break;
-		case CHAR_MAX+1:
-			err = regcomp(&re_args, optarg, cflags);
-			if (err != 0) {
-				regerror (err, &re_args, errbuf, MAX_INPUT_BUFFER);
-				die (STATE_UNKNOWN, "PROCS %s: %s - %s\n", _("UNKNOWN"), _("Could not compile regular expression"), errbuf);
-			}
-			/* Strip off any | within the regex optarg */
-			temp_string = strdup(optarg);
-			while(temp_string[i]!='\0'){
-				if(temp_string[i]=='|')
-					temp_string[i]=',';
-				i++;
-			}
-			xasprintf (&fmt, "%s%sregex args '%s'", (fmt ? fmt : ""), (options ? ", " : ""), temp_string);
-			options |= EREG_ARGS;
-			break;
-		case 'r': 					/* RSS */
-			if (sscanf (optarg, "%d%[^0-9]", &rss, tmp) == 1) {
-				xasprintf (&fmt, "%s%sRSS >= %d", (fmt ? fmt : ""), (options ? ", " : ""), rss);
-				options |= RSS;
-				break;
-			}
-			usage4 (_("RSS must be an integer!"));
-		case 'z':					/* VSZ */
-			if (sscanf (optarg, "%d%[^0-9]", &vsz, tmp) == 1) {
-				xasprintf (&fmt, "%s%sVSZ >= %d", (fmt ? fmt : ""), (options ? ", " : ""), vsz);
-				options |= VSZ;
-				break;
-			}
-			usage4 (_("VSZ must be an integer!"));
-		case 'P':					/* PCPU */
-			/* TODO: -P 1.5.5 is accepted */
-			if (sscanf (optarg, "%f%[^0-9.]", &pcpu, tmp) == 1) {
-				xasprintf (&fmt, "%s%sPCPU >= %.2f", (fmt ? fmt : ""), (options ? ", " : ""), pcpu);
-				options |= PCPU;
-				break;
-			}
-			usage4 (_("PCPU must be a float!"));
-		case 'm':
-			xasprintf (&metric_name, "%s", optarg);
-			if ( strcmp(optarg, "PROCS") == 0) {
-				metric = METRIC_PROCS;
-				break;
-			}
-			else if ( strcmp(optarg, "VSZ") == 0) {
-				metric = METRIC_VSZ;
-				break;
-			}
-			else if ( strcmp(optarg, "RSS") == 0 ) {
-				metric = METRIC_RSS;
-				break;
-			}
-			else if ( strcmp(optarg, "CPU") == 0 ) {
-				metric = METRIC_CPU;
-				break;
-			}
-			else if ( strcmp(optarg, "ELAPSED") == 0) {
-				metric = METRIC_ELAPSED;
-				break;
-			}
-
-			usage4 (_("Metric must be one of PROCS, VSZ, RSS, CPU, ELAPSED!"));
 		case 'k':	/* linux kernel thread filter */
 			kthread_filter = 1;
 			break;
@@ -623,53 +556,398 @@ process_arguments (int argc, char **argv)
 		case CHAR_MAX+2:
 			input_filename = optarg;
 			break;
+		case CHAR_MAX+3:
+			use_ps = true;
+			break;
+		case CHAR_MAX+4:
+			rule_texts = realloc (rule_texts, (nof_rule_texts + 1) * sizeof (char *));
+			if (rule_texts == NULL)
+				die (STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+			rule_texts[nof_rule_texts++] = optarg;
+			break;
+		case CHAR_MAX+5:
+			if (!procs_rules_read_file (optarg, &rule_texts, &nof_rule_texts))
+				die (STATE_UNKNOWN, "PROCS %s: %s %s - %s\n", _("UNKNOWN"), _("Could not read rule file"), optarg, strerror(errno));
+			break;
+		case CHAR_MAX+6:
+			if (!is_intpos (optarg))
+				usage2 (_("Rate interval must be a positive integer"), optarg);
+			rate_interval = atoi (optarg);
+			break;
+		case CHAR_MAX+7:
+			if (!procs_group_by_name (optarg, &group_by))
+				usage2 (_("Processes can be grouped by cgroup, user, prog or ppid"), optarg);
+			break;
+		case CHAR_MAX+8:
+			cgroup_stats = true;
+			break;
+		default:
+			filter_option (&rules[0], c, optarg);
+			break;
 		}
 	}
 
 	c = optind;
-	if ((! warning_range) && argv[c])
-		warning_range = argv[c++];
-	if ((! critical_range) && argv[c])
-		critical_range = argv[c++];
-	if (statopts == NULL && argv[c]) {
-		xasprintf (&statopts, "%s", argv[c++]);
-		xasprintf (&fmt, _("%s%sSTATE = %s"), (fmt ? fmt : ""), (options ? ", " : ""), statopts);
-		options |= STAT;
+	if ((! rules[0].warning_range) && argv[c])
+		rules[0].warning_range = argv[c++];
+	if ((! rules[0].critical_range) && argv[c])
+		rules[0].critical_range = argv[c++];
+	if (rules[0].statopts == NULL && argv[c]) {
+		filter_option (&rules[0], 's', argv[c++]);
 	}
 
-	/* this will abort in case of invalid ranges */
-	set_thresholds (&procs_thresholds, warning_range, critical_range);
+	if (nof_rule_texts > 0) {
+		/* the filters go into the rules then */
+		if (rules[0].options || rules[0].warning_range || rules[0].critical_range || rules[0].metric != METRIC_PROCS)
+			usage4 (_("Filters, metric and thresholds must be given in the rules"));
+		free (rules[0].metric_name);
+		nof_rules = 0;
+		rules = realloc (rules, nof_rule_texts * sizeof (procs_rule));
+		if (rules == NULL)
+			die (STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+
+		for (size_t r = 0; r < nof_rule_texts; r++) {
+			if (!procs_rule_split (rule_texts[r], &rule_argc, &rule_argv))
+				usage2 (_("A rule must be NAME: OPTIONS"), rule_texts[r]);
+			rule = &rules[nof_rules++];
+			procs_rule_init (rule, rule_argv[0]);
+			for (size_t other = 0; other + 1 < nof_rules; other++) {
+				if (strcmp (rules[other].name, rule->name) == 0)
+					usage2 (_("Rule names must be unique"), rule->name);
+			}
+
+			/* restart the option parser for the options of the rule */
+			optind = 0;
+			while ((c = getopt_long (rule_argc, rule_argv, "+c:w:p:s:u:C:a:z:r:m:P:X:", longopts, &option)) != -1) {
+				if (c == '?' || !filter_option (rule, c, optarg))
+					usage2 (_("Only filters, metric and thresholds can be given in a rule"), rule_texts[r]);
+			}
+			if (optind < rule_argc)
+				usage2 (_("Unexpected argument in rule"), rule_argv[optind]);
+		}
+	}
 
 	return validate_arguments ();
 }
 
 
 
+/* filter and threshold options, for the command line or a rule */
+bool
+filter_option (procs_rule *rule, int c, char *optarg)
+{
+	char *user;
+	struct passwd *pw;
+	int err;
+	int cflags = REG_NOSUB | REG_EXTENDED;
+	char errbuf[MAX_INPUT_BUFFER];
+	char *temp_string;
+	char *exclude_progs;
+	int i=0;
+
+	switch (c) {
+	case 'c':									/* critical threshold */
+		rule->critical_range = optarg;
+		break;
+	case 'w':									/* warning threshold */
+		rule->warning_range = optarg;
+		break;
+	case 'p':									/* process id */
+		if (sscanf (optarg, "%d%[^0-9]", &rule->ppid, tmp) == 1) {
+			xasprintf (&rule->fmt, "%s%sPPID = %d", (rule->fmt ? rule->fmt : "") , (rule->options ? ", " : ""), rule->ppid);
+			rule->options |= PPID;
+			break;
+		}
+		usage4 (_("Parent Process ID must be an integer!"));
+	case 's':									/* status */
+		if (rule->statopts)
+			break;
+		else
+			rule->statopts = optarg;
+		xasprintf (&rule->fmt, _("%s%sSTATE = %s"), (rule->fmt ? rule->fmt : ""), (rule->options ? ", " : ""), rule->statopts);
+		rule->options |= STAT;
+		break;
+	case 'u':									/* user or user id */
+		if (is_integer (optarg)) {
+			rule->uid = atoi (optarg);
+			pw = getpwuid ((uid_t) rule->uid);
+			/*  check to be sure user exists */
+			if (pw == NULL)
+				usage2 (_("UID was not found"), optarg);
+		}
+		else {
+			pw = getpwnam (optarg);
+			/*  check to be sure user exists */
+			if (pw == NULL)
+				usage2 (_("User name was not found"), optarg);
+			/*  then get uid */
+			rule->uid = pw->pw_uid;
+		}
+		user = pw->pw_name;
+		xasprintf (&rule->fmt, "%s%sUID = %d (%s)", (rule->fmt ? rule->fmt : ""), (rule->options ? ", " : ""),
+		          rule->uid, user);
+		rule->options |= USER;
+		break;
+	case 'C':									/* command */
+		/* TODO: allow this to be passed in with --metric */
+		if (rule->prog)
+			break;
+		else
+			rule->prog = optarg;
+		xasprintf (&rule->fmt, _("%s%scommand name '%s'"), (rule->fmt ? rule->fmt : ""), (rule->options ? ", " : ""),
+		          rule->prog);
+		rule->options |= PROG;
+		break;
+	case 'X':
+		if(rule->exclude_progs_arr)
+		  break;
+		else
+		  exclude_progs = optarg;
+		xasprintf (&rule->fmt, _("%s%sexclude progs '%s'"), (rule->fmt ? rule->fmt : ""), (rule->options ? ", " : ""),
+			   exclude_progs);
+		char *p = strtok(exclude_progs, ",");
+
+		while(p){
+		  rule->exclude_progs_arr = realloc(rule->exclude_progs_arr, sizeof(char*) * ++rule->exclude_progs_counter);
+		  rule->exclude_progs_arr[rule->exclude_progs_counter-1] = p;
+		  p = strtok(NULL, ",");
+		}
+
+		rule->options |= EXCLUDE_PROGS;
+		break;
+	case 'a':									/* args (full path name with args) */
+		/* TODO: allow this to be passed in with --metric */
+		if (rule->args)
+			break;
+		else
+			rule->args = optarg;
+		xasprintf (&rule->fmt, "%s%sargs '%s'", (rule->fmt ? rule->fmt : ""), (rule->options ? ", " : ""), rule->args);
+		rule->options |= ARGS;
+		break;
+	case CHAR_MAX+1:
+		err = regcomp(&rule->re_args, optarg, cflags);
+		if (err != 0) {
+			regerror (err, &rule->re_args, errbuf, MAX_INPUT_BUFFER);
+			die (STATE_UNKNOWN, "PROCS %s: %s - %s\n", _("UNKNOWN"), _("Could not compile regular expression"), errbuf);
+		}
+		rule->re_literal = procs_regex_literal (optarg);
+		/* Strip off any | within the regex optarg */
+		temp_string = strdup(optarg);
+		while(temp_string[i]!='\0'){
+			if(temp_string[i]=='|')
+				temp_string[i]=',';
+			i++;
+		}
+		xasprintf (&rule->fmt, "%s%sregex args '%s'", (rule->fmt ? rule->fmt : ""), (rule->options ? ", " : ""), temp_string);
+		rule->options |= EREG_ARGS;
+		break;
+	case 'r': 					/* RSS */
+		if (sscanf (optarg, "%d%[^0-9]", &rule->rss, tmp) == 1) {
+			xasprintf (&rule->fmt, "%s%sRSS >= %d", (rule->fmt ? rule->fmt : ""), (rule->options ? ", " : ""), rule->rss);
+			rule->options |= RSS;
+			break;
+		}
+		usage4 (_("RSS must be an integer!"));
+	case 'z':					/* VSZ */
+		if (sscanf (optarg, "%d%[^0-9]", &rule->vsz, tmp) == 1) {
+			xasprintf (&rule->fmt, "%s%sVSZ >= %d", (rule->fmt ? rule->fmt : ""), (rule->options ? ", " : ""), rule->vsz);
+			rule->options |= VSZ;
+			break;
+		}
+		usage4 (_("VSZ must be an integer!"));
+	case 'P':					/* PCPU */
+		/* TODO: -P 1.5.5 is accepted */
+		if (sscanf (optarg, "%f%[^0-9.]", &rule->pcpu, tmp) == 1) {
+			xasprintf (&rule->fmt, "%s%sPCPU >= %.2f", (rule->fmt ? rule->fmt : ""), (rule->options ? ", " : ""), rule->pcpu);
+			rule->options |= PCPU;
+			break;
+		}
+		usage4 (_("PCPU must be a float!"));
+	case 'm':
+		free (rule->metric_name);
+		xasprintf (&rule->metric_name, "%s", optarg);
+		if ( strcmp(optarg, "PROCS") == 0) {
+			rule->metric = METRIC_PROCS;
+			break;
+		}
+		else if ( strcmp(optarg, "VSZ") == 0) {
+			rule->metric = METRIC_VSZ;
+			break;
+		}
+		else if ( strcmp(optarg, "RSS") == 0 ) {
+			rule->metric = METRIC_RSS;
+			break;
+		}
+		else if ( strcmp(optarg, "CPU") == 0 ) {
+			rule->metric = METRIC_CPU;
+			break;
+		}
+		else if ( strcmp(optarg, "ELAPSED") == 0) {
+			rule->metric = METRIC_ELAPSED;
+			break;
+		}
+		else if ( strcmp(optarg, "CPU_RATE") == 0) {
+			rule->metric = METRIC_CPU_RATE;
+			break;
+		}
+		else if ( strcmp(optarg, "READ_RATE") == 0) {
+			rule->metric = METRIC_READ_RATE;
+			break;
+		}
+		else if ( strcmp(optarg, "WRITE_RATE") == 0) {
+			rule->metric = METRIC_WRITE_RATE;
+			break;
+		}
+		else if ( strcmp(optarg, "CSW_RATE") == 0) {
+			rule->metric = METRIC_CSW_RATE;
+			break;
+		}
+
+		usage4 (_("Metric must be one of PROCS, VSZ, RSS, CPU, ELAPSED, CPU_RATE, READ_RATE, WRITE_RATE, CSW_RATE!"));
+	default:
+		return false;
+	}
+	return true;
+}
+
+
+
 int
 validate_arguments ()
 {
-	if (options == 0)
-		options = ALL;
+	for (size_t r = 0; r < nof_rules; r++) {
+		procs_rule *rule = &rules[r];
+
+		if (rule->options == 0)
+			rule->options = ALL;
+
+		if (rule->statopts==NULL)
+			rule->statopts = strdup("");
+
+		if (rule->prog==NULL)
+			rule->prog = strdup("");
+
+		if (rule->args==NULL)
+			rule->args = strdup("");
+
+		if (rule->fmt==NULL)
+			rule->fmt = strdup("");
+
+		if (rule->metric == METRIC_ELAPSED)
+			elapsed_metric = true;
+		if (procs_metric_is_rate (rule->metric))
+			rate_metric = true;
+
+		if (rule->re_literal)
+			rule->re_literal_length = strlen (rule->re_literal);
+		procs_rule_compile (rule);
+
+		/* this will abort in case of invalid ranges */
+		set_thresholds (&rule->thresholds, rule->warning_range, rule->critical_range);
+	}
+
+	if (rate_metric && (input_filename || use_ps))
+		usage4 (_("Rate metrics need the process table of /proc, not the output of ps"));
+	if (rate_metric && rate_interval >= (int) timeout_interval)
+		usage4 (_("Rate interval must be shorter than the timeout"));
+
+	if (group_by != GROUP_NONE) {
+		if (rate_metric)
+			usage4 (_("Rate metrics cannot be grouped"));
+		if (group_by == GROUP_CGROUP && (input_filename || use_ps))
+			usage4 (_("Grouping by cgroup needs the process table of /proc, not the output of ps"));
+		rule_groups = calloc (nof_rules, sizeof (procs_groups));
+		if (rule_groups == NULL)
+			die (STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	}
+	if (cgroup_stats && group_by != GROUP_CGROUP)
+		usage4 (_("--cgroup-stats needs --group-by=cgroup"));
+
+	return OK;
+}
+
+
+/* count a process in state against rule */
+void
+rule_state (procs_rule *rule, int state, const char *prog)
+{
+	if (state == STATE_WARNING) {
+		rule->warn++;
+		xasprintf (&rule->fails, "%s%s%s", rule->fails, (strcmp(rule->fails,"") ? ", " : ""), prog);
+		rule->result = max_state (rule->result, state);
+	}
+	if (state == STATE_CRITICAL) {
+		rule->crit++;
+		xasprintf (&rule->fails, "%s%s%s", rule->fails, (strcmp(rule->fails,"") ? ", " : ""), prog);
+		rule->result = max_state (rule->result, state);
+	}
+}
+
 
-	if (statopts==NULL)
-		statopts = strdup("");
+/* the number of processes, and of groups when grouping */
+void
+print_count (const procs_rule *rule, const procs_groups *groups)
+{
+	if (groups)
+		printf (ngettext ("%zu group of ", "%zu groups of ", (unsigned long) groups->nof_groups), groups->nof_groups);
+	printf (ngettext ("%d process", "%d processes", (unsigned long) rule->procs), rule->procs);
+}
 
-	if (prog==NULL)
-		prog = strdup("");
 
-	if (args==NULL)
-		args = strdup("");
+/* the name of a user instead of the uid */
+const char *
+group_label (const procs_group *group)
+{
+	struct passwd *pw;
 
-	if (fmt==NULL)
-		fmt = strdup("");
+	if (group_by == GROUP_USER && (pw = getpwuid ((uid_t) atoi (group->key))) != NULL)
+		return pw->pw_name;
+	return group->key;
+}
 
-	if (fails==NULL)
-		fails = strdup("");
 
-	return options;
+/* the metric of every group, with the thresholds of the rule */
+void
+print_group_perfdata (const procs_rule *rule, const procs_groups *groups)
+{
+	const char *unit = "";
+
+	if (groups == NULL)
+		return;
+	if (rule->metric == METRIC_VSZ || rule->metric == METRIC_RSS)
+		unit = "KB";
+	else if (rule->metric == METRIC_CPU)
+		unit = "%";
+	else if (rule->metric == METRIC_ELAPSED)
+		unit = "s";
+
+	for (size_t g = 0; g < groups->nof_groups; g++) {
+		const procs_group *group = groups->groups[g];
+		const char *label = group_label (group);
+
+		printf (" '%s%s%s'=%.*f%s;%s;%s;0;", rule->name ? rule->name : "", rule->name ? "/" : "", label,
+				rule->metric == METRIC_CPU ? 2 : 0, procs_group_value (group, rule->metric), unit,
+				rule->warning_range ? rule->warning_range : "",
+				rule->critical_range ? rule->critical_range : "");
+		if (group->has_cpu_usage)
+			printf (" '%s%s%s cpu'=%.2fs;;;0;", rule->name ? rule->name : "", rule->name ? "/" : "", label,
+					group->cpu_usage);
+	}
 }
 
 
+/* the highest rate of the processes of a rule */
+void
+print_rate_perfdata (const procs_rule *rule, const char *label)
+{
+	if (!procs_metric_is_rate (rule->metric))
+		return;
+	printf (" '%s_max'=%.2f%s;%s;%s;0;", label, rule->has_max ? rule->max : 0,
+			rule->metric == METRIC_CPU_RATE ? "%" : "",
+			rule->warning_range ? rule->warning_range : "",
+			rule->critical_range ? rule->critical_range : "");
+}
+
 /* convert the elapsed time to seconds */
 int
 convert_to_seconds(char *etime) {
@@ -726,7 +1004,7 @@ convert_to_seconds(char *etime) {
 		(minutes * 60) +
 		seconds;
 
-	if (verbose >= 3 && metric == METRIC_ELAPSED) {
+	if (verbose >= 3 && elapsed_metric) {
 			printf("seconds: %d\n", total);
 	}
 	return total;
@@ -769,6 +1047,10 @@ print_help (void)
 /* only linux etime is support currently */
 #if defined( __linux__ )
   printf ("  %s\n", _("ELAPSED - time elapsed in seconds"));
+  printf ("  %s\n", _("CPU_RATE   - percentage CPU over the rate interval"));
+  printf ("  %s\n", _("READ_RATE  - bytes read from storage per second"));
+  printf ("  %s\n", _("WRITE_RATE - bytes written to storage per second"));
+  printf ("  %s\n", _("CSW_RATE   - context switches per second"));
 #endif /* defined(__linux__) */
   printf (UT_PLUG_TIMEOUT, DEFAULT_SOCKET_TIMEOUT);
 
@@ -778,6 +1060,22 @@ print_help (void)
   printf (" %s\n", "-T, --traditional");
   printf ("   %s\n", _("Filter own process the traditional way by PID instead of /proc/pid/exe"));
 
+  printf (" %s\n", "--use-ps");
+  printf ("   %s\n", _("Run ps even where the process table can be read from /proc directly"));
+  printf (" %s\n", "--rate-interval=SECONDS");
+  printf ("   %s\n", _("Time between the two samples of the rate metrics (default 1)"));
+  printf (" %s\n", "--group-by=cgroup|user|prog|ppid");
+  printf ("   %s\n", _("Add up the matched processes by their cgroup (v2), user, command name or"));
+  printf ("   %s\n", _("parent. The metric and the thresholds apply to every group."));
+  printf (" %s\n", "--cgroup-stats");
+  printf ("   %s\n", _("With --group-by=cgroup, take the memory of a group from memory.current and"));
+  printf ("   %s\n", _("add its CPU time from cpu.stat instead of adding up the processes"));
+  printf (" %s\n", "--rule='NAME: OPTIONS'");
+  printf ("   %s\n", _("Check the filters, metric and thresholds in OPTIONS as a rule of its own,"));
+  printf ("   %s\n", _("can be repeated. All rules are checked against the same process table."));
+  printf (" %s\n", "--rule-file=FILE");
+  printf ("   %s\n", _("Read rules from FILE, one per line. Lines starting with # are ignored."));
+
   printf ("\n");
 	printf ("%s\n", "Filters:");
   printf (" %s\n", "-s, --state=STATUSFLAGS");
@@ -833,6 +1131,8 @@ be the total number of running processes\n\n"));
   printf ("  %s\n\n", _("Alert if VSZ of any processes over 50K or 100K"));
   printf (" %s\n", "check_procs -w 10 -c 20 --metric=CPU");
   printf ("  %s\n", _("Alert if CPU of any processes over 10%% or 20%%"));
+  printf (" %s\n", "check_procs --rule='sshd: -C sshd -c 1:' --rule='zombies: -s Z -w 5'");
+  printf ("  %s\n", _("Critical if there is no sshd, warning if there are more than 5 zombies"));
 
   printf (UT_SUPPORT);
 }
@@ -843,5 +1143,7 @@ print_usage (void)
   printf ("%s\n", _("Usage:"));
   printf ("%s -w <range> -c <range> [-m metric] [-s state] [-p ppid]\n", progname);
   printf (" [-u user] [-r rss] [-z vsz] [-P %%cpu] [-a argument-array]\n");
-  printf (" [-C command] [-X process_to_exclude] [-k] [-t timeout] [-v]\n");
+  printf (" [-C command] [-X process_to_exclude] [-k] [-t timeout] [-v] [--use-ps]\n");
+  printf (" [--rule='NAME: OPTIONS']... [--rule-file=FILE] [--rate-interval=SECONDS]\n");
+  printf (" [--group-by=cgroup|user|prog|ppid] [--cgroup-stats]\n");
 }
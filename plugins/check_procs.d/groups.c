@@ -0,0 +1,121 @@
+#include "./groups.h"
+
+bool procs_group_by_name(const char *name, procs_group_by *by) {
+	if (strcmp(name, "cgroup") == 0)
+		*by = GROUP_CGROUP;
+	else if (strcmp(name, "user") == 0)
+		*by = GROUP_USER;
+	else if (strcmp(name, "prog") == 0)
+		*by = GROUP_PROG;
+	else if (strcmp(name, "ppid") == 0)
+		*by = GROUP_PPID;
+	else
+		return false;
+	return true;
+}
+
+const char *procs_group_key(procs_group_by by, const proc_scan_entry *process, char *buffer, size_t size) {
+	switch (by) {
+	case GROUP_CGROUP:
+		return process->cgroup;
+	case GROUP_USER:
+		snprintf(buffer, size, "%d", process->uid);
+		return buffer;
+	case GROUP_PROG:
+		return process->prog;
+	case GROUP_PPID:
+		snprintf(buffer, size, "%d", (int)process->ppid);
+		return buffer;
+	default:
+		return "";
+	}
+}
+
+procs_group *procs_groups_add(procs_groups *groups, const char *key, const proc_scan_entry *process) {
+	procs_group *group = np_name_hash_get(&groups->index, key);
+
+	if (group == NULL) {
+		group = calloc(1, sizeof(procs_group));
+		if (group == NULL || (group->key = strdup(key)) == NULL)
+			die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+		group->result = STATE_OK;
+		np_name_hash_put(&groups->index, group->key, group);
+		if (groups->nof_groups == groups->size) {
+			groups->size = groups->size ? groups->size * 2 : 16;
+			groups->groups = realloc(groups->groups, groups->size * sizeof(procs_group *));
+			if (groups->groups == NULL)
+				die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+		}
+		groups->groups[groups->nof_groups++] = group;
+	}
+
+	group->procs++;
+	group->vsz += process->vsz;
+	group->rss += process->rss;
+	group->pcpu += process->pcpu;
+	if (process->seconds > group->seconds)
+		group->seconds = process->seconds;
+	return group;
+}
+
+/* Reads a small file of the cgroup into buffer */
+static bool procs_group_read_file(const char *root, const char *cgroup, const char *name, char *buffer, size_t size) {
+	char path[PATH_MAX];
+	FILE *fp;
+	size_t length;
+
+	snprintf(path, sizeof(path), "%s%s/%s", root, cgroup, name);
+	if ((fp = fopen(path, "r")) == NULL)
+		return false;
+	length = fread(buffer, 1, size - 1, fp);
+	buffer[length] = '\0';
+	fclose(fp);
+	return length > 0;
+}
+
+bool procs_group_read_cgroup(procs_group *group, const char *root) {
+	char buffer[4096];
+	unsigned long long value;
+	bool found = false;
+
+	/* cgroup v2 only, the key is the path in the unified hierarchy */
+	if (group->key[0] != '/' || strstr(group->key, "/..") != NULL)
+		return false;
+	if (procs_group_read_file(root, group->key, "memory.current", buffer, sizeof(buffer)) && sscanf(buffer, "%llu", &value) == 1) {
+		group->rss = (long long)(value / 1024);
+		found = true;
+	}
+	if (procs_group_read_file(root, group->key, "cpu.stat", buffer, sizeof(buffer)) &&
+		proc_scan_parse_value(buffer, "usage_usec", &value)) {
+		group->cpu_usage = (double)value / 1.0e6;
+		group->has_cpu_usage = true;
+		found = true;
+	}
+	return found;
+}
+
+double procs_group_value(const procs_group *group, enum metric metric) {
+	switch (metric) {
+	case METRIC_VSZ:
+		return (double)group->vsz;
+	case METRIC_RSS:
+		return (double)group->rss;
+	case METRIC_CPU:
+		return group->pcpu;
+	case METRIC_ELAPSED:
+		return (double)group->seconds;
+	default:
+		return (double)group->procs;
+	}
+}
+
+static int procs_group_compare(const void *a, const void *b) {
+	const procs_group *x = *(procs_group *const *)a;
+	const procs_group *y = *(procs_group *const *)b;
+
+	return strcmp(x->key, y->key);
+}
+
+void procs_groups_sort(procs_groups *groups) {
+	qsort(groups->groups, groups->nof_groups, sizeof(procs_group *), procs_group_compare);
+}
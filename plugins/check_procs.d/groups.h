@@ -0,0 +1,63 @@
+#pragma once
+
+#include "../common.h"
+#include "utils_disk.h"
+#include "./proc_scan.h"
+#include "./rules.h"
+
+/*
+ * Totals of the matched processes by cgroup, user, command name or parent
+ *
+ * The processes are folded into the group of their key while they are
+ * scanned. For cgroups the memory and CPU time the kernel accounts can be
+ * read from the cgroup itself instead of adding up its processes.
+ */
+
+#define PROCS_CGROUP_ROOT "/sys/fs/cgroup"
+
+typedef enum {
+	GROUP_NONE,
+	GROUP_CGROUP,
+	GROUP_USER,
+	GROUP_PROG,
+	GROUP_PPID
+} procs_group_by;
+
+typedef struct {
+	char *key;
+	int procs;
+	long long vsz; /* KiB, summed */
+	long long rss; /* KiB, summed or memory.current of the cgroup */
+	double pcpu;   /* summed */
+	int seconds;   /* of the oldest process */
+	bool has_cpu_usage;
+	double cpu_usage; /* seconds of CPU time of the cgroup, cpu.stat */
+	int result;
+} procs_group;
+
+typedef struct {
+	struct name_hash index; /* by key */
+	procs_group **groups;   /* in the order they were found */
+	size_t nof_groups;
+	size_t size;
+} procs_groups;
+
+/* Parses the argument of --group-by, false if it is none of the kinds */
+bool procs_group_by_name(const char *name, procs_group_by *by);
+
+/* The key of process, in buffer if it has to be formatted */
+const char *procs_group_key(procs_group_by by, const proc_scan_entry *process, char *buffer, size_t size);
+
+/* Adds process to the group of key */
+procs_group *procs_groups_add(procs_groups *groups, const char *key, const proc_scan_entry *process);
+
+/* Replaces the summed RSS of group by memory.current of the cgroup of the
+ * same name below root and reads its CPU time from cpu.stat. False if
+ * neither could be read. */
+bool procs_group_read_cgroup(procs_group *group, const char *root);
+
+/* The value of metric for the whole group */
+double procs_group_value(const procs_group *group, enum metric metric);
+
+/* Sorts the groups by key */
+void procs_groups_sort(procs_groups *groups);
@@ -0,0 +1,335 @@
+#include "./proc_scan.h"
+#include "../utils.h"
+
+#include <fcntl.h>
+#include <time.h>
+#include <sys/syscall.h>
+
+#define PROC_SCAN_DIRENTS_SIZE 32768
+
+#ifdef SYS_getdents64
+struct proc_scan_dirent {
+	uint64_t ino;
+	int64_t off;
+	unsigned short reclen;
+	unsigned char type;
+	char name[];
+};
+#endif
+
+/* Reads the file at path below the root into the buffer, returns its length
+ * or -1 */
+static ssize_t proc_scan_read(proc_scan *scan, const char *path) {
+	int fd = openat(scan->root_fd, path, O_RDONLY | O_CLOEXEC);
+	size_t length = 0;
+
+	if (fd < 0)
+		return -1;
+	for (;;) {
+		ssize_t n;
+
+		if (length + 1 >= scan->buffer_size) {
+			char *larger = realloc(scan->buffer, scan->buffer_size * 2);
+
+			if (larger == NULL)
+				die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+			scan->buffer = larger;
+			scan->buffer_size *= 2;
+		}
+		n = read(fd, scan->buffer + length, scan->buffer_size - length - 1);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0) {
+			close(fd);
+			return -1;
+		}
+		if (n == 0)
+			break;
+		length += (size_t)n;
+	}
+	close(fd);
+	scan->buffer[length] = '\0';
+	return (ssize_t)length;
+}
+
+static const char *proc_scan_number(const char *p, long long *value) {
+	bool negative = false;
+	long long n = 0;
+
+	while (*p == ' ')
+		p++;
+	if (*p == '-') {
+		negative = true;
+		p++;
+	}
+	if (*p < '0' || *p > '9')
+		return NULL;
+	while (*p >= '0' && *p <= '9')
+		n = n * 10 + (*p++ - '0');
+	*value = negative ? -n : n;
+	return p;
+}
+
+bool proc_scan_parse_stat(const proc_scan *scan, const char *text, proc_scan_entry *entry) {
+	/* the fields by their number in proc(5), the command name may contain
+	 * anything including parentheses so it ends at the last one */
+	const char *open = strchr(text, '(');
+	const char *close = strrchr(text, ')');
+	long long field[25];
+	const char *p;
+	double elapsed;
+	size_t length;
+	char *flag;
+
+	if (open == NULL || close == NULL || close < open || close[1] != ' ' || close[2] == '\0')
+		return false;
+	if (proc_scan_number(text, &field[1]) == NULL)
+		return false;
+	p = close + 3;
+	for (int i = 4; i <= 24; i++) {
+		if ((p = proc_scan_number(p, &field[i])) == NULL)
+			return false;
+	}
+
+	entry->pid = (pid_t)field[1];
+	entry->ppid = (pid_t)field[4];
+	length = (size_t)(close - open - 1);
+	if (length >= sizeof(entry->prog))
+		length = sizeof(entry->prog) - 1;
+	memcpy(entry->prog, open + 1, length);
+	entry->prog[length] = '\0';
+
+	/* the flags ps adds to the state: priority, session leader,
+	 * multi-threaded, in the foreground process group */
+	flag = entry->stat;
+	*flag++ = close[2];
+	if (field[19] < 0)
+		*flag++ = '<';
+	else if (field[19] > 0)
+		*flag++ = 'N';
+	if (field[6] == field[1])
+		*flag++ = 's';
+	if (field[20] > 1)
+		*flag++ = 'l';
+	if (field[8] == field[5])
+		*flag++ = '+';
+	*flag = '\0';
+
+	elapsed = scan->uptime - (double)field[22] / (double)scan->ticks;
+	if (elapsed < 0)
+		elapsed = 0;
+	entry->seconds = (int)elapsed;
+	entry->pcpu = elapsed > 0 ? (float)((double)(field[14] + field[15]) / (double)scan->ticks / elapsed * 100) : 0;
+	entry->cpu_ticks = (unsigned long long)(field[14] + field[15]);
+	entry->start_ticks = (unsigned long long)field[22];
+	entry->vsz = (int)(field[23] / 1024);
+	entry->rss = (int)(field[24] * scan->page_kib);
+	return true;
+}
+
+const char *proc_scan_parse_cgroup(char *text) {
+	/* hierarchy-ID:controllers:path, the unified hierarchy is 0 without
+	 * controllers */
+	char *line = strstr(text, "0::/");
+	char *end;
+
+	if (line != NULL && (line == text || line[-1] == '\n')) {
+		line += 3;
+	} else {
+		line = strchr(text, ':');
+		line = line ? strchr(line + 1, ':') : NULL;
+		if (line == NULL)
+			return NULL;
+		line++;
+	}
+	end = strchr(line, '\n');
+	if (end)
+		*end = '\0';
+	return line;
+}
+
+int proc_scan_parse_uid(const char *text) {
+	const char *line = strstr(text, "\nUid:");
+	long long real;
+	long long effective;
+	const char *p;
+
+	if (line == NULL)
+		return -1;
+	p = line + 5;
+	while (*p == '\t')
+		p++;
+	if ((p = proc_scan_number(p, &real)) == NULL)
+		return -1;
+	while (*p == '\t')
+		p++;
+	if (proc_scan_number(p, &effective) == NULL)
+		return -1;
+	return (int)effective;
+}
+
+bool proc_scan_parse_value(const char *text, const char *name, unsigned long long *value) {
+	size_t length = strlen(name);
+	const char *line = text;
+	long long number;
+
+	/* "name: value" in /proc, "name value" in the files of cgroups */
+	while (line != NULL && (strncmp(line, name, length) != 0 || (line[length] != ':' && line[length] != ' '))) {
+		line = strchr(line, '\n');
+		if (line)
+			line++;
+	}
+	if (line == NULL)
+		return false;
+	line += length + 1;
+	while (*line == ' ' || *line == '\t')
+		line++;
+	if (proc_scan_number(line, &number) == NULL || number < 0)
+		return false;
+	*value = (unsigned long long)number;
+	return true;
+}
+
+bool proc_scan_counters(proc_scan *scan, pid_t pid, proc_counters *counters) {
+	proc_scan_entry entry;
+	unsigned long long voluntary;
+	unsigned long long involuntary;
+	char path[64];
+
+	clock_gettime(CLOCK_MONOTONIC, &counters->time);
+	snprintf(path, sizeof(path), "%d/stat", (int)pid);
+	if (proc_scan_read(scan, path) < 0 || !proc_scan_parse_stat(scan, scan->buffer, &entry))
+		return false;
+	counters->start_ticks = entry.start_ticks;
+	counters->cpu_ticks = entry.cpu_ticks;
+
+	snprintf(path, sizeof(path), "%d/status", (int)pid);
+	if (proc_scan_read(scan, path) < 0 || !proc_scan_parse_value(scan->buffer, "voluntary_ctxt_switches", &voluntary) ||
+		!proc_scan_parse_value(scan->buffer, "nonvoluntary_ctxt_switches", &involuntary))
+		return false;
+	counters->context_switches = voluntary + involuntary;
+
+	snprintf(path, sizeof(path), "%d/io", (int)pid);
+	counters->has_io = proc_scan_read(scan, path) >= 0 && proc_scan_parse_value(scan->buffer, "read_bytes", &counters->read_bytes) &&
+					   proc_scan_parse_value(scan->buffer, "write_bytes", &counters->write_bytes);
+	return true;
+}
+
+bool proc_scan_open(proc_scan *scan, const char *root, unsigned int fields) {
+#ifdef SYS_getdents64
+	memset(scan, 0, sizeof(*scan));
+	scan->fields = fields;
+	scan->ticks = sysconf(_SC_CLK_TCK);
+	scan->page_kib = sysconf(_SC_PAGESIZE) / 1024;
+	scan->buffer_size = 4096;
+	scan->buffer = malloc(scan->buffer_size);
+	scan->dirents = malloc(PROC_SCAN_DIRENTS_SIZE);
+	if (scan->buffer == NULL || scan->dirents == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+
+	scan->root_fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (scan->root_fd < 0 || scan->ticks <= 0 || proc_scan_read(scan, "uptime") < 0 || sscanf(scan->buffer, "%lf", &scan->uptime) != 1) {
+		proc_scan_close(scan);
+		return false;
+	}
+	return true;
+#else
+	(void)root;
+	(void)fields;
+	memset(scan, 0, sizeof(*scan));
+	scan->root_fd = -1;
+	return false;
+#endif
+}
+
+bool proc_scan_next(proc_scan *scan, proc_scan_entry *entry) {
+#ifdef SYS_getdents64
+	for (;;) {
+		const struct proc_scan_dirent *dirent;
+		char path[64];
+		ssize_t length;
+
+		if (scan->dirents_pos >= scan->dirents_length) {
+			scan->dirents_length = syscall(SYS_getdents64, scan->root_fd, scan->dirents, PROC_SCAN_DIRENTS_SIZE);
+			scan->dirents_pos = 0;
+			if (scan->dirents_length <= 0)
+				return false;
+		}
+		dirent = (const struct proc_scan_dirent *)(scan->dirents + scan->dirents_pos);
+		scan->dirents_pos += dirent->reclen;
+		if (dirent->name[0] < '1' || dirent->name[0] > '9' || strspn(dirent->name, "0123456789") != strlen(dirent->name))
+			continue;
+
+		snprintf(path, sizeof(path), "%s/stat", dirent->name);
+		if (proc_scan_read(scan, path) < 0 || !proc_scan_parse_stat(scan, scan->buffer, entry))
+			continue;
+
+		entry->cgroup = "";
+		if (scan->fields & PROC_SCAN_CGROUP) {
+			const char *cgroup;
+			size_t cgroup_length;
+
+			snprintf(path, sizeof(path), "%s/cgroup", dirent->name);
+			if (proc_scan_read(scan, path) < 0 || (cgroup = proc_scan_parse_cgroup(scan->buffer)) == NULL)
+				continue;
+			/* kept apart, the buffer is used for the other files */
+			cgroup_length = strlen(cgroup);
+			if (cgroup_length + 1 > scan->cgroup_size) {
+				scan->cgroup_size = cgroup_length + 1;
+				scan->cgroup = realloc(scan->cgroup, scan->cgroup_size);
+				if (scan->cgroup == NULL)
+					die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+			}
+			memcpy(scan->cgroup, cgroup, cgroup_length + 1);
+			entry->cgroup = scan->cgroup;
+		}
+
+		entry->uid = -1;
+		if (scan->fields & PROC_SCAN_UID) {
+			snprintf(path, sizeof(path), "%s/status", dirent->name);
+			if (proc_scan_read(scan, path) < 0 || (entry->uid = proc_scan_parse_uid(scan->buffer)) < 0)
+				continue;
+		}
+
+		if (scan->fields & PROC_SCAN_ARGS) {
+			snprintf(path, sizeof(path), "%s/cmdline", dirent->name);
+			if ((length = proc_scan_read(scan, path)) < 0)
+				continue;
+			/* the arguments are separated by NUL, ps shows them with blanks */
+			while (length > 0 && scan->buffer[length - 1] == '\0')
+				length--;
+			for (ssize_t i = 0; i < length; i++) {
+				if (scan->buffer[i] == '\0')
+					scan->buffer[i] = ' ';
+			}
+			scan->buffer[length] = '\0';
+			/* kernel threads and zombies have none */
+			if (length == 0)
+				length = snprintf(scan->buffer, scan->buffer_size, entry->stat[0] == 'Z' ? "[%s] <defunct>" : "[%s]", entry->prog);
+		} else {
+			scan->buffer[0] = '\0';
+			length = 0;
+		}
+		/* the buffer may have been moved while reading */
+		entry->args = scan->buffer;
+		entry->args_length = (size_t)length;
+		return true;
+	}
+#else
+	(void)scan;
+	(void)entry;
+	return false;
+#endif
+}
+
+void proc_scan_close(proc_scan *scan) {
+	if (scan->root_fd >= 0)
+		close(scan->root_fd);
+	scan->root_fd = -1;
+	free(scan->buffer);
+	free(scan->cgroup);
+	free(scan->dirents);
+	scan->buffer = NULL;
+	scan->cgroup = NULL;
+	scan->dirents = NULL;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "../common.h"
+
+/*
+ * Process table read from /proc instead of the output of ps
+ *
+ * The directory is listed with getdents64 and only the files needed for the
+ * fields asked for are read, /proc/<pid>/stat always, status and cmdline
+ * only when the uid or the arguments are used. The values are those ps
+ * shows for "stat uid pid ppid vsz rss pcpu etime comm args".
+ */
+
+#define PROC_SCAN_ROOT "/proc"
+
+#define PROC_SCAN_UID  1 /* read /proc/<pid>/status */
+#define PROC_SCAN_ARGS 2 /* read /proc/<pid>/cmdline */
+#define PROC_SCAN_CGROUP 4 /* read /proc/<pid>/cgroup */
+
+#define PROC_SCAN_PROG_SIZE 64
+
+typedef struct {
+	pid_t pid;
+	pid_t ppid;
+	int uid;     /* effective, -1 unless PROC_SCAN_UID */
+	int vsz;     /* KiB */
+	int rss;     /* KiB */
+	float pcpu;  /* CPU time over elapsed time, percent */
+	int seconds; /* elapsed since the start */
+	char stat[8];
+	char prog[PROC_SCAN_PROG_SIZE];
+	char *args;  /* valid until the next entry, "" unless PROC_SCAN_ARGS */
+	size_t args_length;
+	const char *cgroup; /* path in the unified hierarchy, "" unless PROC_SCAN_CGROUP */
+	unsigned long long cpu_ticks;   /* user and system time */
+	unsigned long long start_ticks; /* since boot */
+} proc_scan_entry;
+
+/* The counters of a process rates are computed from */
+typedef struct {
+	unsigned long long start_ticks; /* tells a new process with the same pid */
+	unsigned long long cpu_ticks;
+	unsigned long long context_switches; /* voluntary and involuntary */
+	unsigned long long read_bytes;  /* from and to storage */
+	unsigned long long write_bytes;
+	bool has_io; /* /proc/<pid>/io is only readable by the owner */
+	struct timespec time;
+} proc_counters;
+
+typedef struct {
+	int root_fd;
+	unsigned int fields;
+	long ticks;      /* clock ticks per second */
+	long page_kib;   /* page size in KiB */
+	double uptime;   /* seconds, when the scan started */
+	char *buffer;    /* file contents, reused for every file */
+	size_t buffer_size;
+	char *cgroup;    /* of the last process */
+	size_t cgroup_size;
+	char *dirents;   /* directory entries not yet returned */
+	long dirents_length;
+	long dirents_pos;
+} proc_scan;
+
+/* Starts a scan of root (PROC_SCAN_ROOT except in tests), false if it
+ * cannot be read. fields is a combination of PROC_SCAN_UID and
+ * PROC_SCAN_ARGS. */
+bool proc_scan_open(proc_scan *scan, const char *root, unsigned int fields);
+
+/* Returns the next process, false at the end. Processes which exit while
+ * they are read are skipped. */
+bool proc_scan_next(proc_scan *scan, proc_scan_entry *entry);
+
+void proc_scan_close(proc_scan *scan);
+
+/* Reads the counters of pid, false if it is gone. The scan must be open. */
+bool proc_scan_counters(proc_scan *scan, pid_t pid, proc_counters *counters);
+
+/* Decodes a /proc/<pid>/stat line */
+bool proc_scan_parse_stat(const proc_scan *scan, const char *text, proc_scan_entry *entry);
+
+/* Returns the cgroup v2 path from /proc/<pid>/cgroup, or the one of the
+ * first hierarchy if there is no unified one. The line is changed. */
+const char *proc_scan_parse_cgroup(char *text);
+
+/* Returns the effective uid from /proc/<pid>/status, -1 if there is none */
+int proc_scan_parse_uid(const char *text);
+
+/* Finds the number after name in the "name: value" or "name value" lines
+ * of text */
+bool proc_scan_parse_value(const char *text, const char *name, unsigned long long *value);
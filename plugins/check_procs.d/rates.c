@@ -0,0 +1,89 @@
+#include "./rates.h"
+
+bool procs_metric_is_rate(enum metric metric) {
+	return metric == METRIC_CPU_RATE || metric == METRIC_READ_RATE || metric == METRIC_WRITE_RATE || metric == METRIC_CSW_RATE;
+}
+
+void procs_rates_track(procs_rates *rates, size_t rule, const proc_scan_entry *process) {
+	procs_tracked *tracked;
+
+	if (rates->nof_tracked == rates->size) {
+		rates->size = rates->size ? rates->size * 2 : 64;
+		rates->tracked = realloc(rates->tracked, rates->size * sizeof(procs_tracked));
+		if (rates->tracked == NULL)
+			die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	}
+	tracked = &rates->tracked[rates->nof_tracked++];
+	memset(tracked, 0, sizeof(*tracked));
+	tracked->rule = rule;
+	tracked->pid = process->pid;
+	tracked->start_ticks = process->start_ticks;
+	memcpy(tracked->prog, process->prog, sizeof(tracked->prog));
+	tracked->valid = true;
+}
+
+static int procs_tracked_compare(const void *a, const void *b) {
+	const procs_tracked *x = a;
+	const procs_tracked *y = b;
+
+	if (x->pid != y->pid)
+		return x->pid < y->pid ? -1 : 1;
+	return x->rule < y->rule ? -1 : x->rule > y->rule;
+}
+
+void procs_rates_sample(procs_rates *rates, proc_scan *scan, bool first) {
+	/* a process matched by several rules is read once */
+	if (first)
+		qsort(rates->tracked, rates->nof_tracked, sizeof(procs_tracked), procs_tracked_compare);
+
+	for (size_t i = 0; i < rates->nof_tracked; i++) {
+		procs_tracked *tracked = &rates->tracked[i];
+		proc_counters *counters = first ? &tracked->before : &tracked->after;
+
+		if (i > 0 && rates->tracked[i - 1].pid == tracked->pid) {
+			*counters = first ? rates->tracked[i - 1].before : rates->tracked[i - 1].after;
+			tracked->valid = tracked->valid && rates->tracked[i - 1].valid;
+			continue;
+		}
+		if (!tracked->valid)
+			continue;
+		/* a new process may have got the pid in the meantime */
+		if (!proc_scan_counters(scan, tracked->pid, counters) || counters->start_ticks != tracked->start_ticks)
+			tracked->valid = false;
+	}
+}
+
+bool procs_rates_value(const procs_tracked *tracked, enum metric metric, long ticks, double *value) {
+	double seconds = (double)(tracked->after.time.tv_sec - tracked->before.time.tv_sec) +
+					 (double)(tracked->after.time.tv_nsec - tracked->before.time.tv_nsec) / 1.0e9;
+
+	if (!tracked->valid || seconds <= 0)
+		return false;
+	switch (metric) {
+	case METRIC_CPU_RATE:
+		*value = (double)(tracked->after.cpu_ticks - tracked->before.cpu_ticks) / (double)ticks / seconds * 100;
+		return true;
+	case METRIC_CSW_RATE:
+		*value = (double)(tracked->after.context_switches - tracked->before.context_switches) / seconds;
+		return true;
+	case METRIC_READ_RATE:
+		if (!tracked->before.has_io || !tracked->after.has_io)
+			return false;
+		*value = (double)(tracked->after.read_bytes - tracked->before.read_bytes) / seconds;
+		return true;
+	case METRIC_WRITE_RATE:
+		if (!tracked->before.has_io || !tracked->after.has_io)
+			return false;
+		*value = (double)(tracked->after.write_bytes - tracked->before.write_bytes) / seconds;
+		return true;
+	default:
+		return false;
+	}
+}
+
+void procs_rates_free(procs_rates *rates) {
+	free(rates->tracked);
+	rates->tracked = NULL;
+	rates->nof_tracked = 0;
+	rates->size = 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../common.h"
+#include "./proc_scan.h"
+#include "./rules.h"
+
+/*
+ * Rates of the processes matched by rules with a rate metric
+ *
+ * The counters of the matched processes are read twice, an interval apart,
+ * after the scan. Only those processes are kept.
+ */
+
+#define PROCS_DEFAULT_RATE_INTERVAL 1
+
+typedef struct {
+	size_t rule; /* index of the rule which matched */
+	pid_t pid;
+	unsigned long long start_ticks;
+	char prog[PROC_SCAN_PROG_SIZE];
+	proc_counters before;
+	proc_counters after;
+	bool valid; /* read both times */
+} procs_tracked;
+
+typedef struct {
+	procs_tracked *tracked;
+	size_t nof_tracked;
+	size_t size;
+} procs_rates;
+
+/* Whether metric is a rate, which needs two samples */
+bool procs_metric_is_rate(enum metric metric);
+
+/* Remembers process as matched by rule */
+void procs_rates_track(procs_rates *rates, size_t rule, const proc_scan_entry *process);
+
+/* Reads the counters of all tracked processes, into before the first time
+ * and into after the second. Processes which are gone are no longer valid. */
+void procs_rates_sample(procs_rates *rates, proc_scan *scan, bool first);
+
+/* The rate of metric for tracked, false if it cannot be told */
+bool procs_rates_value(const procs_tracked *tracked, enum metric metric, long ticks, double *value);
+
+void procs_rates_free(procs_rates *rates);
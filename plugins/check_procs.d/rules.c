@@ -0,0 +1,279 @@
+#include "./rules.h"
+
+#include <ctype.h>
+
+void procs_rule_init(procs_rule *rule, const char *name) {
+	memset(rule, 0, sizeof(*rule));
+	rule->name = name ? strdup(name) : NULL;
+	rule->metric = METRIC_PROCS;
+	rule->metric_name = strdup("PROCS");
+	rule->result = STATE_UNKNOWN;
+	rule->fails = strdup("");
+}
+
+static bool filter_uid(const procs_rule *rule, const proc_scan_entry *process) { return process->uid == rule->uid; }
+
+static bool filter_ppid(const procs_rule *rule, const proc_scan_entry *process) { return process->ppid == rule->ppid; }
+
+static bool filter_vsz(const procs_rule *rule, const proc_scan_entry *process) { return process->vsz >= rule->vsz; }
+
+static bool filter_rss(const procs_rule *rule, const proc_scan_entry *process) { return process->rss >= rule->rss; }
+
+static bool filter_pcpu(const procs_rule *rule, const proc_scan_entry *process) { return process->pcpu >= rule->pcpu; }
+
+static bool filter_stat(const procs_rule *rule, const proc_scan_entry *process) { return strstr(process->stat, rule->statopts) != NULL; }
+
+static bool filter_prog(const procs_rule *rule, const proc_scan_entry *process) { return strcmp(rule->prog, process->prog) == 0; }
+
+/* Ignore excluded processes by name */
+static bool filter_exclude_progs(const procs_rule *rule, const proc_scan_entry *process) {
+	for (int i = 0; i < rule->exclude_progs_counter; i++) {
+		if (!strcmp(process->prog, rule->exclude_progs_arr[i]))
+			return false;
+	}
+	return true;
+}
+
+static bool filter_args(const procs_rule *rule, const proc_scan_entry *process) {
+	return memmem(process->args, process->args_length, rule->args, strlen(rule->args)) != NULL;
+}
+
+static bool filter_ereg_args(const procs_rule *rule, const proc_scan_entry *process) {
+	/* most processes do not even contain the literal part of the regex */
+	if (rule->re_literal && memmem(process->args, process->args_length, rule->re_literal, rule->re_literal_length) == NULL)
+		return false;
+	return regexec(&rule->re_args, process->args, (size_t)0, NULL, 0) == 0;
+}
+
+void procs_rule_compile(procs_rule *rule) {
+	/* by cost: number comparisons, the short state and command name, then
+	 * the arguments, which can be long, and the regex last */
+	static const struct {
+		int option;
+		procs_filter filter;
+	} order[] = {
+		{USER, filter_uid},
+		{PPID, filter_ppid},
+		{VSZ, filter_vsz},
+		{RSS, filter_rss},
+		{PCPU, filter_pcpu},
+		{STAT, filter_stat},
+		{PROG, filter_prog},
+		{EXCLUDE_PROGS, filter_exclude_progs},
+		{ARGS, filter_args},
+		{EREG_ARGS, filter_ereg_args},
+	};
+
+	rule->nof_filters = 0;
+	if (rule->options == ALL)
+		return;
+	for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+		if (rule->options & order[i].option)
+			rule->filters[rule->nof_filters++] = order[i].filter;
+	}
+}
+
+bool procs_rule_matches(const procs_rule *rule, const proc_scan_entry *process) {
+	for (int i = 0; i < rule->nof_filters; i++) {
+		if (!rule->filters[i](rule, process))
+			return false;
+	}
+	return true;
+}
+
+/* Characters which are not literal in an extended regular expression */
+#define PROCS_REGEX_SPECIAL ".[]()*+?{}|^$\\"
+
+char *procs_regex_literal(const char *re) {
+	size_t length = strlen(re);
+	char *run = malloc(length + 1);
+	char *best = malloc(length + 1);
+	size_t run_length = 0;
+	size_t best_length = 0;
+	int depth = 0;
+
+	if (run == NULL || best == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+
+	for (const char *p = re; *p; p++) {
+		char literal = '\0';
+		bool optional;
+		bool repeated;
+
+		if (*p == '\\' && p[1] && strchr(PROCS_REGEX_SPECIAL, p[1]) != NULL) {
+			literal = *++p;
+		} else if (*p == '\\') {
+			/* \w and the like, or a trailing backslash */
+			literal = '\0';
+			if (p[1])
+				p++;
+		} else if (*p == '|' && depth == 0) {
+			/* any of the alternatives */
+			free(run);
+			free(best);
+			return NULL;
+		} else if (*p == '(') {
+			depth++;
+		} else if (*p == ')') {
+			if (depth > 0)
+				depth--;
+		} else if (*p == '[') {
+			/* skip the bracket expression, ] right after [ or [^ is part of it */
+			p++;
+			if (*p == '^')
+				p++;
+			if (*p == ']')
+				p++;
+			while (*p && *p != ']') {
+				if (*p == '[' && (p[1] == ':' || p[1] == '.' || p[1] == '=')) {
+					const char *close = strstr(p + 2, (char[]){p[1], ']', '\0'});
+					p = close ? close + 1 : p + strlen(p) - 1;
+				}
+				p++;
+			}
+			if (*p == '\0')
+				break;
+		} else if (*p == '{') {
+			/* skip the interval, its bounds are no part of the string */
+			while (*p && *p != '}')
+				p++;
+			if (*p == '\0')
+				break;
+		} else if (strchr(PROCS_REGEX_SPECIAL, *p) == NULL) {
+			literal = *p;
+		}
+
+		optional = p[1] == '*' || p[1] == '?' || p[1] == '{';
+		repeated = p[1] == '+';
+		if (literal != '\0' && depth == 0 && !optional) {
+			run[run_length++] = literal;
+			if (run_length > best_length) {
+				memcpy(best, run, run_length);
+				best_length = run_length;
+			}
+			if (!repeated)
+				continue;
+		}
+		/* anything else ends the string */
+		run_length = 0;
+	}
+
+	free(run);
+	if (best_length == 0) {
+		free(best);
+		return NULL;
+	}
+	best[best_length] = '\0';
+	return best;
+}
+
+double procs_rule_value(const procs_rule *rule, const proc_scan_entry *process) {
+	switch (rule->metric) {
+	case METRIC_VSZ:
+		return (double)process->vsz;
+	case METRIC_RSS:
+		return (double)process->rss;
+	/* TODO? float thresholds for --metric=CPU */
+	case METRIC_CPU:
+		return process->pcpu;
+	case METRIC_ELAPSED:
+		return (double)process->seconds;
+	default:
+		return 0;
+	}
+}
+
+unsigned int procs_rule_fields(const procs_rule *rule) {
+	unsigned int fields = 0;
+
+	if (rule->options & USER)
+		fields |= PROC_SCAN_UID;
+	if (rule->options & (ARGS | EREG_ARGS))
+		fields |= PROC_SCAN_ARGS;
+	return fields;
+}
+
+bool procs_rule_split(const char *text, int *argc, char ***argv) {
+	const char *colon = strchr(text, ':');
+	const char *p;
+	size_t length = strlen(text);
+	char *word;
+	char **words;
+	int nof_words = 1;
+
+	while (isspace((unsigned char)*text))
+		text++;
+	if (colon == NULL || colon == text)
+		return false;
+
+	/* at most one word for every two characters */
+	words = calloc(length / 2 + 3, sizeof(char *));
+	if (words == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	words[0] = strndup(text, (size_t)(colon - text));
+	while (words[0][0] && isspace((unsigned char)words[0][strlen(words[0]) - 1]))
+		words[0][strlen(words[0]) - 1] = '\0';
+
+	for (p = colon + 1;;) {
+		char quote = '\0';
+		char *end;
+
+		while (isspace((unsigned char)*p))
+			p++;
+		if (*p == '\0')
+			break;
+		word = end = malloc(length + 1);
+		if (word == NULL)
+			die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+		for (; *p && (quote || !isspace((unsigned char)*p)); p++) {
+			if (quote && *p == quote)
+				quote = '\0';
+			else if (!quote && (*p == '\'' || *p == '"'))
+				quote = *p;
+			else if (*p == '\\' && quote != '\'' && p[1])
+				*end++ = *++p;
+			else
+				*end++ = *p;
+		}
+		*end = '\0';
+		if (quote) {
+			free(word);
+			for (int i = 0; i < nof_words; i++)
+				free(words[i]);
+			free(words);
+			return false;
+		}
+		words[nof_words++] = word;
+	}
+	words[nof_words] = NULL;
+	*argc = nof_words;
+	*argv = words;
+	return true;
+}
+
+bool procs_rules_read_file(const char *file, char ***texts, size_t *nof_texts) {
+	FILE *fp = fopen(file, "r");
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t length;
+
+	if (fp == NULL)
+		return false;
+	while ((length = getline(&line, &size, fp)) >= 0) {
+		char *start = line;
+
+		while (length > 0 && isspace((unsigned char)line[length - 1]))
+			line[--length] = '\0';
+		while (isspace((unsigned char)*start))
+			start++;
+		if (*start == '\0' || *start == '#')
+			continue;
+		*texts = realloc(*texts, (*nof_texts + 1) * sizeof(char *));
+		if (*texts == NULL || ((*texts)[*nof_texts] = strdup(start)) == NULL)
+			die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+		(*nof_texts)++;
+	}
+	free(line);
+	fclose(fp);
+	return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "../common.h"
+#include "utils_base.h"
+#include "regex.h"
+#include "./proc_scan.h"
+
+/*
+ * Filter and threshold sets of check_procs
+ *
+ * The options on the command line make up one rule. With --rule or
+ * --rule-file there can be many, all of them are matched against every
+ * process of the same scan.
+ */
+
+/* filter criteria, bits of procs_rule.options */
+#define ALL 1
+#define STAT 2
+#define PPID 4
+#define USER 8
+#define PROG 16
+#define ARGS 32
+#define VSZ  64
+#define RSS  128
+#define PCPU 256
+#define ELAPSED 512
+#define EREG_ARGS 1024
+#define EXCLUDE_PROGS 2048
+
+/* Different metrics */
+enum metric {
+	METRIC_PROCS,
+	METRIC_VSZ,
+	METRIC_RSS,
+	METRIC_CPU,
+	METRIC_ELAPSED,
+	/* between two samples, see rates.h */
+	METRIC_CPU_RATE,
+	METRIC_READ_RATE,
+	METRIC_WRITE_RATE,
+	METRIC_CSW_RATE
+};
+
+#define PROCS_MAX_FILTERS 12
+
+struct procs_rule;
+typedef bool (*procs_filter)(const struct procs_rule *rule, const proc_scan_entry *process);
+
+typedef struct procs_rule {
+	char *name;  /* NULL for the rule of the command line */
+	int options; /* bitmask of filter criteria to test against */
+	int uid;
+	pid_t ppid;
+	int vsz;
+	int rss;
+	float pcpu;
+	char *statopts;
+	char *prog;
+	char *args;
+	regex_t re_args;
+	char **exclude_progs_arr;
+	int exclude_progs_counter;
+	enum metric metric;
+	char *metric_name;
+	char *warning_range;
+	char *critical_range;
+	thresholds *thresholds;
+	char *fmt; /* description of the filters */
+
+	/* the filters of options, cheapest first, see procs_rule_compile() */
+	procs_filter filters[PROCS_MAX_FILTERS];
+	int nof_filters;
+	char *re_literal; /* a string every match of re_args contains, or NULL */
+	size_t re_literal_length;
+
+	/* results of the scan */
+	int procs; /* number of processes meeting the filter criteria */
+	int warn;  /* number of processes in warn state */
+	int crit;  /* number of processes in crit state */
+	int result;
+	char *fails;
+	bool has_max; /* of a rate metric */
+	double max;
+} procs_rule;
+
+/* Sets the defaults of a rule */
+void procs_rule_init(procs_rule *rule, const char *name);
+
+/* Orders the filters of rule by their cost, to be called once the options
+ * are set */
+void procs_rule_compile(procs_rule *rule);
+
+/* The longest string any match of the extended regular expression re must
+ * contain, NULL if there is none which is certain. Only plain characters
+ * outside of groups count, and none if there is an alternative at the top
+ * level. */
+char *procs_regex_literal(const char *re);
+
+/* Whether process meets all filter criteria of rule, the filters stop at
+ * the first one which does not match */
+bool procs_rule_matches(const procs_rule *rule, const proc_scan_entry *process);
+
+/* The value of the metric of rule for process */
+double procs_rule_value(const procs_rule *rule, const proc_scan_entry *process);
+
+/* The PROC_SCAN_ fields the filters of rule need */
+unsigned int procs_rule_fields(const procs_rule *rule);
+
+/* Splits "NAME: OPTIONS" into the name and an argument vector for getopt,
+ * blanks separate the options unless they are quoted with ' or " or
+ * escaped with a backslash. argv[0] is the name. Returns false if there is
+ * no name or a quote is not closed. */
+bool procs_rule_split(const char *text, int *argc, char ***argv);
+
+/* Appends the rules in file, one per line, to texts. Empty lines and lines
+ * starting with # are skipped. */
+bool procs_rules_read_file(const char *file, char ***texts, size_t *nof_texts);
@@ -36,6 +36,14 @@ const char *email = "devel@monitoring-plugins.org";
 #include "runcmd.h"
 #include "utils.h"
 #include "utils_cmd.h"
+#include "check_snmp.d/ber.h"
+#include "check_snmp.d/session.h"
+#include "check_snmp.d/poller.h"
+#include "check_snmp.d/table.h"
+#include "check_snmp.d/mib.h"
+#include "check_snmp.d/rate.h"
+
+#include <stdarg.h>
 
 #define DEFAULT_COMMUNITY        "public"
 #define DEFAULT_PORT             "161"
@@ -64,6 +72,14 @@ const char *email = "devel@monitoring-plugins.org";
 #define L_INVERT_SEARCH             CHAR_MAX + 3
 #define L_OFFSET                    CHAR_MAX + 4
 #define L_IGNORE_MIB_PARSING_ERRORS CHAR_MAX + 5
+#define L_NATIVE                    CHAR_MAX + 6
+#define L_HOSTS                     CHAR_MAX + 7
+#define L_HOSTS_FILE                CHAR_MAX + 8
+#define L_TABLE                     CHAR_MAX + 9
+#define L_TABLE_LABEL               CHAR_MAX + 10
+#define L_MAX_REPETITIONS           CHAR_MAX + 11
+#define L_MIB_CACHE                 CHAR_MAX + 12
+#define L_BUILD_MIB_CACHE           CHAR_MAX + 13
 
 /* Gobble to string - stop incrementing c when c[0] match one of the
  * characters in s */
@@ -92,6 +108,23 @@ const char *email = "devel@monitoring-plugins.org";
 		break;                                                                                                                             \
 	}
 
+/* Text that grows without copying all of it again on every append, for
+ * the output of tables of thousands of rows */
+typedef struct {
+	char *text;
+	size_t length;
+	size_t size;
+} text_buffer;
+
+/* The value of an OID as it is shown, the same for one agent, --hosts and
+ * --table */
+typedef struct {
+	char *show;       /* without its type, multiplied, or the rate */
+	char type[8];     /* of the performance data, "c" for counters */
+	bool valid;       /* false if the thresholds or --rate found no number */
+	bool unfinished;  /* a string that goes on in the lines that follow */
+} oid_value;
+
 static int process_arguments(int, char **);
 static int validate_arguments(void);
 static char *thisarg(char *str);
@@ -99,13 +132,26 @@ static char *nextarg(char *str);
 void print_usage(void);
 static void print_help(void);
 static char *multiply(char *str);
+static int evaluate_value(size_t i, char *response, const char *key, oid_value *value);
+static void append_perfdata(text_buffer *perfdata, const char *prefix, size_t i, const char *oidname, const oid_value *value);
+static void text_append(text_buffer *buffer, const char *format, ...);
+static void native_query(output *out);
+static void format_value(const snmp_oid *oid, const snmp_value *value, char *buffer, size_t size);
+static void add_host(char *host);
+static void read_hosts_file(const char *filename);
+static int poll_hosts(void);
+static int walk_table(void);
+static bool agent_uptime(snmp_session *session, uint64_t *uptime);
+static struct timespec requests_deadline(void);
+static const snmp_mib_cache *mib_cache(void);
+static bool translate_oid(char **name);
+static int write_mib_cache(void);
 
 #include "regex.h"
 static char regex_expect[MAX_INPUT_BUFFER] = "";
 static regex_t preg;
 static regmatch_t pmatch[10];
 static char errbuf[MAX_INPUT_BUFFER] = "";
-static char perfstr[MAX_INPUT_BUFFER] = "| ";
 static int cflags = REG_EXTENDED | REG_NOSUB | REG_NEWLINE;
 static int eflags = 0;
 static int errcode, excode;
@@ -146,8 +192,6 @@ static char *warning_thresholds = NULL;
 static char *critical_thresholds = NULL;
 static thresholds **thlds;
 static size_t thlds_size = OID_COUNT_STEP;
-static double *response_value;
-static size_t response_size = OID_COUNT_STEP;
 static int retries = 0;
 static int *eval_method;
 static size_t eval_size = OID_COUNT_STEP;
@@ -159,8 +203,10 @@ static int calculate_rate = 0;
 static double offset = 0.0;
 static int rate_multiplier = 1;
 static state_data *previous_state;
-static double *previous_value;
-static size_t previous_size = OID_COUNT_STEP;
+static snmp_rate_state previous_rates;
+static snmp_rate_state current_rates;
+static bool query_uptime = false;    /* of the agent with the OIDs, for their rates */
+static bool separate_uptime = false; /* in a request of its own instead */
 static int perf_labels = 1;
 static char *ip_version = "";
 static double multiplier = 1.0;
@@ -168,6 +214,16 @@ static char *fmtstr = "";
 static bool fmtstr_set = false;
 static char buffer[DEFAULT_BUFFER_SIZE];
 static bool ignore_mib_parsing_errors = false;
+static bool native = false; /* query in-process instead of running snmpget */
+static char **hosts = NULL;  /* of --hosts and --hosts-file, polled at once */
+static size_t nof_hosts = 0;
+static size_t hosts_size = 0;
+static bool table = false;         /* walk the OIDs as columns of a table */
+static char *table_label = NULL;   /* column naming the rows of the table */
+static int max_repetitions = SNMP_TABLE_MAX_REPETITIONS;
+static char *mib_cache_file = NULL; /* symbolic OIDs without loading MIBs */
+static bool build_mib_cache = false;
+static char **oid_names = NULL; /* as given, of the OIDs translated by the cache */
 
 static char *fix_snmp_range(char *th) {
 	double left;
@@ -192,7 +248,6 @@ static char *fix_snmp_range(char *th) {
 }
 
 int main(int argc, char **argv) {
-	int len;
 	int total_oids;
 	size_t line;
 	unsigned int bk_count = 0;
@@ -211,22 +266,13 @@ int main(int argc, char **argv) {
 	char *show = NULL;
 	char *th_warn = NULL;
 	char *th_crit = NULL;
-	char type[8] = "";
 	output chld_out;
 	output chld_err;
-	char *previous_string = NULL;
-	char *ap = NULL;
 	char *state_string = NULL;
-	size_t response_length;
-	size_t current_length;
-	size_t string_length;
-	char *temp_string = NULL;
-	char *quote_string = NULL;
 	time_t current_time;
-	double temp_double;
-	time_t duration;
-	char *conv = "12345678";
-	int is_counter = 0;
+	char key[32];
+	oid_value value;
+	text_buffer perfdata = {0};
 
 	setlocale(LC_ALL, "");
 	bindtextdomain(PACKAGE, LOCALEDIR);
@@ -235,8 +281,6 @@ int main(int argc, char **argv) {
 	labels = malloc(labels_size * sizeof(*labels));
 	unitv = malloc(unitv_size * sizeof(*unitv));
 	thlds = malloc(thlds_size * sizeof(*thlds));
-	response_value = malloc(response_size * sizeof(*response_value));
-	previous_value = malloc(previous_size * sizeof(*previous_value));
 	eval_method = calloc(eval_size, sizeof(*eval_method));
 	oids = calloc(oids_size, sizeof(char *));
 
@@ -261,25 +305,33 @@ int main(int argc, char **argv) {
 	if (process_arguments(argc, argv) == ERROR)
 		usage4(_("Could not parse arguments"));
 
+	if (build_mib_cache)
+		return write_mib_cache();
+
 	if (calculate_rate) {
 		if (!strcmp(label, "SNMP"))
 			label = strdup("SNMP RATE");
 
-		size_t i = 0;
-
 		previous_state = np_state_read();
 		if (previous_state != NULL) {
-			/* Split colon separated values */
-			previous_string = strdup((char *)previous_state->data);
-			while ((ap = strsep(&previous_string, ":")) != NULL) {
-				if (verbose > 2)
-					printf("State for %zd=%s\n", i, ap);
-				while (i >= previous_size) {
-					previous_size += OID_COUNT_STEP;
-					previous_value = realloc(previous_value, previous_size * sizeof(*previous_value));
-				}
-				previous_value[i++] = strtod(ap, NULL);
+			if (verbose > 2)
+				printf("Previous state=%s\n", (char *)previous_state->data);
+			snmp_rate_parse(&previous_rates, (char *)previous_state->data, previous_state->time);
+		}
+		current_rates.time = current_time;
+
+		/* the uptime tells restarts of the agent apart. An agent without it
+		 * fails a whole SNMPv1 request (noSuchName), there it is asked for
+		 * on its own, or not at all with snmpget and the wall clock is used */
+		if (!table && !usesnmpgetnext && strcmp(proto, "1") != 0) {
+			if (numoids >= oids_size) {
+				oids_size += OID_COUNT_STEP;
+				oids = realloc(oids, oids_size * sizeof(*oids));
 			}
+			oids[numoids] = SNMP_RATE_UPTIME_OID;
+			query_uptime = true;
+		} else if (!table && !usesnmpgetnext && native) {
+			separate_uptime = true;
 		}
 	}
 
@@ -314,90 +366,113 @@ int main(int argc, char **argv) {
 		}
 	}
 
-	/* Create the command array to execute */
-	if (usesnmpgetnext) {
-		snmpcmd = strdup(PATH_TO_SNMPGETNEXT);
+	if (nof_hosts > 0)
+		return poll_hosts();
+	if (table)
+		return walk_table();
+
+	if (native) {
+		/* Set signal handling and alarm */
+		if (signal(SIGALRM, runcmd_timeout_alarm_handler) == SIG_ERR) {
+			usage4(_("Cannot catch SIGALRM"));
+		}
+		alarm(timeout_interval * retries + 5);
+		native_query(&chld_out);
+		alarm(0);
 	} else {
-		snmpcmd = strdup(PATH_TO_SNMPGET);
-	}
+		/* Create the command array to execute */
+		if (usesnmpgetnext) {
+#ifdef PATH_TO_SNMPGETNEXT
+			snmpcmd = strdup(PATH_TO_SNMPGETNEXT);
+#else
+			die(STATE_UNKNOWN, _("snmpgetnext was not found at compile time, query the agent with --native\n"));
+#endif
+		} else {
+#ifdef PATH_TO_SNMPGET
+			snmpcmd = strdup(PATH_TO_SNMPGET);
+#else
+			die(STATE_UNKNOWN, _("snmpget was not found at compile time, query the agent with --native\n"));
+#endif
+		}
 
-	/* 10 arguments to pass before context and authpriv options + 1 for host and numoids. Add one for terminating NULL */
+		/* 10 arguments to pass before context and authpriv options + 1 for host and numoids. Add one for terminating NULL */
 
-	unsigned index = 0;
-	command_line = calloc(11 + numcontext + numauthpriv + 1 + numoids + 1, sizeof(char *));
+		unsigned index = 0;
+		command_line = calloc(11 + numcontext + numauthpriv + 1 + numoids + query_uptime + 1, sizeof(char *));
 
-	command_line[index++] = snmpcmd;
-	command_line[index++] = strdup("-Le");
-	command_line[index++] = strdup("-t");
-	xasprintf(&command_line[index++], "%d", timeout_interval);
-	command_line[index++] = strdup("-r");
-	xasprintf(&command_line[index++], "%d", retries);
-	command_line[index++] = strdup("-m");
-	command_line[index++] = strdup(miblist);
-	command_line[index++] = "-v";
-	command_line[index++] = strdup(proto);
+		command_line[index++] = snmpcmd;
+		command_line[index++] = strdup("-Le");
+		command_line[index++] = strdup("-t");
+		xasprintf(&command_line[index++], "%d", timeout_interval);
+		command_line[index++] = strdup("-r");
+		xasprintf(&command_line[index++], "%d", retries);
+		command_line[index++] = strdup("-m");
+		command_line[index++] = strdup(miblist);
+		command_line[index++] = "-v";
+		command_line[index++] = strdup(proto);
 
-	xasprintf(&cl_hidden_auth, "%s -Le -t %d -r %d -m %s -v %s", snmpcmd, timeout_interval, retries, strlen(miblist) ? miblist : "''",
-			  proto);
+		xasprintf(&cl_hidden_auth, "%s -Le -t %d -r %d -m %s -v %s", snmpcmd, timeout_interval, retries, strlen(miblist) ? miblist : "''",
+				  proto);
 
-	if (ignore_mib_parsing_errors) {
-		command_line[index++] = "-Pe";
-		xasprintf(&cl_hidden_auth, "%s -Pe", cl_hidden_auth);
-	}
+		if (ignore_mib_parsing_errors) {
+			command_line[index++] = "-Pe";
+			xasprintf(&cl_hidden_auth, "%s -Pe", cl_hidden_auth);
+		}
 
-	for (int i = 0; i < numcontext; i++) {
-		command_line[index++] = contextargs[i];
-	}
+		for (int i = 0; i < numcontext; i++) {
+			command_line[index++] = contextargs[i];
+		}
 
-	for (int i = 0; i < numauthpriv; i++) {
-		command_line[index++] = authpriv[i];
-	}
+		for (int i = 0; i < numauthpriv; i++) {
+			command_line[index++] = authpriv[i];
+		}
 
-	xasprintf(&command_line[index++], "%s:%s", server_address, port);
+		xasprintf(&command_line[index++], "%s:%s", server_address, port);
 
-	xasprintf(&cl_hidden_auth, "%s [context] [authpriv] %s:%s", cl_hidden_auth, server_address, port);
+		xasprintf(&cl_hidden_auth, "%s [context] [authpriv] %s:%s", cl_hidden_auth, server_address, port);
 
-	for (size_t i = 0; i < numoids; i++) {
-		command_line[index++] = oids[i];
-		xasprintf(&cl_hidden_auth, "%s %s", cl_hidden_auth, oids[i]);
-	}
+		for (size_t i = 0; i < numoids + query_uptime; i++) {
+			command_line[index++] = oids[i];
+			xasprintf(&cl_hidden_auth, "%s %s", cl_hidden_auth, oids[i]);
+		}
 
-	command_line[index++] = NULL;
+		command_line[index++] = NULL;
 
-	if (verbose) {
-		printf("%s\n", cl_hidden_auth);
-	}
+		if (verbose) {
+			printf("%s\n", cl_hidden_auth);
+		}
 
-	/* Set signal handling and alarm */
-	if (signal(SIGALRM, runcmd_timeout_alarm_handler) == SIG_ERR) {
-		usage4(_("Cannot catch SIGALRM"));
-	}
-	alarm(timeout_interval * retries + 5);
-
-	/* Run the command */
-	return_code = cmd_run_array(command_line, &chld_out, &chld_err, 0);
-
-	/* disable alarm again */
-	alarm(0);
-
-	/* Due to net-snmp sometimes showing stderr messages with poorly formed MIBs,
-	   only return state unknown if return code is non zero or there is no stdout.
-	   Do this way so that if there is stderr, will get added to output, which helps problem diagnosis
-	*/
-	if (return_code != 0)
-		external_error = 1;
-	if (chld_out.lines == 0)
-		external_error = 1;
-	if (external_error) {
-		if (chld_err.lines > 0) {
-			printf(_("External command error: %s\n"), chld_err.line[0]);
-			for (size_t i = 1; i < chld_err.lines; i++) {
-				printf("%s\n", chld_err.line[i]);
+		/* Set signal handling and alarm */
+		if (signal(SIGALRM, runcmd_timeout_alarm_handler) == SIG_ERR) {
+			usage4(_("Cannot catch SIGALRM"));
+		}
+		alarm(timeout_interval * retries + 5);
+
+		/* Run the command */
+		return_code = cmd_run_array(command_line, &chld_out, &chld_err, 0);
+
+		/* disable alarm again */
+		alarm(0);
+
+		/* Due to net-snmp sometimes showing stderr messages with poorly formed MIBs,
+		   only return state unknown if return code is non zero or there is no stdout.
+		   Do this way so that if there is stderr, will get added to output, which helps problem diagnosis
+		*/
+		if (return_code != 0)
+			external_error = 1;
+		if (chld_out.lines == 0)
+			external_error = 1;
+		if (external_error) {
+			if (chld_err.lines > 0) {
+				printf(_("External command error: %s\n"), chld_err.line[0]);
+				for (size_t i = 1; i < chld_err.lines; i++) {
+					printf("%s\n", chld_err.line[i]);
+				}
+			} else {
+				printf(_("External command error with no output (return code: %d)\n"), return_code);
 			}
-		} else {
-			printf(_("External command error with no output (return code: %d)\n"), return_code);
+			exit(STATE_UNKNOWN);
 		}
-		exit(STATE_UNKNOWN);
 	}
 
 	if (verbose) {
@@ -406,14 +481,16 @@ int main(int argc, char **argv) {
 		}
 	}
 
+	/* the uptime of the agent, asked for after the OIDs */
+	if (query_uptime && chld_out.lines > 0 && strstr(chld_out.line[chld_out.lines - 1], "Timeticks: ") != NULL) {
+		snmp_rate_kind kind;
+
+		current_rates.has_uptime = snmp_rate_value(chld_out.line[chld_out.lines - 1], &kind, &current_rates.uptime);
+	}
+
 	line = 0;
 	total_oids = 0;
 	for (size_t i = 0; line < chld_out.lines && i < numoids; line++, i++, total_oids++) {
-		if (calculate_rate)
-			conv = "%.10g";
-		else
-			conv = "%.0f";
-
 		ptr = chld_out.line[line];
 		oidname = strpcpy(oidname, ptr, delimiter);
 		response = strstr(ptr, delimiter);
@@ -424,158 +501,35 @@ int main(int argc, char **argv) {
 			printf("Processing oid %zi (line %zi)\n  oidname: %s\n  response: %s\n", i + 1, line + 1, oidname, response);
 		}
 
-		/* Clean up type array - Sol10 does not necessarily zero it out */
-		bzero(type, sizeof(type));
-
-		is_counter = 0;
-		/* We strip out the datatype indicator for PHBs */
-		if (strstr(response, "Gauge: ")) {
-			show = multiply(strstr(response, "Gauge: ") + 7);
-		} else if (strstr(response, "Gauge32: ")) {
-			show = multiply(strstr(response, "Gauge32: ") + 9);
-		} else if (strstr(response, "Counter32: ")) {
-			show = strstr(response, "Counter32: ") + 11;
-			is_counter = 1;
-			if (!calculate_rate)
-				strcpy(type, "c");
-		} else if (strstr(response, "Counter64: ")) {
-			show = strstr(response, "Counter64: ") + 11;
-			is_counter = 1;
-			if (!calculate_rate)
-				strcpy(type, "c");
-		} else if (strstr(response, "INTEGER: ")) {
-			show = multiply(strstr(response, "INTEGER: ") + 9);
-
-			if (fmtstr_set) {
-				conv = fmtstr;
-			}
-		} else if (strstr(response, "OID: ")) {
-			show = strstr(response, "OID: ") + 5;
-		} else if (strstr(response, "STRING: ")) {
-			show = strstr(response, "STRING: ") + 8;
-			conv = "%.10g";
-
-			/* Get the rest of the string on multi-line strings */
-			ptr = show;
-			COUNT_SEQ(ptr, bk_count, dq_count)
-			while (dq_count && ptr[0] != '\n' && ptr[0] != '\0') {
-				ptr++;
-				GOBBLE_TOS(ptr, "\n\"\\")
-				COUNT_SEQ(ptr, bk_count, dq_count)
-			}
-
-			if (dq_count) { /* unfinished line */
-				/* copy show verbatim first */
-				if (!mult_resp)
-					mult_resp = strdup("");
-				xasprintf(&mult_resp, "%s%s:\n%s\n", mult_resp, oids[i], show);
-				/* then strip out unmatched double-quote from single-line output */
-				if (show[0] == '"')
-					show++;
-
-				/* Keep reading until we match end of double-quoted string */
-				for (line++; line < chld_out.lines; line++) {
-					ptr = chld_out.line[line];
-					xasprintf(&mult_resp, "%s%s\n", mult_resp, ptr);
+		snprintf(key, sizeof(key), "%zu", i);
+		iresult = evaluate_value(i, response, key, &value);
+		if (!value.valid)
+			die(nulloid, _("No valid data returned (%s)\n"), value.show);
+		show = value.show;
+
+		if (value.unfinished) {
+			/* copy show verbatim first */
+			if (!mult_resp)
+				mult_resp = strdup("");
+			xasprintf(&mult_resp, "%s%s:\n%s\n", mult_resp, oids[i], strstr(response, "STRING: ") + 8);
+
+			/* Keep reading until we match end of double-quoted string */
+			bk_count = 0;
+			dq_count = 1;
+			for (line++; line < chld_out.lines; line++) {
+				ptr = chld_out.line[line];
+				xasprintf(&mult_resp, "%s%s\n", mult_resp, ptr);
 
+				COUNT_SEQ(ptr, bk_count, dq_count)
+				while (dq_count && ptr[0] != '\n' && ptr[0] != '\0') {
+					ptr++;
+					GOBBLE_TOS(ptr, "\n\"\\")
 					COUNT_SEQ(ptr, bk_count, dq_count)
-					while (dq_count && ptr[0] != '\n' && ptr[0] != '\0') {
-						ptr++;
-						GOBBLE_TOS(ptr, "\n\"\\")
-						COUNT_SEQ(ptr, bk_count, dq_count)
-					}
-					/* Break for loop before next line increment when done */
-					if (!dq_count)
-						break;
 				}
+				/* Break for loop before next line increment when done */
+				if (!dq_count)
+					break;
 			}
-
-		} else if (strstr(response, "Timeticks: ")) {
-			show = strstr(response, "Timeticks: ");
-		} else
-			show = response + 3;
-
-		iresult = STATE_DEPENDENT;
-
-		/* Process this block for numeric comparisons */
-		/* Make some special values,like Timeticks numeric only if a threshold is defined */
-		if (thlds[i]->warning || thlds[i]->critical || calculate_rate) {
-			if (verbose > 2) {
-				print_thresholds("  thresholds", thlds[i]);
-			}
-			ptr = strpbrk(show, "-0123456789");
-			if (ptr == NULL) {
-				if (nulloid == 3)
-					die(STATE_UNKNOWN, _("No valid data returned (%s)\n"), show);
-				else if (nulloid == 0)
-					die(STATE_OK, _("No valid data returned (%s)\n"), show);
-				else if (nulloid == 1)
-					die(STATE_WARNING, _("No valid data returned (%s)\n"), show);
-				else if (nulloid == 2)
-					die(STATE_CRITICAL, _("No valid data returned (%s)\n"), show);
-			}
-			while (i >= response_size) {
-				response_size += OID_COUNT_STEP;
-				response_value = realloc(response_value, response_size * sizeof(*response_value));
-			}
-			response_value[i] = strtod(ptr, NULL) + offset;
-
-			if (calculate_rate) {
-				if (previous_state != NULL) {
-					duration = current_time - previous_state->time;
-					if (duration <= 0)
-						die(STATE_UNKNOWN, _("Time duration between plugin calls is invalid"));
-					temp_double = response_value[i] - previous_value[i];
-					/* Simple overflow catcher (same as in rrdtool, rrd_update.c) */
-					if (is_counter) {
-						if (temp_double < (double)0.0)
-							temp_double += (double)4294967296.0; /* 2^32 */
-						if (temp_double < (double)0.0)
-							temp_double += (double)18446744069414584320.0; /* 2^64-2^32 */
-						;
-					}
-					/* Convert to per second, then use multiplier */
-					temp_double = temp_double / duration * rate_multiplier;
-					iresult = get_status(temp_double, thlds[i]);
-					xasprintf(&show, conv, temp_double);
-				}
-			} else {
-				iresult = get_status(response_value[i], thlds[i]);
-				xasprintf(&show, conv, response_value[i]);
-			}
-		}
-
-		/* Process this block for string matching */
-		else if (eval_size > i && eval_method[i] & CRIT_STRING) {
-			if (strcmp(show, string_value))
-				iresult = (invert_search == 0) ? STATE_CRITICAL : STATE_OK;
-			else
-				iresult = (invert_search == 0) ? STATE_OK : STATE_CRITICAL;
-		}
-
-		/* Process this block for regex matching */
-		else if (eval_size > i && eval_method[i] & CRIT_REGEX) {
-			excode = regexec(&preg, response, 10, pmatch, eflags);
-			if (excode == 0) {
-				iresult = (invert_search == 0) ? STATE_OK : STATE_CRITICAL;
-			} else if (excode != REG_NOMATCH) {
-				regerror(excode, &preg, errbuf, MAX_INPUT_BUFFER);
-				printf(_("Execute Error: %s\n"), errbuf);
-				exit(STATE_CRITICAL);
-			} else {
-				iresult = (invert_search == 0) ? STATE_CRITICAL : STATE_OK;
-			}
-		}
-
-		/* Process this block for existence-nonexistence checks */
-		/* TV: Should this be outside of this else block? */
-		else {
-			if (eval_size > i && eval_method[i] & CRIT_PRESENT)
-				iresult = STATE_CRITICAL;
-			else if (eval_size > i && eval_method[i] & WARN_PRESENT)
-				iresult = STATE_WARNING;
-			else if (response && iresult == STATE_DEPENDENT)
-				iresult = STATE_OK;
 		}
 
 		/* Result is the worst outcome of all the OIDs tested */
@@ -591,78 +545,12 @@ int main(int argc, char **argv) {
 		if (nunits > (size_t)0 && (size_t)i < nunits && unitv[i] != NULL)
 			xasprintf(&outbuff, "%s %s", outbuff, unitv[i]);
 
-		/* Write perfdata with whatever can be parsed by strtod, if possible */
-		ptr = NULL;
-		strtod(show, &ptr);
-		if (ptr > show) {
-			if (perf_labels && nlabels >= (size_t)1 && (size_t)i < nlabels && labels[i] != NULL)
-				temp_string = labels[i];
-			else
-				temp_string = oidname;
-			if (strpbrk(temp_string, " ='\"") == NULL) {
-				strncat(perfstr, temp_string, sizeof(perfstr) - strlen(perfstr) - 1);
-			} else {
-				if (strpbrk(temp_string, "'") == NULL) {
-					quote_string = "'";
-				} else {
-					quote_string = "\"";
-				}
-				strncat(perfstr, quote_string, sizeof(perfstr) - strlen(perfstr) - 1);
-				strncat(perfstr, temp_string, sizeof(perfstr) - strlen(perfstr) - 1);
-				strncat(perfstr, quote_string, sizeof(perfstr) - strlen(perfstr) - 1);
-			}
-			strncat(perfstr, "=", sizeof(perfstr) - strlen(perfstr) - 1);
-			len = sizeof(perfstr) - strlen(perfstr) - 1;
-			strncat(perfstr, show, len > ptr - show ? ptr - show : len);
-
-			if (strcmp(type, "") != 0) {
-				strncat(perfstr, type, sizeof(perfstr) - strlen(perfstr) - 1);
-			}
-
-			if (warning_thresholds) {
-				strncat(perfstr, ";", sizeof(perfstr) - strlen(perfstr) - 1);
-				if (thlds[i]->warning && thlds[i]->warning->text)
-					strncat(perfstr, thlds[i]->warning->text, sizeof(perfstr) - strlen(perfstr) - 1);
-			}
-
-			if (critical_thresholds) {
-				if (!warning_thresholds)
-					strncat(perfstr, ";", sizeof(perfstr) - strlen(perfstr) - 1);
-				strncat(perfstr, ";", sizeof(perfstr) - strlen(perfstr) - 1);
-				if (thlds[i]->critical && thlds[i]->critical->text)
-					strncat(perfstr, thlds[i]->critical->text, sizeof(perfstr) - strlen(perfstr) - 1);
-			}
-
-			strncat(perfstr, " ", sizeof(perfstr) - strlen(perfstr) - 1);
-		}
+		append_perfdata(&perfdata, NULL, i, oidname, &value);
 	}
 
 	/* Save state data, as all data collected now */
 	if (calculate_rate) {
-		string_length = 1024;
-		state_string = malloc(string_length);
-		if (state_string == NULL)
-			die(STATE_UNKNOWN, _("Cannot malloc"));
-
-		current_length = 0;
-		for (int i = 0; i < total_oids; i++) {
-			xasprintf(&temp_string, "%.0f", response_value[i]);
-			if (temp_string == NULL)
-				die(STATE_UNKNOWN, _("Cannot asprintf()"));
-			response_length = strlen(temp_string);
-			if (current_length + response_length > string_length) {
-				string_length = current_length + 1024;
-				state_string = realloc(state_string, string_length);
-				if (state_string == NULL)
-					die(STATE_UNKNOWN, _("Cannot realloc()"));
-			}
-			strcpy(&state_string[current_length], temp_string);
-			current_length = current_length + response_length;
-			state_string[current_length] = ':';
-			current_length++;
-			free(temp_string);
-		}
-		state_string[--current_length] = '\0';
+		state_string = snmp_rate_format(&current_rates);
 		if (verbose > 2)
 			printf("State string=%s\n", state_string);
 
@@ -674,7 +562,7 @@ int main(int argc, char **argv) {
 		}
 	}
 
-	printf("%s %s -%s %s\n", label, state_text(result), outbuff, perfstr);
+	printf("%s %s -%s | %s\n", label, state_text(result), outbuff, perfdata.length ? perfdata.text : "");
 	if (mult_resp)
 		printf("%s", mult_resp);
 
@@ -719,6 +607,14 @@ int process_arguments(int argc, char **argv) {
 									   {"multiplier", required_argument, 0, 'M'},
 									   {"fmtstr", required_argument, 0, 'f'},
 									   {"ignore-mib-parsing-errors", no_argument, false, L_IGNORE_MIB_PARSING_ERRORS},
+									   {"native", no_argument, 0, L_NATIVE},
+									   {"hosts", required_argument, 0, L_HOSTS},
+									   {"hosts-file", required_argument, 0, L_HOSTS_FILE},
+									   {"table", no_argument, 0, L_TABLE},
+									   {"table-label", required_argument, 0, L_TABLE_LABEL},
+									   {"max-repetitions", required_argument, 0, L_MAX_REPETITIONS},
+									   {"mib-cache", required_argument, 0, L_MIB_CACHE},
+									   {"build-mib-cache", no_argument, 0, L_BUILD_MIB_CACHE},
 									   {0, 0, 0, 0}};
 
 	if (argc < 2)
@@ -950,7 +846,7 @@ int process_arguments(int argc, char **argv) {
 			break;
 		case L_CALCULATE_RATE:
 			if (calculate_rate == 0)
-				np_enable_state(NULL, 1);
+				np_enable_state(NULL, 2);
 			calculate_rate = 1;
 			break;
 		case L_RATE_MULTIPLIER:
@@ -986,15 +882,56 @@ int process_arguments(int argc, char **argv) {
 			break;
 		case L_IGNORE_MIB_PARSING_ERRORS:
 			ignore_mib_parsing_errors = true;
+			break;
+		case L_NATIVE:
+			native = true;
+			break;
+		case L_HOSTS:
+			for (char *host = strtok(optarg, ", "); host != NULL; host = strtok(NULL, ", "))
+				add_host(host);
+			break;
+		case L_HOSTS_FILE:
+			read_hosts_file(optarg);
+			break;
+		case L_TABLE:
+			table = true;
+			native = true;
+			break;
+		case L_TABLE_LABEL:
+			table_label = optarg;
+			break;
+		case L_MAX_REPETITIONS:
+			if (!is_intpos(optarg) || (max_repetitions = atoi(optarg)) < 1)
+				usage2(_("Max repetitions must be a positive integer"), optarg);
+			break;
+		case L_MIB_CACHE:
+			mib_cache_file = optarg;
+			break;
+		case L_BUILD_MIB_CACHE:
+			build_mib_cache = true;
+			break;
 		}
 	}
 
 	if (server_address == NULL)
 		server_address = argv[optind];
 
+	/* -H is one more of them */
+	if (nof_hosts > 0) {
+		if (server_address != NULL)
+			add_host(server_address);
+		native = true;
+	}
+
 	if (community == NULL)
 		community = strdup(DEFAULT_COMMUNITY);
 
+	if (build_mib_cache) {
+		if (mib_cache_file == NULL)
+			usage4(_("--build-mib-cache needs --mib-cache"));
+		return OK;
+	}
+
 	return validate_arguments();
 }
 
@@ -1017,6 +954,24 @@ selected.</para>
 ******************************************************************************/
 
 static int validate_arguments() {
+	/* symbolic OIDs from the MIB cache, those not in it from the MIBs */
+	if (needmibs && mib_cache_file != NULL) {
+		needmibs = false;
+		oid_names = calloc(numoids, sizeof(char *));
+		if (oid_names == NULL)
+			die(STATE_UNKNOWN, _("Cannot malloc"));
+		for (size_t i = 0; i < numoids; i++) {
+			char *name = oids[i];
+
+			if (!translate_oid(&oids[i]))
+				needmibs = true;
+			else if (oids[i] != name)
+				oid_names[i] = name;
+		}
+	}
+	if (table_label != NULL && mib_cache_file != NULL && !translate_oid(&table_label))
+		usage2(_("Invalid OID"), table_label);
+
 	/* check whether to load locally installed MIBS (CPU/disk intensive) */
 	if (miblist == NULL) {
 		if (needmibs) {
@@ -1027,7 +982,7 @@ static int validate_arguments() {
 	}
 
 	/* Check server_address is given */
-	if (server_address == NULL)
+	if (server_address == NULL && nof_hosts == 0)
 		die(STATE_UNKNOWN, _("No host specified\n"));
 
 	/* Check oid is given */
@@ -1113,6 +1068,20 @@ static int validate_arguments() {
 		usage2(_("Invalid SNMP version"), proto);
 	}
 
+	if (native) {
+		if (strcmp(proto, "1") != 0 && strcmp(proto, "2c") != 0)
+			usage4(_("--native supports SNMP versions 1 and 2c only"));
+		if (needmibs)
+			usage4(_("--native needs numeric OIDs or names of the MIB cache"));
+	}
+
+	if (nof_hosts > 0 && calculate_rate)
+		usage4(_("--rate cannot be used with several hosts"));
+	if (table && nof_hosts > 0)
+		usage4(_("--table cannot be used with several hosts"));
+	if (table_label != NULL && !table)
+		usage4(_("--table-label needs --table"));
+
 	return OK;
 }
 
@@ -1157,6 +1126,599 @@ static char *nextarg(char *str) {
 	return NULL;
 }
 
+/* Queries the OIDs in-process and leaves the varbinds in out, one line per
+ * line of text as snmpget prints them, so that they are evaluated the same */
+static void native_query(output *out) {
+	static snmp_session session;
+	size_t nof_oids = numoids + query_uptime;
+	snmp_varbind *requested = calloc(nof_oids, sizeof(snmp_varbind));
+	snmp_varbind *varbinds = calloc(nof_oids, sizeof(snmp_varbind));
+	snmp_pdu request = {.type = usesnmpgetnext ? SNMP_PDU_GETNEXT : SNMP_PDU_GET, .varbinds = requested, .nof_varbinds = nof_oids};
+	snmp_pdu response = {.varbinds = varbinds};
+	char oid[SNMP_MAX_OID_LENGTH * 11];
+	char value[MAX_INPUT_BUFFER];
+	char *text = strdup("");
+
+	if (requested == NULL || varbinds == NULL || text == NULL)
+		die(STATE_UNKNOWN, _("Cannot malloc"));
+	for (size_t i = 0; i < nof_oids; i++) {
+		if (!snmp_oid_parse(oids[i], &requested[i].oid))
+			usage2(_("Invalid OID"), oids[i]);
+		requested[i].value.type = SNMP_NULL;
+	}
+
+	session.version = strcmp(proto, "1") == 0 ? SNMP_VERSION_1 : SNMP_VERSION_2C;
+	session.community = community;
+	session.timeout = timeout_interval;
+	session.retries = retries;
+	if (verbose)
+		printf("%s v%s %s:%s (%zu OIDs)\n", usesnmpgetnext ? "GETNEXT" : "GET", proto, server_address, port, numoids);
+	if (!snmp_session_open(&session, server_address, port, strlen(ip_version) ? AF_INET6 : AF_INET))
+		die(STATE_UNKNOWN, "%s %s - %s (%s:%s)\n", label, state_text(STATE_UNKNOWN), session.error, server_address, port);
+	if (!snmp_session_request(&session, &request, &response, nof_oids))
+		die(STATE_UNKNOWN, "%s %s - %s (%s:%s)\n", label, state_text(STATE_UNKNOWN), session.error, server_address, port);
+	if (separate_uptime)
+		current_rates.has_uptime = agent_uptime(&session, &current_rates.uptime);
+	snmp_session_close(&session);
+
+	if (response.error_status != 0) {
+		oid[0] = '\0';
+		if (response.error_index > 0 && (size_t)response.error_index <= response.nof_varbinds)
+			snmp_oid_format(&varbinds[response.error_index - 1].oid, oid, sizeof(oid));
+		die(STATE_UNKNOWN, "%s %s - %s: %s %s\n", label, state_text(STATE_UNKNOWN), _("Error in packet"),
+			snmp_error_text(response.error_status), oid);
+	}
+
+	for (size_t i = 0; i < response.nof_varbinds; i++) {
+		snmp_oid_format(&varbinds[i].oid, oid, sizeof(oid));
+		format_value(&varbinds[i].oid, &varbinds[i].value, value, sizeof(value));
+		xasprintf(&text, "%s%s = %s\n", text, oid, value);
+	}
+
+	/* lines of text, as cmd_run_array() splits them */
+	out->buf = text;
+	out->buflen = strlen(text);
+	out->lines = 0;
+	out->line = calloc(out->buflen + 1, sizeof(char *));
+	out->lens = calloc(out->buflen + 1, sizeof(size_t));
+	if (out->line == NULL || out->lens == NULL)
+		die(STATE_UNKNOWN, _("Cannot malloc"));
+	for (char *rest = text; rest != NULL && *rest != '\0';) {
+		char *line = strsep(&rest, "\n");
+
+		out->line[out->lines] = line;
+		out->lens[out->lines++] = strlen(line);
+	}
+	free(requested);
+	free(varbinds);
+}
+
+static void add_host(char *host) {
+	if (nof_hosts == hosts_size) {
+		hosts_size += OID_COUNT_STEP * 8;
+		hosts = realloc(hosts, hosts_size * sizeof(*hosts));
+		if (hosts == NULL)
+			die(STATE_UNKNOWN, _("Cannot malloc"));
+	}
+	hosts[nof_hosts++] = host;
+}
+
+/* One host per line, blank lines and comments starting with # are skipped */
+static void read_hosts_file(const char *filename) {
+	FILE *fp = fopen(filename, "r");
+	char line[MAX_INPUT_BUFFER];
+
+	if (fp == NULL)
+		die(STATE_UNKNOWN, _("Cannot open hosts file %s: %s\n"), filename, strerror(errno));
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		char *host = line + strspn(line, " \t");
+
+		host[strcspn(host, " \t\r\n#")] = '\0';
+		if (host[0] != '\0')
+			add_host(strdup(host));
+	}
+	fclose(fp);
+}
+
+/* The value as snmpget prints it, enumerations by their names as with the
+ * MIBs loaded */
+static void format_value(const snmp_oid *oid, const snmp_value *value, char *buffer, size_t size) {
+	const char *name = NULL;
+
+	snmp_value_format(value, buffer, size);
+	if (value->type == SNMP_INTEGER && mib_cache_file != NULL)
+		name = snmp_mib_cache_enum(mib_cache(), oid, value->integer);
+	if (name != NULL)
+		snprintf(buffer, size, "INTEGER: %s(%lld)", name, (long long)value->integer);
+}
+
+/* Queries all hosts at once and evaluates every OID of each of them the way
+ * a check of a single host does */
+static int poll_hosts(void) {
+	snmp_poller poller = {.community = community,
+						  .timeout = timeout_interval,
+						  .retries = retries,
+						  .port = port,
+						  .family = strlen(ip_version) ? AF_INET6 : AF_INET};
+	snmp_varbind *requested = calloc(numoids, sizeof(snmp_varbind));
+	snmp_pdu request = {.type = usesnmpgetnext ? SNMP_PDU_GETNEXT : SNMP_PDU_GET, .varbinds = requested, .nof_varbinds = numoids};
+	int *states = calloc(nof_hosts, sizeof(int));
+	char **texts = calloc(nof_hosts, sizeof(char *));
+	text_buffer perfdata = {0};
+	static const int order[] = {STATE_CRITICAL, STATE_WARNING, STATE_UNKNOWN, STATE_OK};
+	int counts[STATE_UNKNOWN + 1] = {0};
+	int result = STATE_OK;
+	char oid[SNMP_MAX_OID_LENGTH * 11];
+	char response[MAX_INPUT_BUFFER];
+
+	if (requested == NULL || states == NULL || texts == NULL)
+		die(STATE_UNKNOWN, _("Cannot malloc"));
+	for (size_t i = 0; i < numoids; i++) {
+		if (!snmp_oid_parse(oids[i], &requested[i].oid))
+			usage2(_("Invalid OID"), oids[i]);
+		requested[i].value.type = SNMP_NULL;
+	}
+	poller.version = strcmp(proto, "1") == 0 ? SNMP_VERSION_1 : SNMP_VERSION_2C;
+	for (size_t h = 0; h < nof_hosts; h++)
+		snmp_poller_add(&poller, hosts[h]);
+
+	/* no alarm, the agents that did not answer by the deadline are reported
+	 * with the others */
+	poller.deadline = requests_deadline();
+	if (!snmp_poller_run(&poller, &request, numoids))
+		die(STATE_UNKNOWN, _("Cannot open socket: %s\n"), strerror(errno));
+
+	for (size_t h = 0; h < nof_hosts; h++) {
+		const snmp_target *target = &poller.targets[h];
+
+		states[h] = STATE_OK;
+		texts[h] = strdup("");
+		if (target->state != SNMP_TARGET_ANSWERED) {
+			states[h] = STATE_UNKNOWN;
+			xasprintf(&texts[h], " %s", target->error);
+		} else if (target->response.error_status != 0) {
+			states[h] = STATE_UNKNOWN;
+			xasprintf(&texts[h], " %s: %s", _("Error in packet"), snmp_error_text(target->response.error_status));
+		}
+
+		for (size_t i = 0; states[h] != STATE_UNKNOWN && i < target->response.nof_varbinds && i < numoids; i++) {
+			const snmp_varbind *varbind = &target->response.varbinds[i];
+			const char *name = oid;
+			oid_value value;
+			int iresult;
+
+			snmp_oid_format(&varbind->oid, oid, sizeof(oid));
+			if (i < nlabels && labels[i] != NULL)
+				name = labels[i];
+			strcpy(response, " = ");
+			format_value(&varbind->oid, &varbind->value, response + 3, sizeof(response) - 3);
+
+			iresult = evaluate_value(i, response, NULL, &value);
+			append_perfdata(&perfdata, target->host, i, oid, &value);
+			states[h] = max_state_alt(states[h], iresult);
+			xasprintf(&texts[h], "%s%s%s %s%s%s", texts[h], i == 0 ? " " : output_delim, name, mark(iresult), value.show,
+					  mark(iresult));
+			if (nunits > i && unitv[i] != NULL)
+				xasprintf(&texts[h], "%s %s", texts[h], unitv[i]);
+		}
+		counts[states[h]]++;
+		result = max_state_alt(result, states[h]);
+	}
+
+	printf("%s %s - %zu %s, %d %s, %d %s, %d %s | %s\n", label, state_text(result), nof_hosts, _("hosts"), counts[STATE_CRITICAL],
+		   _("critical"), counts[STATE_WARNING], _("warning"), counts[STATE_UNKNOWN], _("unknown"), perfdata.length ? perfdata.text : "");
+	/* the hosts with problems first */
+	for (size_t s = 0; s < sizeof(order) / sizeof(order[0]); s++) {
+		for (size_t h = 0; h < nof_hosts; h++) {
+			if (states[h] == order[s])
+				printf("%s %s -%s\n", hosts[h], state_text(order[s]), texts[h]);
+		}
+	}
+	snmp_poller_free(&poller);
+	return result;
+}
+
+static void text_append(text_buffer *buffer, const char *format, ...) {
+	va_list ap;
+	int length;
+
+	for (;;) {
+		if (buffer->size - buffer->length > 0) {
+			va_start(ap, format);
+			length = vsnprintf(buffer->text + buffer->length, buffer->size - buffer->length, format, ap);
+			va_end(ap);
+			if (length < 0)
+				die(STATE_UNKNOWN, _("Cannot asprintf()"));
+			if ((size_t)length < buffer->size - buffer->length) {
+				buffer->length += (size_t)length;
+				return;
+			}
+		}
+		buffer->size = buffer->size ? buffer->size * 2 : 4096;
+		buffer->text = realloc(buffer->text, buffer->size);
+		if (buffer->text == NULL)
+			die(STATE_UNKNOWN, _("Cannot realloc()"));
+		buffer->text[buffer->length] = '\0';
+	}
+}
+
+/* The end of all requests of --hosts and --table, after the final timeout
+ * of the help */
+static struct timespec requests_deadline(void) {
+	struct timespec deadline;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeout_interval * retries + 5;
+	return deadline;
+}
+
+/* The uptime of the agent, that tells its restarts apart for rates */
+static bool agent_uptime(snmp_session *session, uint64_t *uptime) {
+	snmp_varbind requested = {.value = {.type = SNMP_NULL}};
+	snmp_varbind varbind;
+	snmp_pdu request = {.type = SNMP_PDU_GET, .varbinds = &requested, .nof_varbinds = 1};
+	snmp_pdu response = {.varbinds = &varbind};
+
+	snmp_oid_parse(SNMP_RATE_UPTIME_OID, &requested.oid);
+	if (!snmp_session_request(session, &request, &response, 1) || response.error_status != 0 || response.nof_varbinds != 1 ||
+		varbind.value.type != SNMP_TIMETICKS)
+		return false;
+	*uptime = varbind.value.counter;
+	return true;
+}
+
+/* Walks the OIDs as the columns of a table and evaluates every row the way
+ * a check of single OIDs is evaluated, the rows with problems are listed
+ * after the summary */
+static int walk_table(void) {
+	static snmp_session session;
+	size_t nof_columns = numoids + (table_label != NULL);
+	snmp_oid *columns = calloc(nof_columns, sizeof(snmp_oid));
+	static const int order[] = {STATE_CRITICAL, STATE_WARNING, STATE_UNKNOWN, STATE_OK};
+	int counts[STATE_UNKNOWN + 1] = {0};
+	int result = STATE_OK;
+	snmp_table rows;
+	text_buffer perfdata = {0};
+	int *states;
+	char **texts;
+	char row_index[SNMP_MAX_OID_LENGTH * 11];
+	char key[SNMP_MAX_OID_LENGTH * 11 + 32];
+	char response[MAX_INPUT_BUFFER + 64];
+
+	if (columns == NULL)
+		die(STATE_UNKNOWN, _("Cannot malloc"));
+	for (size_t i = 0; i < numoids; i++) {
+		if (!snmp_oid_parse(oids[i], &columns[i]))
+			usage2(_("Invalid OID"), oids[i]);
+	}
+	if (table_label != NULL && !snmp_oid_parse(table_label, &columns[numoids]))
+		usage2(_("Invalid OID"), table_label);
+
+	session.version = strcmp(proto, "1") == 0 ? SNMP_VERSION_1 : SNMP_VERSION_2C;
+	session.community = community;
+	session.timeout = timeout_interval;
+	session.retries = retries;
+	/* the requests of the walk stop at the deadline instead of an alarm, not
+	 * to end up with some of the rows */
+	session.deadline = requests_deadline();
+	if (!snmp_session_open(&session, server_address, port, strlen(ip_version) ? AF_INET6 : AF_INET))
+		die(STATE_UNKNOWN, "%s %s - %s (%s:%s)\n", label, state_text(STATE_UNKNOWN), session.error, server_address, port);
+	snmp_table_init(&rows, columns, nof_columns);
+	if (!snmp_table_walk(&rows, &session, max_repetitions)) {
+		if (session.expired)
+			die(STATE_UNKNOWN, "%s %s - %s (%s:%s)\n", label, state_text(STATE_UNKNOWN), _("table walk timed out"), server_address, port);
+		die(STATE_UNKNOWN, "%s %s - %s (%s:%s)\n", label, state_text(STATE_UNKNOWN), rows.error, server_address, port);
+	}
+	if (calculate_rate)
+		current_rates.has_uptime = agent_uptime(&session, &current_rates.uptime);
+	snmp_session_close(&session);
+	if (verbose)
+		printf("%zu rows of %zu columns in %u requests\n", rows.nof_rows, nof_columns, rows.requests);
+	if (rows.nof_rows == 0)
+		die(STATE_UNKNOWN, _("No valid data returned (%s)\n"), _("empty table"));
+
+	states = calloc(rows.nof_rows, sizeof(int));
+	texts = calloc(rows.nof_rows, sizeof(char *));
+	if (states == NULL || texts == NULL)
+		die(STATE_UNKNOWN, _("Cannot malloc"));
+	text_append(&perfdata, "");
+
+	for (size_t r = 0; r < rows.nof_rows; r++) {
+		const snmp_row *row = &rows.rows[r];
+		const char *name = row_index;
+		text_buffer text = {0};
+
+		snmp_table_index_format(row, row_index, sizeof(row_index));
+		if (table_label != NULL && row->cells[numoids].present && row->cells[numoids].text[0] != '\0')
+			name = row->cells[numoids].text;
+		states[r] = STATE_OK;
+		text_append(&text, "");
+
+		for (size_t i = 0; i < numoids; i++) {
+			const snmp_cell *cell = &row->cells[i];
+			const char *column = oid_names != NULL && oid_names[i] != NULL ? oid_names[i] : oids[i];
+			const char *enumeration = NULL;
+			oid_value value;
+			int iresult;
+
+			if (!cell->present)
+				continue;
+			if (i < nlabels && labels[i] != NULL)
+				column = labels[i];
+			/* as snmpget prints it, enumerations by their names unless rates
+			 * are asked for */
+			if (cell->type == SNMP_INTEGER && mib_cache_file != NULL && !calculate_rate)
+				enumeration = snmp_mib_cache_enum(mib_cache(), &columns[i], (int64_t)cell->exact);
+			if (enumeration != NULL)
+				snprintf(response, sizeof(response), " = INTEGER: %s(%lld)", enumeration, (long long)(int64_t)cell->exact);
+			else
+				snprintf(response, sizeof(response), " = %s", cell->value);
+
+			snprintf(key, sizeof(key), "%zu.%s", i, row_index);
+			iresult = evaluate_value(i, response, key, &value);
+			/* a value that has no rate yet */
+			if (iresult == STATE_DEPENDENT)
+				iresult = STATE_OK;
+			append_perfdata(&perfdata, name, i, oids[i], &value);
+			states[r] = max_state_alt(states[r], iresult);
+			text_append(&text, "%s%s %s%s%s", text.length == 0 ? " " : output_delim, column, mark(iresult), value.show, mark(iresult));
+			if (nunits > i && unitv[i] != NULL)
+				text_append(&text, " %s", unitv[i]);
+		}
+		xasprintf(&texts[r], "%s %s -%s", name, state_text(states[r]), text.text);
+		free(text.text);
+		counts[states[r]]++;
+		result = max_state_alt(result, states[r]);
+	}
+
+	if (calculate_rate) {
+		np_state_write_string(current_rates.time, snmp_rate_format(&current_rates));
+		if (previous_state == NULL)
+			die(STATE_OK, _("No previous data to calculate rate - assume okay"));
+	}
+
+	printf("%s %s - %zu %s, %d %s, %d %s, %d %s | %s\n", label, state_text(result), rows.nof_rows, _("rows"), counts[STATE_CRITICAL],
+		   _("critical"), counts[STATE_WARNING], _("warning"), counts[STATE_UNKNOWN], _("unknown"), perfdata.text);
+	/* the rows with problems first, all of them only when asked for */
+	for (size_t s = 0; s < sizeof(order) / sizeof(order[0]); s++) {
+		if (order[s] == STATE_OK && !verbose)
+			break;
+		for (size_t r = 0; r < rows.nof_rows; r++) {
+			if (states[r] == order[s])
+				printf("%s\n", texts[r]);
+		}
+	}
+	snmp_table_free(&rows);
+	return result;
+}
+
+/* The MIB cache, mapped the first time it is needed */
+static const snmp_mib_cache *mib_cache(void) {
+	static snmp_mib_cache cache;
+	static bool mapped = false;
+
+	if (!mapped) {
+		if (!snmp_mib_cache_open(&cache, mib_cache_file))
+			die(STATE_UNKNOWN, _("Cannot open MIB cache %s: %s\n"), mib_cache_file, strerror(errno));
+		mapped = true;
+	}
+	return &cache;
+}
+
+/* Replaces a symbolic OID by the numeric one of the MIB cache, false if it
+ * is not in there */
+static bool translate_oid(char **name) {
+	snmp_oid oid;
+	char *numeric = strdup("");
+
+	if (strspn(*name, "0123456789.") == strlen(*name))
+		return true;
+	if (!snmp_mib_cache_translate(mib_cache(), *name, &oid))
+		return false;
+	for (size_t i = 0; i < oid.length; i++)
+		xasprintf(&numeric, "%s%s%u", numeric, i == 0 ? "" : ".", oid.ids[i]);
+	if (verbose)
+		printf("%s = %s (%s)\n", *name, numeric, snmp_mib_cache_type(mib_cache(), &oid));
+	*name = numeric;
+	return true;
+}
+
+/* Builds the MIB cache from the MIBs of the miblist, as snmptranslate
+ * reads them */
+static int write_mib_cache(void) {
+#ifdef PATH_TO_SNMPTRANSLATE
+	char *command_line[] = {PATH_TO_SNMPTRANSLATE, "-Tp", "-m", miblist ? miblist : DEFAULT_MIBLIST, NULL};
+	output chld_out;
+	output chld_err;
+	size_t count;
+
+	if (cmd_run_array(command_line, &chld_out, &chld_err, 0) != 0 || chld_out.lines == 0)
+		die(STATE_UNKNOWN, "%s %s - %s: %s\n", label, state_text(STATE_UNKNOWN), PATH_TO_SNMPTRANSLATE,
+			chld_err.lines > 0 ? chld_err.line[0] : _("No MIB tree"));
+	if (!snmp_mib_cache_build(chld_out.line, chld_out.lines, mib_cache_file, &count))
+		die(STATE_UNKNOWN, _("Cannot write MIB cache %s: %s\n"), mib_cache_file, strerror(errno));
+	printf("%s %s - %zu %s %s\n", label, state_text(STATE_OK), count, _("objects cached in"), mib_cache_file);
+	return STATE_OK;
+#else
+	die(STATE_UNKNOWN, _("The MIB cache is built with snmptranslate, which was not found at compile time\n"));
+#endif
+}
+
+/* Evaluates the response of the i-th OID, " = TYPE: value" as snmpget
+ * prints it: against the thresholds or as a rate if there are any, else by
+ * the string or regex to match. key tells the value apart in the state of
+ * the rates. */
+static int evaluate_value(size_t i, char *response, const char *key, oid_value *value) {
+	unsigned int bk_count = 0;
+	unsigned int dq_count = 0;
+	int iresult = STATE_DEPENDENT;
+	char *conv = calculate_rate ? "%.10g" : "%.0f";
+	char *ptr;
+	double number;
+
+	value->type[0] = '\0';
+	value->valid = true;
+	value->unfinished = false;
+
+	/* We strip out the datatype indicator for PHBs */
+	if (strstr(response, "Gauge: ")) {
+		value->show = multiply(strstr(response, "Gauge: ") + 7);
+	} else if (strstr(response, "Gauge32: ")) {
+		value->show = multiply(strstr(response, "Gauge32: ") + 9);
+	} else if (strstr(response, "Counter32: ")) {
+		value->show = strstr(response, "Counter32: ") + 11;
+		if (!calculate_rate)
+			strcpy(value->type, "c");
+	} else if (strstr(response, "Counter64: ")) {
+		value->show = strstr(response, "Counter64: ") + 11;
+		if (!calculate_rate)
+			strcpy(value->type, "c");
+	} else if (strstr(response, "INTEGER: ")) {
+		value->show = multiply(strstr(response, "INTEGER: ") + 9);
+
+		if (fmtstr_set) {
+			conv = fmtstr;
+		}
+	} else if (strstr(response, "OID: ")) {
+		value->show = strstr(response, "OID: ") + 5;
+	} else if (strstr(response, "STRING: ")) {
+		value->show = strstr(response, "STRING: ") + 8;
+		conv = "%.10g";
+
+		/* multi-line strings end in one of the lines that follow */
+		ptr = value->show;
+		COUNT_SEQ(ptr, bk_count, dq_count)
+		while (dq_count && ptr[0] != '\n' && ptr[0] != '\0') {
+			ptr++;
+			GOBBLE_TOS(ptr, "\n\"\\")
+			COUNT_SEQ(ptr, bk_count, dq_count)
+		}
+
+		if (dq_count) { /* unfinished line */
+			value->unfinished = true;
+			/* strip out unmatched double-quote from single-line output */
+			if (value->show[0] == '"')
+				value->show++;
+		}
+	} else if (strstr(response, "Timeticks: ")) {
+		value->show = strstr(response, "Timeticks: ");
+	} else
+		value->show = response + 3;
+
+	/* Process this block for numeric comparisons */
+	/* Make some special values,like Timeticks numeric only if a threshold is defined */
+	if (thlds[i]->warning || thlds[i]->critical || calculate_rate) {
+		if (verbose > 2) {
+			print_thresholds("  thresholds", thlds[i]);
+		}
+		ptr = strpbrk(value->show, "-0123456789");
+		if (ptr == NULL) {
+			value->valid = false;
+			return nulloid;
+		}
+		number = strtod(ptr, NULL) + offset;
+
+		if (calculate_rate) {
+			snmp_rate_kind kind;
+			uint64_t raw;
+
+			/* the exact value, not the one shown */
+			if (snmp_rate_value(response, &kind, &raw)) {
+				snmp_rate_add(&current_rates, key, kind, raw);
+				if (previous_state != NULL) {
+					switch (snmp_rate(&previous_rates, &current_rates, &current_rates.samples[current_rates.nof_samples - 1], &number)) {
+					case SNMP_RATE_VALID:
+						/* Gauges and integers are shown multiplied, so are their rates */
+						if (kind == SNMP_RATE_GAUGE && (strstr(response, "Gauge") || strstr(response, "INTEGER: ")))
+							number *= multiplier;
+						number *= rate_multiplier;
+						iresult = get_status(number, thlds[i]);
+						xasprintf(&value->show, conv, number);
+						break;
+					case SNMP_RATE_NO_TIME:
+						die(STATE_UNKNOWN, _("Time duration between plugin calls is invalid"));
+					case SNMP_RATE_RESET:
+						iresult = STATE_OK;
+						xasprintf(&value->show, "%s", _("no rate, counter reset"));
+						break;
+					case SNMP_RATE_NO_PREVIOUS:
+						iresult = STATE_OK;
+						xasprintf(&value->show, "%s", _("no rate yet"));
+					}
+				}
+			}
+		} else {
+			iresult = get_status(number, thlds[i]);
+			xasprintf(&value->show, conv, number);
+		}
+	}
+
+	/* Process this block for string matching */
+	else if (eval_size > i && eval_method[i] & CRIT_STRING) {
+		if (strcmp(value->show, string_value))
+			iresult = (invert_search == 0) ? STATE_CRITICAL : STATE_OK;
+		else
+			iresult = (invert_search == 0) ? STATE_OK : STATE_CRITICAL;
+	}
+
+	/* Process this block for regex matching */
+	else if (eval_size > i && eval_method[i] & CRIT_REGEX) {
+		excode = regexec(&preg, response, 10, pmatch, eflags);
+		if (excode == 0) {
+			iresult = (invert_search == 0) ? STATE_OK : STATE_CRITICAL;
+		} else if (excode != REG_NOMATCH) {
+			regerror(excode, &preg, errbuf, MAX_INPUT_BUFFER);
+			printf(_("Execute Error: %s\n"), errbuf);
+			exit(STATE_CRITICAL);
+		} else {
+			iresult = (invert_search == 0) ? STATE_CRITICAL : STATE_OK;
+		}
+	}
+
+	/* Process this block for existence-nonexistence checks */
+	else {
+		if (eval_size > i && eval_method[i] & CRIT_PRESENT)
+			iresult = STATE_CRITICAL;
+		else if (eval_size > i && eval_method[i] & WARN_PRESENT)
+			iresult = STATE_WARNING;
+		else if (iresult == STATE_DEPENDENT)
+			iresult = STATE_OK;
+	}
+	return iresult;
+}
+
+/* Writes the performance data of the i-th OID with whatever can be parsed
+ * by strtod, if possible, the label after prefix/ if there is one */
+static void append_perfdata(text_buffer *perfdata, const char *prefix, size_t i, const char *oidname, const oid_value *value) {
+	const char *name = oidname;
+	const char *quote = "";
+	char *label_text;
+	char *end = NULL;
+
+	strtod(value->show, &end);
+	if (end <= value->show)
+		return;
+	if (perf_labels && i < nlabels && labels[i] != NULL)
+		name = labels[i];
+	else if (oid_names != NULL && oid_names[i] != NULL)
+		name = oid_names[i];
+	if (prefix != NULL)
+		xasprintf(&label_text, "%s/%s", prefix, name);
+	else
+		label_text = strdup(name);
+	if (strpbrk(label_text, " ='\"") != NULL)
+		quote = strchr(label_text, '\'') == NULL ? "'" : "\"";
+
+	text_append(perfdata, "%s%s%s=%.*s%s", quote, label_text, quote, (int)(end - value->show), value->show, value->type);
+	if (warning_thresholds)
+		text_append(perfdata, ";%s", thlds[i]->warning && thlds[i]->warning->text ? thlds[i]->warning->text : "");
+	if (critical_thresholds)
+		text_append(perfdata, "%s;%s", warning_thresholds ? "" : ";",
+					thlds[i]->critical && thlds[i]->critical->text ? thlds[i]->critical->text : "");
+	text_append(perfdata, " ");
+	free(label_text);
+}
+
 /* multiply result (values 0 < n < 1 work as divider) */
 static char *multiply(char *str) {
 	if (multiplier == 1)
@@ -1299,6 +1861,32 @@ static void print_help(void) {
 
 	printf(" %s\n", "--ignore-mib-parsing-errors");
 	printf("    %s\n", _("Tell snmpget to not print errors encountered when parsing MIB files"));
+	printf(" %s\n", "--native");
+	printf("    %s\n", _("Query the agent directly instead of running snmpget, for SNMP versions 1"));
+	printf("    %s\n", _("and 2c and numeric OIDs only"));
+	printf(" %s\n", "--hosts=HOST[:PORT][,HOST...]");
+	printf("    %s\n", _("Query the OIDs of all these agents at once, as with --native, and report"));
+	printf("    %s\n", _("each of them. The thresholds apply to every host."));
+	printf("    %s\n", _("Every request has the timeout and retries of -t and -e, an agent that does"));
+	printf("    %s\n", _("not answer, or not within the final timeout above, is reported as UNKNOWN"));
+	printf("    %s\n", _("without ending the others."));
+	printf(" %s\n", "--hosts-file=FILE");
+	printf("    %s\n", _("Read more hosts from FILE, one per line"));
+	printf(" %s\n", "--table");
+	printf("    %s\n", _("Walk the OIDs as columns of a table, as with --native, and evaluate every"));
+	printf("    %s\n", _("row. The thresholds apply to the column of the same position, --rate to"));
+	printf("    %s\n", _("each row of it. A walk that does not end within the final timeout above"));
+	printf("    %s\n", _("is UNKNOWN."));
+	printf(" %s\n", "--table-label=OID");
+	printf("    %s\n", _("Name the rows by this column, for example ifName, instead of their index"));
+	printf(" %s\n", "--max-repetitions=INTEGER");
+	printf("    %s %d)\n", _("Rows asked for per GETBULK request (default:"), SNMP_TABLE_MAX_REPETITIONS);
+	printf(" %s\n", "--mib-cache=FILE");
+	printf("    %s\n", _("Translate symbolic OIDs with this cache instead of loading the MIBs on"));
+	printf("    %s\n", _("every run, only those not in it are left to the MIBs"));
+	printf(" %s\n", "--build-mib-cache");
+	printf("    %s\n", _("Write the cache of the MIBs of -m (default: ALL) to the file of --mib-cache"));
+	printf("    %s\n", _("and exit, again whenever the MIBs change"));
 
 	printf(UT_VERBOSE);
 
@@ -1328,6 +1916,10 @@ static void print_help(void) {
 	printf(" %s\n", _("On the first run, there will be no prior state - this will return with OK."));
 	printf(" %s\n", _("The state is uniquely determined by the arguments to the plugin, so"));
 	printf(" %s\n", _("changing the arguments will create a new state file."));
+	printf(" %s\n", _("The rate is taken over the uptime of the agent (sysUpTime.0), or the time"));
+	printf(" %s\n", _("between the runs if the agent has none (or with snmpget and SNMPv1). Counters"));
+	printf(" %s\n", _("that wrapped around are accounted for, after the agent restarted or a"));
+	printf(" %s\n", _("Counter64 went back there is no rate until the next run."));
 
 	printf(UT_SUPPORT);
 }
@@ -1339,5 +1931,6 @@ void print_usage(void) {
 	printf("[-l label] [-u units] [-p port-number] [-d delimiter] [-D output-delimiter]\n");
 	printf("[-m miblist] [-P snmp version] [-N context] [-L seclevel] [-U secname]\n");
 	printf("[-a authproto] [-A authpasswd] [-x privproto] [-X privpasswd] [-4|6]\n");
-	printf("[-M multiplier [-f format]]\n");
+	printf("[-M multiplier [-f format]] [--native] [--hosts=host,... | --hosts-file=file]\n");
+	printf("[--table [--table-label=oid] [--max-repetitions=integer]] [--mib-cache=file [--build-mib-cache]]\n");
 }
@@ -0,0 +1,531 @@
+#include "./ber.h"
+
+#include <ctype.h>
+
+#define BER_SEQUENCE 0x30
+
+/* Messages are written back to front, so that the length of every
+ * constructed value is known before its header is written */
+typedef struct {
+	uint8_t *start;
+	uint8_t *pos;
+	bool overflow;
+} ber_writer;
+
+typedef struct {
+	const uint8_t *pos;
+	const uint8_t *end;
+} ber_reader;
+
+static void ber_put_byte(ber_writer *writer, uint8_t byte) {
+	if (writer->pos == writer->start) {
+		writer->overflow = true;
+		return;
+	}
+	*--writer->pos = byte;
+}
+
+static void ber_put_bytes(ber_writer *writer, const uint8_t *bytes, size_t length) {
+	if ((size_t)(writer->pos - writer->start) < length) {
+		writer->overflow = true;
+		return;
+	}
+	writer->pos -= length;
+	memcpy(writer->pos, bytes, length);
+}
+
+static void ber_put_header(ber_writer *writer, uint8_t type, size_t length) {
+	if (length < 0x80) {
+		ber_put_byte(writer, (uint8_t)length);
+	} else {
+		uint8_t octets = 0;
+
+		for (; length > 0; length >>= 8, octets++)
+			ber_put_byte(writer, (uint8_t)(length & 0xff));
+		ber_put_byte(writer, 0x80 | octets);
+	}
+	ber_put_byte(writer, type);
+}
+
+/* The length of what was written since mark */
+static size_t ber_since(const ber_writer *writer, const uint8_t *mark) { return (size_t)(mark - writer->pos); }
+
+static void ber_put_integer(ber_writer *writer, uint8_t type, int64_t value) {
+	uint8_t *mark = writer->pos;
+
+	/* two's complement in as few octets as keep the sign */
+	do {
+		ber_put_byte(writer, (uint8_t)((uint64_t)value & 0xff));
+		value >>= 8;
+	} while (!writer->overflow && !((value == 0 && !(writer->pos[0] & 0x80)) || (value == -1 && (writer->pos[0] & 0x80))));
+	ber_put_header(writer, type, ber_since(writer, mark));
+}
+
+static void ber_put_unsigned(ber_writer *writer, uint8_t type, uint64_t value) {
+	uint8_t *mark = writer->pos;
+
+	do {
+		ber_put_byte(writer, (uint8_t)(value & 0xff));
+		value >>= 8;
+	} while (value > 0 && !writer->overflow);
+	/* a leading zero keeps it from being read as negative */
+	if (!writer->overflow && (writer->pos[0] & 0x80))
+		ber_put_byte(writer, 0);
+	ber_put_header(writer, type, ber_since(writer, mark));
+}
+
+/* Base 128, the last octet without the continuation bit */
+static void ber_put_sub_id(ber_writer *writer, uint64_t id) {
+	ber_put_byte(writer, id & 0x7f);
+	for (id >>= 7; id > 0; id >>= 7)
+		ber_put_byte(writer, 0x80 | (id & 0x7f));
+}
+
+static void ber_put_oid(ber_writer *writer, const snmp_oid *oid) {
+	uint8_t *mark = writer->pos;
+
+	for (size_t i = oid->length; i-- > 2;)
+		ber_put_sub_id(writer, oid->ids[i]);
+	/* the first two sub-identifiers are encoded as one */
+	if (oid->length >= 2)
+		ber_put_sub_id(writer, (uint64_t)oid->ids[0] * 40 + oid->ids[1]);
+	else
+		ber_put_sub_id(writer, oid->length ? (uint64_t)oid->ids[0] * 40 : 0);
+	ber_put_header(writer, SNMP_OBJECT_ID, ber_since(writer, mark));
+}
+
+static void ber_put_value(ber_writer *writer, const snmp_value *value) {
+	switch (value->type) {
+	case SNMP_INTEGER:
+		ber_put_integer(writer, SNMP_INTEGER, value->integer);
+		break;
+	case SNMP_OCTET_STRING:
+	case SNMP_IP_ADDRESS:
+	case SNMP_OPAQUE:
+		ber_put_bytes(writer, value->bytes, value->length);
+		ber_put_header(writer, (uint8_t)value->type, value->length);
+		break;
+	case SNMP_OBJECT_ID:
+		ber_put_oid(writer, &value->oid);
+		break;
+	case SNMP_COUNTER32:
+	case SNMP_GAUGE32:
+	case SNMP_TIMETICKS:
+	case SNMP_COUNTER64:
+		ber_put_unsigned(writer, (uint8_t)value->type, value->counter);
+		break;
+	default: /* NULL and the exceptions have no contents */
+		ber_put_header(writer, (uint8_t)value->type, 0);
+	}
+}
+
+size_t snmp_encode(const snmp_pdu *pdu, uint8_t *buffer, size_t size) {
+	ber_writer writer = {.start = buffer, .pos = buffer + size};
+	uint8_t *message = writer.pos;
+	size_t length;
+
+	for (size_t i = pdu->nof_varbinds; i-- > 0;) {
+		uint8_t *varbind = writer.pos;
+
+		ber_put_value(&writer, &pdu->varbinds[i].value);
+		ber_put_oid(&writer, &pdu->varbinds[i].oid);
+		ber_put_header(&writer, BER_SEQUENCE, ber_since(&writer, varbind));
+	}
+	ber_put_header(&writer, BER_SEQUENCE, ber_since(&writer, message));
+	ber_put_integer(&writer, SNMP_INTEGER, pdu->error_index);
+	ber_put_integer(&writer, SNMP_INTEGER, pdu->error_status);
+	ber_put_integer(&writer, SNMP_INTEGER, pdu->request_id);
+	ber_put_header(&writer, (uint8_t)pdu->type, ber_since(&writer, message));
+	ber_put_bytes(&writer, (const uint8_t *)pdu->community, pdu->community_length);
+	ber_put_header(&writer, SNMP_OCTET_STRING, pdu->community_length);
+	ber_put_integer(&writer, SNMP_INTEGER, pdu->version);
+	ber_put_header(&writer, BER_SEQUENCE, ber_since(&writer, message));
+
+	if (writer.overflow)
+		return 0;
+	length = ber_since(&writer, message);
+	memmove(buffer, writer.pos, length);
+	return length;
+}
+
+static bool ber_get_header(ber_reader *reader, uint8_t *type, size_t *length) {
+	if (reader->end - reader->pos < 2)
+		return false;
+	*type = *reader->pos++;
+	*length = *reader->pos++;
+	if (*length & 0x80) {
+		size_t octets = *length & 0x7f;
+
+		/* no indefinite lengths, and nothing as long as 2^32 */
+		if (octets == 0 || octets > 4 || (size_t)(reader->end - reader->pos) < octets)
+			return false;
+		for (*length = 0; octets > 0; octets--)
+			*length = (*length << 8) | *reader->pos++;
+	}
+	return *length <= (size_t)(reader->end - reader->pos);
+}
+
+/* Enters a constructed value of type, reader is limited to its contents
+ * and outer continues after it */
+static bool ber_enter(ber_reader *reader, uint8_t type, ber_reader *inner) {
+	uint8_t found;
+	size_t length;
+
+	if (!ber_get_header(reader, &found, &length) || found != type)
+		return false;
+	inner->pos = reader->pos;
+	inner->end = reader->pos + length;
+	reader->pos += length;
+	return true;
+}
+
+static bool ber_read_integer(const uint8_t *contents, size_t length, int64_t *value) {
+	uint64_t bits;
+
+	if (length == 0 || length > 8)
+		return false;
+	bits = (contents[0] & 0x80) ? UINT64_MAX : 0;
+	for (size_t i = 0; i < length; i++)
+		bits = (bits << 8) | contents[i];
+	*value = (int64_t)bits;
+	return true;
+}
+
+static bool ber_read_unsigned(const uint8_t *contents, size_t length, uint64_t *value) {
+	/* the leading zero of large values does not count */
+	if (length > 1 && contents[0] == 0) {
+		contents++;
+		length--;
+	}
+	if (length == 0 || length > 8)
+		return false;
+	*value = 0;
+	for (size_t i = 0; i < length; i++)
+		*value = (*value << 8) | contents[i];
+	return true;
+}
+
+static bool ber_read_oid(const uint8_t *contents, size_t length, snmp_oid *oid) {
+	uint32_t id = 0;
+
+	oid->length = 0;
+	if (length == 0)
+		return false;
+	for (size_t i = 0; i < length; i++) {
+		if (id > (UINT32_MAX >> 7))
+			return false;
+		id = (id << 7) | (contents[i] & 0x7f);
+		if (contents[i] & 0x80)
+			continue;
+		if (oid->length == 0) {
+			oid->ids[oid->length++] = id < 80 ? id / 40 : 2;
+			oid->ids[oid->length++] = id < 80 ? id % 40 : id - 80;
+		} else {
+			if (oid->length == SNMP_MAX_OID_LENGTH)
+				return false;
+			oid->ids[oid->length++] = id;
+		}
+		id = 0;
+	}
+	/* the last sub-identifier has to be complete */
+	return !(contents[length - 1] & 0x80);
+}
+
+static bool ber_get_integer(ber_reader *reader, int32_t *value) {
+	uint8_t type;
+	size_t length;
+	int64_t number;
+
+	if (!ber_get_header(reader, &type, &length) || type != SNMP_INTEGER || !ber_read_integer(reader->pos, length, &number) ||
+		number < INT32_MIN || number > INT32_MAX)
+		return false;
+	reader->pos += length;
+	*value = (int32_t)number;
+	return true;
+}
+
+static bool ber_get_value(ber_reader *reader, snmp_value *value) {
+	uint8_t type;
+	size_t length;
+	const uint8_t *contents;
+	bool valid = true;
+
+	if (!ber_get_header(reader, &type, &length))
+		return false;
+	contents = reader->pos;
+	reader->pos += length;
+
+	value->type = (snmp_type)type;
+	value->integer = 0;
+	value->counter = 0;
+	value->bytes = NULL;
+	value->length = 0;
+	value->oid.length = 0;
+	switch (type) {
+	case SNMP_INTEGER:
+		valid = ber_read_integer(contents, length, &value->integer);
+		break;
+	case SNMP_OCTET_STRING:
+	case SNMP_IP_ADDRESS:
+	case SNMP_OPAQUE:
+		value->bytes = contents;
+		value->length = length;
+		break;
+	case SNMP_OBJECT_ID:
+		valid = ber_read_oid(contents, length, &value->oid);
+		break;
+	case SNMP_COUNTER32:
+	case SNMP_GAUGE32:
+	case SNMP_TIMETICKS:
+		valid = ber_read_unsigned(contents, length, &value->counter) && value->counter <= UINT32_MAX;
+		break;
+	case SNMP_COUNTER64:
+		valid = ber_read_unsigned(contents, length, &value->counter);
+		break;
+	case SNMP_NULL:
+	case SNMP_NO_SUCH_OBJECT:
+	case SNMP_NO_SUCH_INSTANCE:
+	case SNMP_END_OF_MIB_VIEW:
+		break;
+	default:
+		valid = false;
+	}
+	return valid;
+}
+
+bool snmp_decode(const uint8_t *buffer, size_t length, snmp_pdu *pdu, size_t max_varbinds) {
+	ber_reader reader = {.pos = buffer, .end = buffer + length};
+	ber_reader message;
+	ber_reader contents;
+	ber_reader list;
+	uint8_t type;
+	size_t community_length;
+	int32_t version;
+
+	if (!ber_enter(&reader, BER_SEQUENCE, &message) || !ber_get_integer(&message, &version))
+		return false;
+	pdu->version = (snmp_version)version;
+	if (!ber_get_header(&message, &type, &community_length) || type != SNMP_OCTET_STRING)
+		return false;
+	pdu->community = (const char *)message.pos;
+	pdu->community_length = community_length;
+	message.pos += community_length;
+
+	if (message.pos == message.end)
+		return false;
+	pdu->type = (snmp_pdu_type)*message.pos;
+	if (!ber_enter(&message, (uint8_t)pdu->type, &contents) || !ber_get_integer(&contents, &pdu->request_id) ||
+		!ber_get_integer(&contents, &pdu->error_status) || !ber_get_integer(&contents, &pdu->error_index) ||
+		!ber_enter(&contents, BER_SEQUENCE, &list))
+		return false;
+
+	pdu->nof_varbinds = 0;
+	while (list.pos < list.end) {
+		ber_reader varbind;
+		snmp_varbind ignored;
+		snmp_varbind *target = pdu->nof_varbinds < max_varbinds ? &pdu->varbinds[pdu->nof_varbinds] : &ignored;
+		size_t oid_length;
+
+		if (!ber_enter(&list, BER_SEQUENCE, &varbind) || !ber_get_header(&varbind, &type, &oid_length) || type != SNMP_OBJECT_ID ||
+			!ber_read_oid(varbind.pos, oid_length, &target->oid))
+			return false;
+		varbind.pos += oid_length;
+		if (!ber_get_value(&varbind, &target->value))
+			return false;
+		if (target != &ignored)
+			pdu->nof_varbinds++;
+	}
+	return true;
+}
+
+bool snmp_oid_parse(const char *text, snmp_oid *oid) {
+	const char *pos = text;
+
+	oid->length = 0;
+	if (*pos == '.')
+		pos++;
+	while (*pos) {
+		char *end;
+		unsigned long id;
+
+		if (!isdigit((unsigned char)*pos) || oid->length == SNMP_MAX_OID_LENGTH)
+			return false;
+		errno = 0;
+		id = strtoul(pos, &end, 10);
+		if (errno != 0 || id > UINT32_MAX)
+			return false;
+		oid->ids[oid->length++] = (uint32_t)id;
+		if (*end == '.' && end[1] != '\0')
+			end++;
+		else if (*end != '\0')
+			return false;
+		pos = end;
+	}
+	/* BER cannot encode anything else in the first octet */
+	return oid->length >= 2 && oid->ids[0] <= 2 && (oid->ids[0] == 2 || oid->ids[1] < 40);
+}
+
+void snmp_oid_format(const snmp_oid *oid, char *buffer, size_t size) {
+	static const char *const roots[] = {"ccitt", "iso", "joint-iso-ccitt"};
+	size_t used;
+
+	if (size == 0)
+		return;
+	buffer[0] = '\0';
+	if (oid->length == 0)
+		return;
+	used = (size_t)snprintf(buffer, size, "%s", oid->ids[0] <= 2 ? roots[oid->ids[0]] : "");
+	for (size_t i = oid->ids[0] <= 2 ? 1 : 0; i < oid->length && used < size; i++)
+		used += (size_t)snprintf(buffer + used, size - used, "%s%" PRIu32, used ? "." : "", oid->ids[i]);
+}
+
+int snmp_oid_compare(const snmp_oid *a, const snmp_oid *b) {
+	for (size_t i = 0; i < a->length && i < b->length; i++) {
+		if (a->ids[i] != b->ids[i])
+			return a->ids[i] < b->ids[i] ? -1 : 1;
+	}
+	if (a->length == b->length)
+		return 0;
+	return a->length < b->length ? -1 : 1;
+}
+
+/* net-snmp prints strings with line breaks and tabs as text, anything else
+ * unprintable as hex */
+static bool snmp_is_text(const uint8_t *bytes, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		/* a trailing NUL is common and allowed */
+		if (bytes[i] == '\0' && i == length - 1)
+			continue;
+		if (!isprint(bytes[i]) && !isspace(bytes[i]))
+			return false;
+	}
+	return true;
+}
+
+static size_t snmp_format_hex(const uint8_t *bytes, size_t length, char *buffer, size_t size) {
+	size_t used = 0;
+
+	for (size_t i = 0; i < length && used < size; i++)
+		used += (size_t)snprintf(buffer + used, size - used, "%02X%s", bytes[i], (i % 16 == 15 && i + 1 < length) ? "\n" : " ");
+	return used;
+}
+
+void snmp_value_format(const snmp_value *value, char *buffer, size_t size) {
+	size_t used = 0;
+	uint64_t ticks;
+
+	if (size == 0)
+		return;
+	buffer[0] = '\0';
+	switch (value->type) {
+	case SNMP_INTEGER:
+		snprintf(buffer, size, "INTEGER: %" PRId64, value->integer);
+		break;
+	case SNMP_OCTET_STRING:
+		if (value->length == 0) {
+			snprintf(buffer, size, "\"\"");
+		} else if (snmp_is_text(value->bytes, value->length)) {
+			used = (size_t)snprintf(buffer, size, "STRING: \"");
+			for (size_t i = 0; i < value->length && value->bytes[i] != '\0' && used + 3 < size; i++) {
+				if (value->bytes[i] == '"' || value->bytes[i] == '\\')
+					buffer[used++] = '\\';
+				buffer[used++] = (char)value->bytes[i];
+			}
+			snprintf(buffer + used, size - used, "\"");
+		} else {
+			used = (size_t)snprintf(buffer, size, "Hex-STRING: ");
+			snmp_format_hex(value->bytes, value->length, buffer + used, size - used);
+		}
+		break;
+	case SNMP_NULL:
+		snprintf(buffer, size, "NULL");
+		break;
+	case SNMP_OBJECT_ID:
+		used = (size_t)snprintf(buffer, size, "OID: ");
+		if (used < size)
+			snmp_oid_format(&value->oid, buffer + used, size - used);
+		break;
+	case SNMP_IP_ADDRESS:
+		if (value->length == 4)
+			snprintf(buffer, size, "IpAddress: %u.%u.%u.%u", value->bytes[0], value->bytes[1], value->bytes[2], value->bytes[3]);
+		else
+			snprintf(buffer, size, "IpAddress: ");
+		break;
+	case SNMP_COUNTER32:
+		snprintf(buffer, size, "Counter32: %" PRIu64, value->counter);
+		break;
+	case SNMP_GAUGE32:
+		snprintf(buffer, size, "Gauge32: %" PRIu64, value->counter);
+		break;
+	case SNMP_TIMETICKS:
+		/* hundredths of a second */
+		ticks = value->counter / 100;
+		if (ticks / 86400 == 0)
+			snprintf(buffer, size, "Timeticks: (%" PRIu64 ") %d:%02d:%02d.%02d", value->counter, (int)(ticks % 86400 / 3600),
+					 (int)(ticks % 3600 / 60), (int)(ticks % 60), (int)(value->counter % 100));
+		else
+			snprintf(buffer, size, "Timeticks: (%" PRIu64 ") %d %s, %d:%02d:%02d.%02d", value->counter, (int)(ticks / 86400),
+					 ticks / 86400 == 1 ? "day" : "days", (int)(ticks % 86400 / 3600), (int)(ticks % 3600 / 60), (int)(ticks % 60),
+					 (int)(value->counter % 100));
+		break;
+	case SNMP_OPAQUE:
+		used = (size_t)snprintf(buffer, size, "Opaque: ");
+		snmp_format_hex(value->bytes, value->length, buffer + used, size - used);
+		break;
+	case SNMP_COUNTER64:
+		snprintf(buffer, size, "Counter64: %" PRIu64, value->counter);
+		break;
+	case SNMP_NO_SUCH_OBJECT:
+		snprintf(buffer, size, "No Such Object available on this agent at this OID");
+		break;
+	case SNMP_NO_SUCH_INSTANCE:
+		snprintf(buffer, size, "No Such Instance currently exists at this OID");
+		break;
+	case SNMP_END_OF_MIB_VIEW:
+		snprintf(buffer, size, "No more variables left in this MIB View (It is past the end of the MIB tree)");
+		break;
+	}
+}
+
+bool snmp_value_number(const snmp_value *value, double *number) {
+	switch (value->type) {
+	case SNMP_INTEGER:
+		*number = (double)value->integer;
+		return true;
+	case SNMP_COUNTER32:
+	case SNMP_GAUGE32:
+	case SNMP_TIMETICKS:
+	case SNMP_COUNTER64:
+		*number = (double)value->counter;
+		return true;
+	default:
+		return false;
+	}
+}
+
+const char *snmp_error_text(int32_t error_status) {
+	/* RFC 3416, the first five are those of v1 */
+	static const char *const errors[] = {"noError",
+										 "tooBig",
+										 "noSuchName",
+										 "badValue",
+										 "readOnly",
+										 "genErr",
+										 "noAccess",
+										 "wrongType",
+										 "wrongLength",
+										 "wrongEncoding",
+										 "wrongValue",
+										 "noCreation",
+										 "inconsistentValue",
+										 "resourceUnavailable",
+										 "commitFailed",
+										 "undoFailed",
+										 "authorizationError",
+										 "notWritable",
+										 "inconsistentName"};
+
+	if (error_status < 0 || (size_t)error_status >= sizeof(errors) / sizeof(errors[0]))
+		return "unknown error";
+	return errors[error_status];
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "../common.h"
+
+/*
+ * SNMP v1/v2c messages in BER
+ *
+ * Requests are encoded into and responses decoded from a caller supplied
+ * buffer, the decoded values point into it. Only the subset of ASN.1 SNMP
+ * uses is understood: definite lengths, the universal types of SMIv2 and
+ * the application types of RFC 2578.
+ */
+
+enum {
+	SNMP_MAX_OID_LENGTH = 128, /* sub-identifiers, as in RFC 2578 */
+	SNMP_MAX_MESSAGE = 65507   /* largest UDP payload */
+};
+
+typedef enum {
+	SNMP_VERSION_1 = 0,
+	SNMP_VERSION_2C = 1
+} snmp_version;
+
+typedef enum {
+	SNMP_INTEGER = 0x02,
+	SNMP_OCTET_STRING = 0x04,
+	SNMP_NULL = 0x05,
+	SNMP_OBJECT_ID = 0x06,
+	SNMP_IP_ADDRESS = 0x40,
+	SNMP_COUNTER32 = 0x41,
+	SNMP_GAUGE32 = 0x42,
+	SNMP_TIMETICKS = 0x43,
+	SNMP_OPAQUE = 0x44,
+	SNMP_COUNTER64 = 0x46,
+	/* exceptions in place of a value, v2c only */
+	SNMP_NO_SUCH_OBJECT = 0x80,
+	SNMP_NO_SUCH_INSTANCE = 0x81,
+	SNMP_END_OF_MIB_VIEW = 0x82
+} snmp_type;
+
+typedef enum {
+	SNMP_PDU_GET = 0xa0,
+	SNMP_PDU_GETNEXT = 0xa1,
+	SNMP_PDU_RESPONSE = 0xa2,
+	SNMP_PDU_GETBULK = 0xa5
+} snmp_pdu_type;
+
+typedef struct {
+	uint32_t ids[SNMP_MAX_OID_LENGTH];
+	size_t length;
+} snmp_oid;
+
+typedef struct {
+	snmp_type type;
+	int64_t integer;      /* INTEGER */
+	uint64_t counter;     /* Counter32, Gauge32, TimeTicks, Counter64 */
+	const uint8_t *bytes; /* OCTET STRING, IpAddress, Opaque */
+	size_t length;
+	snmp_oid oid; /* OBJECT IDENTIFIER */
+} snmp_value;
+
+typedef struct {
+	snmp_oid oid;
+	snmp_value value;
+} snmp_varbind;
+
+typedef struct {
+	snmp_version version;
+	const char *community;
+	size_t community_length;
+	snmp_pdu_type type;
+	int32_t request_id;
+	int32_t error_status; /* non-repeaters of GETBULK */
+	int32_t error_index;  /* max-repetitions of GETBULK */
+	snmp_varbind *varbinds;
+	size_t nof_varbinds;
+} snmp_pdu;
+
+/* Parses a numeric OID like ".1.3.6.1.2.1.1.3.0", false if it is none */
+bool snmp_oid_parse(const char *text, snmp_oid *oid);
+
+/* Formats oid the way net-snmp does without MIBs, "iso.3.6.1.2.1.1.3.0" */
+void snmp_oid_format(const snmp_oid *oid, char *buffer, size_t size);
+
+/* -1, 0 or 1 as a is before, the same as or after b in lexicographic order */
+int snmp_oid_compare(const snmp_oid *a, const snmp_oid *b);
+
+/* Encodes pdu into buffer, returns the length of the message or 0 if it
+ * does not fit. The values of the varbinds are encoded as well, NULL for
+ * requests. */
+size_t snmp_encode(const snmp_pdu *pdu, uint8_t *buffer, size_t size);
+
+/* Decodes a message, at most max_varbinds of its varbinds are stored in
+ * pdu->varbinds. False if the message is malformed. */
+bool snmp_decode(const uint8_t *buffer, size_t length, snmp_pdu *pdu, size_t max_varbinds);
+
+/* Formats a value the way snmpget prints it, "Counter32: 42",
+ * "STRING: \"text\"" or "Timeticks: (4200) 0:00:42.00" */
+void snmp_value_format(const snmp_value *value, char *buffer, size_t size);
+
+/* The value of a number type as a double, false for the others */
+bool snmp_value_number(const snmp_value *value, double *number);
+
+/* The text of an error-status of a response, as net-snmp reports it */
+const char *snmp_error_text(int32_t error_status);
@@ -0,0 +1,427 @@
+#include "./mib.h"
+#include "../utils.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SNMP_MIB_MAGIC "MPMIB001"
+
+/* The file, all of it in the byte order of the host that built it */
+struct snmp_mib_header {
+	char magic[8];
+	uint32_t nof_nodes;
+	uint32_t nof_enums;
+	uint32_t nof_ids;
+	uint32_t strings_size;
+};
+
+struct snmp_mib_node {
+	uint32_t name; /* offsets into the strings */
+	uint32_t type;
+	uint32_t oid; /* first of its ids */
+	uint32_t oid_length;
+	uint32_t enums; /* first of its enums */
+	uint32_t nof_enums;
+};
+
+struct snmp_mib_enum {
+	int32_t value;
+	uint32_t label;
+};
+
+/* The cache while it is built */
+typedef struct {
+	struct snmp_mib_node *nodes;
+	size_t nof_nodes, nodes_size;
+	struct snmp_mib_enum *enums;
+	size_t nof_enums, enums_size;
+	uint32_t *ids;
+	size_t nof_ids, ids_size;
+	char *strings;
+	size_t strings_length, strings_size;
+} snmp_mib_builder;
+
+static void *snmp_mib_grow(void *array, size_t *size, size_t needed, size_t element) {
+	if (needed <= *size)
+		return array;
+	while (*size < needed)
+		*size = *size ? *size * 2 : 1024;
+	array = realloc(array, *size * element);
+	if (array == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	return array;
+}
+
+static uint32_t snmp_mib_string(snmp_mib_builder *builder, const char *text, size_t length) {
+	uint32_t offset = (uint32_t)builder->strings_length;
+
+	builder->strings = snmp_mib_grow(builder->strings, &builder->strings_size, builder->strings_length + length + 1, 1);
+	memcpy(builder->strings + offset, text, length);
+	builder->strings[offset + length] = '\0';
+	builder->strings_length += length + 1;
+	return offset;
+}
+
+/* "label(42)" at text, false if it is none */
+static bool snmp_mib_label(const char **text, const char **label, size_t *length, long *number) {
+	const char *open = *text + strcspn(*text, "( \t,|");
+	char *end;
+
+	if (*open != '(' || open == *text)
+		return false;
+	*label = *text;
+	*length = (size_t)(open - *text);
+	*number = strtol(open + 1, &end, 10);
+	if (end == open + 1 || *end != ')')
+		return false;
+	*text = end + 1;
+	return true;
+}
+
+/* The enumerated values of "Values: up(1), down(2)" and of the lines it
+ * is continued on */
+static void snmp_mib_values(snmp_mib_builder *builder, const char *text) {
+	struct snmp_mib_node *node = &builder->nodes[builder->nof_nodes - 1];
+	const char *label;
+	size_t length;
+	long value;
+
+	for (;;) {
+		text += strspn(text, " \t,|");
+		if (!snmp_mib_label(&text, &label, &length, &value))
+			return;
+		builder->enums = snmp_mib_grow(builder->enums, &builder->enums_size, builder->nof_enums + 1, sizeof(struct snmp_mib_enum));
+		builder->enums[builder->nof_enums++] = (struct snmp_mib_enum){.value = (int32_t)value, .label = snmp_mib_string(builder, label, length)};
+		node->nof_enums++;
+	}
+}
+
+/* A line of the tree, "+--mib-2(1)" or "+-- -R-- Counter   ifInOctets(10)"
+ * indented by three columns per level */
+static void snmp_mib_node(snmp_mib_builder *builder, const char *line, const char *plus, uint32_t *path) {
+	size_t depth = (size_t)(plus - line) / 3;
+	const char *text = plus + 3;
+	const char *type = "";
+	size_t type_length = 0;
+	const char *label;
+	size_t length;
+	long subid;
+	struct snmp_mib_node *node;
+
+	if (depth >= SNMP_MAX_OID_LENGTH)
+		return;
+	if (*text == ' ') {
+		/* access, then the type unless it has none */
+		text += strspn(text, " ");
+		text += strcspn(text, " ");
+		text += strspn(text, " ");
+		if (!snmp_mib_label(&(const char *){text}, &label, &length, &subid)) {
+			type = text;
+			type_length = strcspn(text, " ");
+			text += type_length;
+			text += strspn(text, " ");
+		}
+	}
+	if (!snmp_mib_label(&text, &label, &length, &subid) || subid < 0)
+		return;
+	path[depth] = (uint32_t)subid;
+
+	builder->nodes = snmp_mib_grow(builder->nodes, &builder->nodes_size, builder->nof_nodes + 1, sizeof(struct snmp_mib_node));
+	builder->ids = snmp_mib_grow(builder->ids, &builder->ids_size, builder->nof_ids + depth + 1, sizeof(uint32_t));
+	node = &builder->nodes[builder->nof_nodes++];
+	node->name = snmp_mib_string(builder, label, length);
+	node->type = snmp_mib_string(builder, type, type_length);
+	node->oid = (uint32_t)builder->nof_ids;
+	node->oid_length = (uint32_t)depth + 1;
+	node->enums = (uint32_t)builder->nof_enums;
+	node->nof_enums = 0;
+	memcpy(builder->ids + builder->nof_ids, path, (depth + 1) * sizeof(uint32_t));
+	builder->nof_ids += depth + 1;
+}
+
+/* The cache being built, for the comparisons of qsort() */
+static const struct snmp_mib_node *sort_nodes;
+static const uint32_t *sort_ids;
+static const char *sort_strings;
+
+static int snmp_mib_compare_names(const void *a, const void *b) {
+	const struct snmp_mib_node *x = a;
+	const struct snmp_mib_node *y = b;
+	int order = strcmp(sort_strings + x->name, sort_strings + y->name);
+
+	/* the first of the same name, objects only have one in practice */
+	if (order == 0)
+		return x->oid < y->oid ? -1 : x->oid > y->oid;
+	return order;
+}
+
+static int snmp_mib_compare_ids(const uint32_t *a, size_t a_length, const uint32_t *b, size_t b_length) {
+	for (size_t i = 0; i < a_length && i < b_length; i++) {
+		if (a[i] != b[i])
+			return a[i] < b[i] ? -1 : 1;
+	}
+	if (a_length == b_length)
+		return 0;
+	return a_length < b_length ? -1 : 1;
+}
+
+static int snmp_mib_compare_oids(const void *a, const void *b) {
+	const struct snmp_mib_node *x = &sort_nodes[*(const uint32_t *)a];
+	const struct snmp_mib_node *y = &sort_nodes[*(const uint32_t *)b];
+
+	return snmp_mib_compare_ids(sort_ids + x->oid, x->oid_length, sort_ids + y->oid, y->oid_length);
+}
+
+static bool snmp_mib_write(const void *data, size_t size, FILE *fp) { return size == 0 || fwrite(data, size, 1, fp) == 1; }
+
+bool snmp_mib_cache_build(char **lines, size_t nof_lines, const char *filename, size_t *count) {
+	snmp_mib_builder builder = {0};
+	struct snmp_mib_header header = {.magic = SNMP_MIB_MAGIC};
+	uint32_t path[SNMP_MAX_OID_LENGTH];
+	uint32_t *by_oid;
+	size_t unique = 0;
+	bool in_values = false;
+	char *temporary;
+	FILE *fp;
+	bool written;
+
+	for (size_t l = 0; l < nof_lines; l++) {
+		const char *line = lines[l];
+		const char *plus = strstr(line, "+--");
+		const char *values = strstr(line, "Values: ");
+
+		if (plus != NULL) {
+			snmp_mib_node(&builder, line, plus, path);
+			in_values = false;
+		} else if (values != NULL && builder.nof_nodes > 0) {
+			snmp_mib_values(&builder, values + 8);
+			in_values = true;
+		} else if (in_values && strchr(line, '(') != NULL && strchr(line, ':') == NULL) {
+			snmp_mib_values(&builder, line);
+		} else {
+			in_values = false;
+		}
+	}
+
+	/* by name, without the later objects of the same name */
+	sort_strings = builder.strings;
+	qsort(builder.nodes, builder.nof_nodes, sizeof(struct snmp_mib_node), snmp_mib_compare_names);
+	for (size_t n = 0; n < builder.nof_nodes; n++) {
+		if (unique == 0 || strcmp(builder.strings + builder.nodes[n].name, builder.strings + builder.nodes[unique - 1].name) != 0)
+			builder.nodes[unique++] = builder.nodes[n];
+	}
+	builder.nof_nodes = unique;
+	by_oid = calloc(unique ? unique : 1, sizeof(uint32_t));
+	if (by_oid == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	for (size_t n = 0; n < unique; n++)
+		by_oid[n] = (uint32_t)n;
+	sort_nodes = builder.nodes;
+	sort_ids = builder.ids;
+	qsort(by_oid, unique, sizeof(uint32_t), snmp_mib_compare_oids);
+
+	header.nof_nodes = (uint32_t)unique;
+	header.nof_enums = (uint32_t)builder.nof_enums;
+	header.nof_ids = (uint32_t)builder.nof_ids;
+	header.strings_size = (uint32_t)builder.strings_length;
+
+	/* replaced at once, a check running meanwhile maps either of them */
+	temporary = malloc(strlen(filename) + 32);
+	if (temporary == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	sprintf(temporary, "%s.%ld", filename, (long)getpid());
+	fp = fopen(temporary, "wb");
+	written = fp != NULL && snmp_mib_write(&header, sizeof(header), fp) &&
+			  snmp_mib_write(builder.nodes, unique * sizeof(struct snmp_mib_node), fp) &&
+			  snmp_mib_write(by_oid, unique * sizeof(uint32_t), fp) &&
+			  snmp_mib_write(builder.enums, builder.nof_enums * sizeof(struct snmp_mib_enum), fp) &&
+			  snmp_mib_write(builder.ids, builder.nof_ids * sizeof(uint32_t), fp) &&
+			  snmp_mib_write(builder.strings, builder.strings_length, fp);
+	if (fp != NULL && fclose(fp) != 0)
+		written = false;
+	if (written && rename(temporary, filename) != 0)
+		written = false;
+	if (!written && fp != NULL) {
+		int error = errno;
+
+		unlink(temporary);
+		errno = error;
+	}
+
+	*count = unique;
+	free(temporary);
+	free(by_oid);
+	free(builder.nodes);
+	free(builder.enums);
+	free(builder.ids);
+	free(builder.strings);
+	return written;
+}
+
+/* Whether first and count of an array fit into its length */
+static bool snmp_mib_range(uint32_t first, uint32_t count, uint32_t length) { return count <= length && first <= length - count; }
+
+/* Every offset and length in the cache within the mapped file, so that a
+ * damaged or foreign file cannot make the lookups read past it */
+static bool snmp_mib_cache_valid(const snmp_mib_cache *cache) {
+	const struct snmp_mib_header *header = cache->header;
+
+	if (header->strings_size > 0 && cache->strings[header->strings_size - 1] != '\0')
+		return false;
+	for (uint32_t n = 0; n < header->nof_nodes; n++) {
+		const struct snmp_mib_node *node = &cache->nodes[n];
+
+		if (node->name >= header->strings_size || node->type >= header->strings_size || node->oid_length == 0 ||
+			node->oid_length > SNMP_MAX_OID_LENGTH || !snmp_mib_range(node->oid, node->oid_length, header->nof_ids) ||
+			!snmp_mib_range(node->enums, node->nof_enums, header->nof_enums) || cache->by_oid[n] >= header->nof_nodes)
+			return false;
+	}
+	for (uint32_t e = 0; e < header->nof_enums; e++) {
+		if (cache->enums[e].label >= header->strings_size)
+			return false;
+	}
+	return true;
+}
+
+bool snmp_mib_cache_open(snmp_mib_cache *cache, const char *filename) {
+	int fd = open(filename, O_RDONLY);
+	const struct snmp_mib_header *header;
+	struct stat st;
+	uint64_t size;
+
+	memset(cache, 0, sizeof(*cache));
+	if (fd < 0)
+		return false;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct snmp_mib_header)) {
+		close(fd);
+		errno = EINVAL;
+		return false;
+	}
+	cache->size = (size_t)st.st_size;
+	cache->map = mmap(NULL, cache->size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (cache->map == MAP_FAILED) {
+		cache->map = NULL;
+		return false;
+	}
+
+	header = (const struct snmp_mib_header *)cache->map;
+	/* cannot overflow with counts of 32 bits */
+	size = sizeof(*header) + (uint64_t)header->nof_nodes * (sizeof(struct snmp_mib_node) + sizeof(uint32_t)) +
+		   (uint64_t)header->nof_enums * sizeof(struct snmp_mib_enum) + (uint64_t)header->nof_ids * sizeof(uint32_t) + header->strings_size;
+	if (memcmp(header->magic, SNMP_MIB_MAGIC, sizeof(header->magic)) != 0 || size != cache->size) {
+		snmp_mib_cache_close(cache);
+		errno = EINVAL;
+		return false;
+	}
+	cache->header = header;
+	cache->nodes = (const struct snmp_mib_node *)(header + 1);
+	cache->by_oid = (const uint32_t *)(cache->nodes + header->nof_nodes);
+	cache->enums = (const struct snmp_mib_enum *)(cache->by_oid + header->nof_nodes);
+	cache->ids = (const uint32_t *)(cache->enums + header->nof_enums);
+	cache->strings = (const char *)(cache->ids + header->nof_ids);
+	if (!snmp_mib_cache_valid(cache)) {
+		snmp_mib_cache_close(cache);
+		errno = EINVAL;
+		return false;
+	}
+	return true;
+}
+
+void snmp_mib_cache_close(snmp_mib_cache *cache) {
+	if (cache->map != NULL)
+		munmap(cache->map, cache->size);
+	memset(cache, 0, sizeof(*cache));
+}
+
+/* The object of a name of length characters */
+static const struct snmp_mib_node *snmp_mib_find_name(const snmp_mib_cache *cache, const char *name, size_t length) {
+	size_t low = 0;
+	size_t high = cache->header->nof_nodes;
+
+	while (low < high) {
+		size_t middle = low + (high - low) / 2;
+		const char *other = cache->strings + cache->nodes[middle].name;
+		int order = strncmp(other, name, length);
+
+		if (order == 0 && other[length] != '\0')
+			order = 1;
+		if (order == 0)
+			return &cache->nodes[middle];
+		if (order < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return NULL;
+}
+
+/* The object of oid or of the longest prefix of it */
+static const struct snmp_mib_node *snmp_mib_find_oid(const snmp_mib_cache *cache, const snmp_oid *oid) {
+	for (size_t length = oid->length; length > 0; length--) {
+		size_t low = 0;
+		size_t high = cache->header->nof_nodes;
+
+		while (low < high) {
+			size_t middle = low + (high - low) / 2;
+			const struct snmp_mib_node *node = &cache->nodes[cache->by_oid[middle]];
+			int order = snmp_mib_compare_ids(cache->ids + node->oid, node->oid_length, oid->ids, length);
+
+			if (order == 0)
+				return node;
+			if (order < 0)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+	}
+	return NULL;
+}
+
+bool snmp_mib_cache_translate(const snmp_mib_cache *cache, const char *name, snmp_oid *oid) {
+	const struct snmp_mib_node *node;
+	const char *module = strstr(name, "::");
+	size_t length;
+
+	if (snmp_oid_parse(name, oid))
+		return true;
+	if (cache->header == NULL)
+		return false;
+	if (module != NULL)
+		name = module + 2;
+	length = strcspn(name, ".");
+	node = snmp_mib_find_name(cache, name, length);
+	if (node == NULL)
+		return false;
+
+	/* the instance after the name */
+	memcpy(oid->ids, cache->ids + node->oid, node->oid_length * sizeof(uint32_t));
+	oid->length = node->oid_length;
+	for (name += length; *name == '.'; oid->length++) {
+		char *end;
+		unsigned long long id = strtoull(name + 1, &end, 10);
+
+		if (end == name + 1 || id > UINT32_MAX || oid->length == SNMP_MAX_OID_LENGTH)
+			return false;
+		oid->ids[oid->length] = (uint32_t)id;
+		name = end;
+	}
+	return *name == '\0';
+}
+
+const char *snmp_mib_cache_type(const snmp_mib_cache *cache, const snmp_oid *oid) {
+	const struct snmp_mib_node *node = cache->header ? snmp_mib_find_oid(cache, oid) : NULL;
+
+	return node ? cache->strings + node->type : NULL;
+}
+
+const char *snmp_mib_cache_enum(const snmp_mib_cache *cache, const snmp_oid *oid, int64_t value) {
+	const struct snmp_mib_node *node = cache->header ? snmp_mib_find_oid(cache, oid) : NULL;
+
+	for (uint32_t e = 0; node != NULL && e < node->nof_enums; e++) {
+		if (cache->enums[node->enums + e].value == value)
+			return cache->strings + cache->enums[node->enums + e].label;
+	}
+	return NULL;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../common.h"
+#include "./ber.h"
+
+/*
+ * Names of MIB objects without parsing MIBs
+ *
+ * The cache is built once from the MIB tree as "snmptranslate -Tp" prints
+ * it, and holds the name, OID, type and enumerated values of every object.
+ * It is mapped into memory as it is, names are found by binary search of
+ * the objects sorted by name and the objects of OIDs by that of the
+ * objects sorted by OID.
+ */
+
+typedef struct {
+	uint8_t *map;
+	size_t size;
+	const struct snmp_mib_header *header;
+	const struct snmp_mib_node *nodes;    /* sorted by name */
+	const uint32_t *by_oid;               /* nodes sorted by OID */
+	const struct snmp_mib_enum *enums;
+	const uint32_t *ids;
+	const char *strings;
+} snmp_mib_cache;
+
+/* Writes the cache of the tree in lines to filename, the number of its
+ * objects in count. False with errno set if it could not be written. */
+bool snmp_mib_cache_build(char **lines, size_t nof_lines, const char *filename, size_t *count);
+
+/* Maps the cache of filename, false with errno set if it is none */
+bool snmp_mib_cache_open(snmp_mib_cache *cache, const char *filename);
+void snmp_mib_cache_close(snmp_mib_cache *cache);
+
+/* Translates "ifInOctets.1", "IF-MIB::ifInOctets.1" or a numeric OID into
+ * oid, false if the name is not in the cache */
+bool snmp_mib_cache_translate(const snmp_mib_cache *cache, const char *name, snmp_oid *oid);
+
+/* The type of the object of oid or of its instance, as snmptranslate names
+ * it ("Counter64", "EnumVal"), NULL if it is not in the cache */
+const char *snmp_mib_cache_type(const snmp_mib_cache *cache, const snmp_oid *oid);
+
+/* The label of value of the enumerated object of oid or of its instance,
+ * "up" for ifOperStatus.1 and 1, NULL if there is none */
+const char *snmp_mib_cache_enum(const snmp_mib_cache *cache, const snmp_oid *oid, int64_t value);
@@ -0,0 +1,273 @@
+#include "./poller.h"
+#include "../utils.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+
+/* Large enough for the responses of a whole window arriving at once */
+#define SNMP_POLL_RECEIVE_BUFFER (4 * 1024 * 1024)
+
+void snmp_poller_add(snmp_poller *poller, const char *host) {
+	if (poller->nof_targets == poller->size) {
+		poller->size = poller->size ? poller->size * 2 : 64;
+		poller->targets = realloc(poller->targets, poller->size * sizeof(snmp_target));
+		if (poller->targets == NULL)
+			die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	}
+	memset(&poller->targets[poller->nof_targets], 0, sizeof(snmp_target));
+	poller->targets[poller->nof_targets++].host = host;
+}
+
+void snmp_poller_free(snmp_poller *poller) {
+	for (size_t i = 0; i < poller->nof_targets; i++) {
+		free(poller->targets[i].message);
+		free(poller->targets[i].response.varbinds);
+	}
+	free(poller->targets);
+	poller->targets = NULL;
+	poller->nof_targets = poller->size = 0;
+}
+
+static int snmp_poll_socket(int family) {
+	int fd = socket(family, SOCK_DGRAM, 0);
+	int size = SNMP_POLL_RECEIVE_BUFFER;
+
+	if (fd < 0)
+		return -1;
+	/* the kernel limit may be lower, that only costs retries */
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	return fd;
+}
+
+static void snmp_poll_close(const int *fds) {
+	for (int family = 0; family < 2; family++) {
+		if (fds[family] >= 0)
+			close(fds[family]);
+	}
+}
+
+static bool snmp_same_address(const struct sockaddr_storage *a, const struct sockaddr_storage *b) {
+	if (a->ss_family != b->ss_family)
+		return false;
+	if (a->ss_family == AF_INET) {
+		const struct sockaddr_in *x = (const struct sockaddr_in *)a;
+		const struct sockaddr_in *y = (const struct sockaddr_in *)b;
+
+		return x->sin_port == y->sin_port && x->sin_addr.s_addr == y->sin_addr.s_addr;
+	}
+	if (a->ss_family == AF_INET6) {
+		const struct sockaddr_in6 *x = (const struct sockaddr_in6 *)a;
+		const struct sockaddr_in6 *y = (const struct sockaddr_in6 *)b;
+
+		return x->sin6_port == y->sin6_port && memcmp(&x->sin6_addr, &y->sin6_addr, sizeof(x->sin6_addr)) == 0;
+	}
+	return false;
+}
+
+static bool snmp_resolve(snmp_target *target, int family, const char *port) {
+	struct addrinfo hints = {.ai_family = family, .ai_socktype = SOCK_DGRAM};
+	struct addrinfo *addresses;
+	char *host = strdup(target->host);
+	char *colon;
+
+	/* host:port, unless it is an IPv6 address */
+	if (host == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	colon = strrchr(host, ':');
+	if (colon != NULL && strchr(host, ':') == colon) {
+		*colon = '\0';
+		port = colon + 1;
+	}
+	if (getaddrinfo(host, port, &hints, &addresses) != 0) {
+		free(host);
+		return false;
+	}
+	memcpy(&target->address, addresses->ai_addr, addresses->ai_addrlen);
+	target->address_length = addresses->ai_addrlen;
+	freeaddrinfo(addresses);
+	free(host);
+	return true;
+}
+
+static double snmp_seconds(const struct timespec *from, const struct timespec *to) {
+	return (double)(to->tv_sec - from->tv_sec) + (double)(to->tv_nsec - from->tv_nsec) / 1.0e9;
+}
+
+/* Sends an attempt, false if it could not be sent */
+static bool snmp_poll_send(snmp_target *target, const int *fds, snmp_pdu *pdu, int32_t request_id, int timeout, const struct timespec *now) {
+	uint8_t message[SNMP_MAX_MESSAGE];
+	size_t length;
+
+	pdu->request_id = request_id;
+	length = snmp_encode(pdu, message, sizeof(message));
+	if (length == 0 || sendto(fds[target->address.ss_family == AF_INET6], message, length, 0, (struct sockaddr *)&target->address,
+							  target->address_length) < 0) {
+		target->state = SNMP_TARGET_FAILED;
+		target->error = length == 0 ? _("Request too large") : strerror(errno);
+		return false;
+	}
+	target->state = SNMP_TARGET_SENT;
+	target->attempts++;
+	target->deadline = *now;
+	target->deadline.tv_sec += timeout;
+	return true;
+}
+
+static bool snmp_poll_expired(const snmp_poller *poller, const struct timespec *now) {
+	return poller->deadline.tv_sec != 0 && snmp_seconds(&poller->deadline, now) >= 0;
+}
+
+bool snmp_poller_run(snmp_poller *poller, const snmp_pdu *request, size_t max_varbinds) {
+	static uint8_t buffer[SNMP_MAX_MESSAGE];
+	int fds[2] = {-1, -1}; /* IPv4, IPv6 */
+	snmp_pdu pdu = *request;
+	snmp_pdu response = {0}; /* only its header, to match it */
+	struct timespec now;
+	int32_t base;
+	size_t next = 0;
+	size_t outstanding = 0;
+	size_t remaining = poller->nof_targets;
+
+	for (size_t i = 0; i < poller->nof_targets; i++) {
+		snmp_target *target = &poller->targets[i];
+		int *fd;
+
+		/* the lookups one after the other count against the deadline too */
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (snmp_poll_expired(poller, &now)) {
+			target->state = SNMP_TARGET_FAILED;
+			target->error = _("Timeout: Not queried");
+			remaining--;
+			continue;
+		}
+		if (!snmp_resolve(target, poller->family, poller->port)) {
+			target->state = SNMP_TARGET_FAILED;
+			target->error = _("Invalid hostname/address");
+			remaining--;
+			continue;
+		}
+		fd = &fds[target->address.ss_family == AF_INET6];
+		if (*fd < 0 && (*fd = snmp_poll_socket(target->address.ss_family)) < 0) {
+			snmp_poll_close(fds);
+			return false;
+		}
+	}
+
+	/* the request id tells the agents apart */
+	clock_gettime(CLOCK_REALTIME, &now);
+	base = (int32_t)((now.tv_nsec ^ (getpid() << 12)) & 0x3fffffff);
+	pdu.version = poller->version;
+	pdu.community = poller->community;
+	pdu.community_length = strlen(poller->community);
+
+	while (remaining > 0) {
+		struct pollfd pfds[2];
+		nfds_t nfds = 0;
+		long wait = -1;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (snmp_poll_expired(poller, &now)) {
+			for (size_t i = 0; i < poller->nof_targets; i++) {
+				snmp_target *target = &poller->targets[i];
+
+				if (target->state == SNMP_TARGET_SENT || target->state == SNMP_TARGET_QUEUED) {
+					target->error = target->state == SNMP_TARGET_SENT ? _("Timeout: No Response") : _("Timeout: Not queried");
+					target->state = SNMP_TARGET_FAILED;
+				}
+			}
+			break;
+		}
+		/* retries that are due */
+		for (size_t i = 0; i < poller->nof_targets; i++) {
+			snmp_target *target = &poller->targets[i];
+
+			if (target->state != SNMP_TARGET_SENT || snmp_seconds(&target->deadline, &now) < 0)
+				continue;
+			if (target->attempts > poller->retries) {
+				target->state = SNMP_TARGET_FAILED;
+				target->error = _("Timeout: No Response");
+			} else if (snmp_poll_send(target, fds, &pdu, base + (int32_t)i, poller->timeout, &now)) {
+				continue;
+			}
+			outstanding--;
+			remaining--;
+		}
+		/* new requests while the window has room */
+		for (; next < poller->nof_targets && outstanding < SNMP_POLL_WINDOW; next++) {
+			snmp_target *target = &poller->targets[next];
+
+			if (target->state != SNMP_TARGET_QUEUED)
+				continue;
+			if (snmp_poll_send(target, fds, &pdu, base + (int32_t)next, poller->timeout, &now))
+				outstanding++;
+			else
+				remaining--;
+		}
+
+		/* sleep until the next deadline */
+		for (size_t i = 0; i < poller->nof_targets; i++) {
+			const snmp_target *target = &poller->targets[i];
+			long left;
+
+			if (target->state != SNMP_TARGET_SENT)
+				continue;
+			left = (long)(snmp_seconds(&now, &target->deadline) * 1000) + 1;
+			if (wait < 0 || left < wait)
+				wait = left < 0 ? 0 : left;
+		}
+		if (poller->deadline.tv_sec != 0) {
+			long left = (long)(snmp_seconds(&now, &poller->deadline) * 1000) + 1;
+
+			if (wait < 0 || left < wait)
+				wait = left < 0 ? 0 : left;
+		}
+		if (remaining == 0)
+			break;
+		for (int family = 0; family < 2; family++) {
+			if (fds[family] >= 0)
+				pfds[nfds++] = (struct pollfd){.fd = fds[family], .events = POLLIN};
+		}
+		if (poll(pfds, nfds, (int)wait) <= 0)
+			continue;
+
+		for (nfds_t p = 0; p < nfds; p++) {
+			struct sockaddr_storage from;
+			socklen_t from_length = sizeof(from);
+			ssize_t received;
+
+			while ((received = recvfrom(pfds[p].fd, buffer, sizeof(buffer), 0, (struct sockaddr *)&from, &from_length)) >= 0) {
+				snmp_target *target;
+				uint32_t index;
+
+				from_length = sizeof(from);
+				if (!snmp_decode(buffer, (size_t)received, &response, 0) || response.type != SNMP_PDU_RESPONSE)
+					continue;
+				index = (uint32_t)response.request_id - (uint32_t)base;
+				if (index >= poller->nof_targets)
+					continue;
+				target = &poller->targets[index];
+				if (target->state != SNMP_TARGET_SENT || !snmp_same_address(&target->address, &from))
+					continue;
+
+				/* keep the message, the buffer is reused */
+				target->message = malloc((size_t)received);
+				target->response.varbinds = calloc(max_varbinds ? max_varbinds : 1, sizeof(snmp_varbind));
+				if (target->message == NULL || target->response.varbinds == NULL)
+					die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+				memcpy(target->message, buffer, (size_t)received);
+				snmp_decode(target->message, (size_t)received, &target->response, max_varbinds);
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				target->seconds = poller->timeout - snmp_seconds(&now, &target->deadline);
+				target->state = SNMP_TARGET_ANSWERED;
+				outstanding--;
+				remaining--;
+			}
+		}
+	}
+
+	snmp_poll_close(fds);
+	return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../common.h"
+#include "./ber.h"
+
+#include <sys/socket.h>
+#include <time.h>
+
+/*
+ * The same request to many agents at once
+ *
+ * All requests go out over one UDP socket per address family and the
+ * responses are matched to their agents by request id and source address.
+ * Every agent has its own timeout and retries, a run takes about as long
+ * as the slowest agent rather than the sum of all of them, and no longer
+ * than up to the deadline of the poller if it has one.
+ */
+
+enum {
+	SNMP_POLL_WINDOW = 512 /* requests awaiting a response at a time */
+};
+
+typedef enum {
+	SNMP_TARGET_QUEUED,
+	SNMP_TARGET_SENT,
+	SNMP_TARGET_ANSWERED,
+	SNMP_TARGET_FAILED
+} snmp_target_state;
+
+typedef struct {
+	const char *host;
+	struct sockaddr_storage address;
+	socklen_t address_length;
+	snmp_target_state state;
+	const char *error; /* why it failed */
+	int attempts;
+	struct timespec deadline; /* of the current attempt */
+	uint8_t *message;         /* the response, response.varbinds point into it */
+	snmp_pdu response;
+	double seconds; /* round trip of the answered attempt */
+} snmp_target;
+
+typedef struct {
+	snmp_version version;
+	const char *community;
+	int timeout; /* seconds per attempt */
+	int retries;
+	int family;       /* AF_INET, AF_INET6 or AF_UNSPEC */
+	const char *port; /* unless a host is given as host:port */
+	struct timespec deadline; /* CLOCK_MONOTONIC, of the whole run, none if zero */
+	snmp_target *targets;
+	size_t nof_targets;
+	size_t size;
+} snmp_poller;
+
+/* Adds an agent, the host is not copied */
+void snmp_poller_add(snmp_poller *poller, const char *host);
+
+/* Sends request to every agent and waits for all of them to answer or to
+ * time out. The agents that did not answer by the deadline, or were not
+ * even resolved or asked by then, fail. The varbinds of each response are
+ * limited to max_varbinds. False if no socket could be opened. */
+bool snmp_poller_run(snmp_poller *poller, const snmp_pdu *request, size_t max_varbinds);
+
+void snmp_poller_free(snmp_poller *poller);
@@ -0,0 +1,168 @@
+#include "./rate.h"
+#include "../utils.h"
+
+#include <inttypes.h>
+#include <math.h>
+
+/* The letters of the kinds in the state */
+static const char snmp_rate_letters[] = {'g', 'c', 'C'};
+
+void snmp_rate_add(snmp_rate_state *state, const char *key, snmp_rate_kind kind, uint64_t value) {
+	if (state->nof_samples == state->size) {
+		state->size = state->size ? state->size * 2 : 16;
+		state->samples = realloc(state->samples, state->size * sizeof(snmp_rate_sample));
+		if (state->samples == NULL)
+			die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	}
+	state->samples[state->nof_samples].key = strdup(key);
+	if (state->samples[state->nof_samples].key == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	state->samples[state->nof_samples].kind = kind;
+	state->samples[state->nof_samples++].value = value;
+	state->sorted = false;
+}
+
+void snmp_rate_free(snmp_rate_state *state) {
+	for (size_t s = 0; s < state->nof_samples; s++)
+		free(state->samples[s].key);
+	free(state->samples);
+	memset(state, 0, sizeof(*state));
+}
+
+char *snmp_rate_format(const snmp_rate_state *state) {
+	size_t size = 32;
+	size_t length;
+	char *text;
+
+	for (size_t s = 0; s < state->nof_samples; s++)
+		size += strlen(state->samples[s].key) + 24;
+	text = malloc(size);
+	if (text == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	text[0] = '\0';
+	length = 0;
+	if (state->has_uptime)
+		length += (size_t)sprintf(text, "uptime=%" PRIu64, state->uptime);
+	for (size_t s = 0; s < state->nof_samples; s++) {
+		const snmp_rate_sample *sample = &state->samples[s];
+
+		if (sample->kind == SNMP_RATE_GAUGE)
+			length += (size_t)sprintf(text + length, "%s%s=g%" PRId64, length ? " " : "", sample->key, (int64_t)sample->value);
+		else
+			length += (size_t)sprintf(text + length, "%s%s=%c%" PRIu64, length ? " " : "", sample->key, snmp_rate_letters[sample->kind],
+									  sample->value);
+	}
+	return text;
+}
+
+static int snmp_rate_compare(const void *a, const void *b) {
+	return strcmp(((const snmp_rate_sample *)a)->key, ((const snmp_rate_sample *)b)->key);
+}
+
+bool snmp_rate_parse(snmp_rate_state *state, const char *text, time_t time) {
+	char *copy = strdup(text);
+	char *rest = copy;
+	char *entry;
+
+	if (copy == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	memset(state, 0, sizeof(*state));
+	state->time = time;
+	while ((entry = strsep(&rest, " ")) != NULL) {
+		char *equals = strchr(entry, '=');
+		const char *letter;
+		char *end;
+
+		if (equals == NULL || equals == entry)
+			continue;
+		*equals = '\0';
+		if (strcmp(entry, "uptime") == 0) {
+			state->uptime = strtoull(equals + 1, &end, 10);
+			state->has_uptime = *end == '\0' && end > equals + 1;
+		} else if (equals[1] != '\0' && (letter = memchr(snmp_rate_letters, equals[1], sizeof(snmp_rate_letters))) != NULL) {
+			snmp_rate_kind kind = (snmp_rate_kind)(letter - snmp_rate_letters);
+			uint64_t value = kind == SNMP_RATE_GAUGE ? (uint64_t)strtoll(equals + 2, &end, 10) : strtoull(equals + 2, &end, 10);
+
+			if (*end == '\0' && end > equals + 2)
+				snmp_rate_add(state, entry, kind, value);
+		}
+	}
+	free(copy);
+	qsort(state->samples, state->nof_samples, sizeof(snmp_rate_sample), snmp_rate_compare);
+	state->sorted = true;
+	return state->has_uptime || state->nof_samples > 0;
+}
+
+bool snmp_rate_value(const char *text, snmp_rate_kind *kind, uint64_t *value) {
+	const char *number;
+	char *end;
+
+	if (strstr(text, "Counter32: ") != NULL) {
+		*kind = SNMP_RATE_COUNTER32;
+		number = strstr(text, "Counter32: ") + 11;
+	} else if (strstr(text, "Counter64: ") != NULL) {
+		*kind = SNMP_RATE_COUNTER64;
+		number = strstr(text, "Counter64: ") + 11;
+	} else {
+		*kind = SNMP_RATE_GAUGE;
+		number = strpbrk(strstr(text, ": ") ? strstr(text, ": ") : text, "-0123456789");
+		if (number == NULL)
+			return false;
+		*value = (uint64_t)strtoll(number, &end, 10);
+		return end > number;
+	}
+	*value = strtoull(number, &end, 10);
+	return end > number && *number != '-';
+}
+
+/* The seconds that passed for the agent, or by the clock if its uptime is
+ * not known. The agent restarted meanwhile if its uptime grew by less than
+ * the time that passed, after 497 days it wraps around instead. */
+static snmp_rate_result snmp_rate_seconds(const snmp_rate_state *previous, const snmp_rate_state *current, double *seconds) {
+	double clock = difftime(current->time, previous->time);
+
+	*seconds = clock;
+	if (previous->has_uptime && current->has_uptime) {
+		if (current->uptime >= previous->uptime)
+			*seconds = (double)(current->uptime - previous->uptime) / 100.0;
+		else
+			*seconds = (double)(UINT32_MAX - previous->uptime + current->uptime + 1) / 100.0;
+		if (fabs(*seconds - clock) > fmax(5.0, clock / 10.0))
+			return SNMP_RATE_RESET;
+	}
+	return *seconds > 0 ? SNMP_RATE_VALID : SNMP_RATE_NO_TIME;
+}
+
+snmp_rate_result snmp_rate(snmp_rate_state *previous, const snmp_rate_state *current, const snmp_rate_sample *sample, double *rate) {
+	const snmp_rate_sample *last;
+	snmp_rate_result result;
+	double seconds;
+	double delta;
+
+	if (!previous->sorted) {
+		qsort(previous->samples, previous->nof_samples, sizeof(snmp_rate_sample), snmp_rate_compare);
+		previous->sorted = true;
+	}
+	last = bsearch(sample, previous->samples, previous->nof_samples, sizeof(snmp_rate_sample), snmp_rate_compare);
+	if (last == NULL || last->kind != sample->kind)
+		return SNMP_RATE_NO_PREVIOUS;
+	result = snmp_rate_seconds(previous, current, &seconds);
+	if (result != SNMP_RATE_VALID)
+		return result;
+
+	switch (sample->kind) {
+	case SNMP_RATE_COUNTER32:
+		/* in 32 bits, so that it wraps around as the counter does */
+		delta = (double)(uint32_t)((uint32_t)sample->value - (uint32_t)last->value);
+		break;
+	case SNMP_RATE_COUNTER64:
+		if (sample->value < last->value)
+			return SNMP_RATE_RESET;
+		delta = (double)(sample->value - last->value);
+		break;
+	default:
+		delta = (double)((int64_t)sample->value - (int64_t)last->value);
+	}
+	*rate = delta / seconds;
+	return SNMP_RATE_VALID;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../common.h"
+
+#include <time.h>
+
+/*
+ * Rates of counters between two runs
+ *
+ * The samples of a run are kept in the state file as exact integers, with
+ * the uptime of the agent, so that a Counter64 keeps all of its bits. The
+ * rate is taken over the time that passed for the agent when its uptime is
+ * known. A Counter32 that is lower than before wrapped around, a lower
+ * Counter64 was reset and so was every sample after the agent restarted:
+ * there is no rate for them rather than a wrong one.
+ */
+
+#define SNMP_RATE_UPTIME_OID "1.3.6.1.2.1.1.3.0" /* sysUpTime.0 */
+
+typedef enum {
+	SNMP_RATE_GAUGE, /* Gauge32, INTEGER and TimeTicks, their difference */
+	SNMP_RATE_COUNTER32,
+	SNMP_RATE_COUNTER64
+} snmp_rate_kind;
+
+typedef struct {
+	char *key;
+	snmp_rate_kind kind;
+	uint64_t value; /* of a gauge as int64_t */
+} snmp_rate_sample;
+
+typedef struct {
+	time_t time;
+	bool has_uptime;
+	uint64_t uptime; /* of the agent, in hundredths of a second */
+	snmp_rate_sample *samples;
+	size_t nof_samples;
+	size_t size;
+	bool sorted; /* by key, to be found */
+} snmp_rate_state;
+
+typedef enum {
+	SNMP_RATE_VALID,
+	SNMP_RATE_NO_PREVIOUS, /* a new sample */
+	SNMP_RATE_RESET,       /* the counter or the agent started again */
+	SNMP_RATE_NO_TIME      /* none has passed since the previous run */
+} snmp_rate_result;
+
+void snmp_rate_add(snmp_rate_state *state, const char *key, snmp_rate_kind kind, uint64_t value);
+
+/* The samples of state as "uptime=4200 0=c17 1=C18446744073709551615" */
+char *snmp_rate_format(const snmp_rate_state *state);
+
+/* Reads the samples of snmp_rate_format(), false if text is none */
+bool snmp_rate_parse(snmp_rate_state *state, const char *text, time_t time);
+
+/* The value of a sample from the text snmpget prints for it, "Counter64:
+ * 42" or "Timeticks: (4200) 0:00:42.00". False if it has no number. */
+bool snmp_rate_value(const char *text, snmp_rate_kind *kind, uint64_t *value);
+
+/* The rate per second of the sample of current since the one of the same
+ * key in previous */
+snmp_rate_result snmp_rate(snmp_rate_state *previous, const snmp_rate_state *current, const snmp_rate_sample *sample, double *rate);
+
+void snmp_rate_free(snmp_rate_state *state);
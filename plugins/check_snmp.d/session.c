@@ -0,0 +1,112 @@
+#include "./session.h"
+
+#include <netdb.h>
+#include <poll.h>
+#include <time.h>
+
+bool snmp_session_open(snmp_session *session, const char *host, const char *port, int family) {
+	struct addrinfo hints = {.ai_family = family, .ai_socktype = SOCK_DGRAM};
+	struct addrinfo *addresses;
+	struct timespec now;
+
+	session->fd = -1;
+	session->error = NULL;
+	if (getaddrinfo(host, port, &hints, &addresses) != 0) {
+		session->error = _("Invalid hostname/address");
+		return false;
+	}
+	for (struct addrinfo *address = addresses; address != NULL && session->fd < 0; address = address->ai_next) {
+		session->fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		if (session->fd >= 0 && connect(session->fd, address->ai_addr, address->ai_addrlen) != 0) {
+			close(session->fd);
+			session->fd = -1;
+		}
+	}
+	freeaddrinfo(addresses);
+	if (session->fd < 0) {
+		session->error = strerror(errno);
+		return false;
+	}
+
+	/* request ids of consecutive runs should not repeat */
+	clock_gettime(CLOCK_REALTIME, &now);
+	session->request_id = (int32_t)((now.tv_nsec ^ (getpid() << 16)) & 0x3fffffff);
+	return true;
+}
+
+void snmp_session_close(snmp_session *session) {
+	if (session->fd >= 0)
+		close(session->fd);
+	session->fd = -1;
+}
+
+static long snmp_elapsed_ms(const struct timespec *start) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+/* Milliseconds until the deadline of the session, at most limit */
+static long snmp_session_left(const snmp_session *session, long limit) {
+	struct timespec now;
+	long left;
+
+	if (session->deadline.tv_sec == 0)
+		return limit;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	left = (session->deadline.tv_sec - now.tv_sec) * 1000 + (session->deadline.tv_nsec - now.tv_nsec) / 1000000;
+	return left < limit ? left : limit;
+}
+
+bool snmp_session_request(snmp_session *session, snmp_pdu *request, snmp_pdu *response, size_t max_varbinds) {
+	uint8_t message[SNMP_MAX_MESSAGE];
+	size_t length;
+
+	session->expired = false;
+
+	request->version = session->version;
+	request->community = session->community;
+	request->community_length = strlen(session->community);
+	request->request_id = session->request_id = (session->request_id + 1) & 0x7fffffff;
+	length = snmp_encode(request, message, sizeof(message));
+	if (length == 0) {
+		session->error = _("Request too large");
+		return false;
+	}
+
+	for (int attempt = 0; attempt <= session->retries; attempt++) {
+		struct timespec sent;
+		long left;
+
+		if (snmp_session_left(session, 1) <= 0)
+			break;
+		if (send(session->fd, message, length, 0) < 0) {
+			session->error = strerror(errno);
+			return false;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &sent);
+		while ((left = snmp_session_left(session, session->timeout * 1000L - snmp_elapsed_ms(&sent))) > 0) {
+			struct pollfd pfd = {.fd = session->fd, .events = POLLIN};
+			ssize_t received;
+
+			if (poll(&pfd, 1, (int)left) <= 0)
+				continue;
+			received = recv(session->fd, session->buffer, sizeof(session->buffer), 0);
+			if (received < 0) {
+				/* ICMP port unreachable of an earlier attempt */
+				if (errno == ECONNREFUSED) {
+					session->error = strerror(errno);
+					return false;
+				}
+				continue;
+			}
+			if (snmp_decode(session->buffer, (size_t)received, response, max_varbinds) && response->type == SNMP_PDU_RESPONSE &&
+				response->request_id == request->request_id)
+				return true;
+		}
+	}
+	session->expired = snmp_session_left(session, 1) <= 0;
+	session->error = _("Timeout: No Response");
+	return false;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../common.h"
+#include "./ber.h"
+
+#include <sys/socket.h>
+#include <time.h>
+
+/*
+ * Requests to one SNMP agent over UDP
+ *
+ * A request is sent again when no response came within the timeout, as
+ * often as there are retries. Responses to other requests, from earlier
+ * attempts or other agents, are dropped. No attempt waits past the
+ * deadline of the session, if it has one.
+ */
+
+typedef struct {
+	int fd;
+	snmp_version version;
+	const char *community;
+	int timeout; /* seconds per attempt */
+	int retries;
+	struct timespec deadline; /* CLOCK_MONOTONIC, of all requests, none if zero */
+	bool expired;             /* the last request failed at the deadline */
+	int32_t request_id; /* of the last request */
+	const char *error;  /* why the last call failed */
+	uint8_t buffer[SNMP_MAX_MESSAGE];
+} snmp_session;
+
+/* Resolves host and connects to port of it, family is AF_INET, AF_INET6 or
+ * AF_UNSPEC */
+bool snmp_session_open(snmp_session *session, const char *host, const char *port, int family);
+void snmp_session_close(snmp_session *session);
+
+/* Sends request with the version and community of the session and waits
+ * for the response. Its varbinds, at most max_varbinds, point into the
+ * buffer of the session until the next request. */
+bool snmp_session_request(snmp_session *session, snmp_pdu *request, snmp_pdu *response, size_t max_varbinds);
@@ -0,0 +1,230 @@
+#include "./table.h"
+#include "../utils.h"
+
+/* error-status of a response, RFC 3416 */
+#define SNMP_ERROR_TOO_BIG      1
+#define SNMP_ERROR_NO_SUCH_NAME 2
+
+void snmp_table_init(snmp_table *table, const snmp_oid *columns, size_t nof_columns) {
+	memset(table, 0, sizeof(*table));
+	table->columns = columns;
+	table->nof_columns = nof_columns;
+}
+
+void snmp_table_free(snmp_table *table) {
+	for (size_t r = 0; r < table->nof_rows; r++) {
+		for (size_t c = 0; c < table->nof_columns; c++) {
+			free(table->rows[r].cells[c].text);
+			free(table->rows[r].cells[c].value);
+		}
+		free(table->rows[r].cells);
+		free(table->rows[r].index);
+	}
+	free(table->rows);
+	table->rows = NULL;
+	table->nof_rows = table->size = 0;
+}
+
+void snmp_table_index_format(const snmp_row *row, char *buffer, size_t size) {
+	size_t used = 0;
+
+	buffer[0] = '\0';
+	for (size_t i = 0; i < row->index_length && used < size; i++)
+		used += (size_t)snprintf(buffer + used, size - used, i == 0 ? "%u" : ".%u", row->index[i]);
+}
+
+static bool snmp_table_in_column(const snmp_table *table, size_t column, const snmp_oid *oid) {
+	const snmp_oid *prefix = &table->columns[column];
+
+	return oid->length > prefix->length && memcmp(oid->ids, prefix->ids, prefix->length * sizeof(uint32_t)) == 0;
+}
+
+static int snmp_table_index_compare(const snmp_row *row, const uint32_t *index, size_t length) {
+	for (size_t i = 0; i < row->index_length && i < length; i++) {
+		if (row->index[i] != index[i])
+			return row->index[i] < index[i] ? -1 : 1;
+	}
+	if (row->index_length == length)
+		return 0;
+	return row->index_length < length ? -1 : 1;
+}
+
+/* The row of an index, a new one where it belongs if there is none. The
+ * columns come in the order of the index, so that is mostly at the end. */
+static snmp_row *snmp_table_row(snmp_table *table, const uint32_t *index, size_t length) {
+	size_t low = 0;
+	size_t high = table->nof_rows;
+	snmp_row *row;
+
+	if (table->nof_rows > 0 && snmp_table_index_compare(&table->rows[table->nof_rows - 1], index, length) < 0) {
+		low = table->nof_rows;
+	} else {
+		while (low < high) {
+			size_t middle = low + (high - low) / 2;
+			int order = snmp_table_index_compare(&table->rows[middle], index, length);
+
+			if (order == 0)
+				return &table->rows[middle];
+			if (order < 0)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+	}
+
+	if (table->nof_rows == table->size) {
+		table->size = table->size ? table->size * 2 : 64;
+		table->rows = realloc(table->rows, table->size * sizeof(snmp_row));
+		if (table->rows == NULL)
+			die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	}
+	memmove(&table->rows[low + 1], &table->rows[low], (table->nof_rows - low) * sizeof(snmp_row));
+	table->nof_rows++;
+	row = &table->rows[low];
+	row->index = malloc(length * sizeof(uint32_t));
+	row->index_length = length;
+	row->cells = calloc(table->nof_columns, sizeof(snmp_cell));
+	if (row->index == NULL || row->cells == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	memcpy(row->index, index, length * sizeof(uint32_t));
+	return row;
+}
+
+bool snmp_table_add(snmp_table *table, size_t column, const snmp_varbind *varbind) {
+	size_t prefix = table->columns[column].length;
+	char text[MAX_INPUT_BUFFER];
+	char *start = text;
+	snmp_cell *cell;
+	size_t length;
+
+	if (!snmp_table_in_column(table, column, &varbind->oid))
+		return false;
+	cell = &snmp_table_row(table, varbind->oid.ids + prefix, varbind->oid.length - prefix)->cells[column];
+
+	snmp_value_format(&varbind->value, text, sizeof(text));
+	free(cell->value);
+	cell->value = strdup(text);
+	if (varbind->value.type < SNMP_NO_SUCH_OBJECT && strstr(text, ": ") != NULL)
+		start = strstr(text, ": ") + 2;
+	length = strlen(start);
+	if (varbind->value.type == SNMP_OCTET_STRING && length >= 2 && start[0] == '"' && start[length - 1] == '"') {
+		start[length - 1] = '\0';
+		start++;
+	}
+
+	free(cell->text);
+	cell->present = true;
+	cell->type = varbind->value.type;
+	cell->is_number = snmp_value_number(&varbind->value, &cell->number);
+	cell->exact = varbind->value.type == SNMP_INTEGER ? (uint64_t)varbind->value.integer : varbind->value.counter;
+	cell->text = strdup(start);
+	if (cell->value == NULL || cell->text == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	return true;
+}
+
+bool snmp_table_walk(snmp_table *table, snmp_session *session, int max_repetitions) {
+	snmp_varbind *requested = calloc(table->nof_columns, sizeof(snmp_varbind));
+	size_t *walking = calloc(table->nof_columns, sizeof(size_t)); /* the column of each requested varbind */
+	bool *done = calloc(table->nof_columns, sizeof(bool));
+	snmp_varbind *varbinds = NULL;
+	snmp_pdu request = {.varbinds = requested};
+	snmp_pdu response = {0};
+	size_t nof_walking = table->nof_columns;
+	bool walked = false;
+
+	if (requested == NULL || walking == NULL || done == NULL)
+		die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+	for (size_t c = 0; c < table->nof_columns; c++) {
+		requested[c].oid = table->columns[c];
+		requested[c].value.type = SNMP_NULL;
+		walking[c] = c;
+	}
+	if (max_repetitions < 1)
+		max_repetitions = 1;
+
+	while (nof_walking > 0) {
+		size_t max_varbinds = nof_walking;
+		size_t kept = 0;
+
+		request.nof_varbinds = nof_walking;
+		if (session->version == SNMP_VERSION_1) {
+			request.type = SNMP_PDU_GETNEXT;
+			request.error_status = request.error_index = 0;
+		} else {
+			request.type = SNMP_PDU_GETBULK;
+			request.error_status = 0; /* non-repeaters */
+			request.error_index = max_repetitions;
+			max_varbinds *= (size_t)max_repetitions;
+		}
+		free(varbinds);
+		varbinds = calloc(max_varbinds, sizeof(snmp_varbind));
+		if (varbinds == NULL)
+			die(STATE_UNKNOWN, _("Could not allocate memory: %s\n"), strerror(errno));
+		response.varbinds = varbinds;
+
+		if (!snmp_session_request(session, &request, &response, max_varbinds)) {
+			table->error = session->error;
+			goto out;
+		}
+		table->requests++;
+
+		if (response.error_status == SNMP_ERROR_TOO_BIG && request.type == SNMP_PDU_GETBULK && max_repetitions > 1) {
+			max_repetitions /= 2;
+			continue;
+		}
+		/* v1 has no endOfMibView, the whole request fails instead */
+		if (response.error_status == SNMP_ERROR_NO_SUCH_NAME && request.type == SNMP_PDU_GETNEXT && response.error_index > 0 &&
+			(size_t)response.error_index <= nof_walking) {
+			size_t ended = (size_t)response.error_index - 1;
+
+			memmove(&requested[ended], &requested[ended + 1], (nof_walking - ended - 1) * sizeof(snmp_varbind));
+			memmove(&walking[ended], &walking[ended + 1], (nof_walking - ended - 1) * sizeof(size_t));
+			nof_walking--;
+			continue;
+		}
+		if (response.error_status != 0) {
+			table->error = snmp_error_text(response.error_status);
+			goto out;
+		}
+		if (response.nof_varbinds < nof_walking) {
+			table->error = _("Response without all columns");
+			goto out;
+		}
+
+		/* the varbinds go round the requested columns, one row after the other */
+		memset(done, 0, table->nof_columns * sizeof(bool));
+		for (size_t v = 0; v < response.nof_varbinds; v++) {
+			size_t w = v % nof_walking;
+			const snmp_varbind *varbind = &varbinds[v];
+
+			if (done[w])
+				continue;
+			if (varbind->value.type == SNMP_END_OF_MIB_VIEW || !snmp_table_in_column(table, walking[w], &varbind->oid)) {
+				done[w] = true;
+				continue;
+			}
+			if (snmp_oid_compare(&varbind->oid, &requested[w].oid) <= 0) {
+				table->error = _("OID not increasing");
+				goto out;
+			}
+			snmp_table_add(table, walking[w], varbind);
+			requested[w].oid = varbind->oid;
+		}
+		for (size_t w = 0; w < nof_walking; w++) {
+			if (done[w])
+				continue;
+			requested[kept] = requested[w];
+			walking[kept++] = walking[w];
+		}
+		nof_walking = kept;
+	}
+	walked = true;
+
+out:
+	free(requested);
+	free(walking);
+	free(done);
+	free(varbinds);
+	return walked;
+}
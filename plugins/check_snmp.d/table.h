@@ -0,0 +1,60 @@
+#pragma once
+
+#include "../common.h"
+#include "./ber.h"
+#include "./session.h"
+
+/*
+ * Columns of an SNMP table, walked side by side
+ *
+ * Every column is walked from its OID until the agent answers with an OID
+ * outside of it, all of them in the same GETBULK requests (GETNEXT with
+ * SNMP v1). The cells are joined into rows by their index, the
+ * sub-identifiers after the OID of the column, so that ifName.3 and
+ * ifHCInOctets.3 end up in the same row.
+ */
+
+enum {
+	SNMP_TABLE_MAX_REPETITIONS = 25 /* rows asked for per request */
+};
+
+typedef struct {
+	bool present;
+	snmp_type type;
+	bool is_number;
+	double number;
+	uint64_t exact; /* the number with all its bits, an INTEGER as int64_t */
+	char *text;  /* without the type, and strings without their quotes */
+	char *value; /* with the type, as snmpget prints it */
+} snmp_cell;
+
+typedef struct {
+	uint32_t *index;
+	size_t index_length;
+	snmp_cell *cells; /* one per column */
+} snmp_row;
+
+typedef struct {
+	const snmp_oid *columns;
+	size_t nof_columns;
+	snmp_row *rows; /* in the order of their index */
+	size_t nof_rows;
+	size_t size;
+	unsigned int requests; /* sent by the walk */
+	const char *error;     /* why the walk failed */
+} snmp_table;
+
+void snmp_table_init(snmp_table *table, const snmp_oid *columns, size_t nof_columns);
+
+/* Stores the value of varbind in the row of its index, false if it is not
+ * in column */
+bool snmp_table_add(snmp_table *table, size_t column, const snmp_varbind *varbind);
+
+/* Walks all columns, with max_repetitions rows per request as long as the
+ * agent does not answer tooBig */
+bool snmp_table_walk(snmp_table *table, snmp_session *session, int max_repetitions);
+
+/* The index of row as in "1.3" */
+void snmp_table_index_format(const snmp_row *row, char *buffer, size_t size);
+
+void snmp_table_free(snmp_table *table);
@@ -42,6 +42,7 @@
 
 #include <stdint.h>
 #include "./check_swap.d/check_swap.h"
+#include "./check_swap.d/proc.h"
 #include "./utils.h"
 
 typedef struct {
@@ -52,6 +53,7 @@ typedef struct {
 static swap_config_wrapper process_arguments(int argc, char **argv);
 void print_usage(void);
 static void print_help(swap_config /*config*/);
+static int check_swap_activity(swap_config config, swap_activity *activity, char **status, char **perfdata);
 
 int verbose;
 
@@ -60,6 +62,9 @@ int verbose;
 #define BYTES_TO_KiB(number) (number / 1024)
 #define BYTES_TO_MiB(number) (BYTES_TO_KiB(number) / 1024)
 
+#define ACTIVITY_WARNING_OPTION  CHAR_MAX + 1
+#define ACTIVITY_CRITICAL_OPTION CHAR_MAX + 2
+
 const char *progname = "check_swap";
 const char *copyright = "2000-2024";
 const char *email = "devel@monitoring-plugins.org";
@@ -71,6 +76,8 @@ int main(int argc, char **argv) {
 
 	char *status = strdup("");
 
+	np_init((char *)progname, argc, argv);
+
 	/* Parse extra opts if any */
 	argv = np_extra_opts(&argc, argv, progname);
 
@@ -139,12 +146,77 @@ int main(int argc, char **argv) {
 		}
 	}
 
+	if (config.activity_enabled) {
+		data.statusCode = max_state(data.statusCode, check_swap_activity(config, &data.activity, &status, &perfdata));
+	}
+
 	printf(_("SWAP %s - %g%% free (%lluMiB out of %lluMiB) %s|%s\n"), state_text(data.statusCode), (HUNDRED_PERCENT - percent_used),
 		   BYTES_TO_MiB(data.metrics.free), BYTES_TO_MiB(data.metrics.total), status, perfdata);
 
 	exit(data.statusCode);
 }
 
+/* Checks the rates of paging since the previous run and the memory pressure */
+int check_swap_activity(swap_config config, swap_activity *activity, char **status, char **perfdata) {
+	swap_activity_read(activity, SWAP_PROC_VMSTAT, SWAP_PROC_PRESSURE_MEMORY);
+	if (!activity->has_pages) {
+		die(STATE_UNKNOWN, _("SWAP UNKNOWN - Failed to read the paging counters from %s\n"), SWAP_PROC_VMSTAT);
+	}
+	for (int i = SWAP_ACTIVITY_PRESSURE; i < SWAP_ACTIVITY_COUNT && !activity->has_pressure; i++) {
+		if (config.activity_warning[i] || config.activity_critical[i]) {
+			die(STATE_UNKNOWN, _("SWAP UNKNOWN - Memory pressure is not available from %s\n"), SWAP_PROC_PRESSURE_MEMORY);
+		}
+	}
+
+	time_t now;
+	time(&now);
+	np_enable_state(NULL, 1);
+	state_data *previous_state = np_state_read();
+	swap_activity_rates(activity, previous_state ? previous_state->data : NULL, previous_state ? previous_state->time : 0, now);
+
+	char current_state[64];
+	swap_activity_format(activity, current_state, sizeof(current_state));
+	np_state_write_string(now, current_state);
+
+	double values[SWAP_ACTIVITY_COUNT] = {
+		[SWAP_ACTIVITY_SWAPIN] = activity->swapin_rate,
+		[SWAP_ACTIVITY_SWAPOUT] = activity->swapout_rate,
+		[SWAP_ACTIVITY_PRESSURE] = activity->pressure_some,
+		[SWAP_ACTIVITY_PRESSURE_FULL] = activity->pressure_full,
+	};
+
+	int result = STATE_OK;
+	for (int i = 0; i < SWAP_ACTIVITY_COUNT; i++) {
+		bool is_pressure = i >= SWAP_ACTIVITY_PRESSURE;
+		if (is_pressure ? !activity->has_pressure : !activity->has_rates) {
+			continue;
+		}
+
+		thresholds *activity_thresholds = NULL;
+		set_thresholds(&activity_thresholds, config.activity_warning[i], config.activity_critical[i]);
+		int metric_result = get_status(values[i], activity_thresholds);
+		if (verbose > 1) {
+			printf("Swap %s: %g, result=%d\n", swap_activity_names[i], values[i], metric_result);
+		}
+		result = max_state(result, metric_result);
+
+		xasprintf(perfdata, "%s %s", *perfdata,
+				  sperfdata(swap_activity_names[i], values[i], is_pressure ? "%" : "", config.activity_warning[i],
+							config.activity_critical[i], true, 0, is_pressure, 100));
+	}
+
+	if (activity->has_rates) {
+		xasprintf(status, _("%sswapping in %.1f, out %.1f pages/s"), *status, activity->swapin_rate, activity->swapout_rate);
+	} else {
+		xasprintf(status, _("%sno swapping rates yet"), *status);
+	}
+	if (activity->has_pressure) {
+		xasprintf(status, _("%s, memory pressure %.1f%%"), *status, activity->pressure_some);
+	}
+
+	return result;
+}
+
 int check_swap(float free_swap_mb, float total_swap_mb, swap_config config) {
 	if (total_swap_mb == 0) {
 		return config.no_swap_state;
@@ -180,7 +252,10 @@ swap_config_wrapper process_arguments(int argc, char **argv) {
 	static struct option longopts[] = {{"warning", required_argument, 0, 'w'}, {"critical", required_argument, 0, 'c'},
 									   {"allswaps", no_argument, 0, 'a'},      {"no-swap", required_argument, 0, 'n'},
 									   {"verbose", no_argument, 0, 'v'},       {"version", no_argument, 0, 'V'},
-									   {"help", no_argument, 0, 'h'},          {0, 0, 0, 0}};
+									   {"help", no_argument, 0, 'h'},
+									   {"activity-warning", required_argument, 0, ACTIVITY_WARNING_OPTION},
+									   {"activity-critical", required_argument, 0, ACTIVITY_CRITICAL_OPTION},
+									   {0, 0, 0, 0}};
 
 	while (true) {
 		int option = 0;
@@ -260,6 +335,23 @@ swap_config_wrapper process_arguments(int argc, char **argv) {
 						 "WARNING, CRITICAL, UNKNOWN) or integer (0-3)."));
 			}
 			break;
+		/* METRIC=RANGE */
+		case ACTIVITY_WARNING_OPTION:
+		case ACTIVITY_CRITICAL_OPTION: {
+			char *range = strchr(optarg, '=');
+			int metric = range ? swap_activity_by_name(optarg, (size_t)(range - optarg)) : -1;
+
+			if (metric < 0) {
+				usage2(_("Expected swapin, swapout, pressure or pressure_full followed by =RANGE"), optarg);
+			}
+			if (option_char == ACTIVITY_WARNING_OPTION) {
+				conf_wrapper.config.activity_warning[metric] = range + 1;
+			} else {
+				conf_wrapper.config.activity_critical[metric] = range + 1;
+			}
+			conf_wrapper.config.activity_enabled = true;
+			break;
+		}
 		case 'v': /* verbose */
 			verbose++;
 			break;
@@ -319,6 +411,12 @@ void print_help(swap_config config) {
 		   _("Resulting state when there is no swap regardless of thresholds. "
 			 "Default:"),
 		   state_text(config.no_swap_state));
+	printf(" %s\n", "--activity-warning=METRIC=RANGE");
+	printf("    %s\n", _("Exit with WARNING status if METRIC is outside RANGE, METRIC is swapin or"));
+	printf("    %s\n", _("swapout (pages per second since the previous run) or pressure or"));
+	printf("    %s\n", _("pressure_full (percentage of the last 10s tasks stalled on memory)"));
+	printf(" %s\n", "--activity-critical=METRIC=RANGE");
+	printf("    %s\n", _("Exit with CRITICAL status if METRIC is outside RANGE"));
 	printf(UT_VERBOSE);
 
 	printf("\n");
@@ -326,6 +424,9 @@ void print_help(swap_config config) {
 	printf(" %s\n", _("Both INTEGER and PERCENT thresholds can be specified, "
 					  "they are all checked."));
 	printf(" %s\n", _("On AIX, if -a is specified, uses lsps -a, otherwise uses lsps -s."));
+	printf(" %s\n", _("The activity is read from /proc/vmstat and /proc/pressure/memory (Linux)."));
+	printf(" %s\n", _("Busy swapping hurts more than a full swap space that is left alone, the"));
+	printf(" %s\n", _("rates are kept as state between runs, the first run reports none."));
 
 	printf(UT_SUPPORT);
 }
@@ -334,4 +435,5 @@ void print_usage(void) {
 	printf("%s\n", _("Usage:"));
 	printf(" %s [-av] -w <percent_free>%% -c <percent_free>%%\n", progname);
 	printf("  -w <bytes_free> -c <bytes_free> [-n <state>]\n");
+	printf("  [--activity-warning=METRIC=RANGE] [--activity-critical=METRIC=RANGE]\n");
 }
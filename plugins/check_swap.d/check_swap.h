@@ -17,10 +17,34 @@ typedef struct {
 	unsigned long long total; // Total swap size, you guessed it, in Bytes!
 } swap_metrics;
 
+/* Swapping as it happens, which occupancy alone does not tell */
+typedef struct {
+	bool has_pages;
+	uint64_t pswpin;  // Pages swapped in since boot
+	uint64_t pswpout; // Pages swapped out since boot
+	bool has_rates;
+	double swapin_rate;  // Pages per second since the previous run
+	double swapout_rate; // Pages per second since the previous run
+	bool has_pressure;
+	double pressure_some; // Percentage of time some tasks stalled on memory, last 10s
+	double pressure_full; // Percentage of time all tasks stalled on memory, last 10s
+} swap_activity;
+
+typedef enum {
+	SWAP_ACTIVITY_SWAPIN,
+	SWAP_ACTIVITY_SWAPOUT,
+	SWAP_ACTIVITY_PRESSURE,
+	SWAP_ACTIVITY_PRESSURE_FULL,
+	SWAP_ACTIVITY_COUNT
+} swap_activity_metric;
+
+extern const char *const swap_activity_names[SWAP_ACTIVITY_COUNT];
+
 typedef struct {
 	int errorcode;
 	int statusCode;
 	swap_metrics metrics;
+	swap_activity activity;
 } swap_result;
 
 typedef struct {
@@ -32,9 +56,13 @@ typedef struct {
 	check_swap_threshold crit;
 	bool on_aix;
 	int conversion_factor;
+	bool activity_enabled;
+	char *activity_warning[SWAP_ACTIVITY_COUNT];
+	char *activity_critical[SWAP_ACTIVITY_COUNT];
 } swap_config;
 
 swap_config swap_config_init(void);
+int swap_activity_by_name(const char *name, size_t length);
 
 swap_result get_swap_data(swap_config config);
 swap_result getSwapFromProcMeminfo(char path_to_proc_meminfo[]);
@@ -0,0 +1,148 @@
+#include "./proc.h"
+
+#include <fcntl.h>
+
+/* Larger than /proc/vmstat of current kernels, about 6 KiB */
+#define SWAP_PROC_BUFFER_SIZE 16384
+
+#define SWAP_PROC_SLOTS 16
+
+static const char *const swap_proc_names[SWAP_PROC_KEY_COUNT] = {"SwapTotal", "SwapFree", "SwapCached", "Swap", "pswpin", "pswpout"};
+
+/* (length + first + last) % 16 differs for each of the names, recompute the
+ * table when adding one */
+static const signed char swap_proc_slots[SWAP_PROC_SLOTS] = {
+	SWAP_PROC_SWAP_FREE, SWAP_PROC_SWAP_CACHED, -1, -1, SWAP_PROC_PSWPIN, -1, -1, SWAP_PROC_SWAP, SWAP_PROC_SWAP_TOTAL, -1, -1,
+	SWAP_PROC_PSWPOUT,   -1,                    -1, -1, -1};
+
+static unsigned swap_proc_hash(const char *name, size_t length) {
+	return ((unsigned)length + (unsigned char)name[0] + (unsigned char)name[length - 1]) % SWAP_PROC_SLOTS;
+}
+
+int swap_proc_key_lookup(const char *name, size_t length) {
+	int key;
+
+	if (length == 0)
+		return -1;
+	key = swap_proc_slots[swap_proc_hash(name, length)];
+	if (key < 0 || strncmp(swap_proc_names[key], name, length) != 0 || swap_proc_names[key][length] != '\0')
+		return -1;
+	return key;
+}
+
+void swap_proc_parse(const char *text, swap_proc_values *values) {
+	const char *line = text;
+
+	while (*line) {
+		const char *end = strchr(line, '\n');
+		size_t length = strcspn(line, ": \t\n");
+		int key = swap_proc_key_lookup(line, length);
+
+		if (end == NULL)
+			end = line + strlen(line);
+		if (key >= 0) {
+			const char *pos = line + length;
+			char *next;
+			uint64_t value;
+
+			if (*pos == ':')
+				pos++;
+			value = strtoull(pos, &next, 10);
+			if (next != pos && next <= end) {
+				if (key == SWAP_PROC_SWAP) {
+					values->swap_used = strtoull(next, &next, 10);
+					values->swap_free = strtoull(next, &next, 10);
+				} else if (strncmp(next, " kB", 3) == 0) {
+					value *= 1024;
+				}
+				values->values[key] = value;
+				values->found[key] = true;
+			}
+		}
+		line = *end ? end + 1 : end;
+	}
+}
+
+bool swap_proc_read(const char *filename, swap_proc_values *values) {
+	char buffer[SWAP_PROC_BUFFER_SIZE];
+	int fd = open(filename, O_RDONLY);
+	ssize_t length;
+
+	if (fd < 0)
+		return false;
+	length = read(fd, buffer, sizeof(buffer) - 1);
+	close(fd);
+	if (length < 0)
+		return false;
+	buffer[length] = '\0';
+	/* a line cut at the end of the buffer would be read short */
+	if ((size_t)length == sizeof(buffer) - 1) {
+		char *last = strrchr(buffer, '\n');
+
+		if (last != NULL)
+			last[1] = '\0';
+	}
+	swap_proc_parse(buffer, values);
+	return true;
+}
+
+bool swap_parse_memory_pressure(const char *text, swap_activity *activity) {
+	const char *some = strncmp(text, "some ", 5) == 0 ? text : strstr(text, "\nsome ");
+	const char *full = strstr(text, "\nfull ");
+
+	if (some == NULL)
+		return false;
+	if (*some == '\n')
+		some++;
+	if (sscanf(some, "some avg10=%lf", &activity->pressure_some) != 1)
+		return false;
+	activity->pressure_full = 0.0;
+	if (full != NULL)
+		sscanf(full + 1, "full avg10=%lf", &activity->pressure_full);
+	activity->has_pressure = true;
+	return true;
+}
+
+void swap_activity_read(swap_activity *activity, const char *vmstat, const char *pressure) {
+	swap_proc_values values = {0};
+	char buffer[256];
+	int fd;
+	ssize_t length;
+
+	memset(activity, 0, sizeof(*activity));
+	if (swap_proc_read(vmstat, &values) && values.found[SWAP_PROC_PSWPIN] && values.found[SWAP_PROC_PSWPOUT]) {
+		activity->has_pages = true;
+		activity->pswpin = values.values[SWAP_PROC_PSWPIN];
+		activity->pswpout = values.values[SWAP_PROC_PSWPOUT];
+	}
+
+	if (pressure == NULL || (fd = open(pressure, O_RDONLY)) < 0)
+		return;
+	length = read(fd, buffer, sizeof(buffer) - 1);
+	close(fd);
+	if (length > 0) {
+		buffer[length] = '\0';
+		swap_parse_memory_pressure(buffer, activity);
+	}
+}
+
+void swap_activity_rates(swap_activity *activity, const char *previous, time_t previous_time, time_t now) {
+	unsigned long long pswpin;
+	unsigned long long pswpout;
+	double seconds = difftime(now, previous_time);
+
+	activity->has_rates = false;
+	if (!activity->has_pages || previous == NULL || seconds <= 0)
+		return;
+	if (sscanf(previous, "pswpin=%llu pswpout=%llu", &pswpin, &pswpout) != 2)
+		return;
+	if (activity->pswpin < pswpin || activity->pswpout < pswpout)
+		return;
+	activity->swapin_rate = (double)(activity->pswpin - pswpin) / seconds;
+	activity->swapout_rate = (double)(activity->pswpout - pswpout) / seconds;
+	activity->has_rates = true;
+}
+
+void swap_activity_format(const swap_activity *activity, char *buffer, size_t size) {
+	snprintf(buffer, size, "pswpin=%llu pswpout=%llu", (unsigned long long)activity->pswpin, (unsigned long long)activity->pswpout);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "./check_swap.h"
+
+#include <time.h>
+
+/*
+ * Swap counters read straight from /proc
+ *
+ * /proc/meminfo and /proc/vmstat are read in one go each and split into
+ * "Name: N kB" and "name N" lines. Of the dozens (vmstat: hundreds) of
+ * names only a few are wanted, so they are looked up in a perfect hash of
+ * just those names: one slot from the length and the first and last
+ * characters, and a single comparison, rejects all others.
+ */
+
+#define SWAP_PROC_VMSTAT          "/proc/vmstat"
+#define SWAP_PROC_PRESSURE_MEMORY "/proc/pressure/memory"
+
+typedef enum {
+	SWAP_PROC_SWAP_TOTAL,  /* bytes */
+	SWAP_PROC_SWAP_FREE,   /* bytes */
+	SWAP_PROC_SWAP_CACHED, /* bytes */
+	SWAP_PROC_SWAP,        /* "Swap: total used free" of old kernels, bytes */
+	SWAP_PROC_PSWPIN,      /* pages swapped in since boot */
+	SWAP_PROC_PSWPOUT,     /* pages swapped out since boot */
+	SWAP_PROC_KEY_COUNT
+} swap_proc_key;
+
+typedef struct {
+	uint64_t values[SWAP_PROC_KEY_COUNT];
+	bool found[SWAP_PROC_KEY_COUNT];
+	/* the rest of the "Swap:" line */
+	uint64_t swap_used;
+	uint64_t swap_free;
+} swap_proc_values;
+
+/* The key of the name of length bytes, -1 if it is none of them */
+int swap_proc_key_lookup(const char *name, size_t length);
+
+/* Decodes the lines of the keys from text, leaves the others */
+void swap_proc_parse(const char *text, swap_proc_values *values);
+
+/* Reads filename with a single read() and decodes it, false if it cannot
+ * be read */
+bool swap_proc_read(const char *filename, swap_proc_values *values);
+
+/* Decodes the avg10 of the "some" and "full" lines of
+ * /proc/pressure/memory */
+bool swap_parse_memory_pressure(const char *text, swap_activity *activity);
+
+/* Reads the paging counters and the memory pressure. Either is optional,
+ * pressure may be NULL. */
+void swap_activity_read(swap_activity *activity, const char *vmstat, const char *pressure);
+
+/* The rates of paging since the counters of the previous run, kept as
+ * state. None if there is no state, no time passed or a counter went back,
+ * as after a reboot. */
+void swap_activity_rates(swap_activity *activity, const char *previous, time_t previous_time, time_t now);
+
+/* The counters to keep as state for the next run */
+void swap_activity_format(const swap_activity *activity, char *buffer, size_t size);
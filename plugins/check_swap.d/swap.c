@@ -1,10 +1,22 @@
 #include "./check_swap.d/check_swap.h"
+#include "./check_swap.d/proc.h"
 #include "../popen.h"
 #include "../utils.h"
 #include "common.h"
 
 extern int verbose;
 
+const char *const swap_activity_names[SWAP_ACTIVITY_COUNT] = {"swapin", "swapout", "pressure", "pressure_full"};
+
+int swap_activity_by_name(const char *name, size_t length) {
+	for (int i = 0; i < SWAP_ACTIVITY_COUNT; i++) {
+		if (strlen(swap_activity_names[i]) == length && strncmp(swap_activity_names[i], name, length) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
 swap_config swap_config_init(void) {
 	swap_config tmp = {0};
 	tmp.allswaps = false;
@@ -63,97 +75,37 @@ swap_result get_swap_data(swap_config config) {
 }
 
 swap_result getSwapFromProcMeminfo(char proc_meminfo[]) {
-	FILE *meminfo_file_ptr;
-	meminfo_file_ptr = fopen(proc_meminfo, "r");
-
 	swap_result result = {0};
+	swap_proc_values values = {0};
+
 	result.errorcode = STATE_UNKNOWN;
 
-	if (meminfo_file_ptr == NULL) {
+	if (!swap_proc_read(proc_meminfo, &values)) {
 		// failed to open meminfo file
 		// errno should contain an error
-		result.errorcode = STATE_UNKNOWN;
 		return result;
 	}
 
-	uint64_t swap_total = 0;
-	uint64_t swap_used = 0;
-	uint64_t swap_free = 0;
-
-	bool found_total = false;
-	bool found_used = false;
-	bool found_free = false;
-
-	char input_buffer[MAX_INPUT_BUFFER];
-	char str[32];
-
-	while (fgets(input_buffer, MAX_INPUT_BUFFER - 1, meminfo_file_ptr)) {
-		uint64_t tmp_KB = 0;
-
+	if (values.found[SWAP_PROC_SWAP_TOTAL] && values.found[SWAP_PROC_SWAP_FREE]) {
 		/*
-		 * The following sscanf call looks for a line looking like: "Swap: 123
-		 * 123 123" On which kind of system this format exists, I can not say,
-		 * but I wanted to document this for people who are not adapt with
-		 * sscanf anymore, like me
-		 * Also the units used here are unclear and probably wrong
+		 * "SwapTotal: 123 kB" and "SwapFree: 123 kB", as since Linux 2.6.
+		 * There is no explicit used metric, swap cached in memory is
+		 * counted as free.
 		 */
-		if (sscanf(input_buffer, "%*[S]%*[w]%*[a]%*[p]%*[:] %lu %lu %lu", &swap_total, &swap_used, &swap_free) == 3) {
-
-			result.metrics.total += swap_total;
-			result.metrics.used += swap_used;
-			result.metrics.free += swap_free;
-
-			found_total = true;
-			found_free = true;
-			found_used = true;
-
-			// Set error
-			result.errorcode = STATE_OK;
-
-			/*
-			 * The following sscanf call looks for lines looking like:
-			 * "SwapTotal: 123" and "SwapFree: 123" This format exists at least
-			 * on Debian Linux with a 5.* kernel
-			 */
-		} else {
-			int sscanf_result = sscanf(input_buffer,
-									   "%*[S]%*[w]%*[a]%*[p]%[TotalFreCchd]%*[:] %lu "
-									   "%*[k]%*[B]",
-									   str, &tmp_KB);
-
-			if (sscanf_result == 2) {
-
-				if (verbose >= 3) {
-					printf("Got %s with %lu\n", str, tmp_KB);
-				}
-
-				/* I think this part is always in Kb, so convert to bytes */
-				if (strcmp("Total", str) == 0) {
-					swap_total = tmp_KB * 1000;
-					found_total = true;
-				} else if (strcmp("Free", str) == 0) {
-					swap_free = swap_free + tmp_KB * 1000;
-					found_free = true;
-					found_used = true; // No explicit used metric available
-				} else if (strcmp("Cached", str) == 0) {
-					swap_free = swap_free + tmp_KB * 1000;
-					found_free = true;
-					found_used = true; // No explicit used metric available
-				}
-
-				result.errorcode = STATE_OK;
-			}
-		}
+		result.metrics.total = values.values[SWAP_PROC_SWAP_TOTAL];
+		result.metrics.free = values.values[SWAP_PROC_SWAP_FREE] + values.values[SWAP_PROC_SWAP_CACHED];
+		result.metrics.used = result.metrics.total - result.metrics.free;
+		result.errorcode = STATE_OK;
+	} else if (values.found[SWAP_PROC_SWAP]) {
+		/* "Swap: total used free" in bytes, as before Linux 2.6 */
+		result.metrics.total = values.values[SWAP_PROC_SWAP];
+		result.metrics.used = values.swap_used;
+		result.metrics.free = values.swap_free;
+		result.errorcode = STATE_OK;
 	}
 
-	fclose(meminfo_file_ptr);
-
-	result.metrics.total = swap_total;
-	result.metrics.used = swap_total - swap_free;
-	result.metrics.free = swap_free;
-
-	if (!found_free || !found_total || !found_used) {
-		result.errorcode = STATE_UNKNOWN;
+	if (verbose >= 3) {
+		printf("Got total %llu, free %llu, used %llu\n", result.metrics.total, result.metrics.free, result.metrics.used);
 	}
 
 	return result;
@@ -8,7 +8,7 @@ use Test::More;
 use NPTest;
 
 if (-x "./check_procs") {
-	plan tests => 54;
+	plan tests => 65;
 } else {
 	plan skip_all => "No check_procs compiled";
 }
@@ -146,3 +146,28 @@ is( $result->output, 'RSS CRITICAL: 5 crit, 0 warn out of 95 processes [WindowSe
 $result = NPTest->testCmd( "$command --ereg-argument-array='(nosuchname|nosuch2name)'" );
 is( $result->return_code, 0, "Checking no pipe symbol in output" );
 is( $result->output, "PROCS OK: 0 processes with regex args '(nosuchname,nosuch2name)' | procs=0;;;0;", "Output correct" );
+
+$result = NPTest->testCmd( "$command --rule='launchd: -C launchd -c 5' --rule='big: --metric=RSS -c 70000' --rule='all: -w 100'" );
+is( $result->return_code, 2, "Checking several rules in one scan" );
+is( $result->output, "PROCS CRITICAL: launchd CRITICAL 6 processes, big CRITICAL RSS 5 crit, 0 warn out of 95 processes, all OK 95 processes | 'launchd'=6;;5;0; 'big'=95;;;0; 'big_warn'=0;;;0; 'big_crit'=5;;;0; 'all'=95;100;;0;", "Output correct" );
+
+$result = NPTest->testCmd( "$command --rule='perl: -a \"/usr/local/bin/perl\" -w 1' --rule='root: -u 0 -w 100'" );
+is( $result->return_code, 0, "Checking quoted rule options" );
+is( $result->output, "PROCS OK: perl OK 0 processes, root OK 30 processes | 'perl'=0;1;;0; 'root'=30;100;;0;", "Output correct" );
+
+$result = NPTest->testCmd( "$command --rule='launchd: -C launchd' -C launchd" );
+is( $result->return_code, 3, "Filters outside of the rules rejected" );
+
+$result = NPTest->testCmd( "$command --rule='launchd: -t 5'" );
+is( $result->return_code, 3, "Only filters and thresholds in rules" );
+
+$result = NPTest->testCmd( "$command --group-by=prog -C launchd -w 3" );
+is( $result->return_code, 1, "Checking processes grouped by command name" );
+is( $result->output, "PROCS WARNING: 1 warn out of 1 group of 6 processes with command name 'launchd' | procs=6;;;0; groups=1;;;0; 'launchd'=6;3;;0;", "Output correct" );
+
+$result = NPTest->testCmd( "$command --group-by=ppid --metric=RSS -c 30000 -u 0" );
+is( $result->return_code, 2, "Checking RSS of the children of every parent" );
+is( $result->output, "RSS CRITICAL: 1 crit, 0 warn out of 5 groups of 30 processes with UID = 0 (root) | procs=30;;;0; groups=5;;;0; '0'=976KB;;30000;0; '1'=164652KB;;30000;0; '129'=6340KB;;30000;0; '175'=13920KB;;30000;0; '4559'=852KB;;30000;0;", "Output correct" );
+
+$result = NPTest->testCmd( "$command --group-by=cgroup" );
+is( $result->return_code, 3, "Cgroups are not in the output of ps" );
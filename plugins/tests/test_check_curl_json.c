@@ -0,0 +1,76 @@
+
+#include "../check_curl.d/json.h"
+#include "../../tap/tap.h"
+
+static json_status feed_bytewise(json_parser *parser, const char *doc) {
+	json_status status = JSON_CONTINUE;
+	for (const char *p = doc; *p && status == JSON_CONTINUE; p++)
+		status = json_parser_feed(parser, p, 1);
+	return json_parser_finish(parser);
+}
+
+int main(void) {
+	const char *doc = "{\"status\": \"ok\", \"db\": {\"conns\": 42, \"lag\": -0.5e1, \"up\": true, \"note\": null},"
+					  " \"items\": [1, {\"x\": 7}, [2, 3]], \"s\": \"a\\\"b\\u00e9\", \"n\": \"17\"}";
+	json_path paths[8];
+	json_parser parser;
+
+	plan_tests(30);
+
+	ok(json_path_compile("$.db.conns", &paths[0]) == 0, "Compile member path");
+	ok(json_path_compile("db.lag", &paths[1]) == 0, "Compile path without root");
+	ok(json_path_compile("$.items[1].x", &paths[2]) == 0, "Compile path with index");
+	ok(json_path_compile("$.items[2][1]", &paths[3]) == 0, "Compile path with nested index");
+	ok(json_path_compile("$.db.up", &paths[4]) == 0, "Compile path to boolean");
+	ok(json_path_compile("$.n", &paths[5]) == 0, "Compile path to numeric string");
+	ok(json_path_compile("$.status", &paths[6]) == 0, "Compile path to string");
+	ok(json_path_compile("$.db.missing", &paths[7]) == 0, "Compile path to missing member");
+	ok(paths[2].nof_segments == 3 && paths[2].segments[1].key == NULL && paths[2].segments[1].index == 1, "Index segment compiled");
+
+	json_path broken;
+	ok(json_path_compile("$..a", &broken) == -1, "Empty member name is rejected");
+	ok(json_path_compile("$.a[x]", &broken) == -1, "Non-numeric index is rejected");
+
+	json_parser_init(&parser, paths, 8);
+	ok(json_parser_feed(&parser, doc, strlen(doc)) == JSON_CONTINUE, "Document parsed, one path unresolved");
+	ok(paths[0].found && paths[0].is_number && paths[0].value == 42, "Member value");
+	ok(paths[1].found && paths[1].is_number && paths[1].value == -5, "Exponent value");
+	ok(paths[2].found && paths[2].value == 7, "Value inside array");
+	ok(paths[3].found && paths[3].value == 3, "Value inside nested array");
+	ok(paths[4].found && paths[4].is_number && paths[4].value == 1, "Boolean counts as number");
+	ok(paths[5].found && paths[5].is_number && paths[5].value == 17, "Numeric string counts as number");
+	ok(paths[6].found && !paths[6].is_number, "String is not a number");
+	ok(!paths[7].found, "Missing member not found");
+
+	/* all paths resolved: parsing stops before the end of the document */
+	json_parser_init(&parser, paths, 2);
+	ok(json_parser_feed(&parser, doc, strlen(doc)) == JSON_DONE, "Parser done once all paths are resolved");
+	ok(parser.offset < strlen(doc), "Rest of the document is not read");
+
+	/* input split at every byte */
+	json_parser_init(&parser, paths, 7);
+	ok(feed_bytewise(&parser, doc) == JSON_DONE, "Document fed byte by byte");
+	ok(paths[1].value == -5 && paths[3].value == 3, "Values correct when fed byte by byte");
+
+	json_path root;
+	json_path_compile("$", &root);
+	json_parser_init(&parser, &root, 1);
+	ok(feed_bytewise(&parser, "12.5") == JSON_DONE && root.value == 12.5, "Number at the end of input");
+	json_path_free(&root);
+
+	json_parser_init(&parser, paths, 1);
+	ok(json_parser_feed(&parser, "{\"db\": {\"conns\": x}}", strlen("{\"db\": {\"conns\": x}}")) == JSON_ERROR, "Syntax error detected");
+	ok(parser.offset == 17, "Offset of syntax error");
+
+	json_parser_init(&parser, paths, 1);
+	ok(json_parser_feed(&parser, "{\"db\": [}", strlen("{\"db\": [}")) == JSON_ERROR, "Mismatched bracket detected");
+
+	json_parser_init(&parser, paths, 1);
+	ok(json_parser_feed(&parser, "{\"db\": {\"conns\": {\"a\": 1}}}", strlen("{\"db\": {\"conns\": {\"a\": 1}}}")) == JSON_DONE, "Object value resolves the path");
+	ok(!paths[0].is_number, "Object is not a number");
+
+	for (int i = 0; i < 8; i++)
+		json_path_free(&paths[i]);
+
+	return exit_status();
+}
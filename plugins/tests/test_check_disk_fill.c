@@ -0,0 +1,66 @@
+#include "../check_disk.d/fill_rate.h"
+#include "../../tap/tap.h"
+
+int main(void) {
+	struct name_hash histories = {0};
+	struct name_hash restored = {0};
+	disk_fill_history *history;
+	disk_fill_history *other;
+	double rate = 0;
+	char *state;
+
+	plan_tests(18);
+
+	history = disk_fill_history_get(&histories, "/var");
+	ok(history->nof_samples == 0, "New history is empty");
+	ok(!disk_fill_rate(history, &rate), "No rate without samples");
+
+	disk_fill_add(history, 1000, 1000000, 3600);
+	ok(!disk_fill_rate(history, &rate), "No rate from a single sample");
+
+	/* 50 bytes per second with some noise */
+	disk_fill_add(history, 1300, 1000000 + 300 * 50 + 700, 3600);
+	disk_fill_add(history, 1600, 1000000 + 600 * 50 - 700, 3600);
+	disk_fill_add(history, 1900, 1000000 + 900 * 50 + 300, 3600);
+	ok(disk_fill_rate(history, &rate) && rate > 49 && rate < 51, "Linear fit over noisy samples (%g)", rate);
+
+	disk_fill_add(history, 5200, 1000000 + 4200 * 50, 3600);
+	ok(history->nof_samples == 2 && history->samples[0].time == 1900, "Samples outside the window dropped");
+
+	disk_fill_add(history, 5000, 900000, 3600);
+	ok(history->nof_samples == 2 && history->samples[1].time == 5000, "Samples from the future dropped");
+	ok(disk_fill_rate(history, &rate) && rate < 0, "Shrinking usage has a negative rate");
+
+	for (int i = 0; i < DISK_FILL_MAX_SAMPLES + 10; i++)
+		disk_fill_add(history, 6000 + i, 100, 3600);
+	ok(history->nof_samples == DISK_FILL_MAX_SAMPLES && history->samples[0].time == 6010, "Number of samples is limited");
+	ok(disk_fill_rate(history, &rate) && rate == 0, "Constant usage has no rate");
+
+	other = disk_fill_history_get(&histories, "my disk;=%");
+	disk_fill_add(other, 100, 1, 3600);
+	disk_fill_add(other, 200, 18446744073709551615ULL, 3600);
+	disk_fill_history_get(&histories, "/not/sampled");
+	/* file systems not mounted in this run, read from an older state */
+	disk_fill_parse("/unmounted=2000:10,3000:20;/long/gone=40:10,50:20", &histories);
+	ok(disk_fill_history_get(&histories, "/var") == history, "History found by label");
+
+	state = disk_fill_format(&histories, 6300, 6200);
+	ok(strstr(state, "my%20disk%3B%3D%25=100:1,200:18446744073709551615") != NULL, "Label escaped in state");
+	ok(strstr(state, "/not/sampled") == NULL, "Histories without samples are not kept");
+	ok(strstr(state, "/unmounted=2000:10,3000:20") != NULL, "History of a missing file system kept during the window");
+	ok(strstr(state, "/long/gone") == NULL, "History without samples in the window dropped");
+
+	disk_fill_parse(state, &restored);
+	ok(restored.count == 3, "Three histories restored");
+	history = np_name_hash_get(&restored, "/var");
+	ok(history && history->nof_samples == DISK_FILL_MAX_SAMPLES && history->samples[DISK_FILL_MAX_SAMPLES - 1].time == 6000 + DISK_FILL_MAX_SAMPLES + 9,
+	   "Samples restored");
+	other = np_name_hash_get(&restored, "my disk;=%");
+	ok(other && other->nof_samples == 2 && other->samples[1].used == 18446744073709551615ULL, "Escaped label and large values restored");
+
+	disk_fill_parse("/a=10:5,x:7,20:6;broken;/b=", &restored);
+	history = np_name_hash_get(&restored, "/a");
+	ok(history && history->nof_samples == 1 && np_name_hash_get(&restored, "/b") != NULL, "Broken state is read as far as possible");
+
+	return exit_status();
+}
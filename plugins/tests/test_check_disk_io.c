@@ -0,0 +1,59 @@
+
+#include "../check_disk.d/io_stats.h"
+#include "../../tap/tap.h"
+
+int main(void) {
+	const char *first = "   8       0 sda 1000 10 80000 2000 500 5 40000 3000 0 4000 5000 0 0 0 0\n"
+						"   8       1 sda1 900 10 70000 1800 400 5 30000 2500 0 3500 4300\n"
+						" 259       0 nvme0n1 4294967000 0 100 0 0 0 0 0 0 0 0\n"
+						"   7       0 loop0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n"
+						"broken\n";
+	const char *second = "   8       1 sda1 1000 10 90000 2300 500 5 40000 3000 0 4000 4800\n"
+						 "   8       0 sda 1100 10 100000 2500 600 5 50000 3500 0 4500 5900 0 0 0 0\n"
+						 " 259       0 nvme0n1 100 0 200 0 0 0 0 0 0 0 0\n";
+	io_sample before;
+	io_sample after;
+	io_pressure pressure;
+	const io_device_counters *device;
+	double metrics[IO_METRIC_COUNT];
+
+	plan_tests(17);
+
+	ok(io_metric_by_name("util=90", 4) == IO_METRIC_UTIL, "Metric found by name prefix");
+	ok(io_metric_by_name("utilization", 11) == -1, "Unknown metric");
+
+	ok(io_sample_parse(first, &before) && before.nof_devices == 4, "Four devices parsed, broken line skipped");
+	ok(io_sample_parse(second, &after) && after.nof_devices == 3, "Three devices parsed");
+	ok(before.devices[0].major == 7 && before.devices[3].major == 259, "Devices sorted");
+
+	device = io_sample_find(&before, 8, 1);
+	ok(device && device->reads == 900 && device->sectors_written == 30000 && device->ms_doing_io == 3500, "Partition found");
+	ok(io_sample_find(&before, 8, 2) == NULL, "Unknown device not found");
+	ok(io_sample_find(&after, 7, 0) == NULL, "Device gone in the second sample");
+
+	/* 200 requests and 30000 sectors in 2s, 500ms of waiting, busy for 500 of 2000ms */
+	io_metrics_compute(io_sample_find(&before, 8, 0), io_sample_find(&after, 8, 0), 2, metrics);
+	ok(metrics[IO_METRIC_IOPS] == 100, "IOPS");
+	ok(metrics[IO_METRIC_THROUGHPUT] == 30000 * 512 / 2, "Throughput in bytes");
+	ok(metrics[IO_METRIC_AWAIT] == 0.005, "Await in seconds (%g)", metrics[IO_METRIC_AWAIT]);
+	ok(metrics[IO_METRIC_UTIL] == 25, "Utilisation in percent (%g)", metrics[IO_METRIC_UTIL]);
+
+	io_metrics_compute(io_sample_find(&before, 8, 1), io_sample_find(&after, 8, 1), 1, metrics);
+	ok(metrics[IO_METRIC_IOPS] == 200 && metrics[IO_METRIC_UTIL] == 50, "Partition metrics");
+
+	io_metrics_compute(io_sample_find(&before, 259, 0), io_sample_find(&after, 259, 0), 1, metrics);
+	ok(metrics[IO_METRIC_IOPS] == 396, "32 bit counter wrapped around (%g)", metrics[IO_METRIC_IOPS]);
+
+	ok(io_pressure_parse("some avg10=1.50 avg60=0.05 avg300=0.13 total=8974739\n"
+						 "full avg10=0.75 avg60=0.04 avg300=0.08 total=6352274\n",
+						 &pressure) &&
+		   pressure.some_avg10 == 1.5 && pressure.full_avg10 == 0.75 && pressure.has_full,
+	   "Pressure parsed");
+	ok(io_pressure_parse("some avg10=3.00 avg60=0.05 avg300=0.13 total=1\n", &pressure) && !pressure.has_full,
+	   "Pressure without full line");
+	ok(!io_pressure_parse("", &pressure), "No pressure information");
+
+	io_sample_free(&before);
+	io_sample_free(&after);
+	return exit_status();
+}
@@ -0,0 +1,90 @@
+
+#include "../check_disk.d/disk_stat.h"
+#include "../../tap/tap.h"
+
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#define NOF_PATHS 2000
+
+static double seconds_since(struct timeval *start) {
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_usec - start->tv_usec) / 1.0e6;
+}
+
+static void setup(disk_stat_request *requests, char **paths, const char *mountdir) {
+	for (int i = 0; i < NOF_PATHS; i++) {
+		memset(&requests[i], 0, sizeof(requests[i]));
+		requests[i].path = paths[i];
+		requests[i].mountdir = mountdir;
+		requests[i].devname = "tmpfs";
+	}
+	/* only stat()ed */
+	requests[1].mountdir = NULL;
+}
+
+int main(void) {
+	/* tmpfs, as bind mounts of containers often are */
+	char base[] = "/dev/shm/test_check_disk_stat.XXXXXX";
+	char *paths[NOF_PATHS];
+	disk_stat_request *plain = calloc(NOF_PATHS, sizeof(*plain));
+	disk_stat_request *batched = calloc(NOF_PATHS, sizeof(*batched));
+	struct timeval start;
+	double plain_time;
+	double batched_time;
+	int mismatches = 0;
+	int ok_count = 0;
+
+	plan_tests(6);
+
+	if (access("/dev/shm", W_OK) != 0 || mkdtemp(base) == NULL) {
+		skip(6, "no tmpfs fixture in /dev/shm");
+		return exit_status();
+	}
+
+	for (int i = 0; i < NOF_PATHS; i++) {
+		char path[PATH_MAX];
+
+		snprintf(path, sizeof(path), "%s/p%04d", base, i);
+		paths[i] = strdup(path);
+		/* one missing path */
+		if (i != 7)
+			mkdir(paths[i], 0700);
+	}
+
+	setup(plain, paths, base);
+	disk_stat_set_batch(false);
+	gettimeofday(&start, NULL);
+	disk_stat_run(plain, NOF_PATHS, 5);
+	plain_time = seconds_since(&start);
+
+	setup(batched, paths, base);
+	disk_stat_set_batch(true);
+	gettimeofday(&start, NULL);
+	disk_stat_run(batched, NOF_PATHS, 5);
+	batched_time = seconds_since(&start);
+
+	diag("stat and statvfs of %d paths: %.4fs with threads, %.4fs batched", NOF_PATHS, plain_time, batched_time);
+
+	for (int i = 0; i < NOF_PATHS; i++) {
+		if (batched[i].status != plain[i].status || batched[i].fsu.fsu_blocks != plain[i].fsu.fsu_blocks ||
+			batched[i].fsu.fsu_blocksize != plain[i].fsu.fsu_blocksize)
+			mismatches++;
+		if (batched[i].status == DISK_STAT_OK)
+			ok_count++;
+	}
+	ok(mismatches == 0, "batched results are the same as the plain ones");
+	ok(ok_count == NOF_PATHS - 1, "all existing paths answered");
+	ok(batched[7].status == DISK_STAT_FAILED && batched[7].error == ENOENT, "missing path failed with ENOENT");
+	ok(plain[7].status == DISK_STAT_FAILED && plain[7].error == ENOENT, "also without batching");
+	ok(batched[1].status == DISK_STAT_OK && batched[1].fsu.fsu_blocks == 0, "stat() only request has no usage");
+	ok(batched[0].fsu.fsu_blocks > 0 && batched[NOF_PATHS - 1].fsu.fsu_blocks == batched[0].fsu.fsu_blocks,
+	   "usage shared between the paths on the same file system");
+
+	for (int i = 0; i < NOF_PATHS; i++)
+		rmdir(paths[i]);
+	rmdir(base);
+
+	return exit_status();
+}
@@ -0,0 +1,69 @@
+
+#include "../check_hpjd.d/status.h"
+#include "../../tap/tap.h"
+
+/* A response of a printer to the request of hpjd_oids */
+static snmp_varbind varbinds[HPJD_NOF_OIDS];
+static snmp_pdu response = {.type = SNMP_PDU_RESPONSE, .varbinds = varbinds, .nof_varbinds = HPJD_NOF_OIDS};
+
+static void printer(const char *display) {
+	for (size_t i = 0; i < HPJD_NOF_OIDS; i++) {
+		snmp_oid_parse(hpjd_oids[i], &varbinds[i].oid);
+		varbinds[i].value = (snmp_value){.type = SNMP_INTEGER, .integer = 0};
+	}
+	varbinds[HPJD_NOF_OIDS - 1].value =
+		(snmp_value){.type = SNMP_OCTET_STRING, .bytes = (const uint8_t *)display, .length = strlen(display)};
+}
+
+int main(void) {
+	hpjd_status status;
+	const char *message;
+	char error[256];
+
+	plan_tests(13);
+
+	printer("READY");
+	ok(hpjd_status_decode(&status, &response, error, sizeof(error)) && strcmp(status.display_message, "READY") == 0, "Status decoded");
+	ok(hpjd_status_check(&status, true, &message) == STATE_OK && message == NULL, "Ready printer is ok");
+
+	printer("PAPER JAM\r\nTRAY 2");
+	varbinds[4].value.integer = 1;
+	varbinds[6].value.integer = 1;
+	ok(hpjd_status_decode(&status, &response, error, sizeof(error)) && status.paper_jam && status.toner_low,
+	   "Flags in the order of the OIDs");
+	ok(strcmp(status.display_message, "PAPER JAM  TRAY 2") == 0, "Lines of the panel folded (%s)", status.display_message);
+	ok(hpjd_status_check(&status, true, &message) == STATE_WARNING && strcmp(message, "Paper Jam") == 0, "Paper jam before toner low");
+
+	printer("LOAD TRAY 1");
+	varbinds[5].value.integer = 1;
+	hpjd_status_decode(&status, &response, error, sizeof(error));
+	ok(hpjd_status_check(&status, true, &message) == STATE_WARNING && strcmp(message, "Out of Paper") == 0, "Out of paper");
+	ok(hpjd_status_check(&status, false, &message) == STATE_OK, "Out of paper ok with -D");
+
+	printer("POWERSAVE ON");
+	varbinds[0].value.integer = OFFLINE;
+	hpjd_status_decode(&status, &response, error, sizeof(error));
+	ok(hpjd_status_check(&status, true, &message) == STATE_OK, "Offline in power save is ok");
+	printer("OFFLINE");
+	varbinds[0].value.integer = OFFLINE;
+	hpjd_status_decode(&status, &response, error, sizeof(error));
+	ok(hpjd_status_check(&status, true, &message) == STATE_WARNING && strcmp(message, "Printer Offline") == 0, "Offline printer");
+
+	printer("READY");
+	varbinds[9].value = (snmp_value){.type = SNMP_NO_SUCH_OBJECT};
+	ok(!hpjd_status_decode(&status, &response, error, sizeof(error)) && strstr(error, HPJD_GD_DOOR_OPEN ".0") == error,
+	   "Missing OID reported (%s)", error);
+	printer("READY");
+	response.nof_varbinds = 11;
+	ok(!hpjd_status_decode(&status, &response, error, sizeof(error)), "Short response rejected");
+	response.nof_varbinds = HPJD_NOF_OIDS;
+
+	/* lines as snmpget -OQa prints them, after the '=' */
+	memset(&status, 0, sizeof(status));
+	hpjd_status_set(&status, 9, " 1");
+	hpjd_status_set(&status, HPJD_NOF_OIDS - 1, " \"READY\"");
+	ok(status.door_open == 1 && strcmp(status.display_message, "\"READY\"") == 0, "Status set from text");
+	ok(hpjd_status_check(&status, true, &message) == STATE_WARNING && strcmp(message, "A Door is Open") == 0, "Door open");
+
+	return exit_status();
+}
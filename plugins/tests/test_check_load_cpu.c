@@ -0,0 +1,120 @@
+
+#include "../check_load.d/cpu.h"
+#include "../check_load.d/top.h"
+#include "../../tap/tap.h"
+
+static void write_file(const char *filename, const char *text) {
+	FILE *fp = fopen(filename, "w");
+
+	if (fp != NULL) {
+		fputs(text, fp);
+		fclose(fp);
+	}
+}
+
+static proc_scan_entry process(pid_t pid, float pcpu) {
+	proc_scan_entry entry = {.pid = pid, .pcpu = pcpu};
+
+	snprintf(entry.prog, sizeof(entry.prog), "proc%d", (int)pid);
+	return entry;
+}
+
+/* The kept processes are those of the most %CPU, the most first */
+static bool top_sorted(const load_top *top) {
+	for (size_t p = 1; p < top->nof_processes; p++) {
+		if (top->processes[p - 1].pcpu < top->processes[p].pcpu)
+			return false;
+	}
+	return true;
+}
+
+int main(void) {
+	load_cpu_times cpu;
+	load_pressure pressure;
+	load_sample first;
+	load_sample second;
+	load_usage usage;
+	load_top top;
+	proc_scan_entry entry;
+	char directory[] = "/tmp/check_load_XXXXXX";
+	char stat_file[64];
+	char pressure_file[64];
+
+	plan_tests(17);
+
+	ok(load_parse_stat("cpu  100 20 30 400 50 6 7 8 0 0\ncpu0 50 10 15 200 25 3 3 4 0 0\n", &cpu) && cpu.user == 100 && cpu.nice == 20 &&
+		   cpu.idle == 400 && cpu.iowait == 50 && cpu.steal == 8,
+	   "Line of all CPUs decoded");
+	ok(load_parse_stat("cpu  1 2 3 4\n", &cpu) && cpu.idle == 4 && cpu.iowait == 0 && cpu.steal == 0, "Line of an old kernel decoded");
+	ok(!load_parse_stat("cpu0 1 2 3 4\n", &cpu), "Line of one CPU rejected");
+	ok(load_parse_pressure("some avg10=1.50 avg60=0.75 avg300=0.10 total=123456\nfull avg10=0.00 avg60=0.00 avg300=0.00 total=0\n",
+						   &pressure) &&
+		   pressure.avg10 == 1.5 && pressure.avg60 == 0.75 && pressure.total == 123456,
+	   "Pressure decoded");
+	ok(!load_parse_pressure("full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n", &pressure), "No some line");
+
+	/* two seconds of two CPUs, 400 ticks */
+	memset(&first, 0, sizeof(first));
+	memset(&second, 0, sizeof(second));
+	first.cpu = (load_cpu_times){.user = 1000, .system = 500, .idle = 5000, .iowait = 100, .steal = 10};
+	second.cpu = (load_cpu_times){.user = 1100, .system = 540, .idle = 5220, .iowait = 120, .steal = 30};
+	second.time.tv_sec = 2;
+	first.has_pressure = second.has_pressure = true;
+	first.pressure.total = 1000000;
+	second.pressure.total = 1500000;
+	second.pressure.avg10 = 25.0;
+	load_usage_between(&first, &second, &usage);
+	ok(usage.utilization == 35.0 && usage.iowait == 5.0 && usage.steal == 5.0, "Shares of the CPU time (%.1f%%, %.1f%%, %.1f%%)",
+	   usage.utilization, usage.iowait, usage.steal);
+	ok(usage.has_pressure && usage.pressure == 25.0 && usage.avg10 == 25.0, "Pressure over the window (%.1f%%)", usage.pressure);
+	second.has_pressure = false;
+	load_usage_between(&first, &second, &usage);
+	ok(!usage.has_pressure, "No pressure without PSI");
+
+	if (mkdtemp(directory) == NULL) {
+		skip(3, "could not create a directory for the fixture");
+	} else {
+		snprintf(stat_file, sizeof(stat_file), "%s/stat", directory);
+		snprintf(pressure_file, sizeof(pressure_file), "%s/cpu", directory);
+		write_file(stat_file, "cpu  1 2 3 4 5 6 7 8 0 0\n");
+		write_file(pressure_file, "some avg10=0.00 avg60=0.00 avg300=0.00 total=42\n");
+		ok(load_sample_read(&first, stat_file, pressure_file) && first.cpu.steal == 8 && first.has_pressure && first.pressure.total == 42,
+		   "Sample read from the files");
+		unlink(pressure_file);
+		ok(load_sample_read(&first, stat_file, pressure_file) && !first.has_pressure, "Sample without pressure");
+		unlink(stat_file);
+		ok(!load_sample_read(&first, stat_file, pressure_file), "No sample without the CPU time");
+		rmdir(directory);
+	}
+
+	load_top_init(&top, 3);
+	entry = process(1, 5.0f);
+	load_top_add(&top, &entry);
+	entry = process(2, 50.0f);
+	load_top_add(&top, &entry);
+	entry = process(3, 0.5f);
+	load_top_add(&top, &entry);
+	ok(top.nof_processes == 3 && top.processes[0].pid == 2 && top.processes[2].pid == 3, "Processes in the order of their %%CPU");
+	entry = process(4, 0.1f);
+	load_top_add(&top, &entry);
+	ok(top.nof_processes == 3 && top.processes[2].pid == 3, "Process of less %%CPU than all kept skipped");
+	entry = process(5, 20.0f);
+	load_top_add(&top, &entry);
+	ok(top.processes[0].pid == 2 && top.processes[1].pid == 5 && top.processes[2].pid == 1 && strcmp(top.processes[1].prog, "proc5") == 0,
+	   "Process of more %%CPU taken in, the last one dropped");
+	load_top_free(&top);
+
+	load_top_init(&top, 0);
+	load_top_add(&top, &entry);
+	ok(top.nof_processes == 0, "Nothing kept of none");
+	load_top_free(&top);
+
+	load_top_init(&top, 5);
+	ok(load_top_scan(&top, PROC_SCAN_ROOT) && top.nof_processes > 0 && top_sorted(&top), "Top processes of %s", PROC_SCAN_ROOT);
+	load_top_free(&top);
+	load_top_init(&top, 5);
+	ok(!load_top_scan(&top, "/nonexistent"), "No scan without /proc");
+	load_top_free(&top);
+
+	return exit_status();
+}
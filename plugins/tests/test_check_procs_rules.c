@@ -0,0 +1,214 @@
+
+#include "../check_procs.d/rules.h"
+#include "utils_cmd.h"
+#include "../../tap/tap.h"
+
+#include <ctype.h>
+
+static bool literal_is(const char *re, const char *expected) {
+	char *literal = procs_regex_literal(re);
+	bool result = (literal == NULL || expected == NULL) ? literal == expected : strcmp(literal, expected) == 0;
+
+	if (!result)
+		diag("%s: got '%s', expected '%s'", re, literal ? literal : "(none)", expected ? expected : "(none)");
+	free(literal);
+	return result;
+}
+
+static void rule_setup(procs_rule *rule, int options, const char *re) {
+	procs_rule_init(rule, "test");
+	rule->options = options;
+	rule->uid = 33;
+	rule->statopts = "S";
+	rule->prog = "apache2";
+	rule->args = "-k start";
+	if (re) {
+		regcomp(&rule->re_args, re, REG_NOSUB | REG_EXTENDED);
+		rule->re_literal = procs_regex_literal(re);
+		rule->re_literal_length = rule->re_literal ? strlen(rule->re_literal) : 0;
+	}
+	procs_rule_compile(rule);
+}
+
+/* the filters the way check_procs used to apply them, all of them */
+static bool matches_unconditionally(const procs_rule *rule, const proc_scan_entry *process) {
+	int resultsum = 0;
+
+	if ((rule->options & STAT) && (strstr(process->stat, rule->statopts)))
+		resultsum |= STAT;
+	if ((rule->options & ARGS) && (strstr(process->args, rule->args) != NULL))
+		resultsum |= ARGS;
+	if ((rule->options & EREG_ARGS) && (regexec(&rule->re_args, process->args, (size_t)0, NULL, 0) == 0))
+		resultsum |= EREG_ARGS;
+	if ((rule->options & PROG) && (strcmp(rule->prog, process->prog) == 0))
+		resultsum |= PROG;
+	if ((rule->options & USER) && (process->uid == rule->uid))
+		resultsum |= USER;
+	return rule->options == resultsum || rule->options == ALL;
+}
+
+/* The options of the filters, cheapest first */
+static const int filter_order[] = {USER, PPID, VSZ, RSS, PCPU, STAT, PROG, EXCLUDE_PROGS, ARGS, EREG_ARGS};
+#define NOF_FILTERS (int)(sizeof(filter_order) / sizeof(filter_order[0]))
+
+/* Whether the filters of all options come in the order of their cost, each
+ * the same as that of a rule of just its option */
+static bool filters_ordered(void) {
+	procs_rule all;
+	procs_rule single;
+	bool result = true;
+
+	procs_rule_init(&all, "all");
+	for (int i = 0; i < NOF_FILTERS; i++)
+		all.options |= filter_order[i];
+	procs_rule_compile(&all);
+	if (all.nof_filters != NOF_FILTERS)
+		return false;
+	for (int i = 0; i < NOF_FILTERS; i++) {
+		procs_rule_init(&single, "single");
+		single.options = filter_order[i];
+		procs_rule_compile(&single);
+		if (single.nof_filters != 1 || single.filters[0] != all.filters[i]) {
+			diag("filter %d out of order", i);
+			result = false;
+		}
+	}
+	return result;
+}
+
+/* Whether the bounds of intervals keep no command lines from the regex they
+ * match */
+static bool intervals_matched(void) {
+	static const char *const intervals[][2] = {
+		{"ab{10}", "/usr/bin/abbbbbbbbbb"}, {"x{2,3}yz", "/opt/xxxyz --foo"}, {"[a-z]{12}", "/usr/bin/abcdefghijkl"}};
+	proc_scan_entry process = {0};
+	procs_rule rule;
+	bool result = true;
+
+	for (size_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++) {
+		rule_setup(&rule, EREG_ARGS, intervals[i][0]);
+		process.args = strdup(intervals[i][1]);
+		process.args_length = strlen(process.args);
+		if (!procs_rule_matches(&rule, &process)) {
+			diag("%s does not match %s", intervals[i][0], intervals[i][1]);
+			result = false;
+		}
+		free(process.args);
+	}
+	return result;
+}
+
+int main(void) {
+	output chld_out;
+	proc_scan_entry *processes;
+	size_t nof_processes = 0;
+	procs_rule rules[4];
+	int rule_argc;
+	char **rule_argv;
+	proc_scan_entry process = {0};
+	bool same = true;
+
+	plan_tests(29);
+
+	ok(literal_is("sshd", "sshd"), "Plain string");
+	ok(literal_is("^/usr/sbin/sshd( |$)", "/usr/sbin/sshd"), "Anchor and group");
+	ok(literal_is("a|b", NULL), "Alternatives");
+	ok(literal_is("(foo|bar)baz", "baz"), "Alternatives in a group");
+	ok(literal_is("jre.*-Xmx[0-9]+g", "-Xmx"), "Bracket expression");
+	ok(literal_is("colou?r", "colo"), "Optional character");
+	ok(literal_is("ab+c", "ab"), "Repeated character");
+	ok(literal_is("x{2}yz", "yz"), "Interval");
+	ok(literal_is("ab{10}", "a"), "Bounds of an interval");
+	ok(literal_is("x{2,3}yz", "yz"), "Bounds of an interval with a maximum");
+	ok(literal_is("[a-z]{12}", NULL), "Interval of a bracket expression");
+	ok(literal_is("\\.py\\b", ".py"), "Escapes");
+	ok(literal_is("[[:digit:]]abc", "abc"), "Character class");
+	ok(literal_is(".*", NULL), "Nothing literal");
+
+	ok(procs_rule_split("web server : -C apache2 -a 'a b' --ereg-argument-array=x\\ \"y z\"", &rule_argc, &rule_argv) && rule_argc == 6,
+	   "Rule split");
+	ok(strcmp(rule_argv[0], "web server") == 0 && strcmp(rule_argv[4], "a b") == 0 &&
+		   strcmp(rule_argv[5], "--ereg-argument-array=x y z") == 0 && rule_argv[6] == NULL,
+	   "Quotes and escapes");
+	ok(!procs_rule_split("-C apache2", &rule_argc, &rule_argv), "No name");
+	ok(!procs_rule_split("web: -a 'a b", &rule_argc, &rule_argv), "Unclosed quote");
+
+	/* the fixture of tests/check_procs.t, many times over */
+	if (cmd_file_read("./var/ps-axwo.debian", &chld_out, 0) != 0 || chld_out.lines < 2) {
+		skip(10, "fixture not found");
+		return exit_status();
+	}
+	processes = calloc(chld_out.lines - 1, sizeof(proc_scan_entry));
+	for (size_t j = 1; j < chld_out.lines; j++) {
+		char procstat[8];
+		char procetime[MAX_INPUT_BUFFER];
+		char procprog[MAX_INPUT_BUFFER];
+		int procuid;
+		pid_t procpid;
+		pid_t procppid;
+		int procvsz;
+		int procrss;
+		float procpcpu;
+		int pos;
+		proc_scan_entry *process = &processes[nof_processes];
+
+		if (sscanf(chld_out.line[j], PS_FORMAT, PS_VARLIST) < PS_COLS - 1)
+			continue;
+		strcpy(process->stat, procstat);
+		process->uid = procuid;
+		process->pid = procpid;
+		process->ppid = procppid;
+		snprintf(process->prog, sizeof(process->prog), "%.*s", (int)sizeof(process->prog) - 1, procprog);
+		process->args = strdup(chld_out.line[j] + pos);
+		process->args_length = strlen(process->args);
+		while (process->args_length > 0 && isspace((unsigned char)process->args[process->args_length - 1]))
+			process->args[--process->args_length] = '\0';
+		nof_processes++;
+	}
+
+	rule_setup(&rules[0], EREG_ARGS, "^/usr/sbin/apache2 -k (start|graceful)");
+	rule_setup(&rules[1], EREG_ARGS | USER, "apache2.*start");
+	rule_setup(&rules[2], PROG | ARGS | STAT, NULL);
+	rule_setup(&rules[3], EREG_ARGS, "nfs[a-z]*|rpc");
+	ok(rules[0].nof_filters == 1 && strcmp(rules[0].re_literal, "/usr/sbin/apache2 -k ") == 0, "Literal of the rule");
+	ok(rules[1].filters[0] != rules[0].filters[0], "Uid checked before the regex");
+	ok(rules[3].re_literal == NULL, "No literal for alternatives");
+	ok(filters_ordered(), "Filters ordered by cost");
+	rule_setup(&rules[0], ALL, NULL);
+	ok(rules[0].nof_filters == 0 && procs_rule_matches(&rules[0], &processes[0]), "No filters for all processes");
+	rule_setup(&rules[0], EREG_ARGS, "^/usr/sbin/apache2 -k (start|graceful)");
+
+	/* the arguments must not be looked at, reading them would crash */
+	process.uid = 0;
+	process.args = NULL;
+	ok(!procs_rule_matches(&rules[1], &process), "Stops at the first filter which does not match");
+	/* the regex would match, a literal it does not contain stops it before */
+	process.args = "/usr/sbin/apache2 -k start";
+	process.args_length = strlen(process.args);
+	free(rules[0].re_literal);
+	rules[0].re_literal = strdup("nginx");
+	rules[0].re_literal_length = 5;
+	ok(!procs_rule_matches(&rules[0], &process), "Regex only run if the literal is there");
+	free(rules[0].re_literal);
+	rules[0].re_literal = procs_regex_literal("^/usr/sbin/apache2 -k (start|graceful)");
+	rules[0].re_literal_length = strlen(rules[0].re_literal);
+	ok(procs_rule_matches(&rules[0], &process), "Regex run if the literal is there");
+	ok(intervals_matched(), "Intervals matched through the literal");
+
+	for (int r = 0; r < 4; r++) {
+		int pipeline = 0;
+		int unconditional = 0;
+
+		for (size_t i = 0; i < nof_processes; i++) {
+			pipeline += procs_rule_matches(&rules[r], &processes[i]);
+			unconditional += matches_unconditionally(&rules[r], &processes[i]);
+		}
+		diag("rule %d: %d of %zu processes", r, pipeline, nof_processes);
+		if (pipeline != unconditional || (r < 3 && pipeline == 0))
+			same = false;
+	}
+	ok(same, "Same processes matched");
+	ok(procs_rule_matches(&rules[2], &processes[0]) == false, "systemd is no apache2");
+
+	return exit_status();
+}
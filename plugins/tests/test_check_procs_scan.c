@@ -0,0 +1,178 @@
+#include "../check_procs.d/proc_scan.h"
+#include "../check_procs.d/rates.h"
+#include "../check_procs.d/groups.h"
+#include "utils_cmd.h"
+#include "../../tap/tap.h"
+
+#include <sys/time.h>
+
+/* the fixtures are read relative to the directory the tests are run in */
+#define FIXTURE       "./var/proc"
+#define FIXTURE_LATER "./var/proc_later"
+
+static double seconds_since(struct timeval *start) {
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_usec - start->tv_usec) / 1.0e6;
+}
+
+/* the way check_procs parses the output of ps */
+static int parse_ps_output(output *chld_out) {
+	char procstat[8];
+	char procetime[MAX_INPUT_BUFFER];
+	char procprog[MAX_INPUT_BUFFER];
+	int procuid;
+	pid_t procpid;
+	pid_t procppid;
+	int procvsz;
+	int procrss;
+	float procpcpu;
+	int pos;
+	int parsed = 0;
+
+	for (size_t j = 1; j < chld_out->lines; j++) {
+		if (sscanf(chld_out->line[j], PS_FORMAT, PS_VARLIST) >= PS_COLS - 1)
+			parsed++;
+	}
+	return parsed;
+}
+
+/* The live /proc against ps as check_procs runs it, only reported, the
+ * machine may be busy with anything else */
+static void benchmark(void) {
+	proc_scan scan = {0};
+	proc_scan_entry entry;
+	struct timeval start;
+	output chld_out;
+	output chld_err;
+	double scan_time;
+	int scanned = 0;
+
+	if (!proc_scan_open(&scan, PROC_SCAN_ROOT, PROC_SCAN_UID | PROC_SCAN_ARGS)) {
+		diag("no /proc to compare with ps");
+		return;
+	}
+	gettimeofday(&start, NULL);
+	while (proc_scan_next(&scan, &entry))
+		scanned++;
+	scan_time = seconds_since(&start);
+	proc_scan_close(&scan);
+
+	gettimeofday(&start, NULL);
+	if (cmd_run(PS_COMMAND, &chld_out, &chld_err, 0) != 0 || chld_out.lines < 2) {
+		diag("ps could not be run to compare with");
+		return;
+	}
+	diag("%d processes from /proc in %.4fs, %d from ps in %.4fs", scanned, scan_time, parse_ps_output(&chld_out), seconds_since(&start));
+}
+
+int main(void) {
+	proc_scan scan = {0};
+	proc_scan later = {0};
+	proc_scan_entry entry;
+	int scanned = 0;
+	bool found_sshd = false;
+	bool found_kthread = false;
+	bool found_java = false;
+	bool found_other = false;
+	procs_rates rates = {0};
+	procs_groups groups = {0};
+	char cgroups[64];
+	char key[32];
+	procs_tracked tracked = {0};
+	unsigned long long value;
+	double rate;
+
+	plan_tests(30);
+
+	/* 100 ticks per second, 4 KiB pages, started 50s before an uptime of 150s */
+	scan.ticks = 100;
+	scan.page_kib = 4;
+	scan.uptime = 150;
+	ok(proc_scan_parse_stat(&scan, "1234 (my (odd) prog) S 1 1234 1234 0 -1 4194560 100 0 0 0 200 300 0 0 20 0 1 0 10000 104857600 256 "
+									"18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 1 0 0 0 0 0\n",
+							&entry),
+	   "Stat line parsed");
+	ok(entry.pid == 1234 && entry.ppid == 1, "Process ids");
+	ok(strcmp(entry.prog, "my (odd) prog") == 0, "Command name with parentheses (%s)", entry.prog);
+	ok(strcmp(entry.stat, "Ss") == 0, "Session leader flag (%s)", entry.stat);
+	ok(entry.vsz == 102400 && entry.rss == 1024, "Memory in KiB");
+	ok(entry.seconds == 50 && entry.pcpu == 10, "Elapsed time and CPU (%d, %g)", entry.seconds, entry.pcpu);
+
+	ok(proc_scan_parse_stat(&scan, "77 (worker) R 10 5 3 34816 5 0 0 0 0 0 0 0 0 0 20 -5 4 0 20000 0 0\n", &entry) &&
+		   strcmp(entry.stat, "R<l+") == 0 && entry.seconds == 0 && entry.pcpu == 0,
+	   "High priority, threaded, foreground, started after the uptime (%s)", entry.stat);
+	ok(!proc_scan_parse_stat(&scan, "77 (worker) R 10 5\n", &entry), "Truncated line");
+	ok(!proc_scan_parse_stat(&scan, "77 worker R 10 5 3 34816 5 0 0 0 0 0 0 0 0 0 20 -5 4 0 20000 0 0\n", &entry), "No command name");
+
+	ok(proc_scan_parse_uid("Name:\tsshd\nUmask:\t0022\nState:\tS (sleeping)\nUid:\t1000\t0\t0\t0\nGid:\t0\t0\t0\t0\n") == 0,
+	   "Effective uid");
+	ok(proc_scan_parse_uid("Name:\tsshd\n") == -1, "No uid");
+	ok(proc_scan_parse_value("rchar: 1\nread_bytes: 4096\nwrite_bytes: 0\n", "read_bytes", &value) && value == 4096, "Value parsed");
+	ok(!proc_scan_parse_value("rchar: 1\nread_bytes_x: 4096\n", "read_bytes", &value), "Only the whole name");
+
+	/* 50 ticks of 100 per second, 2MB written and 30 context switches in 2s */
+	tracked.valid = true;
+	tracked.before = (proc_counters){.cpu_ticks = 100, .context_switches = 10, .write_bytes = 0, .has_io = true, .time = {10, 0}};
+	tracked.after = (proc_counters){.cpu_ticks = 150, .context_switches = 40, .write_bytes = 2000000, .has_io = true, .time = {12, 0}};
+	ok(procs_rates_value(&tracked, METRIC_CPU_RATE, 100, &rate) && rate == 25, "CPU rate (%g)", rate);
+	ok(procs_rates_value(&tracked, METRIC_WRITE_RATE, 100, &rate) && rate == 1000000, "Write rate");
+	ok(procs_rates_value(&tracked, METRIC_CSW_RATE, 100, &rate) && rate == 15, "Context switch rate");
+	tracked.after.has_io = false;
+	ok(!procs_rates_value(&tracked, METRIC_READ_RATE, 100, &rate), "No I/O rate without /proc/<pid>/io");
+
+	strcpy(cgroups, "12:cpu,cpuacct:/old\n0::/system.slice/ssh.service\n");
+	ok(strcmp(proc_scan_parse_cgroup(cgroups), "/system.slice/ssh.service") == 0, "Unified hierarchy preferred");
+	strcpy(cgroups, "4:memory:/user.slice\n");
+	ok(strcmp(proc_scan_parse_cgroup(cgroups), "/user.slice") == 0, "Controller hierarchy without a unified one");
+
+	ok(proc_scan_open(&scan, FIXTURE, PROC_SCAN_UID | PROC_SCAN_ARGS), "Fixture opened");
+	while (proc_scan_next(&scan, &entry)) {
+		scanned++;
+		if (entry.pid == 1)
+			found_sshd = entry.uid == 0 && strcmp(entry.args, "/usr/sbin/sshd -D -o a b") == 0 && entry.vsz == 400;
+		else if (entry.pid == 2)
+			found_kthread = strcmp(entry.args, "[kthreadd]") == 0;
+		else if (entry.pid == 3)
+			found_java = entry.uid == 1000 && strlen(entry.args) == 6020 && strncmp(entry.args, "/usr/bin/java -Dpad=aaa", 23) == 0;
+		else
+			found_other = true;
+	}
+	proc_scan_close(&scan);
+	ok(scanned == 3 && !found_other, "Only complete processes returned (%d)", scanned);
+	ok(found_sshd, "Arguments joined");
+	ok(found_kthread, "Kernel thread shown with its name");
+	ok(found_java, "Arguments longer than the first buffer");
+
+	ok(proc_scan_open(&scan, FIXTURE, 0) && proc_scan_next(&scan, &entry) && entry.uid == -1 && entry.args[0] == '\0',
+	   "Uid and arguments only read when asked for");
+	proc_scan_close(&scan);
+
+	/* the cgroup files are found below the fixture as well */
+	ok(proc_scan_open(&scan, FIXTURE, PROC_SCAN_CGROUP), "Fixture opened with cgroups");
+	while (proc_scan_next(&scan, &entry))
+		procs_groups_add(&groups, procs_group_key(GROUP_CGROUP, &entry, key, sizeof(key)), &entry);
+	proc_scan_close(&scan);
+	procs_groups_sort(&groups);
+	ok(groups.nof_groups == 2 && strcmp(groups.groups[1]->key, "/system.slice/ssh.service") == 0 &&
+		   procs_group_read_cgroup(groups.groups[1], FIXTURE) && groups.groups[1]->rss == 1024 && groups.groups[1]->cpu_usage == 2.5,
+	   "Memory and CPU time of a cgroup");
+
+	/* by the second sample pid 2 is another process and pid 3 has exited */
+	ok(proc_scan_open(&scan, FIXTURE, 0) && proc_scan_open(&later, FIXTURE_LATER, 0), "Fixtures opened again");
+	while (proc_scan_next(&scan, &entry))
+		procs_rates_track(&rates, 0, &entry);
+	procs_rates_sample(&rates, &scan, true);
+	procs_rates_sample(&rates, &later, false);
+	ok(rates.nof_tracked == 3 && rates.tracked[0].pid == 1 && rates.tracked[0].valid && !rates.tracked[1].valid &&
+		   !rates.tracked[2].valid && rates.tracked[0].after.context_switches == 6 && !rates.tracked[0].after.has_io,
+	   "Processes with a reused pid or gone not sampled");
+	procs_rates_free(&rates);
+	proc_scan_close(&scan);
+	proc_scan_close(&later);
+
+	ok(!proc_scan_open(&scan, "/nonexistent", 0), "Missing root");
+
+	benchmark();
+	return exit_status();
+}
@@ -0,0 +1,191 @@
+
+#include "../check_snmp.d/ber.h"
+#include "../check_snmp.d/session.h"
+#include "../../tap/tap.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+/* A GET of sysUpTime.0 with community public, request id 1 */
+static const uint8_t get_sysuptime[] = {0x30, 0x26, 0x02, 0x01, 0x00, 0x04, 0x06, 'p',  'u',  'b',  'l',  'i',  'c',
+										0xa0, 0x19, 0x02, 0x01, 0x01, 0x02, 0x01, 0x00, 0x02, 0x01, 0x00, 0x30, 0x0e,
+										0x30, 0x0c, 0x06, 0x08, 0x2b, 0x06, 0x01, 0x02, 0x01, 0x01, 0x03, 0x00, 0x05, 0x00};
+
+static bool formats_as(snmp_value *value, const char *expected) {
+	char text[256];
+
+	snmp_value_format(value, text, sizeof(text));
+	if (strcmp(text, expected) != 0) {
+		diag("got '%s', expected '%s'", text, expected);
+		return false;
+	}
+	return true;
+}
+
+/* Answers every second request with the OIDs asked for and a value of each
+ * type, the first attempt is dropped to exercise the retries */
+static void agent(int fd) {
+	uint8_t buffer[SNMP_MAX_MESSAGE];
+	snmp_varbind varbinds[8];
+	snmp_pdu pdu = {.varbinds = varbinds};
+	struct sockaddr_storage peer;
+	socklen_t peer_length;
+	static const uint8_t text[] = "Linux agent";
+
+	for (int requests = 1;; requests++) {
+		ssize_t received;
+		size_t length;
+
+		peer_length = sizeof(peer);
+		received = recvfrom(fd, buffer, sizeof(buffer), 0, (struct sockaddr *)&peer, &peer_length);
+		if (received <= 0 || !snmp_decode(buffer, (size_t)received, &pdu, 8))
+			_exit(1);
+		if (requests % 2 == 1)
+			continue;
+		pdu.type = SNMP_PDU_RESPONSE;
+		for (size_t i = 0; i < pdu.nof_varbinds; i++) {
+			snmp_value *value = &varbinds[i].value;
+
+			memset(value, 0, sizeof(*value));
+			switch (i) {
+			case 0:
+				value->type = SNMP_OCTET_STRING;
+				value->bytes = text;
+				value->length = sizeof(text) - 1;
+				break;
+			case 1:
+				value->type = SNMP_COUNTER64;
+				value->counter = UINT64_MAX - 1;
+				break;
+			case 2:
+				value->type = SNMP_INTEGER;
+				value->integer = -42;
+				break;
+			default:
+				value->type = SNMP_NO_SUCH_INSTANCE;
+			}
+		}
+		/* pdu.community still points into buffer */
+		length = snmp_encode(&pdu, buffer + SNMP_MAX_MESSAGE / 2, SNMP_MAX_MESSAGE / 2);
+		sendto(fd, buffer + SNMP_MAX_MESSAGE / 2, length, 0, (struct sockaddr *)&peer, peer_length);
+	}
+}
+
+/* A UDP socket on the loopback interface, its port in port */
+static int bind_loopback(char *port, size_t size) {
+	struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = 0};
+	socklen_t length = sizeof(address);
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+		getsockname(fd, (struct sockaddr *)&address, &length) != 0)
+		return -1;
+	snprintf(port, size, "%u", ntohs(address.sin_port));
+	return fd;
+}
+
+int main(void) {
+	static snmp_session session;
+	uint8_t buffer[512];
+	snmp_varbind requested[4];
+	snmp_varbind varbinds[4];
+	snmp_pdu request = {.version = SNMP_VERSION_1, .community = "public", .community_length = 6, .type = SNMP_PDU_GET, .request_id = 1};
+	snmp_pdu response = {.varbinds = varbinds};
+	snmp_value value;
+	char text[256];
+	char port[16];
+	size_t length;
+	pid_t child;
+	int fd;
+
+	plan_tests(25);
+
+	ok(snmp_oid_parse(".1.3.6.1.2.1.1.3.0", &requested[0].oid) && requested[0].oid.length == 9, "OID parsed");
+	snmp_oid_format(&requested[0].oid, text, sizeof(text));
+	ok(strcmp(text, "iso.3.6.1.2.1.1.3.0") == 0, "OID formatted as without MIBs (%s)", text);
+	ok(!snmp_oid_parse("1.3.6.x", &value.oid) && !snmp_oid_parse("3.1", &value.oid) && !snmp_oid_parse("1.3.", &value.oid) &&
+		   !snmp_oid_parse("", &value.oid) && !snmp_oid_parse("1.3.6.1.4294967296", &value.oid),
+	   "Invalid OIDs rejected");
+
+	requested[0].value.type = SNMP_NULL;
+	request.varbinds = requested;
+	request.nof_varbinds = 1;
+	length = snmp_encode(&request, buffer, sizeof(buffer));
+	ok(length == sizeof(get_sysuptime) && memcmp(buffer, get_sysuptime, length) == 0, "GET encoded");
+	ok(snmp_encode(&request, buffer, 20) == 0, "Too small a buffer");
+	ok(snmp_decode(get_sysuptime, sizeof(get_sysuptime), &response, 4) && response.type == SNMP_PDU_GET && response.request_id == 1 &&
+		   response.nof_varbinds == 1 && snmp_oid_compare(&varbinds[0].oid, &requested[0].oid) == 0 &&
+		   varbinds[0].value.type == SNMP_NULL,
+	   "GET decoded");
+	ok(!snmp_decode(get_sysuptime, sizeof(get_sysuptime) - 1, &response, 4), "Truncated message rejected");
+
+	/* values at the edges of their encodings */
+	snmp_oid_parse("1.3.6.1.4.1.4294967295.2", &requested[0].oid);
+	requested[0].value = (snmp_value){.type = SNMP_INTEGER, .integer = INT32_MIN};
+	requested[1].oid = requested[0].oid;
+	requested[1].value = (snmp_value){.type = SNMP_COUNTER64, .counter = UINT64_MAX};
+	requested[2].oid = requested[0].oid;
+	requested[2].value = (snmp_value){.type = SNMP_INTEGER, .integer = 128};
+	requested[3].oid = requested[0].oid;
+	requested[3].value = (snmp_value){.type = SNMP_INTEGER, .integer = -129};
+	request.type = SNMP_PDU_RESPONSE;
+	request.nof_varbinds = 4;
+	length = snmp_encode(&request, buffer, sizeof(buffer));
+	ok(length > 0 && snmp_decode(buffer, length, &response, 4) && response.nof_varbinds == 4, "Values encoded and decoded");
+	ok(snmp_oid_compare(&varbinds[0].oid, &requested[0].oid) == 0, "Largest sub-identifier");
+	ok(varbinds[0].value.integer == INT32_MIN && varbinds[2].value.integer == 128 && varbinds[3].value.integer == -129,
+	   "Integers keep their sign");
+	ok(varbinds[1].value.type == SNMP_COUNTER64 && varbinds[1].value.counter == UINT64_MAX, "Counter64 as a number");
+	ok(snmp_decode(buffer, length, &response, 2) && response.nof_varbinds == 2, "Varbinds beyond the limit dropped");
+
+	value = (snmp_value){.type = SNMP_TIMETICKS, .counter = 123456};
+	ok(formats_as(&value, "Timeticks: (123456) 0:20:34.56"), "Timeticks");
+	value.counter = 8640000 * 2 + 360000;
+	ok(formats_as(&value, "Timeticks: (17640000) 2 days, 1:00:00.00"), "Timeticks of days");
+	value = (snmp_value){.type = SNMP_OCTET_STRING, .bytes = (const uint8_t *)"say \"C:\\\"", .length = 10};
+	ok(formats_as(&value, "STRING: \"say \\\"C:\\\\\\\"\""), "Quotes and backslashes escaped");
+	value = (snmp_value){.type = SNMP_OCTET_STRING, .bytes = (const uint8_t *)"\x00\x1b\xff", .length = 3};
+	ok(formats_as(&value, "Hex-STRING: 00 1B FF "), "Binary strings in hex");
+	value = (snmp_value){.type = SNMP_GAUGE32, .counter = 4294965296};
+	ok(formats_as(&value, "Gauge32: 4294965296"), "Gauge32");
+	value = (snmp_value){.type = SNMP_NO_SUCH_OBJECT};
+	ok(formats_as(&value, "No Such Object available on this agent at this OID"), "Exception");
+	ok(strcmp(snmp_error_text(2), "noSuchName") == 0 && strcmp(snmp_error_text(99), "unknown error") == 0, "Error status");
+
+	/* a stand-in for snmpd */
+	fd = bind_loopback(port, sizeof(port));
+	if (fd < 0 || (child = fork()) < 0) {
+		skip(6, "could not start an agent on the loopback interface");
+		return exit_status();
+	}
+	if (child == 0)
+		agent(fd);
+	close(fd);
+
+	session.version = SNMP_VERSION_2C;
+	session.community = "public";
+	session.timeout = 1;
+	session.retries = 1;
+	ok(snmp_session_open(&session, "127.0.0.1", port, AF_INET), "Session opened");
+	request.type = SNMP_PDU_GET;
+	request.nof_varbinds = 4;
+	for (size_t i = 0; i < 4; i++)
+		requested[i].value.type = SNMP_NULL;
+	ok(snmp_session_request(&session, &request, &response, 4), "Response after a retry");
+	ok(response.nof_varbinds == 4 && response.version == SNMP_VERSION_2C && response.request_id == request.request_id,
+	   "Response to the request");
+	ok(varbinds[1].value.type == SNMP_COUNTER64 && varbinds[1].value.counter == UINT64_MAX - 1 && varbinds[2].value.integer == -42,
+	   "Typed values");
+	ok(varbinds[3].value.type == SNMP_NO_SUCH_INSTANCE, "Exceptions in place of values");
+	session.retries = 0;
+	ok(!snmp_session_request(&session, &request, &response, 4) && strstr(session.error, "Timeout") != NULL,
+	   "Timeout when the agent does not answer (%s)", session.error);
+	snmp_session_close(&session);
+
+	kill(child, SIGTERM);
+	waitpid(child, NULL, 0);
+	return exit_status();
+}
@@ -0,0 +1,125 @@
+
+#include "../check_snmp.d/ber.h"
+#include "../check_snmp.d/mib.h"
+#include "../../tap/tap.h"
+
+#include <fcntl.h>
+
+/* Part of the tree as "snmptranslate -Tp" prints it */
+static char *tree[] = {
+	"+--iso(1)",
+	"   +--org(3)",
+	"   |  +--dod(6)",
+	"   |  |  +--internet(1)",
+	"   |  |  |  +--mgmt(2)",
+	"   |  |  |  |  +--mib-2(1)",
+	"   |  |  |  |  |  +--system(1)",
+	"   |  |  |  |  |  |  +-- -R-- String    sysDescr(1)",
+	"   |  |  |  |  |  |  |         Textual Convention: DisplayString",
+	"   |  |  |  |  |  |  |         Size: 0..255",
+	"   |  |  |  |  |  |  +-- -R-- TimeTicks sysUpTime(3)",
+	"   |  |  |  |  |  |  |  +--sysUpTimeInstance(0)",
+	"   |  |  |  |  |  |  +-- -RW- String    sysName(5)",
+	"   |  |  |  |  |  +--interfaces(2)",
+	"   |  |  |  |  |  |  +-- -R-- Integer32 ifNumber(1)",
+	"   |  |  |  |  |  |  +--ifTable(2)",
+	"   |  |  |  |  |  |  |  +--ifEntry(1)",
+	"   |  |  |  |  |  |  |  |   |  Index: ifIndex",
+	"   |  |  |  |  |  |  |  |  +-- -R-- Integer32 ifIndex(1)",
+	"   |  |  |  |  |  |  |  |  +-- -R-- EnumVal   ifOperStatus(8)",
+	"   |  |  |  |  |  |  |  |  |         Values: up(1), down(2), testing(3), unknown(4), dormant(5),",
+	"   |  |  |  |  |  |  |  |  |                 notPresent(6), lowerLayerDown(7)",
+	"   |  |  |  |  |  |  |  |  +-- -R-- Counter   ifInOctets(10)",
+	"   |  |  |  +--private(4)",
+	"   |  |  |  |  +--enterprises(1)",
+	"   |  |  |  |  |  +--ucdavis(2021)",
+};
+
+static bool translates_to(const snmp_mib_cache *cache, const char *name, const char *expected) {
+	snmp_oid oid;
+	snmp_oid wanted;
+
+	snmp_oid_parse(expected, &wanted);
+	if (!snmp_mib_cache_translate(cache, name, &oid)) {
+		diag("%s not translated", name);
+		return false;
+	}
+	return snmp_oid_compare(&oid, &wanted) == 0;
+}
+
+/* Whether the cache is rejected once value is written at offset, the
+ * header has 24 bytes and the objects sorted by name follow with 24 each */
+static bool rejected_with(const char *filename, off_t offset, uint32_t value) {
+	snmp_mib_cache cache;
+	size_t count;
+	int fd;
+	bool rejected;
+
+	snmp_mib_cache_build(tree, sizeof(tree) / sizeof(tree[0]), filename, &count);
+	fd = open(filename, O_WRONLY);
+	pwrite(fd, &value, sizeof(value), offset);
+	close(fd);
+	rejected = !snmp_mib_cache_open(&cache, filename) && errno == EINVAL;
+	snmp_mib_cache_close(&cache);
+	return rejected;
+}
+
+int main(void) {
+	char filename[] = "/tmp/test_check_snmp_mib.XXXXXX";
+	snmp_mib_cache cache;
+	snmp_oid oid;
+	size_t count = 0;
+	uint32_t strings_size;
+	int fd = mkstemp(filename);
+
+	plan_tests(15);
+
+	close(fd);
+	ok(snmp_mib_cache_build(tree, sizeof(tree) / sizeof(tree[0]), filename, &count) && count == 21, "Cache of %zu objects built", count);
+	ok(snmp_mib_cache_open(&cache, filename), "Cache mapped");
+
+	ok(translates_to(&cache, "sysUpTime.0", "1.3.6.1.2.1.1.3.0"), "Name and instance");
+	ok(translates_to(&cache, "IF-MIB::ifInOctets.12", "1.3.6.1.2.1.2.2.1.10.12"), "Name of a module");
+	ok(translates_to(&cache, "sysUpTimeInstance", "1.3.6.1.2.1.1.3.0") && translates_to(&cache, "mib-2", "1.3.6.1.2.1") &&
+		   translates_to(&cache, "ucdavis.4.1", "1.3.6.1.4.1.2021.4.1"),
+	   "Nodes at every depth");
+	ok(translates_to(&cache, ".1.3.6.1.2.1.1.5.0", "1.3.6.1.2.1.1.5.0"), "Numeric OIDs as they are");
+	ok(!snmp_mib_cache_translate(&cache, "ifInOctet.1", &oid) && !snmp_mib_cache_translate(&cache, "ifInOctets.x", &oid) &&
+		   !snmp_mib_cache_translate(&cache, "ifInOctets.1.", &oid) && !snmp_mib_cache_translate(&cache, "zzz", &oid),
+	   "Unknown names and bad instances");
+
+	snmp_oid_parse("1.3.6.1.2.1.2.2.1.10.3", &oid);
+	ok(strcmp(snmp_mib_cache_type(&cache, &oid), "Counter") == 0, "Type of an instance");
+	snmp_oid_parse("1.3.6.1.2.1.2", &oid);
+	ok(strcmp(snmp_mib_cache_type(&cache, &oid), "") == 0, "No type for a node of the tree");
+
+	snmp_oid_parse("1.3.6.1.2.1.2.2.1.8.5", &oid);
+	ok(strcmp(snmp_mib_cache_enum(&cache, &oid, 2), "down") == 0, "Enumerated value");
+	ok(strcmp(snmp_mib_cache_enum(&cache, &oid, 7), "lowerLayerDown") == 0, "Value of a continued line");
+	ok(snmp_mib_cache_enum(&cache, &oid, 9) == NULL, "Value without a label");
+	snmp_mib_cache_close(&cache);
+
+	ok(rejected_with(filename, 24, 0xffffff00) && rejected_with(filename, 24 + 8, 0xfffffff0) &&
+		   rejected_with(filename, 24 + 12, SNMP_MAX_OID_LENGTH + 1) && rejected_with(filename, 24 + 20, 1000) &&
+		   rejected_with(filename, 24 + 21 * 24, 21),
+	   "Offsets and lengths outside the file rejected");
+	snmp_mib_cache_build(tree, sizeof(tree) / sizeof(tree[0]), filename, &count);
+	fd = open(filename, O_WRONLY | O_APPEND);
+	write(fd, "x", 1);
+	close(fd);
+	fd = open(filename, O_RDWR);
+	pread(fd, &strings_size, sizeof(strings_size), 20);
+	strings_size++;
+	pwrite(fd, &strings_size, sizeof(strings_size), 20);
+	close(fd);
+	ok(!snmp_mib_cache_open(&cache, filename) && errno == EINVAL, "Unterminated strings rejected");
+
+	/* the tree itself is not a cache */
+	fd = open(filename, O_WRONLY | O_TRUNC);
+	write(fd, tree[0], strlen(tree[0]));
+	close(fd);
+	ok(!snmp_mib_cache_open(&cache, filename) && errno == EINVAL, "Other files rejected");
+
+	unlink(filename);
+	return exit_status();
+}
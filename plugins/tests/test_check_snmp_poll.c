@@ -0,0 +1,141 @@
+
+#include "../check_snmp.d/ber.h"
+#include "../check_snmp.d/poller.h"
+#include "../../tap/tap.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#define AGENTS 8
+#define DELAY_MS 300
+
+/* Answers after a delay with the number of the agent as a Gauge32, or
+ * never if it is silent */
+static void agent(int fd, unsigned int number, bool silent) {
+	uint8_t buffer[SNMP_MAX_MESSAGE];
+	uint8_t answer[SNMP_MAX_MESSAGE];
+	snmp_varbind varbinds[4];
+	snmp_pdu pdu = {.varbinds = varbinds};
+	struct sockaddr_storage peer;
+	socklen_t peer_length;
+
+	for (;;) {
+		ssize_t received;
+		size_t length;
+
+		peer_length = sizeof(peer);
+		received = recvfrom(fd, buffer, sizeof(buffer), 0, (struct sockaddr *)&peer, &peer_length);
+		if (received <= 0 || !snmp_decode(buffer, (size_t)received, &pdu, 4))
+			_exit(1);
+		if (silent)
+			continue;
+		usleep(DELAY_MS * 1000);
+		pdu.type = SNMP_PDU_RESPONSE;
+		for (size_t i = 0; i < pdu.nof_varbinds; i++)
+			varbinds[i].value = (snmp_value){.type = SNMP_GAUGE32, .counter = number};
+		length = snmp_encode(&pdu, answer, sizeof(answer));
+		sendto(fd, answer, length, 0, (struct sockaddr *)&peer, peer_length);
+	}
+}
+
+static int bind_loopback(unsigned short *port) {
+	struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = 0};
+	socklen_t length = sizeof(address);
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+		getsockname(fd, (struct sockaddr *)&address, &length) != 0)
+		return -1;
+	*port = ntohs(address.sin_port);
+	return fd;
+}
+
+int main(void) {
+	snmp_poller poller = {.version = SNMP_VERSION_2C, .community = "public", .timeout = 1, .retries = 1, .family = AF_INET, .port = "161"};
+	snmp_poller bounded = poller;
+	snmp_varbind requested[2];
+	snmp_pdu request = {.type = SNMP_PDU_GET, .varbinds = requested, .nof_varbinds = 2};
+	char hosts[AGENTS][32];
+	pid_t children[AGENTS];
+	struct timespec start;
+	struct timespec end;
+	double seconds;
+	bool values = true;
+	int started = 0;
+
+	plan_tests(9);
+
+	snmp_oid_parse("1.3.6.1.2.1.1.3.0", &requested[0].oid);
+	snmp_oid_parse("1.3.6.1.2.1.1.5.0", &requested[1].oid);
+	requested[0].value.type = requested[1].value.type = SNMP_NULL;
+
+	/* the last agent never answers */
+	for (int i = 0; i < AGENTS; i++) {
+		unsigned short port;
+		int fd = bind_loopback(&port);
+
+		if (fd < 0 || (children[i] = fork()) < 0)
+			break;
+		if (children[i] == 0)
+			agent(fd, (unsigned int)i, i == AGENTS - 1);
+		close(fd);
+		snprintf(hosts[i], sizeof(hosts[i]), "127.0.0.1:%u", port);
+		snmp_poller_add(&poller, hosts[i]);
+		started++;
+	}
+	snmp_poller_add(&poller, "no-such-host.invalid");
+
+	if (started < AGENTS) {
+		skip(9, "could not start the agents on the loopback interface");
+	} else {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		ok(snmp_poller_run(&poller, &request, 2), "Agents polled");
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1.0e9;
+
+		for (int i = 0; i < AGENTS - 1; i++) {
+			const snmp_target *target = &poller.targets[i];
+
+			values = values && target->state == SNMP_TARGET_ANSWERED && target->response.nof_varbinds == 2 &&
+					 target->response.varbinds[1].value.type == SNMP_GAUGE32 && target->response.varbinds[1].value.counter == (uint64_t)i;
+		}
+		ok(values, "Every agent answered with its own values");
+		ok(poller.targets[0].attempts == 1 && poller.targets[0].seconds >= DELAY_MS / 1000.0, "Round trip of an answer (%.3fs)",
+		   poller.targets[0].seconds);
+		ok(poller.targets[AGENTS - 1].state == SNMP_TARGET_FAILED && poller.targets[AGENTS - 1].attempts == 2 &&
+			   strstr(poller.targets[AGENTS - 1].error, "Timeout") != NULL,
+		   "Silent agent timed out after a retry");
+		ok(poller.targets[AGENTS].state == SNMP_TARGET_FAILED && poller.targets[AGENTS].attempts == 0, "Unknown host not queried");
+		/* sequentially the answers would add AGENTS * DELAY_MS to that */
+		ok(seconds < 2.0 + AGENTS * DELAY_MS / 1000.0 / 2, "As long as the slowest agent (%.2fs)", seconds);
+		ok(seconds >= 2.0, "Which is the silent one, with its retry");
+
+		/* a deadline before the silent agent has timed out */
+		snmp_poller_add(&bounded, hosts[0]);
+		snmp_poller_add(&bounded, hosts[AGENTS - 1]);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		bounded.deadline = start;
+		bounded.deadline.tv_nsec += 500000000;
+		if (bounded.deadline.tv_nsec >= 1000000000) {
+			bounded.deadline.tv_sec++;
+			bounded.deadline.tv_nsec -= 1000000000;
+		}
+		snmp_poller_run(&bounded, &request, 2);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1.0e9;
+		ok(bounded.targets[0].state == SNMP_TARGET_ANSWERED && bounded.targets[1].state == SNMP_TARGET_FAILED,
+		   "Silent agent failed at the deadline");
+		ok(seconds >= 0.5 && seconds < 1.0, "Run ended at the deadline (%.2fs)", seconds);
+	}
+
+	for (int i = 0; i < started; i++) {
+		kill(children[i], SIGTERM);
+		waitpid(children[i], NULL, 0);
+	}
+	snmp_poller_free(&poller);
+	snmp_poller_free(&bounded);
+	return exit_status();
+}
@@ -0,0 +1,92 @@
+
+#include "../check_snmp.d/rate.h"
+#include "../../tap/tap.h"
+
+/* The rate of key from the samples of previous to those of current */
+static snmp_rate_result rate_of(snmp_rate_state *previous, const snmp_rate_state *current, const char *key, double *rate) {
+	for (size_t s = 0; s < current->nof_samples; s++) {
+		if (strcmp(current->samples[s].key, key) == 0)
+			return snmp_rate(previous, current, &current->samples[s], rate);
+	}
+	return SNMP_RATE_NO_PREVIOUS;
+}
+
+int main(void) {
+	snmp_rate_state previous;
+	snmp_rate_state current;
+	snmp_rate_state parsed;
+	snmp_rate_kind kind;
+	uint64_t value;
+	double rate = 0;
+	char *text;
+
+	plan_tests(18);
+
+	/* the state file */
+	memset(&previous, 0, sizeof(previous));
+	previous.has_uptime = true;
+	previous.uptime = 4200;
+	snmp_rate_add(&previous, "1", SNMP_RATE_COUNTER64, UINT64_MAX - 99999);
+	snmp_rate_add(&previous, "0", SNMP_RATE_COUNTER32, 4294967000U);
+	snmp_rate_add(&previous, "2.10", SNMP_RATE_GAUGE, (uint64_t)-5);
+	text = snmp_rate_format(&previous);
+	ok(strcmp(text, "uptime=4200 1=C18446744073709451616 0=c4294967000 2.10=g-5") == 0, "State as text (%s)", text);
+	ok(snmp_rate_parse(&parsed, text, 1000) && parsed.has_uptime && parsed.uptime == 4200 && parsed.nof_samples == 3 && parsed.sorted,
+	   "State read back");
+	ok(strcmp(parsed.samples[0].key, "0") == 0 && parsed.samples[1].value == UINT64_MAX - 99999 &&
+		   (int64_t)parsed.samples[2].value == -5 && parsed.samples[2].kind == SNMP_RATE_GAUGE,
+	   "Every bit of a Counter64 kept");
+	free(text);
+	snmp_rate_free(&previous);
+	ok(!snmp_rate_parse(&previous, "1:2:3:", 1000), "State of an older version ignored");
+	snmp_rate_free(&previous);
+
+	/* values as snmpget prints them */
+	ok(snmp_rate_value("IF-MIB::ifHCInOctets.1 = Counter64: 18446744073709551615", &kind, &value) && kind == SNMP_RATE_COUNTER64 &&
+		   value == UINT64_MAX,
+	   "Counter64 parsed exactly");
+	ok(snmp_rate_value("IF-MIB::ifInOctets.1 = Counter32: 17", &kind, &value) && kind == SNMP_RATE_COUNTER32 && value == 17,
+	   "Counter32 parsed");
+	ok(snmp_rate_value("DISMAN-EVENT-MIB::sysUpTimeInstance = Timeticks: (4200) 0:00:42.00", &kind, &value) && kind == SNMP_RATE_GAUGE &&
+		   value == 4200,
+	   "Timeticks parsed as hundredths");
+	ok(snmp_rate_value("UCD-SNMP-MIB::laLoadInt.1 = INTEGER: -12", &kind, &value) && (int64_t)value == -12, "Negative INTEGER parsed");
+	ok(!snmp_rate_value("SNMPv2-MIB::sysName.0 = STRING: router", &kind, &value), "No number in a string");
+
+	/* 60 seconds later, by the clock and the agent */
+	memset(&current, 0, sizeof(current));
+	current.time = 1060;
+	current.has_uptime = true;
+	current.uptime = 4200 + 6000;
+	snmp_rate_add(&current, "0", SNMP_RATE_COUNTER32, 704);
+	snmp_rate_add(&current, "1", SNMP_RATE_COUNTER64, UINT64_MAX - 39999);
+	snmp_rate_add(&current, "2.10", SNMP_RATE_GAUGE, 55);
+	snmp_rate_add(&current, "3", SNMP_RATE_COUNTER32, 1);
+	ok(rate_of(&parsed, &current, "0", &rate) == SNMP_RATE_VALID && rate == 1000.0 / 60.0, "Counter32 wrapped around (%g)", rate);
+	ok(rate_of(&parsed, &current, "1", &rate) == SNMP_RATE_VALID && rate == 1000.0, "Counter64 near its end (%g)", rate);
+	ok(rate_of(&parsed, &current, "2.10", &rate) == SNMP_RATE_VALID && rate == 1.0, "Gauge from a negative value (%g)", rate);
+	ok(rate_of(&parsed, &current, "3", &rate) == SNMP_RATE_NO_PREVIOUS, "No rate of a new sample");
+
+	current.samples[1].value = 5;
+	ok(rate_of(&parsed, &current, "1", &rate) == SNMP_RATE_RESET, "A lower Counter64 was reset");
+
+	/* the agent restarted 10 seconds ago */
+	current.uptime = 1000;
+	ok(rate_of(&parsed, &current, "0", &rate) == SNMP_RATE_RESET, "A Counter32 after a restart was reset");
+
+	/* its uptime wrapped around after 497 days */
+	parsed.uptime = UINT32_MAX - 999;
+	current.uptime = 5000;
+	ok(rate_of(&parsed, &current, "2.10", &rate) == SNMP_RATE_VALID && rate == 1.0, "Uptime wrapped around (%g)", rate);
+
+	/* no uptime, the clock */
+	current.has_uptime = false;
+	current.time = 1030;
+	ok(rate_of(&parsed, &current, "2.10", &rate) == SNMP_RATE_VALID && rate == 2.0, "Rate by the clock without uptime (%g)", rate);
+	current.time = 1000;
+	ok(rate_of(&parsed, &current, "2.10", &rate) == SNMP_RATE_NO_TIME, "No rate without time passing");
+
+	snmp_rate_free(&current);
+	snmp_rate_free(&parsed);
+	return exit_status();
+}
@@ -0,0 +1,217 @@
+
+#include "../check_snmp.d/ber.h"
+#include "../check_snmp.d/session.h"
+#include "../check_snmp.d/table.h"
+#include "../../tap/tap.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#define ROWS           300
+#define AGENT_VARBINDS 40 /* more in a response are tooBig */
+
+/* ifName and ifHCInOctets of every row, ifHCInUcastPkts.1 after them and
+ * ifAlias of the even rows last */
+static snmp_varbind mib[ROWS * 2 + 1 + ROWS / 2];
+static size_t mib_length;
+static char names[ROWS + 1][16];
+
+static void mib_add(const char *column, unsigned int row, snmp_value value) {
+	char oid[64];
+
+	snprintf(oid, sizeof(oid), "%s.%u", column, row);
+	snmp_oid_parse(oid, &mib[mib_length].oid);
+	mib[mib_length++].value = value;
+}
+
+static void mib_build(void) {
+	for (unsigned int r = 1; r <= ROWS; r++) {
+		snprintf(names[r], sizeof(names[r]), "eth%u", r);
+		mib_add("1.3.6.1.2.1.31.1.1.1.1", r, (snmp_value){.type = SNMP_OCTET_STRING, .bytes = (uint8_t *)names[r], .length = strlen(names[r])});
+	}
+	for (unsigned int r = 1; r <= ROWS; r++)
+		mib_add("1.3.6.1.2.1.31.1.1.1.6", r, (snmp_value){.type = SNMP_COUNTER64, .counter = r * 1000ULL});
+	mib_add("1.3.6.1.2.1.31.1.1.1.7", 1, (snmp_value){.type = SNMP_COUNTER64, .counter = 1});
+	for (unsigned int r = 2; r <= ROWS; r += 2)
+		mib_add("1.3.6.1.2.1.31.1.1.1.18", r, (snmp_value){.type = SNMP_OCTET_STRING, .bytes = (const uint8_t *)"uplink", .length = 6});
+}
+
+/* The first varbind of the MIB after oid, NULL at its end */
+static const snmp_varbind *mib_next(const snmp_oid *oid) {
+	for (size_t i = 0; i < mib_length; i++) {
+		if (snmp_oid_compare(&mib[i].oid, oid) > 0)
+			return &mib[i];
+	}
+	return NULL;
+}
+
+/* Answers GETNEXT as an SNMP v1 agent does and GETBULK as a v2c one */
+static void agent(int fd) {
+	uint8_t buffer[SNMP_MAX_MESSAGE];
+	uint8_t answer[SNMP_MAX_MESSAGE];
+	snmp_varbind requested[8];
+	snmp_varbind varbinds[256];
+	snmp_pdu request = {.varbinds = requested};
+	struct sockaddr_storage peer;
+	socklen_t peer_length;
+
+	for (;;) {
+		snmp_pdu response;
+		ssize_t received;
+		size_t length;
+
+		peer_length = sizeof(peer);
+		received = recvfrom(fd, buffer, sizeof(buffer), 0, (struct sockaddr *)&peer, &peer_length);
+		if (received <= 0 || !snmp_decode(buffer, (size_t)received, &request, 8))
+			_exit(1);
+		response = request;
+		response.type = SNMP_PDU_RESPONSE;
+		response.error_status = response.error_index = 0;
+		response.varbinds = varbinds;
+		response.nof_varbinds = 0;
+
+		if (request.type == SNMP_PDU_GETNEXT) {
+			for (size_t k = 0; k < request.nof_varbinds; k++) {
+				const snmp_varbind *next = mib_next(&requested[k].oid);
+
+				if (next == NULL) {
+					response.error_status = 2; /* noSuchName */
+					response.error_index = (int32_t)k + 1;
+					response.varbinds = requested;
+					response.nof_varbinds = request.nof_varbinds;
+					break;
+				}
+				varbinds[response.nof_varbinds++] = *next;
+			}
+		} else {
+			for (int32_t r = 0; r < request.error_index; r++) {
+				for (size_t k = 0; k < request.nof_varbinds && response.nof_varbinds < 256; k++) {
+					const snmp_varbind *next = mib_next(&requested[k].oid);
+					snmp_varbind *varbind = &varbinds[response.nof_varbinds++];
+
+					if (next == NULL) {
+						varbind->oid = requested[k].oid;
+						varbind->value = (snmp_value){.type = SNMP_END_OF_MIB_VIEW};
+					} else {
+						*varbind = *next;
+						requested[k].oid = next->oid;
+					}
+				}
+			}
+			if (response.nof_varbinds > AGENT_VARBINDS) {
+				response.error_status = 1; /* tooBig */
+				response.varbinds = requested;
+				response.nof_varbinds = 0;
+			}
+		}
+		length = snmp_encode(&response, answer, sizeof(answer));
+		sendto(fd, answer, length, 0, (struct sockaddr *)&peer, peer_length);
+	}
+}
+
+static int bind_loopback(char *port, size_t size) {
+	struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = 0};
+	socklen_t length = sizeof(address);
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+		getsockname(fd, (struct sockaddr *)&address, &length) != 0)
+		return -1;
+	snprintf(port, size, "%u", ntohs(address.sin_port));
+	return fd;
+}
+
+/* Every row has its name and counter, the even ones their alias */
+static bool rows_joined(const snmp_table *table) {
+	for (size_t r = 0; r < table->nof_rows; r++) {
+		const snmp_row *row = &table->rows[r];
+
+		if (row->index_length != 1 || row->index[0] != r + 1 || !row->cells[0].present || strcmp(row->cells[0].text, names[r + 1]) != 0 ||
+			!row->cells[1].is_number || row->cells[1].number != (r + 1) * 1000.0 || row->cells[2].present != (r % 2 == 1)) {
+			diag("row %zu is not as expected", r + 1);
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(void) {
+	static snmp_session session;
+	snmp_oid columns[3];
+	snmp_table table;
+	snmp_varbind varbind;
+	char text[64];
+	char port[16];
+	pid_t child;
+	int fd;
+
+	plan_tests(12);
+
+	mib_build();
+	snmp_oid_parse("1.3.6.1.2.1.31.1.1.1.1", &columns[0]);
+	snmp_oid_parse("1.3.6.1.2.1.31.1.1.1.6", &columns[1]);
+	snmp_oid_parse("1.3.6.1.2.1.31.1.1.1.18", &columns[2]);
+
+	/* the rows of cells coming in any order */
+	snmp_table_init(&table, columns, 3);
+	snmp_table_add(&table, 1, &mib[ROWS + 2]);
+	snmp_table_add(&table, 0, &mib[0]);
+	snmp_table_add(&table, 1, &mib[ROWS]);
+	snmp_table_add(&table, 0, &mib[2]);
+	ok(table.nof_rows == 2 && table.rows[0].index[0] == 1 && table.rows[1].index[0] == 3, "Rows in the order of their index");
+	ok(table.rows[0].cells[0].present && table.rows[0].cells[1].present && !table.rows[0].cells[2].present,
+	   "Cells joined by index");
+	ok(strcmp(table.rows[1].cells[0].text, "eth3") == 0 && table.rows[1].cells[1].type == SNMP_COUNTER64 &&
+		   table.rows[1].cells[1].number == 3000.0 && strcmp(table.rows[1].cells[1].text, "3000") == 0,
+	   "Values without their type and quotes");
+	ok(!snmp_table_add(&table, 0, &mib[ROWS]), "Varbind of another column rejected");
+	snmp_oid_parse("1.3.6.1.2.1.31.1.1.1.1.10.20.30", &varbind.oid);
+	varbind.value = (snmp_value){.type = SNMP_INTEGER, .integer = 7};
+	snmp_table_add(&table, 0, &varbind);
+	snmp_table_index_format(&table.rows[2], text, sizeof(text));
+	ok(strcmp(text, "10.20.30") == 0, "Index of several sub-identifiers (%s)", text);
+	snmp_table_free(&table);
+
+	/* a stand-in for snmpd */
+	fd = bind_loopback(port, sizeof(port));
+	if (fd < 0 || (child = fork()) < 0) {
+		skip(7, "could not start an agent on the loopback interface");
+		return exit_status();
+	}
+	if (child == 0)
+		agent(fd);
+	close(fd);
+
+	session.version = SNMP_VERSION_2C;
+	session.community = "public";
+	session.timeout = 1;
+	session.retries = 1;
+	snmp_session_open(&session, "127.0.0.1", port, AF_INET);
+	snmp_table_init(&table, columns, 3);
+	ok(snmp_table_walk(&table, &session, SNMP_TABLE_MAX_REPETITIONS), "Table walked with GETBULK");
+	ok(table.nof_rows == ROWS && rows_joined(&table), "All rows, up to the next column");
+	/* 25 rows of 3 columns are tooBig, 12 of them are not: 1 + 13 requests
+	 * until ifAlias ends and 13 for the other 144 rows and their end */
+	ok(table.requests == 27, "Repetitions halved once the agent answered tooBig (%u requests)", table.requests);
+	snmp_table_free(&table);
+
+	session.version = SNMP_VERSION_1;
+	snmp_table_init(&table, columns, 3);
+	ok(snmp_table_walk(&table, &session, SNMP_TABLE_MAX_REPETITIONS), "Table walked with GETNEXT");
+	ok(table.nof_rows == ROWS && rows_joined(&table), "The same rows, past noSuchName at the end of the MIB");
+	ok(table.requests == ROWS + 2, "One request per row (%u requests)", table.requests);
+	snmp_table_free(&table);
+	snmp_session_close(&session);
+
+	kill(child, SIGTERM);
+	waitpid(child, NULL, 0);
+	snmp_table_init(&table, columns, 1);
+	session.retries = 0;
+	snmp_session_open(&session, "127.0.0.1", port, AF_INET);
+	ok(!snmp_table_walk(&table, &session, 10) && table.error != NULL, "Walk fails without an agent (%s)", table.error);
+	snmp_session_close(&session);
+	return exit_status();
+}
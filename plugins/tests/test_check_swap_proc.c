@@ -0,0 +1,97 @@
+
+#include "../check_swap.d/proc.h"
+#include "../../tap/tap.h"
+
+static void write_file(const char *filename, const char *text) {
+	FILE *fp = fopen(filename, "w");
+
+	if (fp != NULL) {
+		fputs(text, fp);
+		fclose(fp);
+	}
+}
+
+int main(void) {
+	static const char *const names[SWAP_PROC_KEY_COUNT] = {"SwapTotal", "SwapFree", "SwapCached", "Swap", "pswpin", "pswpout"};
+	swap_proc_values values;
+	swap_activity activity;
+	bool all_found = true;
+	char state[64];
+	char directory[] = "/tmp/check_swap_XXXXXX";
+	char vmstat_file[64];
+	char pressure_file[64];
+
+	plan_tests(18);
+
+	for (int key = 0; key < SWAP_PROC_KEY_COUNT; key++) {
+		if (swap_proc_key_lookup(names[key], strlen(names[key])) != key)
+			all_found = false;
+	}
+	ok(all_found, "Every name found in its slot");
+	ok(swap_proc_key_lookup("SwapTotals", 9) == SWAP_PROC_SWAP_TOTAL, "Name of the given length only");
+	ok(swap_proc_key_lookup("MemTotal", 8) == -1 && swap_proc_key_lookup("pswpout", 6) == -1 && swap_proc_key_lookup("", 0) == -1,
+	   "Other names not found");
+	ok(swap_proc_key_lookup("pgpgin", 6) == -1 && swap_proc_key_lookup("SwapTotaX", 9) == -1, "Name of a taken slot not found");
+
+	memset(&values, 0, sizeof(values));
+	swap_proc_parse("MemTotal:       16318764 kB\nSwapCached:         1024 kB\nSwapTotal:      33431548 kB\nSwapFree:       33430524 kB\n",
+					&values);
+	ok(values.found[SWAP_PROC_SWAP_TOTAL] && values.values[SWAP_PROC_SWAP_TOTAL] == 34233905152ULL, "SwapTotal in bytes");
+	ok(values.values[SWAP_PROC_SWAP_FREE] == 34232856576ULL && values.values[SWAP_PROC_SWAP_CACHED] == 1048576,
+	   "SwapFree and SwapCached in bytes");
+	ok(!values.found[SWAP_PROC_SWAP] && !values.found[SWAP_PROC_PSWPIN], "Nothing else found");
+
+	memset(&values, 0, sizeof(values));
+	swap_proc_parse("nr_free_pages 12345\npgpgin 999\npswpin 42\npswpout 4711\nswap_ra 7", &values);
+	ok(values.found[SWAP_PROC_PSWPIN] && values.values[SWAP_PROC_PSWPIN] == 42 && values.values[SWAP_PROC_PSWPOUT] == 4711,
+	   "Paging counters of vmstat");
+
+	memset(&values, 0, sizeof(values));
+	swap_proc_parse("Swap: 1000 300 700\n", &values);
+	ok(values.found[SWAP_PROC_SWAP] && values.values[SWAP_PROC_SWAP] == 1000 && values.swap_used == 300 && values.swap_free == 700,
+	   "Swap line of old kernels");
+
+	memset(&activity, 0, sizeof(activity));
+	ok(swap_parse_memory_pressure("some avg10=12.50 avg60=3.00 avg300=1.00 total=99\nfull avg10=2.25 avg60=0.50 avg300=0.10 total=9\n",
+								  &activity) &&
+		   activity.has_pressure && activity.pressure_some == 12.5 && activity.pressure_full == 2.25,
+	   "Memory pressure decoded");
+	memset(&activity, 0, sizeof(activity));
+	ok(!swap_parse_memory_pressure("full avg10=2.25 avg60=0.50 avg300=0.10 total=9\n", &activity) && !activity.has_pressure,
+	   "No some line");
+
+	memset(&activity, 0, sizeof(activity));
+	activity.has_pages = true;
+	activity.pswpin = 1600;
+	activity.pswpout = 400;
+	swap_activity_rates(&activity, "pswpin=1000 pswpout=100", 1000, 1060);
+	ok(activity.has_rates && activity.swapin_rate == 10.0 && activity.swapout_rate == 5.0, "Rates over a minute (%.1f, %.1f)",
+	   activity.swapin_rate, activity.swapout_rate);
+	swap_activity_rates(&activity, NULL, 0, 1060);
+	ok(!activity.has_rates, "No rates without state");
+	swap_activity_rates(&activity, "pswpin=2000 pswpout=100", 1000, 1060);
+	ok(!activity.has_rates, "No rates after a reboot");
+	swap_activity_rates(&activity, "pswpin=1000 pswpout=100", 1060, 1060);
+	ok(!activity.has_rates, "No rates without time passed");
+	swap_activity_format(&activity, state, sizeof(state));
+	ok(strcmp(state, "pswpin=1600 pswpout=400") == 0, "State of the counters");
+
+	if (mkdtemp(directory) == NULL) {
+		skip(2, "could not create a directory for the fixture");
+	} else {
+		snprintf(vmstat_file, sizeof(vmstat_file), "%s/vmstat", directory);
+		snprintf(pressure_file, sizeof(pressure_file), "%s/memory", directory);
+		write_file(vmstat_file, "pgpgout 5\npswpin 7\npswpout 9\n");
+		write_file(pressure_file, "some avg10=1.00 avg60=0.00 avg300=0.00 total=1\nfull avg10=0.50 avg60=0.00 avg300=0.00 total=1\n");
+		swap_activity_read(&activity, vmstat_file, pressure_file);
+		ok(activity.has_pages && activity.pswpin == 7 && activity.pswpout == 9 && activity.has_pressure && activity.pressure_full == 0.5,
+		   "Activity read from the files");
+		unlink(pressure_file);
+		unlink(vmstat_file);
+		swap_activity_read(&activity, vmstat_file, pressure_file);
+		ok(!activity.has_pages && !activity.has_pressure, "No activity without the files");
+		rmdir(directory);
+	}
+
+	return exit_status();
+}